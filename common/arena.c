@@ -0,0 +1,150 @@
+#include "common/arena.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define ARENA_DEFAULT_CHUNK 4096
+#define ARENA_ALIGN 8
+
+typedef struct ArenaChunk {
+    struct ArenaChunk *next;
+    size_t cap;
+    size_t used;
+    char data[];
+} ArenaChunk;
+
+struct Arena {
+    ArenaChunk *head;        // 当前分配块
+    size_t chunkSize;
+    size_t bytes;
+    const char **strs;       // 去重表（开放寻址，NULL 为空槽），表本身在堆上
+    size_t strCap;
+    size_t strCount;
+};
+
+static ArenaChunk *chunk_new(size_t cap) {
+    ArenaChunk *c = malloc(sizeof(ArenaChunk) + cap);
+    if (!c) return NULL;
+    c->next = NULL;
+    c->cap = cap;
+    c->used = 0;
+    return c;
+}
+
+Arena *arena_new(size_t chunkSize) {
+    Arena *arena = calloc(1, sizeof(Arena));
+    if (!arena) return NULL;
+    arena->chunkSize = chunkSize ? chunkSize : ARENA_DEFAULT_CHUNK;
+    return arena;
+}
+
+void arena_free(Arena *arena) {
+    if (!arena) return;
+    ArenaChunk *c = arena->head;
+    while (c) {
+        ArenaChunk *next = c->next;
+        free(c);
+        c = next;
+    }
+    free(arena->strs);
+    free(arena);
+}
+
+void *arena_alloc(Arena *arena, size_t size) {
+    if (!arena) return NULL;
+    if (size == 0) size = 1;
+    if (size > SIZE_MAX - ARENA_ALIGN) return NULL;
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    ArenaChunk *c = arena->head;
+    if (!c || c->cap - c->used < size) {
+        // 大块单独分配并挂在当前块之后，不浪费当前块剩余空间
+        if (c && size > arena->chunkSize / 4) {
+            ArenaChunk *big = chunk_new(size);
+            if (!big) return NULL;
+            big->used = size;
+            big->next = c->next;
+            c->next = big;
+            arena->bytes += size;
+            memset(big->data, 0, size);
+            return big->data;
+        }
+        c = chunk_new(size > arena->chunkSize ? size : arena->chunkSize);
+        if (!c) return NULL;
+        c->next = arena->head;
+        arena->head = c;
+        arena->bytes += c->cap;
+    }
+    void *p = c->data + c->used;
+    c->used += size;
+    memset(p, 0, size);
+    return p;
+}
+
+void *arena_calloc(Arena *arena, size_t n, size_t size) {
+    if (size && n > SIZE_MAX / size) return NULL;
+    return arena_alloc(arena, n * size);
+}
+
+static size_t str_hash(const char *s) {
+    size_t h = 2166136261u;   // FNV-1a
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int strs_grow(Arena *arena) {
+    size_t cap = arena->strCap ? arena->strCap * 2 : 32;
+    const char **slots = calloc(cap, sizeof(char*));
+    if (!slots) return -1;
+    for (size_t i = 0; i < arena->strCap; i++) {
+        const char *s = arena->strs[i];
+        if (!s) continue;
+        size_t h = str_hash(s) & (cap - 1);
+        while (slots[h]) h = (h + 1) & (cap - 1);
+        slots[h] = s;
+    }
+    free(arena->strs);
+    arena->strs = slots;
+    arena->strCap = cap;
+    return 0;
+}
+
+char *arena_strdup(Arena *arena, const char *s) {
+    if (!arena || !s) return NULL;
+    // 负载超过一半时扩容；扩容失败则不去重，直接复制
+    int dedup = arena->strCount * 2 < arena->strCap || strs_grow(arena) == 0;
+    size_t h = 0;
+    if (dedup) {
+        h = str_hash(s) & (arena->strCap - 1);
+        while (arena->strs[h]) {
+            if (strcmp(arena->strs[h], s) == 0) return (char*)arena->strs[h];
+            h = (h + 1) & (arena->strCap - 1);
+        }
+    }
+    size_t len = strlen(s) + 1;
+    char *copy = arena_alloc(arena, len);
+    if (!copy) return NULL;
+    memcpy(copy, s, len);
+    if (dedup) {
+        arena->strs[h] = copy;
+        arena->strCount++;
+    }
+    return copy;
+}
+
+const char *arena_find(const Arena *arena, const char *s) {
+    if (!arena || !s || !arena->strCap) return NULL;
+    size_t h = str_hash(s) & (arena->strCap - 1);
+    while (arena->strs[h]) {
+        if (strcmp(arena->strs[h], s) == 0) return arena->strs[h];
+        h = (h + 1) & (arena->strCap - 1);
+    }
+    return NULL;
+}
+
+size_t arena_bytes(const Arena *arena) {
+    return arena ? arena->bytes : 0;
+}
@@ -0,0 +1,36 @@
+#ifndef COMMON_ARENA_H
+#define COMMON_ARENA_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 按块分配的 bump 分配器：只分配不单独释放，arena_free 一次释放全部
+// 字符串经 arena_strdup 去重（同一 arena 内内容相同返回同一指针），结果只读
+// 非线程安全，调用方负责串行化
+typedef struct Arena Arena;
+
+// chunkSize 为 0 时使用默认块大小
+Arena *arena_new(size_t chunkSize);
+void arena_free(Arena *arena);
+
+// 8 字节对齐、已清零；失败返回 NULL
+void *arena_alloc(Arena *arena, size_t size);
+void *arena_calloc(Arena *arena, size_t n, size_t size);
+
+// 复制并去重字符串；s 为 NULL 时返回 NULL
+char *arena_strdup(Arena *arena, const char *s);
+
+// 只查找已去重的字符串，不存在返回 NULL
+const char *arena_find(const Arena *arena, const char *s);
+
+// 已申请的块内存总量（字节）
+size_t arena_bytes(const Arena *arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COMMON_ARENA_H
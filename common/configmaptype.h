@@ -94,6 +94,8 @@ typedef struct Twin {
     DeviceProperty *property;   // Pointer to device property
     TwinProperty observedDesired; // Observed desired value
     TwinProperty reported;        // Reported value
+    int writing;                  // 有写入在锁外执行中（受 device->mutex 保护），避免重复下发
+    char *appliedDesired;         // reported 是按哪个 desired 写入的（desired 文本副本，NULL 表示无）；reported 变化时清空
 } Twin;
 
 // DeviceInstance stores detailed information about the device in the mapper.
@@ -111,6 +113,7 @@ typedef struct {
     DeviceMethod *methods;      // Array of device methods
     int methodsCount;           // Number of methods
     DeviceStatus status;        // Device status
+    struct Arena *arena;        // 非 NULL 时持有上述 spec 数据（twin 的 desired/reported 值除外）
 } DeviceInstance;
 
 // DeviceModel stores detailed information about the device model in the mapper.
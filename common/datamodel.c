@@ -1,4 +1,5 @@
 #include "common/datamodel.h"
+#include "common/intern.h"
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -10,17 +11,23 @@ static int64_t get_timestamp() {
 DataModel *datamodel_new(const char *deviceName, const char *propertyName, const char *namespace_) {
     DataModel *dm = (DataModel *)calloc(1, sizeof(DataModel));
     if (!dm) return NULL;
-    dm->deviceName = deviceName ? strdup(deviceName) : NULL;
-    dm->propertyName = propertyName ? strdup(propertyName) : NULL;
-    dm->namespace_ = namespace_ ? strdup(namespace_) : NULL;
+    // 名字在各采样间大量重复，驻留后只存指针
+    dm->deviceName = (char *)intern(deviceName);
+    dm->propertyName = (char *)intern(propertyName);
+    dm->namespace_ = (char *)intern(namespace_);
     dm->value = NULL;
     dm->type = NULL;
+    dm->interned = 1;
     dm->timeStamp = get_timestamp();
     return dm;
 }
 
 void datamodel_set_type(DataModel *dm, const char *type) {
     if (!dm) return;
+    if (dm->interned) {
+        dm->type = (char *)intern(type);
+        return;
+    }
     if (dm->type) free(dm->type);
     dm->type = type ? strdup(type) : NULL;
 }
@@ -43,10 +50,12 @@ void datamodel_set_timestamp_value(DataModel *dm, int64_t timestamp) {
 
 void datamodel_free(DataModel *dm) {
     if (!dm) return;
-    free(dm->deviceName);
-    free(dm->propertyName);
-    free(dm->namespace_);
+    if (!dm->interned) {
+        free(dm->deviceName);
+        free(dm->propertyName);
+        free(dm->namespace_);
+        free(dm->type);
+    }
     free(dm->value);
-    free(dm->type);
     free(dm);
 }
\ No newline at end of file
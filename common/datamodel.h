@@ -10,9 +10,10 @@ typedef struct DataModel {
     char *value;
     char *type;
     int64_t timeStamp;
+    int interned;        // 非 0 时 deviceName/propertyName/namespace_/type 为驻留字符串，不随 datamodel_free 释放
 } DataModel;
 
-// Create a new DataModel
+// Create a new DataModel; names are interned (see common/intern.h) instead of copied
 DataModel *datamodel_new(const char *deviceName, const char *propertyName, const char *namespace_);
 
 // Set type
@@ -0,0 +1,159 @@
+#include "common/epoch.h"
+#include <stdlib.h>
+#include <pthread.h>
+
+// 每个读者线程一条记录；记录只追加不释放，线程退出后标记空闲供后续线程复用
+typedef struct EpochReader {
+    unsigned long long epoch;   // 0 表示不在读侧临界区
+    int inUse;
+    struct EpochReader *next;
+} EpochReader;
+
+typedef struct EpochRetired {
+    void *ptr;
+    EpochFreeFn freeFn;
+    unsigned long long epoch;   // 退役时的纪元
+    struct EpochRetired *next;
+} EpochRetired;
+
+static unsigned long long g_epoch = 1;
+static EpochReader *g_readers = NULL;          // 通过原子操作追加
+static EpochRetired *g_retired = NULL;         // 受 g_retire_mutex 保护
+static pthread_mutex_t g_retire_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t g_reader_key;
+static pthread_once_t g_key_once = PTHREAD_ONCE_INIT;
+
+static __thread EpochReader *tls_reader = NULL;
+static __thread int tls_depth = 0;
+
+static void reader_release(void *arg) {
+    EpochReader *r = (EpochReader*)arg;
+    if (!r) return;
+    __atomic_store_n(&r->epoch, 0, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&r->inUse, 0, __ATOMIC_RELEASE);
+}
+
+static void make_key(void) {
+    pthread_key_create(&g_reader_key, reader_release);
+}
+
+static EpochReader *reader_get(void) {
+    if (tls_reader) return tls_reader;
+    pthread_once(&g_key_once, make_key);
+
+    // 先尝试复用已退出线程的记录
+    for (EpochReader *r = __atomic_load_n(&g_readers, __ATOMIC_ACQUIRE); r; r = r->next) {
+        int expected = 0;
+        if (__atomic_compare_exchange_n(&r->inUse, &expected, 1, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            tls_reader = r;
+            pthread_setspecific(g_reader_key, r);
+            return r;
+        }
+    }
+
+    EpochReader *r = calloc(1, sizeof(EpochReader));
+    if (!r) return NULL;
+    r->inUse = 1;
+    EpochReader *head = __atomic_load_n(&g_readers, __ATOMIC_ACQUIRE);
+    do {
+        r->next = head;
+    } while (!__atomic_compare_exchange_n(&g_readers, &head, r, 0,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+    tls_reader = r;
+    pthread_setspecific(g_reader_key, r);
+    return r;
+}
+
+void epoch_read_enter(void) {
+    if (tls_depth++ > 0) return;
+    EpochReader *r = reader_get();
+    if (!r) return;
+    // 先公布自己观察到的纪元，再读取共享指针（两者都需 SEQ_CST 保证顺序）
+    __atomic_store_n(&r->epoch, __atomic_load_n(&g_epoch, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+}
+
+void epoch_read_exit(void) {
+    if (tls_depth <= 0) return;
+    if (--tls_depth > 0) return;
+    if (tls_reader) __atomic_store_n(&tls_reader->epoch, 0, __ATOMIC_SEQ_CST);
+}
+
+// 所有活跃读者中最小的纪元；无活跃读者时返回 ~0
+static unsigned long long min_active_epoch(void) {
+    unsigned long long min = ~0ULL;
+    for (EpochReader *r = __atomic_load_n(&g_readers, __ATOMIC_ACQUIRE); r; r = r->next) {
+        unsigned long long e = __atomic_load_n(&r->epoch, __ATOMIC_SEQ_CST);
+        if (e != 0 && e < min) min = e;
+    }
+    return min;
+}
+
+// 把可回收节点摘到 *ready；释放函数由调用方在解锁后执行，允许其中再次 epoch_retire
+static void collect_locked(EpochRetired **ready) {
+    unsigned long long min = min_active_epoch();
+    EpochRetired **pp = &g_retired;
+    while (*pp) {
+        EpochRetired *n = *pp;
+        // 读者纪元 < 退役纪元，说明它可能在替换前读到了旧指针
+        if (n->epoch <= min) {
+            *pp = n->next;
+            n->next = *ready;
+            *ready = n;
+        } else {
+            pp = &n->next;
+        }
+    }
+}
+
+static int free_ready(EpochRetired *ready) {
+    int freed = 0;
+    while (ready) {
+        EpochRetired *n = ready;
+        ready = n->next;
+        if (n->freeFn) n->freeFn(n->ptr); else free(n->ptr);
+        free(n);
+        freed++;
+    }
+    return freed;
+}
+
+void epoch_retire(void *ptr, EpochFreeFn free_fn) {
+    if (!ptr) return;
+    EpochRetired *n = malloc(sizeof(EpochRetired));
+    if (!n) {
+        // 内存不足时无法安全延迟，宁可泄漏也不提前释放
+        return;
+    }
+    n->ptr = ptr;
+    n->freeFn = free_fn;
+    n->epoch = __atomic_add_fetch(&g_epoch, 1, __ATOMIC_SEQ_CST);
+
+    EpochRetired *ready = NULL;
+    pthread_mutex_lock(&g_retire_mutex);
+    n->next = g_retired;
+    g_retired = n;
+    collect_locked(&ready);
+    pthread_mutex_unlock(&g_retire_mutex);
+    free_ready(ready);
+}
+
+int epoch_reclaim(void) {
+    EpochRetired *ready = NULL;
+    pthread_mutex_lock(&g_retire_mutex);
+    collect_locked(&ready);
+    pthread_mutex_unlock(&g_retire_mutex);
+    return free_ready(ready);
+}
+
+void epoch_shutdown(void) {
+    // 释放函数可能再退役新的对象，循环直到清空
+    for (;;) {
+        pthread_mutex_lock(&g_retire_mutex);
+        EpochRetired *ready = g_retired;
+        g_retired = NULL;
+        pthread_mutex_unlock(&g_retire_mutex);
+        if (!ready) break;
+        free_ready(ready);
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef COMMON_EPOCH_H
+#define COMMON_EPOCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 基于纪元的延迟回收（EBR）
+// 读者：epoch_read_enter() / epoch_read_exit() 之间读取的共享指针保证不会被释放，读侧无锁
+// 写者：原子替换指针后调用 epoch_retire()，待所有可能看到旧指针的读者退出后再释放
+
+typedef void (*EpochFreeFn)(void *ptr);
+
+// 进入/退出读侧临界区（可嵌套，不可跨线程）
+void epoch_read_enter(void);
+void epoch_read_exit(void);
+
+// 延迟释放 ptr；free_fn 为 NULL 时使用 free()
+// free_fn 在内部锁之外调用，其中可以再次 epoch_retire（如释放设备时退役其快照）
+void epoch_retire(void *ptr, EpochFreeFn free_fn);
+
+// 尝试回收已无读者引用的对象，返回本次释放数量
+int epoch_reclaim(void);
+
+// 进程退出前调用：不再检查读者，直接释放全部待回收对象
+void epoch_shutdown(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COMMON_EPOCH_H
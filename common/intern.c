@@ -0,0 +1,49 @@
+#include "common/intern.h"
+#include "common/arena.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 驻留字符串存放在一个全局 arena 中，命中走读锁，只有首次出现时加写锁
+static pthread_rwlock_t g_intern_lock = PTHREAD_RWLOCK_INITIALIZER;
+static Arena *g_intern_arena = NULL;
+static size_t g_intern_count = 0;
+
+const char *intern_find(const char *s) {
+    if (!s) return NULL;
+    pthread_rwlock_rdlock(&g_intern_lock);
+    const char *p = arena_find(g_intern_arena, s);
+    pthread_rwlock_unlock(&g_intern_lock);
+    return p;
+}
+
+const char *intern(const char *s) {
+    if (!s) return NULL;
+    const char *p = intern_find(s);
+    if (p) return p;
+
+    pthread_rwlock_wrlock(&g_intern_lock);
+    if (!g_intern_arena) g_intern_arena = arena_new(0);
+    // 加写锁前可能已被其他线程插入，arena_strdup 本身会去重
+    p = arena_find(g_intern_arena, s);
+    if (!p) {
+        p = arena_strdup(g_intern_arena, s);
+        if (p) g_intern_count++;
+    }
+    pthread_rwlock_unlock(&g_intern_lock);
+    return p;
+}
+
+size_t intern_count(void) {
+    pthread_rwlock_rdlock(&g_intern_lock);
+    size_t n = g_intern_count;
+    pthread_rwlock_unlock(&g_intern_lock);
+    return n;
+}
+
+size_t intern_bytes(void) {
+    pthread_rwlock_rdlock(&g_intern_lock);
+    size_t n = arena_bytes(g_intern_arena);
+    pthread_rwlock_unlock(&g_intern_lock);
+    return n;
+}
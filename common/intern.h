@@ -0,0 +1,36 @@
+#ifndef COMMON_INTERN_H
+#define COMMON_INTERN_H
+
+#include <stddef.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 进程级字符串驻留表：内容相同的字符串返回同一只读指针，进程内永不释放
+// 用于命名空间、模型名、属性名、数据类型等大量重复的短名字，驻留后的两个名字可直接比较指针
+// 线程安全；不要驻留数量无上限的值（如采样值、时间戳）
+
+// 返回 s 的驻留指针；s 为 NULL 或内存不足时返回 NULL
+const char *intern(const char *s);
+
+// 只查不插：s 未驻留时返回 NULL（可据此判定某名字一定不存在于驻留数据中）
+const char *intern_find(const char *s);
+
+// 驻留字符串个数与占用内存（字节）
+size_t intern_count(void);
+size_t intern_bytes(void);
+
+// s 本身是驻留指针（而不是内容相同的副本）；释放可能已驻留的字段前据此判断
+#define intern_is(s) ((s) && intern_find(s) == (s))
+
+// 驻留名比较：指针相同必然相等，否则回退 strcmp（兼容未驻留的一侧）
+// 两侧都已驻留时直接比较指针：在入口处对探测值做一次 intern_find，扫描中只比指针
+#define intern_eq(a, b) ((a) == (b) || ((a) && (b) && strcmp((a), (b)) == 0))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COMMON_INTERN_H
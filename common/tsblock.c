@@ -0,0 +1,194 @@
+#include "common/tsblock.h"
+#include <stdlib.h>
+#include <string.h>
+
+static uint64_t double_bits(double v) {
+    uint64_t u;
+    memcpy(&u, &v, sizeof(u));
+    return u;
+}
+
+static double bits_double(uint64_t u) {
+    double v;
+    memcpy(&v, &u, sizeof(v));
+    return v;
+}
+
+void tsblock_init(TsBlock *block) {
+    memset(block, 0, sizeof(*block));
+    block->lastLeading = -1;
+}
+
+void tsblock_free(TsBlock *block) {
+    if (!block) return;
+    free(block->words);
+    tsblock_init(block);
+}
+
+static int ensure_bits(TsBlock *block, size_t more) {
+    size_t need = (block->bits + more + 63) / 64;
+    if (need <= block->capWords) return 0;
+    size_t cap = block->capWords ? block->capWords * 2 : 8;
+    while (cap < need) cap *= 2;
+    uint64_t *p = realloc(block->words, cap * sizeof(uint64_t));
+    if (!p) return -1;
+    memset(p + block->capWords, 0, (cap - block->capWords) * sizeof(uint64_t));
+    block->words = p;
+    block->capWords = cap;
+    return 0;
+}
+
+// 写入 value 的低 n 位（1 <= n <= 64），调用前需 ensure_bits
+static void put_bits(TsBlock *block, uint64_t value, int n) {
+    if (n < 64) value &= ((uint64_t)1 << n) - 1;
+    size_t word = block->bits / 64;
+    int used = (int)(block->bits % 64);
+    int room = 64 - used;
+    if (n <= room) {
+        block->words[word] |= value << (room - n);
+    } else {
+        block->words[word] |= value >> (n - room);
+        block->words[word + 1] |= value << (64 - (n - room));
+    }
+    block->bits += (size_t)n;
+}
+
+int tsblock_append(TsBlock *block, int64_t ts, double value) {
+    uint64_t v = double_bits(value);
+    // 最坏情况：时间戳 4+64 位，数值 2+5+6+64 位
+    if (ensure_bits(block, 160) != 0) return -1;
+
+    if (block->count == 0) {
+        put_bits(block, (uint64_t)ts, 64);
+        put_bits(block, v, 64);
+        block->lastTs = ts;
+        block->lastDelta = 0;
+        block->lastValue = v;
+        block->count = 1;
+        return 0;
+    }
+
+    // 差值在 uint64_t 上回绕计算，极端时间跳变不会有符号溢出；解码端同样回绕，结果一致
+    uint64_t delta = (uint64_t)ts - (uint64_t)block->lastTs;
+    int64_t dod = (int64_t)(delta - (uint64_t)block->lastDelta);
+    if (dod == 0) {
+        put_bits(block, 0, 1);
+    } else if (dod >= -63 && dod <= 64) {
+        put_bits(block, 0x2, 2);
+        put_bits(block, (uint64_t)(dod + 63), 7);
+    } else if (dod >= -255 && dod <= 256) {
+        put_bits(block, 0x6, 3);
+        put_bits(block, (uint64_t)(dod + 255), 9);
+    } else if (dod >= -2047 && dod <= 2048) {
+        put_bits(block, 0xe, 4);
+        put_bits(block, (uint64_t)(dod + 2047), 12);
+    } else {
+        put_bits(block, 0xf, 4);
+        put_bits(block, (uint64_t)dod, 64);
+    }
+    block->lastTs = ts;
+    block->lastDelta = (int64_t)delta;
+
+    uint64_t x = v ^ block->lastValue;
+    if (x == 0) {
+        put_bits(block, 0, 1);
+    } else {
+        int leading = __builtin_clzll(x);
+        int trailing = __builtin_ctzll(x);
+        if (leading > 31) leading = 31;     // 前导零计数只占 5 位
+        put_bits(block, 1, 1);
+        if (block->lastLeading >= 0 && leading >= block->lastLeading &&
+            trailing >= block->lastTrailing) {
+            // 有效位落在上一窗口内，复用窗口
+            put_bits(block, 0, 1);
+            put_bits(block, x >> block->lastTrailing, 64 - block->lastLeading - block->lastTrailing);
+        } else {
+            int sig = 64 - leading - trailing;
+            put_bits(block, 1, 1);
+            put_bits(block, (uint64_t)leading, 5);
+            put_bits(block, (uint64_t)(sig - 1), 6);
+            put_bits(block, x >> trailing, sig);
+            block->lastLeading = leading;
+            block->lastTrailing = trailing;
+        }
+    }
+    block->lastValue = v;
+    block->count++;
+    return 0;
+}
+
+void tsblock_seal(TsBlock *block) {
+    size_t need = (block->bits + 63) / 64;
+    if (need == 0 || need >= block->capWords) return;
+    uint64_t *p = realloc(block->words, need * sizeof(uint64_t));
+    if (!p) return;
+    block->words = p;
+    block->capWords = need;
+}
+
+size_t tsblock_bytes(const TsBlock *block) {
+    return block->capWords * sizeof(uint64_t);
+}
+
+void tsblock_iter_init(TsBlockIter *it, const TsBlock *block) {
+    memset(it, 0, sizeof(*it));
+    it->words = block->words;
+    it->bits = block->bits;
+    it->remaining = block->count;
+}
+
+static uint64_t get_bits(TsBlockIter *it, int n) {
+    size_t word = it->pos / 64;
+    int used = (int)(it->pos % 64);
+    int room = 64 - used;
+    uint64_t v;
+    if (n <= room) {
+        v = it->words[word] >> (room - n);
+    } else {
+        v = (it->words[word] << (n - room)) | (it->words[word + 1] >> (64 - (n - room)));
+    }
+    it->pos += (size_t)n;
+    return n < 64 ? v & (((uint64_t)1 << n) - 1) : v;
+}
+
+static int get_bit(TsBlockIter *it) {
+    int bit = (int)((it->words[it->pos / 64] >> (63 - it->pos % 64)) & 1);
+    it->pos++;
+    return bit;
+}
+
+size_t tsblock_decode(TsBlockIter *it, int64_t *ts, double *values, size_t max) {
+    size_t n = 0;
+    while (n < max && it->remaining > 0) {
+        if (it->index == 0) {
+            it->ts = (int64_t)get_bits(it, 64);
+            it->value = get_bits(it, 64);
+            it->leading = -1;
+        } else {
+            int64_t dod;
+            if (!get_bit(it)) dod = 0;
+            else if (!get_bit(it)) dod = (int64_t)get_bits(it, 7) - 63;
+            else if (!get_bit(it)) dod = (int64_t)get_bits(it, 9) - 255;
+            else if (!get_bit(it)) dod = (int64_t)get_bits(it, 12) - 2047;
+            else dod = (int64_t)get_bits(it, 64);
+            it->delta = (int64_t)((uint64_t)it->delta + (uint64_t)dod);
+            it->ts = (int64_t)((uint64_t)it->ts + (uint64_t)it->delta);
+
+            if (get_bit(it)) {
+                if (get_bit(it)) {
+                    it->leading = (int)get_bits(it, 5);
+                    int sig = (int)get_bits(it, 6) + 1;
+                    it->trailing = 64 - it->leading - sig;
+                }
+                int sig = 64 - it->leading - it->trailing;
+                it->value ^= get_bits(it, sig) << it->trailing;
+            }
+        }
+        ts[n] = it->ts;
+        values[n] = bits_double(it->value);
+        n++;
+        it->index++;
+        it->remaining--;
+    }
+    return n;
+}
@@ -0,0 +1,58 @@
+#ifndef COMMON_TSBLOCK_H
+#define COMMON_TSBLOCK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Gorilla 风格的时间序列压缩块：时间戳按二阶差分（delta-of-delta）变长编码，
+// 数值按与前值异或后的有效位编码。周期采集、变化缓慢的数据通常每点 1~2 字节
+// 块只能追加；写满后 seal 收缩内存，之后只读
+
+typedef struct {
+    uint64_t *words;            // 按位写入，高位在前
+    size_t capWords;
+    size_t bits;                // 已写入位数
+    unsigned int count;         // 点数
+    // 编码状态
+    int64_t lastTs;
+    int64_t lastDelta;
+    uint64_t lastValue;
+    int lastLeading;            // -1 表示尚无可复用的有效位窗口
+    int lastTrailing;
+} TsBlock;
+
+void tsblock_init(TsBlock *block);
+void tsblock_free(TsBlock *block);
+// 追加一个点，时间戳应单调不减；内存不足返回 -1
+int tsblock_append(TsBlock *block, int64_t ts, double value);
+// 释放多余容量，此后不应再追加
+void tsblock_seal(TsBlock *block);
+size_t tsblock_bytes(const TsBlock *block);
+
+// 顺序解码器；块在解码期间不可被修改
+typedef struct {
+    const uint64_t *words;
+    size_t bits;
+    size_t pos;
+    unsigned int remaining;
+    unsigned int index;
+    int64_t ts;
+    int64_t delta;
+    uint64_t value;
+    int leading;
+    int trailing;
+} TsBlockIter;
+
+void tsblock_iter_init(TsBlockIter *it, const TsBlock *block);
+// 按列解码至多 max 个点，返回实际解码数；按列输出便于后续聚合循环向量化
+size_t tsblock_decode(TsBlockIter *it, int64_t *ts, double *values, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COMMON_TSBLOCK_H
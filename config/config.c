@@ -21,12 +21,41 @@ Config *config_parse(const char *filename)
     // 在 config_parse 内，初始化默认值
     memset(&cfg->database, 0, sizeof(cfg->database));
     // cfg->database.mysql.enabled = 0 (默认关闭)
+    cfg->database.rollup.store_raw = 1;
+    strlcpy(cfg->database.rollup.windows, "10s,1m,1h", sizeof(cfg->database.rollup.windows));
+    cfg->grpc_server.min_pollers = 1;
+    cfg->grpc_server.max_pollers = 2;
+    cfg->grpc_server.max_recv_msg_size = 16 * 1024 * 1024;
+    cfg->grpc_server.max_send_msg_size = 16 * 1024 * 1024;
+    cfg->grpc_server.keepalive_time_ms = 30000;
+    cfg->grpc_server.keepalive_timeout_ms = 10000;
+    cfg->grpc_server.keepalive_permit_without_calls = 1;
+    cfg->grpc_server.apply_queue = 64;
+    cfg->grpc_server.apply_workers = 2;
+    cfg->grpc_server.write_coalesce_ms = 50;
+    cfg->grpc_server.apply_drain_ms = 2000;
+    cfg->common.http_threads = 4;
+    cfg->common.http_connection_limit = 1024;
+    cfg->common.http_connection_timeout = 30;
+    cfg->common.history_capacity = 17280;
+    cfg->common.start_concurrency = 32;
+    cfg->common.start_timeout_ms = 5000;
+    cfg->common.reconnect_backoff_min_ms = 1000;
+    cfg->common.reconnect_backoff_max_ms = 60000;
+    cfg->common.health_probe_interval = 10;
+    cfg->common.io_endpoint_concurrency = 2;
+    cfg->common.io_telemetry_concurrency = 1;
+    cfg->common.io_slo_control_ms = 500;
+    cfg->common.io_slo_ondemand_ms = 2000;
+    cfg->common.io_slo_telemetry_ms = 10000;
 
     yaml_parser_t parser;
     yaml_token_t token;
     char key[128] = {0};
     int in_grpc_server = 0, in_common = 0;
     int in_database = 0, in_mysql = 0;  // 新增
+    int in_rollup = 0;
+    DatabaseClientConfig *in_client = NULL;   // database.redis / database.tdengine
 
     if (!yaml_parser_initialize(&parser))
     {
@@ -72,6 +101,12 @@ Config *config_parse(const char *filename)
                     in_database = 1; in_common = 0; in_grpc_server = 0; in_mysql = 0;
                 } else if (in_database && strcmp(key, "mysql") == 0) {
                     in_mysql = 1;
+                } else if (in_database && strcmp(key, "rollup") == 0) {
+                    in_rollup = 1;
+                } else if (in_database && strcmp(key, "redis") == 0) {
+                    in_client = &cfg->database.redis;
+                } else if (in_database && strcmp(key, "tdengine") == 0) {
+                    in_client = &cfg->database.tdengine;
                 }
                 yaml_token_delete(&token);
                 continue;
@@ -83,6 +118,34 @@ Config *config_parse(const char *filename)
                 if (in_grpc_server) {
                     if (strcmp(key, "socket_path") == 0)
                         strncpy(cfg->grpc_server.socket_path, (char *)token.data.scalar.value, sizeof(cfg->grpc_server.socket_path) - 1);
+                    else if (strcmp(key, "max_threads") == 0)
+                        cfg->grpc_server.max_threads = atoi((char *)token.data.scalar.value);
+                    else if (strcmp(key, "memory_quota_mb") == 0)
+                        cfg->grpc_server.memory_quota_mb = atoi((char *)token.data.scalar.value);
+                    else if (strcmp(key, "min_pollers") == 0)
+                        cfg->grpc_server.min_pollers = atoi((char *)token.data.scalar.value);
+                    else if (strcmp(key, "max_pollers") == 0)
+                        cfg->grpc_server.max_pollers = atoi((char *)token.data.scalar.value);
+                    else if (strcmp(key, "max_recv_msg_size") == 0)
+                        cfg->grpc_server.max_recv_msg_size = atoi((char *)token.data.scalar.value);
+                    else if (strcmp(key, "max_send_msg_size") == 0)
+                        cfg->grpc_server.max_send_msg_size = atoi((char *)token.data.scalar.value);
+                    else if (strcmp(key, "keepalive_time_ms") == 0)
+                        cfg->grpc_server.keepalive_time_ms = atoi((char *)token.data.scalar.value);
+                    else if (strcmp(key, "keepalive_timeout_ms") == 0)
+                        cfg->grpc_server.keepalive_timeout_ms = atoi((char *)token.data.scalar.value);
+                    else if (strcmp(key, "keepalive_permit_without_calls") == 0) {
+                        const char *v = (char *)token.data.scalar.value;
+                        cfg->grpc_server.keepalive_permit_without_calls = (!strcasecmp(v,"true") || !strcmp(v,"1")) ? 1 : 0;
+                    }
+                    else if (strcmp(key, "apply_queue") == 0)
+                        cfg->grpc_server.apply_queue = atoi((char *)token.data.scalar.value);
+                    else if (strcmp(key, "apply_workers") == 0)
+                        cfg->grpc_server.apply_workers = atoi((char *)token.data.scalar.value);
+                    else if (strcmp(key, "write_coalesce_ms") == 0)
+                        cfg->grpc_server.write_coalesce_ms = atoi((char *)token.data.scalar.value);
+                    else if (strcmp(key, "apply_drain_ms") == 0)
+                        cfg->grpc_server.apply_drain_ms = atoi((char *)token.data.scalar.value);
                 }
                 else if (in_common) {
                     if (strcmp(key, "name") == 0)
@@ -97,8 +160,38 @@ Config *config_parse(const char *filename)
                         strncpy(cfg->common.address, (char *)token.data.scalar.value, sizeof(cfg->common.address) - 1);
                     else if (strcmp(key, "edgecore_sock") == 0)
                         strncpy(cfg->common.edgecore_sock, (char *)token.data.scalar.value, sizeof(cfg->common.edgecore_sock) - 1);
+                    else if (strcmp(key, "driver_plugin_dir") == 0)
+                        strncpy(cfg->common.driver_plugin_dir, (char *)token.data.scalar.value, sizeof(cfg->common.driver_plugin_dir) - 1);
                     else if (strcmp(key, "http_port") == 0)
                         strncpy(cfg->common.http_port, (char *)token.data.scalar.value, sizeof(cfg->common.http_port) - 1);
+                    else if (strcmp(key, "http_threads") == 0)
+                        cfg->common.http_threads = atoi((char *)token.data.scalar.value);
+                    else if (strcmp(key, "http_connection_limit") == 0)
+                        cfg->common.http_connection_limit = atoi((char *)token.data.scalar.value);
+                    else if (strcmp(key, "http_connection_timeout") == 0)
+                        cfg->common.http_connection_timeout = atoi((char *)token.data.scalar.value);
+                    else if (strcmp(key, "history_capacity") == 0)
+                        cfg->common.history_capacity = atoi((char *)token.data.scalar.value);
+                    else if (strcmp(key, "start_concurrency") == 0)
+                        cfg->common.start_concurrency = atoi((char *)token.data.scalar.value);
+                    else if (strcmp(key, "start_timeout_ms") == 0)
+                        cfg->common.start_timeout_ms = atoi((char *)token.data.scalar.value);
+                    else if (strcmp(key, "reconnect_backoff_min_ms") == 0)
+                        cfg->common.reconnect_backoff_min_ms = atoi((char *)token.data.scalar.value);
+                    else if (strcmp(key, "reconnect_backoff_max_ms") == 0)
+                        cfg->common.reconnect_backoff_max_ms = atoi((char *)token.data.scalar.value);
+                    else if (strcmp(key, "health_probe_interval") == 0)
+                        cfg->common.health_probe_interval = atoi((char *)token.data.scalar.value);
+                    else if (strcmp(key, "io_endpoint_concurrency") == 0)
+                        cfg->common.io_endpoint_concurrency = atoi((char *)token.data.scalar.value);
+                    else if (strcmp(key, "io_telemetry_concurrency") == 0)
+                        cfg->common.io_telemetry_concurrency = atoi((char *)token.data.scalar.value);
+                    else if (strcmp(key, "io_slo_control_ms") == 0)
+                        cfg->common.io_slo_control_ms = atoi((char *)token.data.scalar.value);
+                    else if (strcmp(key, "io_slo_ondemand_ms") == 0)
+                        cfg->common.io_slo_ondemand_ms = atoi((char *)token.data.scalar.value);
+                    else if (strcmp(key, "io_slo_telemetry_ms") == 0)
+                        cfg->common.io_slo_telemetry_ms = atoi((char *)token.data.scalar.value);
                 }
                 else if (in_mysql) {
                     if (strcmp(key, "enabled") == 0) {
@@ -118,6 +211,26 @@ Config *config_parse(const char *filename)
                         strlcpy(cfg->database.mysql.ssl_mode, (char *)token.data.scalar.value, sizeof(cfg->database.mysql.ssl_mode));
                     }
                 }
+                else if (in_rollup) {
+                    const char *v = (char *)token.data.scalar.value;
+                    if (strcmp(key, "enabled") == 0) {
+                        cfg->database.rollup.enabled = (!strcasecmp(v,"true") || !strcmp(v,"1")) ? 1 : 0;
+                    } else if (strcmp(key, "windows") == 0) {
+                        strlcpy(cfg->database.rollup.windows, v, sizeof(cfg->database.rollup.windows));
+                    } else if (strcmp(key, "store_raw") == 0) {
+                        cfg->database.rollup.store_raw = (!strcasecmp(v,"true") || !strcmp(v,"1")) ? 1 : 0;
+                    } else if (strcmp(key, "raw_retention") == 0) {
+                        strlcpy(cfg->database.rollup.raw_retention, v, sizeof(cfg->database.rollup.raw_retention));
+                    }
+                }
+                else if (in_client) {
+                    const char *v = (char *)token.data.scalar.value;
+                    if (strcmp(key, "enabled") == 0) {
+                        in_client->enabled = (!strcasecmp(v,"true") || !strcmp(v,"1")) ? 1 : 0;
+                    } else if (strcmp(key, "client_config") == 0) {
+                        strlcpy(in_client->client_config, v, sizeof(in_client->client_config));
+                    }
+                }
                 yaml_token_delete(&token);
             } else {
                 yaml_token_delete(&token);
@@ -126,6 +239,8 @@ Config *config_parse(const char *filename)
         else if (token.type == YAML_BLOCK_END_TOKEN) {
             // 退出子映射
             if (in_mysql) { in_mysql = 0; }
+            else if (in_rollup) { in_rollup = 0; }
+            else if (in_client) { in_client = NULL; }
             else if (in_database) { in_database = 0; }
             else if (in_common) { in_common = 0; }
             else if (in_grpc_server) { in_grpc_server = 0; }
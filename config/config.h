@@ -7,6 +7,19 @@ extern "C" {
 
 typedef struct {
     char socket_path[256];
+    int  max_threads;              // ResourceQuota 线程上限，0 为 gRPC 默认
+    int  memory_quota_mb;          // ResourceQuota 内存上限（MB），0 不限制
+    int  min_pollers;              // 同步服务（健康检查/反射）轮询线程数
+    int  max_pollers;
+    int  max_recv_msg_size;        // 接收消息上限（字节）
+    int  max_send_msg_size;        // 发送消息上限（字节）
+    int  keepalive_time_ms;        // keepalive ping 间隔，0 不启用
+    int  keepalive_timeout_ms;     // ping 应答超时
+    int  keepalive_permit_without_calls;
+    int  apply_queue;              // 期望值下发队列容量
+    int  apply_workers;            // 下发线程数
+    int  write_coalesce_ms;        // 写入合并窗口（毫秒），0 关闭
+    int  apply_drain_ms;           // 停止时等待已入队计划执行完的上限（毫秒）
 } GRPCServerConfig;
 
 typedef struct {
@@ -16,7 +29,22 @@ typedef struct {
     char protocol[32];
     char address[128];
     char edgecore_sock[256];
+    char driver_plugin_dir[256];   // 协议驱动插件目录（*.so），空为只用内置驱动
     char http_port[16];
+    int  http_threads;             // REST 线程池大小
+    int  http_connection_limit;    // REST 最大并发连接数
+    int  http_connection_timeout;  // REST 空闲连接超时（秒）
+    int  history_capacity;         // 每个属性在内存中保留的历史点数，0 关闭
+    int  start_concurrency;        // 启动时同时初始化的设备数
+    int  start_timeout_ms;         // 单台设备启动超时（毫秒），0 不限
+    int  reconnect_backoff_min_ms; // 重连退避下限（毫秒），每次失败翻倍并加抖动
+    int  reconnect_backoff_max_ms; // 重连退避上限（毫秒）
+    int  health_probe_interval;    // 在线设备健康探测间隔（秒），0 不探测
+    int  io_endpoint_concurrency;  // 单个设备端点同时进行的 I/O 数
+    int  io_telemetry_concurrency; // 其中周期采集可占用的名额
+    int  io_slo_control_ms;        // 控制写排队+执行耗时目标（毫秒），0 不统计
+    int  io_slo_ondemand_ms;       // 按需读耗时目标
+    int  io_slo_telemetry_ms;      // 周期采集耗时目标
 } CommonConfig;
 
 typedef struct {
@@ -29,8 +57,24 @@ typedef struct {
     char password[64];
 } DatabaseMySQLConfig;
 
+typedef struct {
+    int  enabled;
+    char windows[64];          // 汇总窗口，如 "10s,1m,1h"
+    int  store_raw;            // 是否继续写原始数据
+    char raw_retention[32];    // 原始数据保留时长，如 "24h"，空为不清理
+} DatabaseRollupConfig;
+
+// 历史查询可选后端：client_config 与设备 dbMethod 的 redisClientConfig / tdengineClientConfig 同格式
+typedef struct {
+    int  enabled;
+    char client_config[512];
+} DatabaseClientConfig;
+
 typedef struct {
     DatabaseMySQLConfig mysql;
+    DatabaseRollupConfig rollup;   // 基于 MySQL 的降采样
+    DatabaseClientConfig redis;    // /api/v1/database?backend=redis
+    DatabaseClientConfig tdengine; // /api/v1/database?backend=tdengine
 } DatabaseConfigGroup;
 
 typedef struct Config {
@@ -0,0 +1,75 @@
+#include "data/dbmethod/cursor.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define DB_CURSOR_NO_STR ((size_t)-1)
+
+DbCursor *db_cursor_new(const DbCursorOps *ops, void *impl) {
+    if (!ops || !ops->fetch) return NULL;
+    DbCursor *cursor = calloc(1, sizeof(DbCursor));
+    if (!cursor) return NULL;
+    cursor->ops = ops;
+    cursor->impl = impl;
+    return cursor;
+}
+
+static size_t arena_put(DbCursor *cursor, const char *s, size_t len) {
+    if (!s) return DB_CURSOR_NO_STR;
+    if (cursor->arenaLen + len + 1 > cursor->arenaCap) {
+        size_t cap = cursor->arenaCap ? cursor->arenaCap : 16 * 1024;
+        while (cap < cursor->arenaLen + len + 1) cap *= 2;
+        char *p = realloc(cursor->arena, cap);
+        if (!p) return (size_t)-2;
+        cursor->arena = p;
+        cursor->arenaCap = cap;
+    }
+    size_t off = cursor->arenaLen;
+    memcpy(cursor->arena + off, s, len);
+    cursor->arena[off + len] = '\0';
+    cursor->arenaLen += len + 1;
+    return off;
+}
+
+int db_cursor_push(DbCursor *cursor, int64_t timeStamp,
+                   const char *propertyName, size_t propLen,
+                   const char *value, size_t valueLen) {
+    if (!cursor) return -1;
+    if (cursor->count >= DB_CURSOR_BATCH) return 1;
+    size_t propOff = arena_put(cursor, propertyName, propLen);
+    size_t valueOff = arena_put(cursor, value ? value : "", value ? valueLen : 0);
+    if (propOff == (size_t)-2 || valueOff == (size_t)-2) return -1;
+    int i = cursor->count++;
+    cursor->rows[i].timeStamp = timeStamp;
+    cursor->propOff[i] = propOff;
+    cursor->valueOff[i] = valueOff;
+    return cursor->count >= DB_CURSOR_BATCH ? 1 : 0;
+}
+
+int db_cursor_next(DbCursor *cursor) {
+    if (!cursor || cursor->done) return 0;
+    // 复用上一批的缓冲
+    cursor->count = 0;
+    cursor->arenaLen = 0;
+    int n = cursor->ops->fetch(cursor);
+    if (n < 0) {
+        cursor->done = 1;
+        return -1;
+    }
+    if (cursor->count == 0) {
+        cursor->done = 1;
+        return 0;
+    }
+    for (int i = 0; i < cursor->count; i++) {
+        cursor->rows[i].propertyName =
+            cursor->propOff[i] == DB_CURSOR_NO_STR ? NULL : cursor->arena + cursor->propOff[i];
+        cursor->rows[i].value = cursor->arena + cursor->valueOff[i];
+    }
+    return cursor->count;
+}
+
+void db_cursor_close(DbCursor *cursor) {
+    if (!cursor) return;
+    if (cursor->ops->close) cursor->ops->close(cursor);
+    free(cursor->arena);
+    free(cursor);
+}
@@ -0,0 +1,60 @@
+#ifndef DATA_DBMETHOD_CURSOR_H
+#define DATA_DBMETHOD_CURSOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 历史数据游标：各数据库后端按固定大小批次读取，行数据写入游标内可复用的缓冲
+// 每次 db_cursor_next 返回的行在下一次调用前有效，内存占用与结果集大小无关
+
+#define DB_CURSOR_BATCH 256
+
+typedef struct {
+    int64_t timeStamp;          // 毫秒
+    const char *propertyName;   // 后端未存储时为 NULL
+    const char *value;
+} DbRow;
+
+typedef struct DbCursor DbCursor;
+
+typedef struct {
+    // 读取下一批（通过 db_cursor_push 写入），返回本批行数，0 表示结束，-1 出错
+    int (*fetch)(DbCursor *cursor);
+    void (*close)(DbCursor *cursor);
+} DbCursorOps;
+
+struct DbCursor {
+    const DbCursorOps *ops;
+    void *impl;                 // 后端私有状态
+    DbRow rows[DB_CURSOR_BATCH];
+    int count;
+    int done;
+
+    // 批内字符串缓冲：先记录偏移，批次结束后再转换为指针（缓冲可能扩容）
+    char *arena;
+    size_t arenaLen;
+    size_t arenaCap;
+    size_t propOff[DB_CURSOR_BATCH];
+    size_t valueOff[DB_CURSOR_BATCH];
+};
+
+// 后端使用：创建/销毁游标壳
+DbCursor *db_cursor_new(const DbCursorOps *ops, void *impl);
+// 后端使用：向当前批次追加一行，批次已满返回 1，失败返回 -1
+int db_cursor_push(DbCursor *cursor, int64_t timeStamp,
+                   const char *propertyName, size_t propLen,
+                   const char *value, size_t valueLen);
+
+// 读取下一批：返回行数，0 表示结束，-1 出错；行在 cursor->rows[0..n) 中
+int db_cursor_next(DbCursor *cursor);
+void db_cursor_close(DbCursor *cursor);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DATA_DBMETHOD_CURSOR_H
@@ -187,7 +187,8 @@ int mysql_add_data(MySQLDataBaseConfig *db, const DataModel *data) {
         "CREATE TABLE IF NOT EXISTS `%s` ("
         "  id INT AUTO_INCREMENT PRIMARY KEY,"
         "  ts DATETIME NOT NULL,"
-        "  field TEXT"
+        "  field TEXT,"
+        "  INDEX idx_ts_id (ts, id)"
         ")", tableName);
 
     if (mysql_query(db->conn, createTable)) {
@@ -250,4 +251,200 @@ int mysql_add_data(MySQLDataBaseConfig *db, const DataModel *data) {
 
     mysql_stmt_close(stmt);
     return 0;
-}
\ No newline at end of file
+}
+
+int mysql_add_rollup(MySQLDataBaseConfig *db, const char *table, long long startSec,
+                     long long count, int hasNumeric, double min, double max, double avg,
+                     const char *last) {
+    if (!db || !db->conn || !table) return -1;
+
+    char createTable[512];
+    snprintf(createTable, sizeof(createTable),
+        "CREATE TABLE IF NOT EXISTS `%s` ("
+        "  ts DATETIME NOT NULL PRIMARY KEY,"
+        "  cnt BIGINT NOT NULL,"
+        "  min_v DOUBLE NULL,"
+        "  max_v DOUBLE NULL,"
+        "  avg_v DOUBLE NULL,"
+        "  last_v TEXT"
+        ")", table);
+    if (mysql_query(db->conn, createTable)) {
+        log_error("create rollup table failed: %s", mysql_error(db->conn));
+        return -1;
+    }
+
+    char escaped[2 * 128 + 1];
+    size_t lastLen = last ? strlen(last) : 0;
+    if (lastLen > 128) lastLen = 128;
+    mysql_real_escape_string(db->conn, escaped, last ? last : "", (unsigned long)lastLen);
+
+    char numbers[128];
+    if (hasNumeric) {
+        snprintf(numbers, sizeof(numbers), "%.17g, %.17g, %.17g", min, max, avg);
+    } else {
+        snprintf(numbers, sizeof(numbers), "NULL, NULL, NULL");
+    }
+
+    // 停止时写出的未结束桶可能在重启后再次写出，按起始时间覆盖
+    char sql[1024];
+    snprintf(sql, sizeof(sql),
+             "INSERT INTO `%s` (ts, cnt, min_v, max_v, avg_v, last_v) "
+             "VALUES (FROM_UNIXTIME(%lld), %lld, %s, '%s') "
+             "ON DUPLICATE KEY UPDATE cnt=VALUES(cnt), min_v=VALUES(min_v), max_v=VALUES(max_v), "
+             "avg_v=VALUES(avg_v), last_v=VALUES(last_v)",
+             table, startSec, count, numbers, escaped);
+    if (mysql_query(db->conn, sql)) {
+        log_error("insert rollup failed: %s", mysql_error(db->conn));
+        return -1;
+    }
+    return 0;
+}
+
+int mysql_delete_before(MySQLDataBaseConfig *db, const char *table, long long beforeSec) {
+    if (!db || !db->conn || !table) return -1;
+    char sql[512];
+    snprintf(sql, sizeof(sql), "DELETE FROM `%s` WHERE ts < FROM_UNIXTIME(%lld)", table, beforeSec);
+    if (mysql_query(db->conn, sql)) {
+        // 1146: 表尚不存在（仅开启降采样、从未写原始数据）
+        if (mysql_errno(db->conn) == 1146) return 0;
+        log_error("delete expired rows failed: %s", mysql_error(db->conn));
+        return -1;
+    }
+    return 0;
+}
+
+// 范围游标按 (ts, id) 分页，保留期删除按 ts 范围，都走 idx_ts_id；旧表上单列的 idx_ts 随之删掉
+int mysql_ensure_ts_index(MySQLDataBaseConfig *db, const char *table) {
+    if (!db || !db->conn || !table) return -1;
+    char sql[512];
+    snprintf(sql, sizeof(sql), "ALTER TABLE `%s` ADD INDEX idx_ts_id (ts, id)", table);
+    if (mysql_query(db->conn, sql)) {
+        // 1061: 索引已存在；1146: 表尚不存在，建表时会带上索引
+        unsigned int err = mysql_errno(db->conn);
+        if (err == 1061 || err == 1146) return 0;
+        log_error("add (ts, id) index failed: %s", mysql_error(db->conn));
+        return -1;
+    }
+    log_info("Added (ts, id) index to %s", table);
+    snprintf(sql, sizeof(sql), "ALTER TABLE `%s` DROP INDEX idx_ts", table);
+    // 1091: 没有旧索引
+    if (mysql_query(db->conn, sql) && mysql_errno(db->conn) != 1091) {
+        log_warn("drop old ts index on %s failed: %s", table, mysql_error(db->conn));
+    }
+    return 0;
+}
+
+MySQLDataBaseConfig *mysql_clone_client(const MySQLDataBaseConfig *src) {
+    if (!src) return NULL;
+    MySQLDataBaseConfig *db = calloc(1, sizeof(MySQLDataBaseConfig));
+    if (!db) return NULL;
+    db->config.addr = src->config.addr ? strdup(src->config.addr) : NULL;
+    db->config.database = src->config.database ? strdup(src->config.database) : NULL;
+    db->config.userName = src->config.userName ? strdup(src->config.userName) : NULL;
+    db->config.password = src->config.password ? strdup(src->config.password) : NULL;
+    db->config.port = src->config.port;
+    if (mysql_init_client(db) != 0) {
+        FreeMySQLDataBaseClient(db);
+        return NULL;
+    }
+    return db;
+}
+
+void FreeMySQLDataBaseClient(MySQLDataBaseConfig *dbConfig) {
+    if (!dbConfig) return;
+    mysql_close_client(dbConfig);
+    free(dbConfig->config.addr);
+    free(dbConfig->config.database);
+    free(dbConfig->config.userName);
+    free(dbConfig->config.password);
+    free(dbConfig);
+}
+
+typedef struct {
+    MySQLDataBaseConfig *db;
+    char *table;
+    long long startSec;
+    long long endSec;
+    char lastTs[32];            // 已读出的最后一行的 (ts, id)，下一页从其后开始；首页为 (startSec, 0)
+    long long lastId;
+    long long remaining;        // 还可读的行数，-1 表示不限制
+    int exhausted;
+} MySQLCursorImpl;
+
+// 每批单独执行一次 (ts, id) 键集分页查询并 store_result 取完，每页都是 idx_ts_id 上的一段顺序扫描，两批之间不占用连接上的结果集，
+// 客户端读得再慢也不会让服务端挂着未读完的结果，关闭时也没有剩余行要读掉
+static int mysql_cursor_fetch(DbCursor *cursor) {
+    MySQLCursorImpl *impl = (MySQLCursorImpl*)cursor->impl;
+    if (impl->exhausted || impl->remaining == 0) return 0;
+    long long batch = DB_CURSOR_BATCH;
+    if (impl->remaining > 0 && impl->remaining < batch) batch = impl->remaining;
+
+    // 表名由 recorder 规范化生成，只含 [a-z0-9_-/]
+    // 续页的 ts 用上一页读回的原文，不经 UNIX_TIMESTAMP 往返换算
+    char from[64];
+    if (impl->lastTs[0]) snprintf(from, sizeof(from), "'%s'", impl->lastTs);
+    else snprintf(from, sizeof(from), "FROM_UNIXTIME(%lld)", impl->startSec);
+    char sql[640];
+    snprintf(sql, sizeof(sql),
+             "SELECT id, UNIX_TIMESTAMP(ts), field, ts FROM `%s`"
+             " WHERE (ts, id) > (%s, %lld) AND ts < FROM_UNIXTIME(%lld)"
+             " ORDER BY ts, id LIMIT %lld",
+             impl->table, from, impl->lastId, impl->endSec, batch);
+    if (mysql_query(impl->db->conn, sql)) {
+        log_error("mysql range query failed: %s", mysql_error(impl->db->conn));
+        return -1;
+    }
+    MYSQL_RES *res = mysql_store_result(impl->db->conn);
+    if (!res) {
+        log_error("mysql_store_result failed: %s", mysql_error(impl->db->conn));
+        return -1;
+    }
+    MYSQL_ROW row;
+    long long got = 0;
+    while ((row = mysql_fetch_row(res)) != NULL) {
+        unsigned long *lens = mysql_fetch_lengths(res);
+        long long ts = row[1] ? atoll(row[1]) : 0;
+        if (db_cursor_push(cursor, (int64_t)ts * 1000, NULL, 0,
+                           row[2] ? row[2] : "", row[2] && lens ? lens[2] : 0) < 0) {
+            mysql_free_result(res);
+            return -1;
+        }
+        if (row[0]) impl->lastId = atoll(row[0]);
+        if (row[3]) snprintf(impl->lastTs, sizeof(impl->lastTs), "%s", row[3]);
+        got++;
+    }
+    mysql_free_result(res);
+    if (impl->remaining > 0) impl->remaining -= got;
+    if (got < batch) impl->exhausted = 1;
+    return cursor->count;
+}
+
+static void mysql_cursor_close(DbCursor *cursor) {
+    MySQLCursorImpl *impl = (MySQLCursorImpl*)cursor->impl;
+    if (!impl) return;
+    free(impl->table);
+    free(impl);
+}
+
+static const DbCursorOps g_mysql_cursor_ops = {
+    .fetch = mysql_cursor_fetch,
+    .close = mysql_cursor_close,
+};
+
+DbCursor *mysql_open_range_cursor(MySQLDataBaseConfig *db, const char *table,
+                                  long long startSec, long long endSec, long long maxRows) {
+    if (!db || !db->conn || !table) return NULL;
+    MySQLCursorImpl *impl = calloc(1, sizeof(MySQLCursorImpl));
+    if (!impl) return NULL;
+    impl->db = db;
+    impl->table = strdup(table);
+    impl->startSec = startSec;
+    impl->endSec = endSec;
+    impl->remaining = maxRows > 0 ? maxRows : -1;
+    DbCursor *cursor = impl->table ? db_cursor_new(&g_mysql_cursor_ops, impl) : NULL;
+    if (!cursor) {
+        free(impl->table);
+        free(impl);
+    }
+    return cursor;
+}
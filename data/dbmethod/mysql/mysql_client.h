@@ -3,6 +3,7 @@
 
 #include "common/datamodel.h"
 #include "driver/driver.h"
+#include "data/dbmethod/cursor.h"
 #include <mysql.h>
 
 typedef struct {
@@ -33,6 +34,24 @@ int mysql_init_client(MySQLDataBaseConfig *db);         // 更新参数类型
 void mysql_close_client(MySQLDataBaseConfig *db);       // 更新参数类型
 int mysql_add_data(MySQLDataBaseConfig *db, const DataModel *data);  // 更新参数类型
 
+// 写入一个降采样桶（表不存在时创建），同一起始时间重复写入时覆盖
+// hasNumeric 为 0 时 min/max/avg 写 NULL
+int mysql_add_rollup(MySQLDataBaseConfig *db, const char *table, long long startSec,
+                     long long count, int hasNumeric, double min, double max, double avg,
+                     const char *last);
+// 删除表中 ts 早于 beforeSec 的行
+int mysql_delete_before(MySQLDataBaseConfig *db, const char *table, long long beforeSec);
+// 为旧版本建的原始数据表补上 (ts, id) 索引（已存在或表不存在时返回 0）
+int mysql_ensure_ts_index(MySQLDataBaseConfig *db, const char *table);
+
+// 按已有配置新建独立连接（MYSQL 连接不可跨线程共享，查询使用各自的连接）
+MySQLDataBaseConfig *mysql_clone_client(const MySQLDataBaseConfig *src);
+
+// 按时间范围 [startSec, endSec) 打开游标，每批按 id 键集分页查询 DB_CURSOR_BATCH 行
+// 批与批之间连接空闲，游标存续期间不可与其他线程共用该连接；maxRows <= 0 表示不限制
+DbCursor *mysql_open_range_cursor(MySQLDataBaseConfig *db, const char *table,
+                                  long long startSec, long long endSec, long long maxRows);
+
 // MySQL 数据处理函数
 int StartMySQLDataHandler(const char *clientConfigJson, DataModel *dataModel, CustomizedClient *customizedClient, VisitorConfig *visitorConfig, int reportCycleMs);
 int StopMySQLDataHandler(MySQLDataHandlerArgs *args);
@@ -1,10 +1,14 @@
 #include "recorder.h"
 #include "log/log.h"
+#include "data/rollup/rollup.h"
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <stdio.h>
 
 static MySQLDataBaseConfig *g_mysql_db = NULL;
+static RollupEngine *g_rollup = NULL;
+static MySQLDataBaseConfig *g_rollup_db = NULL;   // 汇总线程独立连接
 
 void mysql_recorder_set_db(MySQLDataBaseConfig *db) {
     g_mysql_db = db;
@@ -35,6 +39,19 @@ static void sanitize_id(const char *in, char *out, size_t outsz, const char *fal
     if (j == 0) strlcpy(out, fallback, outsz);
 }
 
+MySQLDataBaseConfig *mysql_recorder_get_db(void) {
+    return g_mysql_db;
+}
+
+void mysql_recorder_table_name(const char *ns, const char *deviceName, const char *propertyName,
+                               char *out, size_t outsz) {
+    char ns_s[128], dev_s[128], prop_s[128];
+    sanitize_id(ns, ns_s, sizeof(ns_s), "default");
+    sanitize_id(deviceName, dev_s, sizeof(dev_s), "device");
+    sanitize_id(propertyName, prop_s, sizeof(prop_s), "property");
+    snprintf(out, outsz, "%s/%s/%s", ns_s, dev_s, prop_s);
+}
+
 int mysql_recorder_record(const char *ns,
                           const char *deviceName,
                           const char *propertyName,
@@ -47,6 +64,11 @@ int mysql_recorder_record(const char *ns,
     sanitize_id(deviceName, dev_s, sizeof(dev_s), "device");
     sanitize_id(propertyName, prop_s, sizeof(prop_s), "property");
 
+    if (g_rollup) {
+        rollup_ingest(g_rollup, ns_s, dev_s, prop_s, value, ts_ms);
+        if (!rollup_store_raw(g_rollup)) return 0;
+    }
+
     DataModel dm = (DataModel){0};
     dm.namespace_   = ns_s;
     dm.deviceName   = dev_s;
@@ -62,4 +84,86 @@ int mysql_recorder_record(const char *ns,
         log_debug("MySQL record ok: %s/%s/%s=%s", ns_s, dev_s, prop_s, dm.value);
     }
     return rc;
-}
\ No newline at end of file
+}
+
+static int rollup_mysql_write(void *arg, const RollupPoint *p) {
+    MySQLDataBaseConfig *db = (MySQLDataBaseConfig*)arg;
+    char label[16], table[512];
+    rollup_window_label(p->windowSec, label, sizeof(label));
+    // 引擎内已是 sanitize 后的名字
+    snprintf(table, sizeof(table), "%s/%s/%s@%s", p->ns, p->device, p->property, label);
+    return mysql_add_rollup(db, table, p->startSec, p->count, p->numericCount > 0,
+                            p->min, p->max, p->avg, p->last);
+}
+
+static int rollup_mysql_prune(void *arg, const char *ns, const char *device, const char *property,
+                              long long olderThanSec) {
+    MySQLDataBaseConfig *db = (MySQLDataBaseConfig*)arg;
+    char table[512];
+    snprintf(table, sizeof(table), "%s/%s/%s", ns, device, property);
+    return mysql_delete_before(db, table, olderThanSec);
+}
+
+static int rollup_mysql_prepare(void *arg, const char *ns, const char *device, const char *property) {
+    MySQLDataBaseConfig *db = (MySQLDataBaseConfig*)arg;
+    char table[512];
+    snprintf(table, sizeof(table), "%s/%s/%s", ns, device, property);
+    return mysql_ensure_ts_index(db, table);
+}
+
+int mysql_recorder_start_rollup(const char *windows, int storeRaw, const char *rawRetention) {
+    if (g_rollup) return 0;
+    if (!g_mysql_db) {
+        log_warn("rollup requires MySQL recorder, skipped");
+        return -1;
+    }
+    RollupOptions opts = {0};
+    opts.windowCount = rollup_parse_windows(windows, opts.windows, ROLLUP_MAX_WINDOWS);
+    if (opts.windowCount <= 0) {
+        log_error("invalid rollup windows: %s", windows ? windows : "(null)");
+        return -1;
+    }
+    opts.storeRaw = storeRaw;
+    if (rawRetention && *rawRetention) {
+        opts.rawRetentionSec = rollup_parse_duration(rawRetention);
+        if (opts.rawRetentionSec < 0) {
+            log_error("invalid rollup raw_retention: %s", rawRetention);
+            return -1;
+        }
+    }
+
+    g_rollup_db = mysql_clone_client(g_mysql_db);
+    if (!g_rollup_db) {
+        log_error("rollup: failed to open MySQL connection");
+        return -1;
+    }
+    RollupSink sink = {
+        .write = rollup_mysql_write,
+        .prune_raw = rollup_mysql_prune,
+        .prepare_raw = rollup_mysql_prepare,
+        .arg = g_rollup_db,
+    };
+    RollupEngine *engine = rollup_new(&opts, &sink);
+    if (!engine || rollup_start(engine) != 0) {
+        rollup_free(engine);
+        FreeMySQLDataBaseClient(g_rollup_db);
+        g_rollup_db = NULL;
+        log_error("rollup: failed to start");
+        return -1;
+    }
+    g_rollup = engine;
+    log_info("MySQL rollup started: windows=%s store_raw=%d raw_retention=%s",
+             windows, storeRaw, (rawRetention && *rawRetention) ? rawRetention : "forever");
+    return 0;
+}
+
+void mysql_recorder_stop_rollup(void) {
+    if (!g_rollup) return;
+    RollupEngine *engine = g_rollup;
+    g_rollup = NULL;
+    rollup_stop(engine, 1);
+    rollup_free(engine);
+    FreeMySQLDataBaseClient(g_rollup_db);
+    g_rollup_db = NULL;
+    log_info("MySQL rollup stopped");
+}
@@ -17,6 +17,20 @@ int mysql_recorder_record(const char *ns,
                           const char *value,
                           long long ts_ms);
 
+// 当前注入的连接（可能为 NULL）；其他线程只应读取配置，不可直接使用 conn
+MySQLDataBaseConfig *mysql_recorder_get_db(void);
+
+// 生成与 record 写入时一致的表名 ns/device/property
+void mysql_recorder_table_name(const char *ns, const char *deviceName, const char *propertyName,
+                               char *out, size_t outsz);
+
+// 开启降采样：windows 如 "10s,1m,1h"，汇总写入 ns/device/property@10s 等表；
+// storeRaw 为 0 时不再写原始数据，rawRetention（如 "24h"，空为不清理）限定原始数据保留时长
+// 需在 mysql_recorder_set_db 之后调用
+int mysql_recorder_start_rollup(const char *windows, int storeRaw, const char *rawRetention);
+// 停止降采样并写出未结束的桶，需在关闭 MySQL 连接之前调用
+void mysql_recorder_stop_rollup(void);
+
 #ifdef __cplusplus
 }
 #endif
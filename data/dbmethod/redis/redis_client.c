@@ -1,8 +1,10 @@
 #include "redis_client.h"
 #include "log/log.h"
+#include "common/intern.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <limits.h>
 #include <cjson/cJSON.h>
 
 int redis_parse_client_config(const char *json, RedisClientConfig *out) {
@@ -142,54 +144,144 @@ int redis_add_data(RedisDataBaseConfig *db, const DataModel *data) {
     return 0;
 }
 
-int redis_get_data_by_device_id(RedisDataBaseConfig *db, const char *deviceID, DataModel ***dataModels, int *count) {
-    if (!db || !db->conn || !deviceID || !dataModels || !count) return -1;
-    
-    // 使用 ZREVRANGE 命令获取数据（按时间戳倒序）
-    redisReply *reply = redisCommand(db->conn, "ZREVRANGE %s 0 -1", deviceID);
-    
-    if (reply == NULL) {
-        log_error("ZREVRANGE command failed");
-        return -1;
+typedef struct {
+    RedisDataBaseConfig *db;
+    char *key;
+    char min[32];               // 下一页的起始分值，首页为调用方给的下限
+    char max[32];
+    long long lastScore;        // 已读出的最大分值
+    long long tied;             // 已读出的分值等于 lastScore 的成员数，下一页跳过它们
+    int exhausted;
+} RedisCursorImpl;
+
+// 成员格式见 redis_add_data："TimeStamp: <ts> PropertyName: <name> data: <value>"
+static int redis_cursor_push_member(DbCursor *cursor, long long score, const char *member, size_t len) {
+    const char *prop = strstr(member, "PropertyName: ");
+    const char *data = prop ? strstr(prop, " data: ") : NULL;
+    if (!prop || !data) {
+        return db_cursor_push(cursor, (int64_t)score, NULL, 0, member, len);
     }
-    
-    if (reply->type == REDIS_REPLY_ERROR) {
-        log_error("ZREVRANGE failed: %s", reply->str);
-        freeReplyObject(reply);
+    prop += strlen("PropertyName: ");
+    const char *value = data + strlen(" data: ");
+    return db_cursor_push(cursor, (int64_t)score, prop, (size_t)(data - prop),
+                          value, len - (size_t)(value - member));
+}
+
+static int redis_cursor_fetch(DbCursor *cursor) {
+    RedisCursorImpl *impl = (RedisCursorImpl*)cursor->impl;
+    if (impl->exhausted) return 0;
+    // 按分值键集分页：从上一页最后的分值开始，只跳过同分值已读过的成员，
+    // 不再用递增的 LIMIT offset 让 Redis 每页从头数过已读的行
+    redisReply *reply = redisCommand(impl->db->conn, "ZRANGEBYSCORE %s %s %s WITHSCORES LIMIT %lld %d",
+                                     impl->key, impl->min, impl->max, impl->tied, DB_CURSOR_BATCH);
+    if (!reply) {
+        log_error("ZRANGEBYSCORE command failed");
         return -1;
     }
-    
     if (reply->type != REDIS_REPLY_ARRAY) {
-        log_error("Unexpected reply type");
+        log_error("ZRANGEBYSCORE failed: %s", reply->type == REDIS_REPLY_ERROR ? reply->str : "unexpected reply");
         freeReplyObject(reply);
         return -1;
     }
-    
-    *count = reply->elements;
-    if (*count == 0) {
-        *dataModels = NULL;
-        freeReplyObject(reply);
-        return 0;
+    size_t pairs = reply->elements / 2;
+    for (size_t i = 0; i < pairs; i++) {
+        redisReply *member = reply->element[2 * i];
+        redisReply *score = reply->element[2 * i + 1];
+        if (!member->str) continue;
+        long long ts = score->str ? atoll(score->str) : 0;
+        if (redis_cursor_push_member(cursor, ts, member->str, member->len) < 0) {
+            freeReplyObject(reply);
+            return -1;
+        }
+        if (ts != impl->lastScore) {
+            impl->lastScore = ts;
+            impl->tied = 0;
+        }
+        impl->tied++;
     }
-    
-    // 分配内存存储数据模型
-    *dataModels = calloc(*count, sizeof(DataModel*));
-    if (!*dataModels) {
-        log_error("Failed to allocate memory for data models");
-        freeReplyObject(reply);
-        return -1;
+    if (pairs < DB_CURSOR_BATCH) impl->exhausted = 1;
+    else snprintf(impl->min, sizeof(impl->min), "%lld", impl->lastScore);
+    freeReplyObject(reply);
+    return cursor->count;
+}
+
+static void redis_cursor_close(DbCursor *cursor) {
+    RedisCursorImpl *impl = (RedisCursorImpl*)cursor->impl;
+    if (!impl) return;
+    free(impl->key);
+    free(impl);
+}
+
+static const DbCursorOps g_redis_cursor_ops = {
+    .fetch = redis_cursor_fetch,
+    .close = redis_cursor_close,
+};
+
+DbCursor *redis_open_range_cursor(RedisDataBaseConfig *db, const char *key,
+                                  long long minScore, long long maxScore) {
+    if (!db || !db->conn || !key) return NULL;
+    RedisCursorImpl *impl = calloc(1, sizeof(RedisCursorImpl));
+    if (!impl) return NULL;
+    impl->db = db;
+    impl->key = strdup(key);
+    if (minScore == LLONG_MIN) snprintf(impl->min, sizeof(impl->min), "-inf");
+    else snprintf(impl->min, sizeof(impl->min), "%lld", minScore);
+    if (maxScore == LLONG_MAX) snprintf(impl->max, sizeof(impl->max), "+inf");
+    else snprintf(impl->max, sizeof(impl->max), "%lld", maxScore);
+    DbCursor *cursor = impl->key ? db_cursor_new(&g_redis_cursor_ops, impl) : NULL;
+    if (!cursor) {
+        free(impl->key);
+        free(impl);
     }
-    
-    // 解析返回的数据（这里简化处理，实际应该解析 deviceData 字符串）
-    for (int i = 0; i < *count; i++) {
-        (*dataModels)[i] = calloc(1, sizeof(DataModel));
-        if ((*dataModels)[i]) {
-            (*dataModels)[i]->deviceName = strdup(deviceID);
-            (*dataModels)[i]->value = strdup(reply->element[i]->str);
-            // 可以进一步解析 TimeStamp 和 PropertyName
+    return cursor;
+}
+
+// 兼容旧接口：经游标分批读取后按时间倒序返回全部数据
+int redis_get_data_by_device_id(RedisDataBaseConfig *db, const char *deviceID, DataModel ***dataModels, int *count) {
+    if (!db || !db->conn || !deviceID || !dataModels || !count) return -1;
+    *dataModels = NULL;
+    *count = 0;
+
+    DbCursor *cursor = redis_open_range_cursor(db, deviceID, LLONG_MIN, LLONG_MAX);
+    if (!cursor) return -1;
+
+    DataModel **models = NULL;
+    int total = 0, cap = 0, n;
+    while ((n = db_cursor_next(cursor)) > 0) {
+        if (total + n > cap) {
+            int newCap = cap ? cap * 2 : DB_CURSOR_BATCH;
+            while (newCap < total + n) newCap *= 2;
+            DataModel **p = realloc(models, sizeof(DataModel*) * (size_t)newCap);
+            if (!p) { n = -1; break; }
+            models = p;
+            cap = newCap;
+        }
+        for (int i = 0; i < n; i++) {
+            const DbRow *row = &cursor->rows[i];
+            DataModel *dm = calloc(1, sizeof(DataModel));
+            if (!dm) continue;
+            dm->interned = 1;   // 同一查询内名字全部相同，驻留而不是逐行复制
+            dm->deviceName = (char*)intern(deviceID);
+            dm->propertyName = (char*)intern(row->propertyName);
+            dm->value = strdup(row->value);
+            dm->timeStamp = row->timeStamp;
+            models[total++] = dm;
         }
     }
-    
-    freeReplyObject(reply);
+    db_cursor_close(cursor);
+    if (n < 0) {
+        for (int i = 0; i < total; i++) datamodel_free(models[i]);
+        free(models);
+        return -1;
+    }
+
+    // 游标为升序，旧接口约定为倒序
+    for (int i = 0, j = total - 1; i < j; i++, j--) {
+        DataModel *t = models[i];
+        models[i] = models[j];
+        models[j] = t;
+    }
+    *dataModels = models;
+    *count = total;
     return 0;
-}
\ No newline at end of file
+}
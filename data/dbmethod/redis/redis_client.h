@@ -3,6 +3,7 @@
 
 #include "common/datamodel.h"
 #include "driver/driver.h"
+#include "data/dbmethod/cursor.h"
 #include <hiredis/hiredis.h>
 
 typedef struct {
@@ -33,6 +34,11 @@ int redis_init_client(RedisDataBaseConfig *db);
 void redis_close_client(RedisDataBaseConfig *db);
 int redis_add_data(RedisDataBaseConfig *db, const DataModel *data);
 int redis_get_data_by_device_id(RedisDataBaseConfig *db, const char *deviceID, DataModel ***dataModels, int *count);
+// 按分值（写入时的 timeStamp，redis handler 写入秒）范围升序打开游标，ZRANGEBYSCORE 按分值键集分页，每批 DB_CURSOR_BATCH 个
+// 行的 timeStamp 即原始分值，不做单位换算
+// minScore/maxScore 取 LLONG_MIN/LLONG_MAX 表示不限
+DbCursor *redis_open_range_cursor(RedisDataBaseConfig *db, const char *key,
+                                  long long minScore, long long maxScore);
 
 // Redis 数据处理函数
 int StartRedisDataHandler(const char *clientConfigJson, DataModel *dataModel, CustomizedClient *customizedClient, VisitorConfig *visitorConfig, int reportCycleMs);
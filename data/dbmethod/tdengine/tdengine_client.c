@@ -1,5 +1,6 @@
 #include "tdengine_client.h"
 #include "log/log.h"
+#include "common/intern.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -235,6 +236,7 @@ int tdengine_get_data_by_device_id(TDEngineDataBaseConfig *db, const char *devic
                 (*dataModels)[i]->timeStamp = *(int64_t*)row[0] * 1000; // 转换为毫秒
             }
             // 解析其他字段
+            // 查询结果里的名字来自库中任意历史数据，复制而不驻留（驻留表永不释放）
             if (row[1]) (*dataModels)[i]->deviceName = strdup((char*)row[1]);
             if (row[2]) (*dataModels)[i]->propertyName = strdup((char*)row[2]);
             if (row[3]) (*dataModels)[i]->value = strdup((char*)row[3]);
@@ -248,54 +250,140 @@ int tdengine_get_data_by_device_id(TDEngineDataBaseConfig *db, const char *devic
     return 0;
 }
 
-int tdengine_get_data_by_time_range(TDEngineDataBaseConfig *db, const char *deviceID, int64_t start, int64_t end, DataModel ***dataModels, int *count) {
-    if (!db || !db->conn || !deviceID || !dataModels || !count) return -1;
-    
+typedef struct {
+    TAOS_RES *res;
+    TAOS_ROW block;             // 当前块，按列存放
+    int blockRows;
+    int pos;                    // 当前块中下一行
+    int *propOffsets;           // 变长列的行偏移，-1 表示 NULL
+    int *dataOffsets;
+} TDEngineCursorImpl;
+
+// 变长列：偏移处为 2 字节长度 + 内容
+static const char *td_var_value(const TAOS_ROW block, int col, const int *offsets, int row, size_t *len) {
+    if (!offsets || offsets[row] < 0) return NULL;
+    const char *p = (const char*)block[col] + offsets[row];
+    uint16_t n;
+    memcpy(&n, p, sizeof(n));
+    *len = n;
+    return p + sizeof(n);
+}
+
+static int tdengine_cursor_fetch(DbCursor *cursor) {
+    TDEngineCursorImpl *impl = (TDEngineCursorImpl*)cursor->impl;
+    for (;;) {
+        if (impl->pos >= impl->blockRows) {
+            impl->blockRows = taos_fetch_block(impl->res, &impl->block);
+            impl->pos = 0;
+            if (impl->blockRows <= 0) {
+                if (taos_errno(impl->res) != 0) {
+                    log_error("taos_fetch_block failed: %s", taos_errstr(impl->res));
+                    return -1;
+                }
+                return cursor->count;
+            }
+            impl->propOffsets = taos_get_column_data_offset(impl->res, 1);
+            impl->dataOffsets = taos_get_column_data_offset(impl->res, 2);
+        }
+        while (impl->pos < impl->blockRows) {
+            int r = impl->pos;
+            int64_t ts = ((const int64_t*)impl->block[0])[r];
+            size_t propLen = 0, dataLen = 0;
+            const char *prop = td_var_value(impl->block, 1, impl->propOffsets, r, &propLen);
+            const char *data = td_var_value(impl->block, 2, impl->dataOffsets, r, &dataLen);
+            int rc = db_cursor_push(cursor, ts, prop, propLen, data, dataLen);
+            if (rc < 0) return -1;
+            impl->pos++;
+            if (rc > 0) return cursor->count;
+        }
+    }
+}
+
+static void tdengine_cursor_close(DbCursor *cursor) {
+    TDEngineCursorImpl *impl = (TDEngineCursorImpl*)cursor->impl;
+    if (!impl) return;
+    if (impl->res) taos_free_result(impl->res);
+    free(impl);
+}
+
+static const DbCursorOps g_tdengine_cursor_ops = {
+    .fetch = tdengine_cursor_fetch,
+    .close = tdengine_cursor_close,
+};
+
+DbCursor *tdengine_open_range_cursor(TDEngineDataBaseConfig *db, const char *deviceID,
+                                     int64_t startMs, int64_t endMs) {
+    if (!db || !db->conn || !deviceID) return NULL;
+
     char *legalTable = replace_char(deviceID, '-', '_');
-    
-    // 转换时间戳为字符串
-    time_t start_time = start;
-    time_t end_time = end;
-    struct tm *start_tm = gmtime(&start_time);
-    struct tm *end_tm = gmtime(&end_time);
-    
-    char start_str[64], end_str[64];
-    strftime(start_str, sizeof(start_str), "%Y-%m-%d %H:%M:%S", start_tm);
-    strftime(end_str, sizeof(end_str), "%Y-%m-%d %H:%M:%S", end_tm);
-    
+    if (!legalTable) return NULL;
     char querySQL[1024];
-    snprintf(querySQL, sizeof(querySQL), 
-            "SELECT ts, deviceid, propertyname, data, type FROM %s WHERE ts >= '%s' AND ts <= '%s'",
-            legalTable, start_str, end_str);
-    
-    log_info("Query SQL: %s", querySQL);
-    
+    // 直接用毫秒时间戳比较，避免本地时间/UTC 字符串不一致
+    snprintf(querySQL, sizeof(querySQL),
+             "SELECT ts, propertyname, data FROM %s WHERE ts >= %lld AND ts < %lld",
+             legalTable, (long long)startMs, (long long)endMs);
+    free(legalTable);
+
     TAOS_RES *result = taos_query(db->conn, querySQL);
     if (taos_errno(result) != 0) {
         log_error("Failed to query data by time range: %s", taos_errstr(result));
-        free(legalTable);
         taos_free_result(result);
-        return -1;
+        return NULL;
     }
-    
-    // 计算行数并分配内存（类似上面的实现）
-    *count = 0;
-    TAOS_ROW row;
-    while ((row = taos_fetch_row(result)) != NULL) {
-        (*count)++;
+    TDEngineCursorImpl *impl = calloc(1, sizeof(TDEngineCursorImpl));
+    if (!impl) {
+        taos_free_result(result);
+        return NULL;
     }
-    
-    if (*count == 0) {
-        *dataModels = NULL;
-        free(legalTable);
+    impl->res = result;
+    DbCursor *cursor = db_cursor_new(&g_tdengine_cursor_ops, impl);
+    if (!cursor) {
         taos_free_result(result);
-        return 0;
+        free(impl);
     }
-    
-    // 重新查询并填充数据（重复上面的逻辑）
-    // ... (实现类似 tdengine_get_data_by_device_id)
-    
-    free(legalTable);
-    taos_free_result(result);
+    return cursor;
+}
+
+// 兼容旧接口：经游标读取 [start, end] 范围内的数据，start/end 仍为秒（与旧版按秒级时间字符串比较一致），
+// 换算为毫秒 [start*1000, (end+1)*1000) 交给游标
+int tdengine_get_data_by_time_range(TDEngineDataBaseConfig *db, const char *deviceID, int64_t start, int64_t end, DataModel ***dataModels, int *count) {
+    if (!db || !db->conn || !deviceID || !dataModels || !count) return -1;
+    *dataModels = NULL;
+    *count = 0;
+
+    DbCursor *cursor = tdengine_open_range_cursor(db, deviceID, start * 1000, (end + 1) * 1000);
+    if (!cursor) return -1;
+
+    DataModel **models = NULL;
+    int total = 0, cap = 0, n;
+    while ((n = db_cursor_next(cursor)) > 0) {
+        if (total + n > cap) {
+            int newCap = cap ? cap * 2 : DB_CURSOR_BATCH;
+            while (newCap < total + n) newCap *= 2;
+            DataModel **p = realloc(models, sizeof(DataModel*) * (size_t)newCap);
+            if (!p) { n = -1; break; }
+            models = p;
+            cap = newCap;
+        }
+        for (int i = 0; i < n; i++) {
+            const DbRow *row = &cursor->rows[i];
+            DataModel *dm = calloc(1, sizeof(DataModel));
+            if (!dm) continue;
+            dm->interned = 1;   // 同一查询内名字全部相同，驻留而不是逐行复制
+            dm->deviceName = (char*)intern(deviceID);
+            dm->propertyName = (char*)intern(row->propertyName);
+            dm->value = strdup(row->value);
+            dm->timeStamp = row->timeStamp;
+            models[total++] = dm;
+        }
+    }
+    db_cursor_close(cursor);
+    if (n < 0) {
+        for (int i = 0; i < total; i++) datamodel_free(models[i]);
+        free(models);
+        return -1;
+    }
+    *dataModels = models;
+    *count = total;
     return 0;
-}
\ No newline at end of file
+}
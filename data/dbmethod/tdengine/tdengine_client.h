@@ -3,6 +3,7 @@
 
 #include "common/datamodel.h"
 #include "driver/driver.h"
+#include "data/dbmethod/cursor.h"
 #include <taos.h>
 
 typedef struct {
@@ -32,7 +33,11 @@ int tdengine_init_client(TDEngineDataBaseConfig *db);
 void tdengine_close_client(TDEngineDataBaseConfig *db);
 int tdengine_add_data(TDEngineDataBaseConfig *db, const DataModel *data);
 int tdengine_get_data_by_device_id(TDEngineDataBaseConfig *db, const char *deviceID, DataModel ***dataModels, int *count);
+// start/end 为秒，闭区间
 int tdengine_get_data_by_time_range(TDEngineDataBaseConfig *db, const char *deviceID, int64_t start, int64_t end, DataModel ***dataModels, int *count);
+// 按时间范围 [startMs, endMs) 打开游标，经 taos_fetch_block 按块读取
+DbCursor *tdengine_open_range_cursor(TDEngineDataBaseConfig *db, const char *deviceID,
+                                     int64_t startMs, int64_t endMs);
 
 // TDengine 数据处理函数
 int StartTDEngineDataHandler(const char *clientConfigJson, DataModel *dataModel, CustomizedClient *customizedClient, VisitorConfig *visitorConfig, int reportCycleMs);
@@ -5,6 +5,9 @@
 #include <unistd.h>
 #include <cjson/cJSON.h>
 #include <stdio.h>  // 新增：修复 snprintf 隐式声明
+#include <time.h>
+
+#define MQTT_DRAIN_TIMEOUT_MS 2000   // 释放前等待在途消息的上限
 
 // 解析 MQTT 配置
 int mqtt_parse_config(const char *json, MqttPublishConfig *config) {
@@ -72,6 +75,12 @@ static void mqtt_disconnect_callback(struct mosquitto *mosq, void *userdata, int
     log_warn("MQTT disconnected: %s", rc ? "unexpected" : "clean");
 }
 
+// 消息已写出（QoS 0）或已收到确认（QoS 1/2）
+static void mqtt_publish_callback(struct mosquitto *mosq, void *userdata, int mid) {
+    MqttPublisher *publisher = (MqttPublisher*)userdata;
+    __atomic_sub_fetch(&publisher->inflight, 1, __ATOMIC_RELAXED);
+}
+
 // 创建 MQTT 发布器
 MqttPublisher *mqtt_publisher_new(const char *config_json) {
     if (!config_json) return NULL;
@@ -107,6 +116,7 @@ MqttPublisher *mqtt_publisher_new(const char *config_json) {
     // 设置回调
     mosquitto_connect_callback_set(publisher->mosq, mqtt_connect_callback);
     mosquitto_disconnect_callback_set(publisher->mosq, mqtt_disconnect_callback);
+    mosquitto_publish_callback_set(publisher->mosq, mqtt_publish_callback);
     
     // 设置用户名密码
     if (publisher->config.username && publisher->config.password) {
@@ -123,6 +133,19 @@ void mqtt_publisher_free(MqttPublisher *publisher) {
     if (!publisher) return;
     
     if (publisher->mosq) {
+        // 限时排空：在途消息送达后再断开，避免关停丢掉最后一批 QoS 1/2 数据
+        struct timespec t0, now;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        while (publisher->connected && __atomic_load_n(&publisher->inflight, __ATOMIC_RELAXED) > 0) {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            long long elapsed = (long long)(now.tv_sec - t0.tv_sec) * 1000 + (now.tv_nsec - t0.tv_nsec) / 1000000;
+            if (elapsed >= MQTT_DRAIN_TIMEOUT_MS) {
+                log_warn("MQTT drain timed out, %d message(s) not acknowledged",
+                         __atomic_load_n(&publisher->inflight, __ATOMIC_RELAXED));
+                break;
+            }
+            mosquitto_loop(publisher->mosq, 100, 1);
+        }
         if (publisher->connected) {
             mosquitto_disconnect(publisher->mosq);
         }
@@ -203,6 +226,7 @@ int mqtt_publisher_publish(MqttPublisher *publisher, const DataModel *data) {
         free(json_string);
         return -1;
     }
+    __atomic_add_fetch(&publisher->inflight, 1, __ATOMIC_RELAXED);
     
     // 处理网络事件确保消息发送完成
     mosquitto_loop(publisher->mosq, 100, 1);
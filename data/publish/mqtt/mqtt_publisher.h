@@ -21,6 +21,7 @@ typedef struct {
     MqttPublishConfig config;
     struct mosquitto *mosq;
     int connected;
+    int inflight;        // 已提交但尚未发送/确认的消息数，释放前据此排空
 } MqttPublisher;
 
 // 函数声明
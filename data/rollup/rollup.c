@@ -0,0 +1,379 @@
+#include "data/rollup/rollup.h"
+#include "log/log.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <time.h>
+#include <pthread.h>
+
+#define ROLLUP_HASH_SIZE 1024
+#define ROLLUP_PRUNE_INTERVAL 60
+
+typedef struct {
+    long long start;
+    long long count;
+    long long numericCount;
+    double min;
+    double max;
+    double sum;
+    char last[ROLLUP_LAST_MAX];
+} RollupBucket;
+
+typedef struct {
+    int open;
+    RollupBucket cur;
+    RollupBucket ring[ROLLUP_RING_SIZE];   // 已关闭、待写出的桶
+    int head;
+    int pending;
+} RollupWindow;
+
+typedef struct RollupSeries {
+    char *ns;
+    char *device;
+    char *property;
+    unsigned int hash;
+    RollupWindow windows[ROLLUP_MAX_WINDOWS];
+    struct RollupSeries *next;      // 哈希链
+    struct RollupSeries *allNext;   // 全部序列链表，序列在引擎生命周期内不删除
+    int rawPrepared;                // prepare_raw 已成功（只在 flush 中访问）
+} RollupSeries;
+
+struct RollupEngine {
+    RollupOptions opts;
+    RollupSink sink;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    RollupSeries *table[ROLLUP_HASH_SIZE];
+    RollupSeries *all;
+    int seriesCount;
+    long long dropped;              // 环形缓冲溢出或写出失败丢弃的桶
+    long long lastPruneSec;
+    pthread_t thread;
+    int running;
+    int started;
+};
+
+// 待写出的桶（拷贝出锁外写入）
+typedef struct {
+    RollupSeries *series;
+    long long windowSec;
+    RollupBucket bucket;
+} RollupOut;
+
+static unsigned int series_hash(const char *ns, const char *device, const char *property) {
+    unsigned int h = 2166136261u;
+    const char *parts[3] = {ns, device, property};
+    for (int i = 0; i < 3; i++) {
+        for (const unsigned char *p = (const unsigned char*)parts[i]; *p; p++) {
+            h ^= *p;
+            h *= 16777619u;
+        }
+        h ^= '/';
+        h *= 16777619u;
+    }
+    return h;
+}
+
+long long rollup_parse_duration(const char *s) {
+    if (!s) return -1;
+    while (isspace((unsigned char)*s)) s++;
+    if (!isdigit((unsigned char)*s)) return -1;
+    char *end = NULL;
+    long long v = strtoll(s, &end, 10);
+    while (end && isspace((unsigned char)*end)) end++;
+    if (!end || !*end) return v;
+    long long mul;
+    switch (tolower((unsigned char)*end)) {
+        case 's': mul = 1; break;
+        case 'm': mul = 60; break;
+        case 'h': mul = 3600; break;
+        case 'd': mul = 86400; break;
+        default: return -1;
+    }
+    end++;
+    while (isspace((unsigned char)*end)) end++;
+    return *end ? -1 : v * mul;
+}
+
+int rollup_parse_windows(const char *spec, long long *out, int max) {
+    if (!spec || !out || max <= 0) return -1;
+    int n = 0;
+    const char *p = spec;
+    while (*p) {
+        const char *end = strchr(p, ',');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        char tok[32];
+        if (len > 0) {
+            if (len >= sizeof(tok) || n >= max) return -1;
+            memcpy(tok, p, len);
+            tok[len] = '\0';
+            long long w = rollup_parse_duration(tok);
+            if (w <= 0) return -1;
+            out[n++] = w;
+        }
+        p += len;
+        if (*p == ',') p++;
+    }
+    return n;
+}
+
+void rollup_window_label(long long windowSec, char *buf, int buflen) {
+    if (windowSec % 86400 == 0) snprintf(buf, (size_t)buflen, "%lldd", windowSec / 86400);
+    else if (windowSec % 3600 == 0) snprintf(buf, (size_t)buflen, "%lldh", windowSec / 3600);
+    else if (windowSec % 60 == 0) snprintf(buf, (size_t)buflen, "%lldm", windowSec / 60);
+    else snprintf(buf, (size_t)buflen, "%llds", windowSec);
+}
+
+RollupEngine *rollup_new(const RollupOptions *opts, const RollupSink *sink) {
+    if (!opts || !sink || !sink->write || opts->windowCount <= 0 ||
+        opts->windowCount > ROLLUP_MAX_WINDOWS) return NULL;
+    RollupEngine *engine = calloc(1, sizeof(RollupEngine));
+    if (!engine) return NULL;
+    engine->opts = *opts;
+    if (engine->opts.flushIntervalMs <= 0) engine->opts.flushIntervalMs = 1000;
+    engine->sink = *sink;
+    pthread_mutex_init(&engine->mutex, NULL);
+    pthread_cond_init(&engine->cond, NULL);
+    engine->lastPruneSec = (long long)time(NULL);
+    return engine;
+}
+
+int rollup_store_raw(const RollupEngine *engine) {
+    return engine ? engine->opts.storeRaw : 1;
+}
+
+static RollupSeries *series_get(RollupEngine *engine, const char *ns, const char *device, const char *property) {
+    unsigned int h = series_hash(ns, device, property);
+    RollupSeries **slot = &engine->table[h % ROLLUP_HASH_SIZE];
+    for (RollupSeries *s = *slot; s; s = s->next) {
+        if (s->hash == h && strcmp(s->property, property) == 0 &&
+            strcmp(s->device, device) == 0 && strcmp(s->ns, ns) == 0) return s;
+    }
+    RollupSeries *s = calloc(1, sizeof(RollupSeries));
+    if (!s) return NULL;
+    s->ns = strdup(ns);
+    s->device = strdup(device);
+    s->property = strdup(property);
+    if (!s->ns || !s->device || !s->property) {
+        free(s->ns); free(s->device); free(s->property); free(s);
+        return NULL;
+    }
+    s->hash = h;
+    s->next = *slot;
+    *slot = s;
+    s->allNext = engine->all;
+    engine->all = s;
+    engine->seriesCount++;
+    return s;
+}
+
+// 关闭当前桶，放入待写出环形缓冲；满时覆盖最旧的一个
+static void window_close(RollupEngine *engine, RollupWindow *w) {
+    if (!w->open) return;
+    w->open = 0;
+    if (w->pending == ROLLUP_RING_SIZE) {
+        w->head = (w->head + 1) % ROLLUP_RING_SIZE;
+        w->pending--;
+        engine->dropped++;
+    }
+    w->ring[(w->head + w->pending) % ROLLUP_RING_SIZE] = w->cur;
+    w->pending++;
+}
+
+static long long align_down(long long t, long long window) {
+    long long r = t % window;
+    return r < 0 ? t - r - window : t - r;
+}
+
+int rollup_ingest(RollupEngine *engine, const char *ns, const char *device,
+                  const char *property, const char *value, long long tsMs) {
+    if (!engine || !device || !property || !value) return -1;
+    if (!ns) ns = "default";
+    long long tsSec = tsMs / 1000;
+
+    char *endp = NULL;
+    double v = strtod(value, &endp);
+    int numeric = (endp != value && *endp == '\0');
+
+    pthread_mutex_lock(&engine->mutex);
+    RollupSeries *s = series_get(engine, ns, device, property);
+    if (!s) {
+        pthread_mutex_unlock(&engine->mutex);
+        return -1;
+    }
+    for (int i = 0; i < engine->opts.windowCount; i++) {
+        long long window = engine->opts.windows[i];
+        long long start = align_down(tsSec, window);
+        RollupWindow *w = &s->windows[i];
+        if (w->open && start != w->cur.start) {
+            if (start < w->cur.start) continue;   // 迟到的样本已不属于任何未关闭的桶
+            window_close(engine, w);
+        }
+        if (!w->open) {
+            memset(&w->cur, 0, sizeof(w->cur));
+            w->cur.start = start;
+            w->open = 1;
+        }
+        RollupBucket *b = &w->cur;
+        b->count++;
+        if (numeric) {
+            if (b->numericCount == 0 || v < b->min) b->min = v;
+            if (b->numericCount == 0 || v > b->max) b->max = v;
+            b->sum += v;
+            b->numericCount++;
+        }
+        snprintf(b->last, sizeof(b->last), "%s", value);
+    }
+    pthread_mutex_unlock(&engine->mutex);
+    return 0;
+}
+
+// 收集所有待写出的桶；closeAll 非 0 时连同未结束的桶一起关闭
+static RollupOut *collect(RollupEngine *engine, long long nowSec, int closeAll, int *outCount) {
+    RollupOut *out = NULL;
+    int n = 0, cap = 0;
+    pthread_mutex_lock(&engine->mutex);
+    for (RollupSeries *s = engine->all; s; s = s->allNext) {
+        for (int i = 0; i < engine->opts.windowCount; i++) {
+            RollupWindow *w = &s->windows[i];
+            long long window = engine->opts.windows[i];
+            // 窗口已过去的桶即使没有新样本也要关闭
+            if (w->open && (closeAll || w->cur.start + window <= nowSec)) window_close(engine, w);
+            while (w->pending > 0) {
+                if (n == cap) {
+                    int newCap = cap ? cap * 2 : 64;
+                    RollupOut *p = realloc(out, sizeof(RollupOut) * (size_t)newCap);
+                    if (!p) goto done;
+                    out = p;
+                    cap = newCap;
+                }
+                out[n].series = s;
+                out[n].windowSec = window;
+                out[n].bucket = w->ring[w->head];
+                n++;
+                w->head = (w->head + 1) % ROLLUP_RING_SIZE;
+                w->pending--;
+            }
+        }
+    }
+done:
+    pthread_mutex_unlock(&engine->mutex);
+    *outCount = n;
+    return out;
+}
+
+static void flush(RollupEngine *engine, int closeAll) {
+    long long now = (long long)time(NULL);
+    int n = 0;
+    RollupOut *out = collect(engine, now, closeAll, &n);
+    int failed = 0;
+    for (int i = 0; i < n; i++) {
+        const RollupBucket *b = &out[i].bucket;
+        RollupPoint p = {
+            .ns = out[i].series->ns,
+            .device = out[i].series->device,
+            .property = out[i].series->property,
+            .windowSec = out[i].windowSec,
+            .startSec = b->start,
+            .count = b->count,
+            .numericCount = b->numericCount,
+            .min = b->min,
+            .max = b->max,
+            .avg = b->numericCount > 0 ? b->sum / (double)b->numericCount : 0,
+            .last = b->last,
+        };
+        if (engine->sink.write(engine->sink.arg, &p) != 0) failed++;
+    }
+    free(out);
+    if (failed > 0) {
+        pthread_mutex_lock(&engine->mutex);
+        engine->dropped += failed;
+        pthread_mutex_unlock(&engine->mutex);
+        log_warn("rollup: %d bucket(s) failed to write", failed);
+    }
+
+    // 原始数据保留窗口
+    if (engine->opts.rawRetentionSec > 0 && engine->sink.prune_raw &&
+        now - engine->lastPruneSec >= ROLLUP_PRUNE_INTERVAL) {
+        engine->lastPruneSec = now;
+        pthread_mutex_lock(&engine->mutex);
+        RollupSeries *head = engine->all;
+        pthread_mutex_unlock(&engine->mutex);
+        // 序列只在链表头插入且不删除，从快照到的头开始遍历无需持锁
+        for (RollupSeries *s = head; s; s = s->allNext) {
+            if (!s->rawPrepared && engine->sink.prepare_raw &&
+                engine->sink.prepare_raw(engine->sink.arg, s->ns, s->device, s->property) != 0) {
+                continue;
+            }
+            s->rawPrepared = 1;
+            engine->sink.prune_raw(engine->sink.arg, s->ns, s->device, s->property,
+                                   now - engine->opts.rawRetentionSec);
+        }
+    }
+}
+
+static void *rollup_thread(void *arg) {
+    RollupEngine *engine = (RollupEngine*)arg;
+    pthread_mutex_lock(&engine->mutex);
+    while (engine->running) {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += engine->opts.flushIntervalMs / 1000;
+        ts.tv_nsec += (long)(engine->opts.flushIntervalMs % 1000) * 1000000L;
+        if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&engine->cond, &engine->mutex, &ts);
+        if (!engine->running) break;
+        pthread_mutex_unlock(&engine->mutex);
+        flush(engine, 0);
+        pthread_mutex_lock(&engine->mutex);
+    }
+    pthread_mutex_unlock(&engine->mutex);
+    return NULL;
+}
+
+int rollup_start(RollupEngine *engine) {
+    if (!engine || engine->started) return -1;
+    engine->running = 1;
+    if (pthread_create(&engine->thread, NULL, rollup_thread, engine) != 0) {
+        engine->running = 0;
+        return -1;
+    }
+    engine->started = 1;
+    return 0;
+}
+
+void rollup_stop(RollupEngine *engine, int flushPartial) {
+    if (!engine) return;
+    if (engine->started) {
+        pthread_mutex_lock(&engine->mutex);
+        engine->running = 0;
+        pthread_cond_broadcast(&engine->cond);
+        pthread_mutex_unlock(&engine->mutex);
+        pthread_join(engine->thread, NULL);
+        engine->started = 0;
+    }
+    flush(engine, flushPartial);
+    if (engine->dropped > 0) {
+        log_warn("rollup: %lld bucket(s) dropped in total", engine->dropped);
+    }
+}
+
+void rollup_free(RollupEngine *engine) {
+    if (!engine) return;
+    RollupSeries *s = engine->all;
+    while (s) {
+        RollupSeries *next = s->allNext;
+        free(s->ns);
+        free(s->device);
+        free(s->property);
+        free(s);
+        s = next;
+    }
+    pthread_mutex_destroy(&engine->mutex);
+    pthread_cond_destroy(&engine->cond);
+    free(engine);
+}
@@ -0,0 +1,73 @@
+#ifndef DATA_ROLLUP_H
+#define DATA_ROLLUP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 边缘侧降采样：按属性在多个时间窗口上维护 min/max/avg/count/last，
+// 窗口结束后经 sink 写入存储；原始数据是否保留及保留时长由调用方配置
+
+#define ROLLUP_MAX_WINDOWS 4
+#define ROLLUP_RING_SIZE 64     // 每个窗口待写出的已关闭桶数上限
+#define ROLLUP_LAST_MAX 64      // last 值最大长度（含结尾 0）
+
+typedef struct {
+    const char *ns;
+    const char *device;
+    const char *property;
+    long long windowSec;
+    long long startSec;         // 桶起始时间（对齐到窗口）
+    long long count;            // 全部样本数
+    long long numericCount;     // 数值样本数，为 0 时 min/max/avg 无意义
+    double min;
+    double max;
+    double avg;
+    const char *last;
+} RollupPoint;
+
+typedef struct {
+    // 写出一个已关闭的桶，失败返回非 0（该桶会被丢弃并计数）
+    int (*write)(void *arg, const RollupPoint *point);
+    // 删除早于 olderThanSec 的原始数据，可为 NULL
+    int (*prune_raw)(void *arg, const char *ns, const char *device, const char *property,
+                     long long olderThanSec);
+    // 某序列首次清理前调用一次（如为按时间删除建索引），失败时下次清理前重试，可为 NULL
+    int (*prepare_raw)(void *arg, const char *ns, const char *device, const char *property);
+    void *arg;
+} RollupSink;
+
+typedef struct {
+    long long windows[ROLLUP_MAX_WINDOWS];
+    int windowCount;
+    int storeRaw;               // 是否继续写原始数据
+    long long rawRetentionSec;  // 原始数据保留时长，0 不清理
+    int flushIntervalMs;        // 后台检查间隔，0 使用默认 1000
+} RollupOptions;
+
+typedef struct RollupEngine RollupEngine;
+
+RollupEngine *rollup_new(const RollupOptions *opts, const RollupSink *sink);
+int rollup_start(RollupEngine *engine);
+// 停止后台线程；flushPartial 非 0 时把未结束的桶也写出
+void rollup_stop(RollupEngine *engine, int flushPartial);
+void rollup_free(RollupEngine *engine);
+
+// 采集侧调用：value 为字符串形式，能解析为数字的参与 min/max/avg
+int rollup_ingest(RollupEngine *engine, const char *ns, const char *device,
+                  const char *property, const char *value, long long tsMs);
+
+int rollup_store_raw(const RollupEngine *engine);
+
+// "10s" / "1m" / "1h" / "1d" / 纯数字（秒）；失败返回 -1
+long long rollup_parse_duration(const char *s);
+// "10s,1m,1h"，返回窗口个数，失败返回 -1
+int rollup_parse_windows(const char *spec, long long *out, int max);
+// 窗口标签，如 10s / 1m / 1h，用于表名
+void rollup_window_label(long long windowSec, char *buf, int buflen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DATA_ROLLUP_H
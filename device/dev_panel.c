@@ -2,47 +2,194 @@
 #include "device.h"
 #include "devicetwin.h"
 #include "log/log.h"
+#include "common/epoch.h"
+#include "common/intern.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <fnmatch.h>
 #include <cjson/cJSON.h>
 // 从 DeviceManager 中获取设备孪生结果
 int dev_panel_get_twin_result(DeviceManager *manager, const char *deviceId, 
                              const char *propertyName, char **value, char **datatype) {
+    // 读已发布的快照，不持有 device->mutex，不会被采集轮次阻塞；
+    // 查找也放在读侧临界区内，期间被移除的设备不会被释放
+    epoch_read_enter();
     Device *device = device_manager_get(manager, deviceId);
     if (!device) {
+        epoch_read_exit();
         log_warn("Device %s not found", deviceId);
         return -1;
     }
-
-    for (int i = 0; i < device->instance.twinsCount; i++) {
-        Twin *twin = &device->instance.twins[i];
-        if (strcmp(twin->propertyName, propertyName) == 0) {
-            *value = strdup(twin->reported.value ? twin->reported.value : "null");
-            *datatype = strdup("string"); // 默认类型
-            return 0;
-        }
+    const TwinSnapshotEntry *entry =
+        devicetwin_snapshot_find(devicetwin_snapshot_acquire(device), propertyName);
+    if (entry) {
+        *value = strdup(entry->value ? entry->value : "null");
+        *datatype = strdup(entry->type ? entry->type : "string"); // 默认类型
+        epoch_read_exit();
+        return 0;
     }
+    epoch_read_exit();
 
     log_warn("Property %s not found for device %s", propertyName, deviceId);
     return -1;
 }
 
-// 写入设备数据
+void twin_json_buf_free(TwinJsonBuf *buf) {
+    if (!buf) return;
+    free(buf->data);
+    buf->data = NULL;
+    buf->len = buf->cap = 0;
+}
+
+int twin_json_buf_append(TwinJsonBuf *buf, const char *s, size_t n) {
+    if (buf->len + n + 1 > buf->cap) {
+        size_t cap = buf->cap ? buf->cap : 1024;
+        while (cap < buf->len + n + 1) cap *= 2;
+        char *p = realloc(buf->data, cap);
+        if (!p) return -1;
+        buf->data = p;
+        buf->cap = cap;
+    }
+    memcpy(buf->data + buf->len, s, n);
+    buf->len += n;
+    buf->data[buf->len] = '\0';
+    return 0;
+}
+
+int twin_json_buf_append_str(TwinJsonBuf *buf, const char *s) {
+    if (twin_json_buf_append(buf, "\"", 1) != 0) return -1;
+    const char *run = s;
+    for (const char *p = s; *p; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c != '"' && c != '\\' && c >= 0x20) continue;
+        if (p > run && twin_json_buf_append(buf, run, (size_t)(p - run)) != 0) return -1;
+        char esc[8];
+        int n;
+        switch (c) {
+            case '"':  n = snprintf(esc, sizeof(esc), "\\\""); break;
+            case '\\': n = snprintf(esc, sizeof(esc), "\\\\"); break;
+            case '\n': n = snprintf(esc, sizeof(esc), "\\n"); break;
+            case '\r': n = snprintf(esc, sizeof(esc), "\\r"); break;
+            case '\t': n = snprintf(esc, sizeof(esc), "\\t"); break;
+            default:   n = snprintf(esc, sizeof(esc), "\\u%04x", c); break;
+        }
+        if (twin_json_buf_append(buf, esc, (size_t)n) != 0) return -1;
+        run = p + 1;
+    }
+    const char *end = run + strlen(run);
+    if (end > run && twin_json_buf_append(buf, run, (size_t)(end - run)) != 0) return -1;
+    return twin_json_buf_append(buf, "\"", 1);
+}
+
+static int buf_append_field(TwinJsonBuf *buf, const char *key, const char *value, int comma) {
+    if (comma && twin_json_buf_append(buf, ",", 1) != 0) return -1;
+    if (twin_json_buf_append_str(buf, key) != 0) return -1;
+    if (twin_json_buf_append(buf, ":", 1) != 0) return -1;
+    return twin_json_buf_append_str(buf, value ? value : "");
+}
+
+int dev_panel_append_twins_json(Device *device, const char *propertyPattern,
+                                int *first, TwinJsonBuf *buf) {
+    if (!device || !first || !buf) return -1;
+    const char *name = device->instance.name ? device->instance.name : "";
+    const char *ns = device->instance.namespace_ ? device->instance.namespace_ : "default";
+    int appended = 0;
+
+    // 只读已发布快照，整个设备在一个读侧临界区内完成序列化
+    epoch_read_enter();
+    const TwinSnapshot *snap = devicetwin_snapshot_acquire(device);
+    for (int i = 0; snap && i < snap->count; i++) {
+        const TwinSnapshotEntry *e = &snap->entries[i];
+        if (!e->propertyName) continue;
+        if (propertyPattern && *propertyPattern &&
+            fnmatch(propertyPattern, e->propertyName, 0) != 0) continue;
+
+        if ((!*first && twin_json_buf_append(buf, ",", 1) != 0) ||
+            twin_json_buf_append(buf, "{", 1) != 0 ||
+            buf_append_field(buf, "deviceName", name, 0) != 0 ||
+            buf_append_field(buf, "deviceNamespace", ns, 1) != 0 ||
+            buf_append_field(buf, "propertyName", e->propertyName, 1) != 0 ||
+            buf_append_field(buf, "value", e->value, 1) != 0 ||
+            buf_append_field(buf, "type", e->type ? e->type : "string", 1) != 0 ||
+            buf_append_field(buf, "timeStamp", e->timestamp, 1) != 0 ||
+            twin_json_buf_append(buf, "}", 1) != 0) {
+            epoch_read_exit();
+            return -1;
+        }
+        *first = 0;
+        appended++;
+    }
+    epoch_read_exit();
+    return appended;
+}
+
+// 获取全部设备的孪生值
+int dev_panel_get_all_twins(DeviceManager *manager, char **response) {
+    if (!manager || !response) return -1;
+    TwinJsonBuf buf = {0};
+    int first = 1;
+    int rc = twin_json_buf_append(&buf, "[", 1);
+
+    pthread_mutex_lock(&manager->managerMutex);
+    for (int i = 0; rc == 0 && i < manager->deviceCount; i++) {
+        if (!manager->devices[i]) continue;
+        if (dev_panel_append_twins_json(manager->devices[i], NULL, &first, &buf) < 0) rc = -1;
+    }
+    pthread_mutex_unlock(&manager->managerMutex);
+
+    if (rc == 0) rc = twin_json_buf_append(&buf, "]", 1);
+    if (rc != 0) {
+        twin_json_buf_free(&buf);
+        return -1;
+    }
+    *response = buf.data;
+    return 0;
+}
+
+// 方法 method 是否声明了属性 propertyName；调用方持 device->mutex
+static int device_method_has_property(const Device *device, const char *method, const char *propertyName) {
+    for (int i = 0; i < device->instance.methodsCount; i++) {
+        const DeviceMethod *m = &device->instance.methods[i];
+        if (!m->name || strcmp(m->name, method) != 0) continue;
+        for (int j = 0; j < m->propertyNamesCount; j++) {
+            if (m->propertyNames[j] && strcmp(m->propertyNames[j], propertyName) == 0) return 1;
+        }
+        return 0;
+    }
+    return 0;
+}
+
+// 写入设备数据；method 非空时只允许写该方法声明的属性
 int dev_panel_write_device(DeviceManager *manager, const char *method, 
                           const char *deviceId, const char *propertyName, const char *data) {
     if (!manager || !deviceId || !propertyName || !data) return -1;
     
-    // 查找设备
+    // 查找设备（读侧临界区内，写入期间设备被移除也不会被释放）
+    epoch_read_enter();
     Device *device = device_manager_get(manager, deviceId);
     if (!device) {
+        epoch_read_exit();
         log_warn("Device %s not found", deviceId);
         return -1;
     }
+    if (method && *method) {
+        // methods 可能被热更新替换，查找期间持有设备锁
+        pthread_mutex_lock(&device->mutex);
+        int allowed = device_method_has_property(device, method, propertyName);
+        pthread_mutex_unlock(&device->mutex);
+        if (!allowed) {
+            epoch_read_exit();
+            log_warn("Device %s: method %s does not declare property %s", deviceId, method, propertyName);
+            return DEV_PANEL_ENOMETHOD;
+        }
+    }
     
     // 设置孪生属性值
     TwinResult result = {0};
-    if (devicetwin_set(device, propertyName, data, &result) != 0) {
+    int rc = devicetwin_set(device, propertyName, data, &result);
+    epoch_read_exit();
+    if (rc != 0) {
         log_error("Failed to set twin property %s for device %s", propertyName, deviceId);
         free(result.value);
         free(result.error);
@@ -64,13 +211,17 @@ int dev_panel_get_device_method(DeviceManager *manager, const char *deviceId,
     if (!manager || !deviceId || !method_map || !method_count ||
         !property_map || !property_count) return -1;
 
+    epoch_read_enter();
     Device *device = device_manager_get(manager, deviceId);
     if (!device) {
+        epoch_read_exit();
         log_warn("Device %s not found", deviceId);
         *method_map = NULL; *method_count = 0;
         *property_map = NULL; *property_count = 0;
         return 0;
     }
+    // methods 可能被热更新替换，复制期间持有设备锁
+    pthread_mutex_lock(&device->mutex);
 
     if (device->instance.methodsCount == 0) {
         log_warn("Device %s has no methods (methodsCount=0)", deviceId);
@@ -110,6 +261,8 @@ int dev_panel_get_device_method(DeviceManager *manager, const char *deviceId,
         *property_map = NULL;
     }
 
+    pthread_mutex_unlock(&device->mutex);
+    epoch_read_exit();
     return 0;
 }
 
@@ -167,38 +320,91 @@ int dev_panel_has_device(DeviceManager *manager, const char *deviceId) {
     return device != NULL ? 1 : 0;
 }
 
-// 更新设备（占位实现）
+// "ns/name" 或 "ns.name" 形式的资源 ID 取名称部分
+static const char *resource_name(const char *id) {
+    const char *sep = strrchr(id, '/');
+    if (!sep) sep = strrchr(id, '.');
+    return (sep && sep[1]) ? sep + 1 : id;
+}
+
+// 新增或增量更新设备：不存在则创建并启动，存在则只对比差异，spec 未变时不重建（见 device_update_spec）
 int dev_panel_update_dev(DeviceManager *manager, const DeviceModel *model, const DeviceInstance *instance) {
-    if (!manager || !model || !instance) return -1;
-    
-    log_info("Updating device: %s", instance->name ? instance->name : "unknown");
-    
-    // TODO: 实现设备更新逻辑
-    // 1. 查找现有设备
-    // 2. 更新设备配置
-    // 3. 重启设备（如果需要）
-    
+    if (!manager || !model || !instance || !instance->name) return -1;
+
+    log_info("Updating device: %s", instance->name);
+
+    epoch_read_enter();
+    Device *device = device_manager_get(manager, instance->name);
+    if (device) {
+        int rc = device_update_spec(device, instance, model);
+        epoch_read_exit();
+        return rc;
+    }
+    epoch_read_exit();
+
+    device = device_new(instance, model);
+    if (!device) {
+        log_error("Failed to create device %s", instance->name);
+        return -1;
+    }
+    if (device_manager_add(manager, device) != 0) {
+        device_free(device);
+        return -1;
+    }
+    if (manager->stopped) return 0;
+    if (device_start(device) != 0) {
+        log_warn("Device %s added but failed to start", instance->name);
+        return -1;
+    }
     return 0;
 }
 
-// 更新模型（占位实现）
+// 移除设备，其余设备不受影响
+int dev_panel_remove_device(DeviceManager *manager, const char *deviceId) {
+    if (!manager || !deviceId) return -1;
+    log_info("Removing device: %s", deviceId);
+    if (device_manager_remove(manager, deviceId) == 0) return 0;
+    return device_manager_remove(manager, resource_name(deviceId));
+}
+
+// 更新模型：保存到模型表，并替换所有引用该模型的设备中的副本
 int dev_panel_update_model(DeviceManager *manager, const DeviceModel *model) {
-    if (!manager || !model) return -1;
-    
-    log_info("Updating model: %s", model->name ? model->name : "unknown");
-    
-    // TODO: 实现模型更新逻辑
+    if (!manager || !model || !model->name) return -1;
     
-    return 0;
+    log_info("Updating model: %s", model->name);
+    if (device_manager_put_model(manager, model) != 0) return -1;
+
+    // 先在管理器锁内收集设备，逐个更新时不持有管理器锁（设备锁可能被采集轮次占用）
+    epoch_read_enter();
+    pthread_mutex_lock(&manager->managerMutex);
+    Device **targets = manager->deviceCount > 0 ? calloc((size_t)manager->deviceCount, sizeof(Device*)) : NULL;
+    int n = 0;
+    // 设备的模型名已驻留时逐个比较指针即可
+    const char *modelName = intern_find(model->name);
+    if (!modelName) modelName = model->name;
+    for (int i = 0; targets && i < manager->deviceCount; i++) {
+        Device *d = manager->devices[i];
+        if (d && intern_eq(d->instance.model, modelName)) targets[n++] = d;
+    }
+    pthread_mutex_unlock(&manager->managerMutex);
+
+    int rc = 0;
+    for (int i = 0; i < n; i++) {
+        if (device_update_model(targets[i], model) != 0) rc = -1;
+    }
+    epoch_read_exit();
+    free(targets);
+    log_info("Model %s applied to %d device(s)", model->name, n);
+    return rc;
 }
 
-// 移除模型（占位实现）
+// 移除模型：只从模型表删除，已创建的设备保留各自的模型副本
 int dev_panel_remove_model(DeviceManager *manager, const char *modelId) {
     if (!manager || !modelId) return -1;
     
     log_info("Removing model: %s", modelId);
-    
-    // TODO: 实现模型移除逻辑
-    
-    return 0;
-}
\ No newline at end of file
+    if (device_manager_remove_model(manager, modelId) == 0) return 0;
+    if (device_manager_remove_model(manager, resource_name(modelId)) == 0) return 0;
+    log_warn("Model %s not found", modelId);
+    return -1;
+}
@@ -15,7 +15,8 @@ extern "C" {
 int dev_panel_get_twin_result(DeviceManager *manager, const char *deviceId, 
                              const char *propertyName, char **value, char **datatype);
 
-// 写入设备数据
+// 写入设备数据；method 非空且设备没有该方法或方法未声明该属性时返回 DEV_PANEL_ENOMETHOD
+#define DEV_PANEL_ENOMETHOD -2
 int dev_panel_write_device(DeviceManager *manager, const char *method, 
                           const char *deviceId, const char *propertyName, const char *data);
 
@@ -30,13 +31,36 @@ int dev_panel_get_device(DeviceManager *manager, const char *deviceId, DeviceIns
 // 获取设备模型
 int dev_panel_get_model(DeviceManager *manager, const char *modelId, DeviceModel *model);
 
+// 获取全部设备的孪生值（JSON 数组字符串，调用者 free）
 int dev_panel_get_all_twins(DeviceManager *manager, char **response);
+
+// 可增长的 JSON 输出缓冲，用于批量读取时分段序列化
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} TwinJsonBuf;
+
+void twin_json_buf_free(TwinJsonBuf *buf);
+int twin_json_buf_append(TwinJsonBuf *buf, const char *s, size_t n);
+// 追加带引号并转义的 JSON 字符串
+int twin_json_buf_append_str(TwinJsonBuf *buf, const char *s);
+
+// 将设备中名称匹配 propertyPattern（fnmatch 通配，NULL 表示全部）的孪生值
+// 以 JSON 对象追加到 buf，对象间以逗号分隔；*first 非 0 时首个对象前不加逗号
+// 返回追加条目数，内存不足返回 -1
+int dev_panel_append_twins_json(Device *device, const char *propertyPattern,
+                                int *first, TwinJsonBuf *buf);
+
 // 检查设备是否存在
 int dev_panel_has_device(DeviceManager *manager, const char *deviceId);
 
-// 更新设备
+// 新增或增量更新设备（只重启受影响的部分）
 int dev_panel_update_dev(DeviceManager *manager, const DeviceModel *model, const DeviceInstance *instance);
 
+// 移除设备
+int dev_panel_remove_device(DeviceManager *manager, const char *deviceId);
+
 // 更新模型
 int dev_panel_update_model(DeviceManager *manager, const DeviceModel *model);
 
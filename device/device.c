@@ -1,8 +1,17 @@
 #include "device.h"
+#include "devicetwin.h"
 #include "log/log.h"
 #include "common/const.h"
 #include "data/publish/publisher.h"   // 新增
 #include "data/dbmethod/mysql/recorder.h"  // 新增：修复 mysql_recorder_record 隐式声明
+#include "common/epoch.h"
+#include "common/arena.h"
+#include "common/intern.h"
+#include "device/twinwatch.h"
+#include "device/twinhistory.h"
+#include "device/startpool.h"
+#include "device/devicestatus.h"
+#include "device/iosched.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -10,6 +19,7 @@
 #include <unistd.h>
 #include <time.h>
 #include <ctype.h>
+#include <errno.h>
 extern Publisher *g_publisher;
 static int sim_temperature_enabled(void) {
     const char *v = getenv("MAPPER_SIM_TEMPERATURE");
@@ -17,127 +27,12 @@ static int sim_temperature_enabled(void) {
 }
 
 // ==== Helpers moved to top (避免隐式声明) ====
-static int json_get_str(const char *json, const char *key, char *out, size_t outsz) {
-    if (!json || !key || !out || outsz == 0) return -1;
-    const char *p = strcasestr(json, key);
-    if (!p) return -1;
-    p = strchr(p, ':');
-    if (!p) return -1;
-    p++;
-    // 跳过空白
-    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') p++;
-    // 可有引号
-    int quoted = 0;
-    if (*p == '\"') { quoted = 1; p++; }
-    size_t i = 0;
-    while (*p && i + 1 < outsz) {
-        if (quoted) {
-            if (*p == '\\' && p[1]) { // 简单跳过转义
-                p++;
-            } else if (*p == '\"') {
-                break;
-            }
-            out[i++] = *p++;
-        } else {
-            if (*p == ',' || *p == '}' || *p == ' ' || *p == '\r' || *p == '\n' || *p == '\t')
-                break;
-            out[i++] = *p++;
-        }
-    }
-    out[i] = 0;
-    return i > 0 ? 0 : -1;
-}
-static int json_get_int(const char *json, const char *key, int *out) {
-    char buf[32] = {0};
-    if (json_get_str(json, key, buf, sizeof(buf)) == 0) { *out = atoi(buf); return 0; }
-    return -1;
-}
 static void now_iso8601(char ts[32]) {
     time_t t = time(NULL); struct tm tm; gmtime_r(&t, &tm);
     strftime(ts, 32, "%Y-%m-%dT%H:%M:%SZ", &tm);
 }
-static int resolve_offset_by_name(const char *propName) {
-    if (!propName) return -1;
-    if (strcmp(propName, "temperature") == 0) return 1;
-    if (strcmp(propName, "threshold") == 0)  return 2;
-    return -1;
-}
 // ==== End helpers ====
 
-// 新增: 去首尾空白
-static void trim_str(char *s) {
-    if (!s) return;
-    char *p = s;
-    while (*p && isspace((unsigned char)*p)) p++;
-    if (p != s) memmove(s, p, strlen(p)+1);
-    size_t len = strlen(s);
-    while (len > 0 && isspace((unsigned char)s[len-1])) {
-        s[--len] = 0;
-    }
-}
-
-// 仅保留允许字符 (主机/IP)
-static void sanitize_host(char *s) {
-    if (!s) return;
-    size_t w = 0;
-    for (size_t r = 0; s[r]; ++r) {
-        unsigned char c = (unsigned char)s[r];
-        if ((c >= '0' && c <= '9') ||
-            (c >= 'A' && c <= 'Z') ||
-            (c >= 'a' && c <= 'z') ||
-            c == '.' || c == '-' || c == '_' || c == ':' ) {
-            s[w++] = (char)c;
-        }
-        // 其它字符直接丢弃（包括反斜杠、n、t 等）
-    }
-    s[w] = 0;
-}
-
-// 去除因简易 JSON 解析残留的转义序列字母前缀 (例如 "\n\t127.0.0.1" -> "127.0.0.1")
-static void cleanup_escape_prefix(char *s) {
-    if (!s) return;
-    // 去掉开头若是 n/t/r 且后面紧跟数字或 1-2 个 n/t/r 再跟数字的情况
-    while (s[0] && (s[0]=='n' || s[0]=='t' || s[0]=='r')) {
-        if (s[1]>='0' && s[1]<='9') {
-            memmove(s, s+1, strlen(s+1)+1);
-            continue;
-        }
-        if ((s[1]=='n'||s[1]=='t'||s[1]=='r') && (s[2]>='0'&&s[2]<='9')) {
-            memmove(s, s+2, strlen(s+2)+1);
-            continue;
-        }
-        break;
-    }
-}
-
-static void normalize_host_port(const char *rawHost, int rawPort,
-                                char *outHost, size_t outHostSz, int *outPort) {
-    snprintf(outHost, outHostSz, "%s", (rawHost && *rawHost) ? rawHost : "");
-    trim_str(outHost);
-    sanitize_host(outHost);
-    if (outHost[0] == 0) {
-        const char *envH = getenv("MAPPER_MODBUS_ADDR");
-        if (envH && *envH) {
-            snprintf(outHost, outHostSz, "%s", envH);
-            trim_str(outHost);
-            sanitize_host(outHost);
-        }
-    }
-    if (outHost[0] == 0) {
-        snprintf(outHost, outHostSz, "%s", "127.0.0.1");
-    }
-    int p = rawPort;
-    if (p <= 0 || p > 65535) {
-        const char *envp = getenv("MAPPER_MODBUS_PORT");
-        if (envp && *envp) {
-            int ep = atoi(envp);
-            if (ep > 0 && ep <= 65535) p = ep;
-        }
-    }
-    if (p <= 0 || p > 65535) p = 1502;
-    *outPort = p;
-}
-
 // 模拟温度数据
 static int simulate_temperature_data(int *current, int *direction) {
     if (!current || !direction) return -1;
@@ -154,7 +49,62 @@ static int simulate_temperature_data(int *current, int *direction) {
     return *current;
 }
 
-// 设备数据处理线程
+static int device_stop_requested(const Device *device) {
+    return __atomic_load_n(&device->stopChan, __ATOMIC_ACQUIRE);
+}
+
+// 持有 device->mutex 时等待 ms 毫秒；收到停止令牌（或 untilCollecting 时连接恢复）提前返回
+static void device_wait(Device *device, int ms, int untilCollecting) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec += ms / 1000;
+    ts.tv_nsec += (long)(ms % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    while (!device_stop_requested(device)) {
+        if (untilCollecting && device_conn_collecting(device)) break;
+        if (pthread_cond_timedwait(&device->wakeCond, &device->mutex, &ts) == ETIMEDOUT) break;
+    }
+}
+
+// 一轮采集中一次读取的副本，名称与访问配置引用设备 spec（处于 epoch 读区间）
+typedef struct {
+    Twin *twin;
+    const char *propertyName;
+    VisitorConfig visitor;
+    char value[DRIVER_VALUE_STR_MAX];   // 读取成功时的文本值
+} TwinRead;
+
+static void twin_sample_sinks(const char *ns, const char *deviceName, const char *prop,
+                              const char *value, int publish);
+
+// 不持锁：本轮全部读取一次交给驱动，占一个周期采集名额
+static void device_read_batch(CustomizedClient *client, const char *endpoint, const char *ns,
+                              const char *deviceName, TwinRead *refs, DriverReadItem *items, int n) {
+    for (int i = 0; i < n; i++) items[i].visitor = &refs[i].visitor;
+    IoSlot slot;
+    iosched_acquire(endpoint, IO_LANE_TELEMETRY, &slot);
+    GetDeviceDataBatch(client, items, n);
+    int ok = 1;
+    for (int i = 0; i < n; i++) {
+        if (items[i].rc != DRIVER_OK && items[i].rc != DRIVER_ENOADDR) ok = 0;
+    }
+    iosched_release(&slot, ok);
+    for (int i = 0; i < n; i++) {
+        if (items[i].rc == DRIVER_OK &&
+            driver_value_format(&items[i].value, refs[i].value, sizeof(refs[i].value)) < 0) {
+            items[i].rc = DRIVER_EIO;
+        }
+        if (items[i].rc == DRIVER_OK) twin_sample_sinks(ns, deviceName, refs[i].propertyName, refs[i].value, 1);
+    }
+}
+
+// 设备数据处理线程：每轮分三段——持锁生成写入与读取副本、释放锁执行 I/O、再持锁提交结果，
+// REST/gRPC 对该设备的读写只需等待很短的准备与提交阶段。
+// 本轮不下发的属性经驱动批量接口一次读回 reported。
+// 只在两次 I/O 之间响应停止令牌，已采到的样本总会写完再退出
 static void *device_data_thread(void *arg) {
     Device *device = (Device*)arg;
     log_info("Device data thread started for device: %s",
@@ -162,16 +112,40 @@ static void *device_data_thread(void *arg) {
 
     int simulated_temperature = 1; // 初始温度
     int direction = 1; // 1 表示升温，-1 表示降温
+    DeviceTwinWrite *writes = NULL;   // 跨轮复用
+    int writesCap = 0;
+    TwinRead *reads = NULL;
+    DriverReadItem *readItems = NULL;
+    int readsCap = 0;
 
-    while (device->dataThreadRunning) {
-        pthread_mutex_lock(&device->mutex);
-
-        if (strcmp(device->status, DEVICE_STATUS_OK) != 0) {
-            pthread_mutex_unlock(&device->mutex);
-            usleep(1000000);
+    pthread_mutex_lock(&device->mutex);
+    while (!device_stop_requested(device)) {
+        // 连接断开（BACKOFF/CONNECTING）期间不采集，等待巡检线程重连后唤醒
+        if (!device_conn_collecting(device)) {
+            device_wait(device, 1000, 1);
             continue;
         }
 
+        int ioOk = 0, ioFail = 0, n = 0, nr = 0;
+        if (device->instance.twinsCount > writesCap) {
+            DeviceTwinWrite *grown = realloc(writes, (size_t)device->instance.twinsCount * sizeof(*writes));
+            if (grown) writes = grown;
+            TwinRead *grownReads = grown ? realloc(reads, (size_t)device->instance.twinsCount * sizeof(*reads)) : NULL;
+            if (grownReads) reads = grownReads;
+            DriverReadItem *grownItems = grownReads ? realloc(readItems, (size_t)device->instance.twinsCount * sizeof(*readItems)) : NULL;
+            if (!grownItems) {
+                log_error("Device %s: out of memory for collection round", device->instance.name);
+                device_wait(device, 5000, 0);
+                continue;
+            }
+            readItems = grownItems;
+            writesCap = readsCap = device->instance.twinsCount;
+        }
+        CustomizedClient *client = device->client;
+        char endpoint[160];
+        device_io_endpoint(device, endpoint, sizeof(endpoint));
+
+        // 1) 持锁：生成本轮的写入与读取副本
         for (int i = 0; i < device->instance.twinsCount; i++) {
             Twin *twin = &device->instance.twins[i];
             if (!twin || !twin->propertyName) continue;
@@ -183,90 +157,417 @@ static void *device_data_thread(void *arg) {
 
                 // 更新 reported（即使未变化也可保留，只在变化时减内存 churn）
                 if (!twin->reported.value || strcmp(twin->reported.value, buf) != 0) {
-                    free(twin->reported.value);
-                    twin->reported.value = strdup(buf);
-                    char ts[32]; now_iso8601(ts);
-                    free(twin->reported.metadata.timestamp);
-                    twin->reported.metadata.timestamp = strdup(ts);
+                    device_twin_set_reported(device, twin, buf);
                     log_debug("Updated reported.value for %s: %s", twin->propertyName, buf);
                 }
 
-                // 无条件写库（如需只变化时写可再加判断）
-                mysql_recorder_record(
-                    device->instance.namespace_ ? device->instance.namespace_ : "default",
-                    device->instance.name ? device->instance.name : "unknown",
-                    twin->propertyName,
-                    twin->reported.value,
-                    (long long)time(NULL) * 1000
-                );
-
-                // 跳过 desired 处理避免被回写成云端旧值
+                // 无条件写库（如需只变化时写可再加判断）；跳过 desired 处理避免被回写成云端旧值
+                DeviceTwinWrite *w = &writes[n];
+                memset(w, 0, sizeof(*w));
+                w->namespace_ = device->instance.namespace_ ? device->instance.namespace_ : "default";
+                w->deviceName = device->instance.name ? device->instance.name : "unknown";
+                w->propertyName = twin->propertyName;
+                w->value = strdup(buf);
+                w->recordOnly = 1;
+                if (w->value) n++;
+                ioOk++;
                 continue;
             }
 
-            // 处理其他属性
-            device_deal_twin(device, twin);
+            // 处理其他属性：需要下发的本轮不读；其余（没有写入在进行的）批量读取
+            if (device_twin_write_prepare(device, twin, &writes[n]) == 1) {
+                n++;
+            } else if (client && !twin->writing && nr < readsCap) {
+                TwinRead *r = &reads[nr++];
+                r->twin = twin;
+                r->propertyName = twin->propertyName;
+                r->visitor.propertyName = twin->propertyName;
+                r->visitor.protocolName = device->instance.protocolName;
+                r->visitor.configData = twin->property ? twin->property->visitors : NULL;
+                r->value[0] = 0;
+            } else {
+                ioOk++;   // 无需下发也无需读取的算作成功
+            }
         }
+        if (n > 0 || nr > 0) {
+            // 2) 不持锁：驱动下发、落库、发布；先进入 epoch 读区间再放锁，期间旧 spec 名称不会被回收
+            epoch_read_enter();
+            pthread_mutex_unlock(&device->mutex);
+            if (!device_stop_requested(device)) {
+                device_twin_write_execute_batch(writes, n);
+            } else {
+                // 停止时下发留待下次启动，模拟样本仍然落库
+                for (int i = 0; i < n; i++) {
+                    if (writes[i].recordOnly) device_twin_write_execute(&writes[i]);
+                }
+            }
+            if (nr > 0 && !device_stop_requested(device)) {
+                device_read_batch(client, endpoint, device->instance.namespace_ ? device->instance.namespace_ : "default",
+                                  device->instance.name ? device->instance.name : "unknown", reads, readItems, nr);
+            } else {
+                nr = 0;
+            }
 
-        pthread_mutex_unlock(&device->mutex);
-        usleep(5000000); // 5 秒采集周期
+            // 3) 持锁：回填 reported，清除写入中标记
+            pthread_mutex_lock(&device->mutex);
+            for (int i = 0; i < n; i++) {
+                int rc = device_twin_write_commit(device, &writes[i]);
+                if (writes[i].recordOnly) continue;
+                if (rc == 0) ioOk++;
+                else if (rc != DRIVER_ENOADDR) ioFail++;   // 驱动不认识的属性与链路无关
+            }
+            for (int i = 0; i < nr; i++) {
+                int rc = readItems[i].rc;
+                if (rc == DRIVER_ENOADDR) continue;
+                if (rc != DRIVER_OK) {
+                    ioFail++;
+                    continue;
+                }
+                ioOk++;
+                // 期间 update_spec 可能已替换 twins 数组；已有新写入在进行时以写入结果为准
+                Twin *twin = reads[i].twin;
+                if (!device->instance.twins || twin < device->instance.twins ||
+                    twin >= device->instance.twins + device->instance.twinsCount) {
+                    twin = device_find_twin(device, reads[i].propertyName);
+                }
+                if (twin && !twin->writing) device_twin_set_reported(device, twin, reads[i].value);
+            }
+            epoch_read_exit();
+        }
+
+        // 整轮全部失败才记一次失败，部分成功说明链路仍通；停止时未执行的下发不计
+        if (ioOk + ioFail > 0 && !device_stop_requested(device)) device_conn_report(device, !(ioFail > 0 && ioOk == 0));
+
+        // 一轮采集结束后统一发布快照，读者只会看到完整的一轮结果
+        device_publish_twins(device);
+        device_wait(device, 5000, 0); // 5 秒采集周期
     }
+    pthread_mutex_unlock(&device->mutex);
+    free(writes);
+    free(reads);
+    free(readItems);
 
     log_info("Device data thread stopped for device: %s",
              device->instance.name ? device->instance.name : "unknown");
     return NULL;
 }
 
-// 创建设备
-Device *device_new(const DeviceInstance *instance, const DeviceModel *model) {
-    if (!instance || !model) {
-        log_error("Invalid parameters for device creation");
-        return NULL;
+// ==== Twin 索引：属性名 -> twins 下标 ====
+unsigned int device_twin_name_hash(const char *s) {
+    unsigned int h = 2166136261u;   // FNV-1a
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
     }
-    
-    Device *device = calloc(1, sizeof(Device));
-    if (!device) {
-        log_error("Failed to allocate memory for device");
-        return NULL;
+    return h;
+}
+
+// 在 twins 数组确定后调用（device_new / device_runtime_rebuild），调用方需持有 device->mutex 或尚未发布该设备
+// 旧索引经 epoch 延迟释放：查找方持设备锁，但可能仍有读者在读侧区间里拿着旧指针
+void device_twin_index_build(Device *device) {
+    if (!device) return;
+    if (device->twinIndex) epoch_retire(device->twinIndex, NULL);
+    device->twinIndex = NULL;
+    device->twinIndexMask = 0;
+    if (!device->instance.twins || device->instance.twinsCount <= 0) return;
+
+    int cap = 8;
+    while (cap < device->instance.twinsCount * 2) cap <<= 1;
+    int *slots = malloc((size_t)cap * sizeof(int));
+    if (!slots) {
+        log_warn("Twin index alloc failed for %s, fallback to linear scan",
+                 device->instance.name ? device->instance.name : "(unknown)");
+        return;
     }
+    for (int i = 0; i < cap; ++i) slots[i] = -1;
+
+    int mask = cap - 1;
+    for (int i = 0; i < device->instance.twinsCount; ++i) {
+        const char *name = device->instance.twins[i].propertyName;
+        if (!name) continue;
+        unsigned int h = device_twin_name_hash(name) & (unsigned int)mask;
+        while (slots[h] >= 0) {
+            // 同名 twin 保留第一个，与原线性查找语义一致
+            if (device->instance.twins[slots[h]].propertyName == name) break;
+            h = (h + 1) & (unsigned int)mask;
+        }
+        if (slots[h] < 0) slots[h] = i;
+    }
+    device->twinIndex = slots;
+    device->twinIndexMask = mask;
+}
+
+// twin 名都已驻留：探测值先 intern_find，没驻留过的名字一定不存在，之后只比指针
+int device_twin_index_lookup(const Device *device, const char *propertyName) {
+    if (!device || !propertyName) return -1;
+    const char *key = intern_find(propertyName);
+    if (!key) return -1;
+    if (!device->twinIndex) {
+        for (int i = 0; i < device->instance.twinsCount; i++) {
+            if (device->instance.twins[i].propertyName == key) return i;
+        }
+        return -1;
+    }
+    unsigned int mask = (unsigned int)device->twinIndexMask;
+    unsigned int h = device_twin_name_hash(key) & mask;
+    while (device->twinIndex[h] >= 0) {
+        int i = device->twinIndex[h];
+        if (device->instance.twins[i].propertyName == key) return i;
+        h = (h + 1) & mask;
+    }
+    return -1;
+}
+
+Twin *device_find_twin(Device *device, const char *propertyName) {
+    int i = device_twin_index_lookup(device, propertyName);
+    return i >= 0 ? &device->instance.twins[i] : NULL;
+}
+
+// 更新 reported 值与时间戳，调用方需持有 device->mutex；发布由 device_publish_twins 完成
+// 值发生变化时通知 twinwatch 订阅者
+void device_twin_set_reported(Device *device, Twin *twin, const char *value) {
+    if (!device || !twin) return;
+    char ts[32]; now_iso8601(ts);
+    int changed = (twin->reported.value == NULL) != (value == NULL) ||
+                  (value && strcmp(twin->reported.value, value) != 0);
+    free(twin->reported.value);
+    twin->reported.value = value ? strdup(value) : NULL;
+    free(twin->reported.metadata.timestamp);
+    twin->reported.metadata.timestamp = strdup(ts);
+    if (changed) {
+        free(twin->appliedDesired);
+        twin->appliedDesired = NULL;
+    }
+    device->twinSnapshotDirty = 1;
+    if (value && twin->propertyName) {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        twinhistory_append(device->instance.namespace_ ? device->instance.namespace_ : "default",
+                           device->instance.name ? device->instance.name : "unknown",
+                           twin->propertyName, value,
+                           (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000);
+    }
+    if (changed && twin->propertyName) {
+        twinwatch_publish(device->instance.namespace_ ? device->instance.namespace_ : "default",
+                          device->instance.name ? device->instance.name : "unknown",
+                          twin->propertyName, twin->reported.value, ts);
+    }
+}
+
+// 若 reported 有变更则发布新快照，调用方需持有 device->mutex
+void device_publish_twins(Device *device) {
+    if (!device || !device->twinSnapshotDirty) return;
+    devicetwin_snapshot_publish(device);
+}
+
+// spec 数据的分配：有 arena 时从 arena 取（随 arena 整体释放），否则走堆
+static void *spec_calloc(Arena *arena, size_t n, size_t size) {
+    return arena ? arena_calloc(arena, n, size) : calloc(n, size);
+}
+
+static char *spec_strdup(Arena *arena, const char *s) {
+    if (!s) return NULL;
+    return arena ? arena_strdup(arena, s) : strdup(s);
+}
+
+// 跨设备重复的名字（命名空间、设备名、模型名、属性名、数据类型等）进入全局驻留表，各设备共享同一指针，
+// 按名字查找时只比较指针；驻留失败（内存不足）时退回复制，这样的名字按名字查不到
+static char *spec_name(Arena *arena, const char *s) {
+    if (!s) return NULL;
+    const char *p = intern(s);
+    if (p) return (char*)p;
+    return arena ? arena_strdup(arena, s) : strdup(s);
+}
+
+// 堆模式下释放 spec_name 填写的字段，驻留指针不释放
+static void spec_name_free(char *s) {
+    if (!intern_is(s)) free(s);
+}
+
+// 接管来的实例里名字可能是普通副本，换成驻留指针；堆上的副本随即释放
+static void spec_name_adopt(Arena *arena, char **field) {
+    if (!*field) return;
+    const char *p = intern(*field);
+    if (!p || p == *field) return;
+    if (!arena) free(*field);
+    *field = (char*)p;
+}
+
+// twin 的 desired/reported 会在运行中替换，始终在堆上
+static void twin_values_clear(Twin *twin) {
+    free(twin->observedDesired.value);
+    free(twin->observedDesired.metadata.timestamp);
+    free(twin->observedDesired.metadata.type);
+    free(twin->reported.value);
+    free(twin->reported.metadata.timestamp);
+    free(twin->reported.metadata.type);
+    free(twin->appliedDesired);
+}
+
+// 释放实例内的全部字段（不含 instance 本身）
+void device_instance_clear(DeviceInstance *instance) {
+    if (!instance) return;
+    if (instance->arena) {
+        for (int i = 0; i < instance->twinsCount; i++) {
+            twin_values_clear(&instance->twins[i]);
+        }
+        arena_free(instance->arena);
+        memset(instance, 0, sizeof(*instance));
+        return;
+    }
+    free(instance->id);
+    spec_name_free(instance->name);
+    spec_name_free(instance->namespace_);
+    spec_name_free(instance->model);
+    free(instance->protocolName);
+    spec_name_free(instance->pProtocol.protocolName);
+    free(instance->pProtocol.configData);
+
+    // twins
+    if (instance->twins) {
+        for (int i = 0; i < instance->twinsCount; i++) {
+            Twin *twin = &instance->twins[i];
+            spec_name_free(twin->propertyName);
+            twin_values_clear(twin);
+
+            if (twin->property) {
+                // 判断是否指向 properties 数组内部；如果不是（说明曾经 deep copy），才释放
+                int embedded = 0;
+                if (instance->properties &&
+                    twin->property >= instance->properties &&
+                    twin->property < instance->properties + instance->propertiesCount) {
+                    embedded = 1;
+                }
+                if (!embedded) {
+                    spec_name_free(twin->property->name);
+                    free(twin->property);
+                }
+                // 若 embedded == 1 则由后续 properties 统一释放，不能这里 free
+            }
+        }
+        free(instance->twins);
+    }
+
+    // properties
+    if (instance->properties) {
+        for (int i = 0; i < instance->propertiesCount; i++) {
+            DeviceProperty *prop = &instance->properties[i];
+            spec_name_free(prop->name);
+            spec_name_free(prop->propertyName);
+            spec_name_free(prop->modelName);
+            spec_name_free(prop->protocol);
+            free(prop->visitors);
+        }
+        free(instance->properties);
+    }
+
+    // methods
+    if (instance->methods) {
+        for (int i = 0; i < instance->methodsCount; i++) {
+            DeviceMethod *method = &instance->methods[i];
+            free(method->name);
+            free(method->description);
+            if (method->propertyNames) {
+                for (int j = 0; j < method->propertyNamesCount; j++) {
+                    spec_name_free(method->propertyNames[j]);
+                }
+                free(method->propertyNames);
+            }
+        }
+        free(instance->methods);
+    }
+    memset(instance, 0, sizeof(*instance));
+}
+
+// 深拷贝模型到 arena（为 NULL 时走堆），dst 原有内容不释放
+static int model_copy_into(DeviceModel *dst, const DeviceModel *src, Arena *arena) {
+    if (!dst || !src) return -1;
+    memset(dst, 0, sizeof(DeviceModel));
+    if (src->id) dst->id = spec_strdup(arena, src->id);
+    if (src->name) dst->name = spec_name(arena, src->name);
+    if (src->namespace_) dst->namespace_ = spec_name(arena, src->namespace_);
+    if (src->description) dst->description = spec_strdup(arena, src->description);
     
-    // 深拷贝设备实例信息
-    memset(&device->instance, 0, sizeof(DeviceInstance)); // 初始化为0
-    
-    // 复制基本字符串字段（只复制存在的字段）
-    if (instance->id) device->instance.id = strdup(instance->id);
-    if (instance->name) device->instance.name = strdup(instance->name);
-    if (instance->namespace_) device->instance.namespace_ = strdup(instance->namespace_);
-    if (!device->instance.namespace_ || !*device->instance.namespace_) {
-        if (device->instance.namespace_) free(device->instance.namespace_);
-        device->instance.namespace_ = strdup("default");
-        log_debug("device_new: namespace not provided, default -> 'default' (device=%s)",
-                  device->instance.name ? device->instance.name : "(nil)");
+    // 复制模型属性
+    if (src->properties && src->propertiesCount > 0) {
+        dst->properties = spec_calloc(arena, src->propertiesCount, sizeof(ModelProperty));
+        if (!dst->properties) return -1;
+        dst->propertiesCount = src->propertiesCount;
+        
+        for (int i = 0; i < src->propertiesCount; i++) {
+            const ModelProperty *srcProp = &src->properties[i];
+            ModelProperty *dstProp = &dst->properties[i];
+            
+            if (srcProp->name) dstProp->name = spec_name(arena, srcProp->name);
+            if (srcProp->dataType) dstProp->dataType = spec_name(arena, srcProp->dataType);
+            if (srcProp->description) dstProp->description = spec_strdup(arena, srcProp->description);
+            if (srcProp->accessMode) dstProp->accessMode = spec_name(arena, srcProp->accessMode);
+            if (srcProp->minimum) dstProp->minimum = spec_strdup(arena, srcProp->minimum);
+            if (srcProp->maximum) dstProp->maximum = spec_strdup(arena, srcProp->maximum);
+            if (srcProp->unit) dstProp->unit = spec_name(arena, srcProp->unit);
+        }
     }
+    return 0;
+}
 
-    device->instance.namespace_ = strdup("test");
-    if (instance->model) device->instance.model = strdup(instance->model);
-    if (instance->protocolName) device->instance.protocolName = strdup(instance->protocolName);
+// 深拷贝模型，dst 原有内容不释放
+int device_model_copy(DeviceModel *dst, const DeviceModel *src) {
+    return model_copy_into(dst, src, NULL);
+}
+
+void device_model_clear(DeviceModel *model) {
+    if (!model) return;
+    free(model->id);
+    spec_name_free(model->name);
+    spec_name_free(model->namespace_);
+    free(model->description);
+    if (model->properties) {
+        for (int i = 0; i < model->propertiesCount; i++) {
+            ModelProperty *prop = &model->properties[i];
+            spec_name_free(prop->name);
+            spec_name_free(prop->dataType);
+            free(prop->description);
+            spec_name_free(prop->accessMode);
+            free(prop->minimum);
+            free(prop->maximum);
+            spec_name_free(prop->unit);
+        }
+        free(model->properties);
+    }
+    memset(model, 0, sizeof(*model));
+}
+
+// 深拷贝实例到 dst（dst 需已清零），twins 的 property 指向 dst 自己的 properties
+// spec 数据全部放入 dst 新建的 arena；arena 创建失败时退回逐项堆分配
+static void device_instance_copy(DeviceInstance *dst, const DeviceInstance *src) {
+    Arena *arena = arena_new(0);
+    dst->arena = arena;
+    // 复制基本字符串字段（只复制存在的字段）
+    if (src->id) dst->id = spec_strdup(arena, src->id);
+    if (src->name) dst->name = spec_name(arena, src->name);
+    if (src->namespace_) dst->namespace_ = spec_name(arena, src->namespace_);
+    if (src->model) dst->model = spec_name(arena, src->model);
+    if (src->protocolName) dst->protocolName = spec_strdup(arena, src->protocolName);
     
     // 复制协议配置（根据实际定义修正）
-    if (instance->pProtocol.protocolName) {
-        device->instance.pProtocol.protocolName = strdup(instance->pProtocol.protocolName);
+    if (src->pProtocol.protocolName) {
+        dst->pProtocol.protocolName = spec_name(arena, src->pProtocol.protocolName);
     }
-    if (instance->pProtocol.configData) {
-        device->instance.pProtocol.configData = strdup(instance->pProtocol.configData);
+    if (src->pProtocol.configData) {
+        dst->pProtocol.configData = spec_strdup(arena, src->pProtocol.configData);
     }
     
     // 深拷贝 twins 数组
-    if (instance->twins && instance->twinsCount > 0) {
-        device->instance.twinsCount = instance->twinsCount;
-        device->instance.twins = calloc(instance->twinsCount, sizeof(Twin));
+    if (src->twins && src->twinsCount > 0) {
+        dst->twinsCount = src->twinsCount;
+        dst->twins = spec_calloc(arena, src->twinsCount, sizeof(Twin));
         
-        for (int i = 0; i < instance->twinsCount; i++) {
-            Twin *srcTwin = &instance->twins[i];
-            Twin *dstTwin = &device->instance.twins[i];
+        for (int i = 0; i < src->twinsCount; i++) {
+            Twin *srcTwin = &src->twins[i];
+            Twin *dstTwin = &dst->twins[i];
             
             if (srcTwin->propertyName) {
-                dstTwin->propertyName = strdup(srcTwin->propertyName);
+                dstTwin->propertyName = spec_name(arena, srcTwin->propertyName);
             }
             
             // 复制 observedDesired
@@ -291,41 +592,25 @@ Device *device_new(const DeviceInstance *instance, const DeviceModel *model) {
                 dstTwin->reported.metadata.type = strdup(srcTwin->reported.metadata.type);
             }
             
-            // 如果有 property 指针，也需要复制
-            if (srcTwin->property) {
-                dstTwin->property = malloc(sizeof(DeviceProperty));
-                if (dstTwin->property) {
-                    memcpy(dstTwin->property, srcTwin->property, sizeof(DeviceProperty));
-                    // 深拷贝 property 中的字符串字段（只复制存在的字段）
-                    if (srcTwin->property->name) {
-                        dstTwin->property->name = strdup(srcTwin->property->name);
-                    }
-                    // 注意：根据错误信息，DeviceProperty 可能没有这些字段，需要检查实际定义
-                    // if (srcTwin->property->dataType) {
-                    //     dstTwin->property->dataType = strdup(srcTwin->property->dataType);
-                    // }
-                    // if (srcTwin->property->accessMode) {
-                    //     dstTwin->property->accessMode = strdup(srcTwin->property->accessMode);
-                    // }
-                }
-            }
+            // property 指针在 properties 复制完成后重新关联
         }
     }
     
     // 深拷贝 properties 数组
-    if (instance->properties && instance->propertiesCount > 0) {
-        device->instance.propertiesCount = instance->propertiesCount;
-        device->instance.properties = calloc(instance->propertiesCount, sizeof(DeviceProperty));
+    if (src->properties && src->propertiesCount > 0) {
+        dst->propertiesCount = src->propertiesCount;
+        dst->properties = spec_calloc(arena, src->propertiesCount, sizeof(DeviceProperty));
         
-        for (int i = 0; i < instance->propertiesCount; i++) {
-            DeviceProperty *srcProp = &instance->properties[i];
-            DeviceProperty *dstProp = &device->instance.properties[i];
+        for (int i = 0; i < src->propertiesCount; i++) {
+            DeviceProperty *srcProp = &src->properties[i];
+            DeviceProperty *dstProp = &dst->properties[i];
             
             // 只复制确实存在的字段
-            if (srcProp->name) dstProp->name = strdup(srcProp->name);
-            if (srcProp->propertyName) dstProp->propertyName = strdup(srcProp->propertyName);
-            if (srcProp->modelName) dstProp->modelName = strdup(srcProp->modelName);
-            if (srcProp->protocol) dstProp->protocol = strdup(srcProp->protocol);
+            if (srcProp->name) dstProp->name = spec_name(arena, srcProp->name);
+            if (srcProp->propertyName) dstProp->propertyName = spec_name(arena, srcProp->propertyName);
+            if (srcProp->modelName) dstProp->modelName = spec_name(arena, srcProp->modelName);
+            if (srcProp->protocol) dstProp->protocol = spec_name(arena, srcProp->protocol);
+            if (srcProp->visitors) dstProp->visitors = spec_strdup(arena, srcProp->visitors);
             
             // 复制数值字段
             dstProp->collectCycle = srcProp->collectCycle;
@@ -348,60 +633,110 @@ Device *device_new(const DeviceInstance *instance, const DeviceModel *model) {
         }
     }
     
+    // twins 关联到本设备 properties 中的对应项（不再单独深拷贝，避免与源实例共享字符串）
+    // 源 twin 未关联时按 twin 名称匹配
+    for (int i = 0; i < dst->twinsCount; i++) {
+        const DeviceProperty *srcProp = src->twins[i].property;
+        const char *name = srcProp ? srcProp->name : dst->twins[i].propertyName;
+        DeviceProperty *bound = NULL;
+        if (srcProp && src->properties && srcProp >= src->properties &&
+            srcProp < src->properties + src->propertiesCount) {
+            bound = &dst->properties[srcProp - src->properties];
+        } else if (name) {
+            for (int j = 0; j < dst->propertiesCount; j++) {
+                if (dst->properties[j].name &&
+                    strcmp(dst->properties[j].name, name) == 0) {
+                    bound = &dst->properties[j];
+                    break;
+                }
+            }
+        }
+        dst->twins[i].property = bound;
+    }
+    
     // 深拷贝 methods 数组
-    if (instance->methods && instance->methodsCount > 0) {
-        device->instance.methodsCount = instance->methodsCount;
-        device->instance.methods = calloc(instance->methodsCount, sizeof(DeviceMethod));
+    if (src->methods && src->methodsCount > 0) {
+        dst->methodsCount = src->methodsCount;
+        dst->methods = spec_calloc(arena, src->methodsCount, sizeof(DeviceMethod));
         
-        for (int i = 0; i < instance->methodsCount; i++) {
-            DeviceMethod *srcMethod = &instance->methods[i];
-            DeviceMethod *dstMethod = &device->instance.methods[i];
+        for (int i = 0; i < src->methodsCount; i++) {
+            DeviceMethod *srcMethod = &src->methods[i];
+            DeviceMethod *dstMethod = &dst->methods[i];
             
-            if (srcMethod->name) dstMethod->name = strdup(srcMethod->name);
-            if (srcMethod->description) dstMethod->description = strdup(srcMethod->description);
+            if (srcMethod->name) dstMethod->name = spec_strdup(arena, srcMethod->name);
+            if (srcMethod->description) dstMethod->description = spec_strdup(arena, srcMethod->description);
             
             // 复制 propertyNames 数组
             if (srcMethod->propertyNames && srcMethod->propertyNamesCount > 0) {
                 dstMethod->propertyNamesCount = srcMethod->propertyNamesCount;
-                dstMethod->propertyNames = calloc(srcMethod->propertyNamesCount, sizeof(char*));
+                dstMethod->propertyNames = spec_calloc(arena, srcMethod->propertyNamesCount, sizeof(char*));
                 
                 for (int j = 0; j < srcMethod->propertyNamesCount; j++) {
                     if (srcMethod->propertyNames[j]) {
-                        dstMethod->propertyNames[j] = strdup(srcMethod->propertyNames[j]);
+                        dstMethod->propertyNames[j] = spec_name(arena, srcMethod->propertyNames[j]);
                     }
                 }
             }
         }
     }
-    
-    // 复制设备状态（如果存在）
-    // device->instance.status = instance->status; // 枚举类型直接赋值
-    
-    // 深拷贝设备模型信息
-    memset(&device->model, 0, sizeof(DeviceModel));
-    if (model->id) device->model.id = strdup(model->id);
-    if (model->name) device->model.name = strdup(model->name);
-    if (model->namespace_) device->model.namespace_ = strdup(model->namespace_);
-    if (model->description) device->model.description = strdup(model->description);
-    
-    // 复制模型属性
-    if (model->properties && model->propertiesCount > 0) {
-        device->model.propertiesCount = model->propertiesCount;
-        device->model.properties = calloc(model->propertiesCount, sizeof(ModelProperty));
-        
-        for (int i = 0; i < model->propertiesCount; i++) {
-            ModelProperty *srcProp = &model->properties[i];
-            ModelProperty *dstProp = &device->model.properties[i];
-            
-            if (srcProp->name) dstProp->name = strdup(srcProp->name);
-            if (srcProp->dataType) dstProp->dataType = strdup(srcProp->dataType);
-            if (srcProp->description) dstProp->description = strdup(srcProp->description);
-            if (srcProp->accessMode) dstProp->accessMode = strdup(srcProp->accessMode);
-            if (srcProp->minimum) dstProp->minimum = strdup(srcProp->minimum);
-            if (srcProp->maximum) dstProp->maximum = strdup(srcProp->maximum);
-            if (srcProp->unit) dstProp->unit = strdup(srcProp->unit);
+}
+
+// 属性按 propertyName（缺省用 name）关联到设备自己的模型副本，写入时以模型 dataType 作类型提示
+static void device_bind_model_properties(Device *device) {
+    for (int i = 0; i < device->instance.propertiesCount; i++) {
+        DeviceProperty *p = &device->instance.properties[i];
+        const char *pn = p->propertyName ? p->propertyName : p->name;
+        p->pProperty = NULL;
+        for (int j = 0; pn && j < device->model.propertiesCount; j++) {
+            if (device->model.properties[j].name && strcmp(device->model.properties[j].name, pn) == 0) {
+                p->pProperty = &device->model.properties[j];
+                break;
+            }
         }
     }
+}
+
+// 按名字查找的字段（见 spec_name）统一换成驻留指针
+static void instance_adopt_names(DeviceInstance *instance) {
+    Arena *arena = instance->arena;
+    spec_name_adopt(arena, &instance->name);
+    spec_name_adopt(arena, &instance->namespace_);
+    spec_name_adopt(arena, &instance->model);
+    spec_name_adopt(arena, &instance->pProtocol.protocolName);
+    for (int i = 0; instance->twins && i < instance->twinsCount; i++) {
+        spec_name_adopt(arena, &instance->twins[i].propertyName);
+    }
+    for (int i = 0; instance->properties && i < instance->propertiesCount; i++) {
+        DeviceProperty *prop = &instance->properties[i];
+        spec_name_adopt(arena, &prop->name);
+        spec_name_adopt(arena, &prop->propertyName);
+        spec_name_adopt(arena, &prop->modelName);
+        spec_name_adopt(arena, &prop->protocol);
+    }
+    for (int i = 0; instance->methods && i < instance->methodsCount; i++) {
+        DeviceMethod *method = &instance->methods[i];
+        for (int j = 0; method->propertyNames && j < method->propertyNamesCount; j++) {
+            spec_name_adopt(arena, &method->propertyNames[j]);
+        }
+    }
+}
+
+// device_new / device_new_move 的公共部分：实例已就位，复制模型并建立运行时状态
+static Device *device_setup(Device *device, const DeviceModel *model) {
+    Arena *arena = device->instance.arena;
+    if (!device->instance.namespace_ || !*device->instance.namespace_) {
+        if (!arena) spec_name_free(device->instance.namespace_);
+        device->instance.namespace_ = spec_name(arena, "default");
+        log_debug("device_setup: namespace not provided, default -> 'default' (device=%s)",
+                  device->instance.name ? device->instance.name : "(nil)");
+    }
+
+    if (!arena) spec_name_free(device->instance.namespace_);
+    device->instance.namespace_ = spec_name(arena, "test");
+
+    // 深拷贝设备模型信息（与实例 spec 同在 arena 中）
+    model_copy_into(&device->model, model, arena);
+    device_bind_model_properties(device);
     
     // 初始化设备状态
     device->status = strdup(DEVICE_STATUS_UNKNOWN);
@@ -414,11 +749,17 @@ Device *device_new(const DeviceInstance *instance, const DeviceModel *model) {
         device_free(device);
         return NULL;
     }
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_cond_init(&device->wakeCond, &ca);
+    pthread_condattr_destroy(&ca);
     
     // 创建设备客户端（修正指针传递）
     if (device->instance.pProtocol.protocolName) {
         device->client = NewClient(&device->instance.pProtocol);
-        if (!device->client) {
+        // 没有对应驱动时保留设备（仍可查询），但不启动，保持 OFFLINE
+        if (!device->client && driver_lookup(device->instance.pProtocol.protocolName)) {
             log_error("Failed to create device client");
             device_free(device);
             return NULL;
@@ -428,11 +769,11 @@ Device *device_new(const DeviceInstance *instance, const DeviceModel *model) {
     // 若无 twins，则基于 properties 自动创建一组简单 twins
     if (device->instance.twinsCount == 0 && device->instance.propertiesCount > 0) {
         device->instance.twinsCount = device->instance.propertiesCount;
-        device->instance.twins = calloc(device->instance.twinsCount, sizeof(Twin));
+        device->instance.twins = spec_calloc(arena, device->instance.twinsCount, sizeof(Twin));
         for (int i = 0; i < device->instance.twinsCount; ++i) {
             DeviceProperty *p = &device->instance.properties[i];
             Twin *tw = &device->instance.twins[i];
-            tw->propertyName = p->name ? strdup(p->name) : strdup("unknown");
+            tw->propertyName = spec_name(arena, p->name ? p->name : "unknown");
             tw->property = p;              // 关键：建立关联
             tw->observedDesired.value = NULL;
             tw->reported.value = NULL;
@@ -443,122 +784,97 @@ Device *device_new(const DeviceInstance *instance, const DeviceModel *model) {
     // 若无 methods，则生成默认 SetProperty 方法（映射全部属性）
     if (device->instance.methodsCount == 0 && device->instance.propertiesCount > 0) {
         device->instance.methodsCount = 1;
-        device->instance.methods = calloc(1, sizeof(DeviceMethod));
+        device->instance.methods = spec_calloc(arena, 1, sizeof(DeviceMethod));
         DeviceMethod *m = &device->instance.methods[0];
-        m->name = strdup("SetProperty");
+        m->name = spec_strdup(arena, "SetProperty");
         m->propertyNamesCount = device->instance.propertiesCount;
-        m->propertyNames = calloc(m->propertyNamesCount, sizeof(char*));
+        m->propertyNames = spec_calloc(arena, m->propertyNamesCount, sizeof(char*));
         for (int i = 0; i < m->propertyNamesCount; ++i) {
-            m->propertyNames[i] = device->instance.properties[i].name
-                                  ? strdup(device->instance.properties[i].name)
-                                  : strdup("unknown");
+            const char *pn = device->instance.properties[i].name;
+            m->propertyNames[i] = spec_name(arena, pn ? pn : "unknown");
         }
         log_info("Auto-built default method SetProperty with %d properties", m->propertyNamesCount);
     }
+
+    device_twin_index_build(device);
+    devicetwin_snapshot_publish(device);
     
     log_info("Device created successfully: %s", device->instance.name);
     return device;
 }
 
-// 销毁设备
-void device_free(Device *device) {
-    if (!device) return;
-
-    // 不再无条件再次 stop，只有还在运行才停
-    if (device->dataThreadRunning || device->dataThread) {
-        device_stop(device);
+// 创建设备
+Device *device_new(const DeviceInstance *instance, const DeviceModel *model) {
+    if (!instance || !model) {
+        log_error("Invalid parameters for device creation");
+        return NULL;
     }
-
-    // 释放客户端
-    if (device->client) {
-        FreeClient(device->client);
+    
+    Device *device = calloc(1, sizeof(Device));
+    if (!device) {
+        log_error("Failed to allocate memory for device");
+        return NULL;
     }
+    
+    // 深拷贝设备实例信息
+    device_instance_copy(&device->instance, instance);
+    return device_setup(device, model);
+}
 
-    // 基本字段
-    free(device->instance.name);
-    free(device->instance.namespace_);
-    free(device->instance.model);
-    free(device->instance.protocolName);
-    free(device->instance.pProtocol.protocolName);
-    free(device->instance.pProtocol.configData);
-
-    // twins
-    if (device->instance.twins) {
-        for (int i = 0; i < device->instance.twinsCount; i++) {
-            Twin *twin = &device->instance.twins[i];
-            free(twin->propertyName);
-            free(twin->observedDesired.value);
-            free(twin->observedDesired.metadata.timestamp);
-            free(twin->observedDesired.metadata.type);
-            free(twin->reported.value);
-            free(twin->reported.metadata.timestamp);
-            free(twin->reported.metadata.type);
-
-            if (twin->property) {
-                // 判断是否指向 properties 数组内部；如果不是（说明曾经 deep copy），才释放
-                int embedded = 0;
-                if (device->instance.properties &&
-                    twin->property >= device->instance.properties &&
-                    twin->property < device->instance.properties + device->instance.propertiesCount) {
-                    embedded = 1;
-                }
-                if (!embedded) {
-                    free(twin->property->name);
-                    free(twin->property);
-                }
-                // 若 embedded == 1 则由后续 properties 统一释放，不能这里 free
-            }
-        }
-        free(device->instance.twins);
+// 接管 instance 的全部字段创建设备（instance 随后被清零），省去一次深拷贝
+Device *device_new_move(DeviceInstance *instance, const DeviceModel *model) {
+    if (!instance || !model) {
+        log_error("Invalid parameters for device creation");
+        return NULL;
     }
-
-    // properties
-    if (device->instance.properties) {
-        for (int i = 0; i < device->instance.propertiesCount; i++) {
-            DeviceProperty *prop = &device->instance.properties[i];
-            free(prop->name);
-            free(prop->propertyName);
-            free(prop->modelName);
-            free(prop->protocol);
-        }
-        free(device->instance.properties);
+    
+    Device *device = calloc(1, sizeof(Device));
+    if (!device) {
+        log_error("Failed to allocate memory for device");
+        return NULL;
     }
-
-    // methods
-    if (device->instance.methods) {
-        for (int i = 0; i < device->instance.methodsCount; i++) {
-            DeviceMethod *method = &device->instance.methods[i];
-            free(method->name);
-            free(method->description);
-            if (method->propertyNames) {
-                for (int j = 0; j < method->propertyNamesCount; j++) {
-                    free(method->propertyNames[j]);
-                }
-                free(method->propertyNames);
+    
+    device->instance = *instance;
+    memset(instance, 0, sizeof(*instance));
+    instance_adopt_names(&device->instance);
+    // 未关联的 twin 按名称关联到 properties
+    for (int i = 0; i < device->instance.twinsCount; i++) {
+        Twin *tw = &device->instance.twins[i];
+        if (tw->property || !tw->propertyName) continue;
+        for (int j = 0; j < device->instance.propertiesCount; j++) {
+            if (device->instance.properties[j].name &&
+                strcmp(device->instance.properties[j].name, tw->propertyName) == 0) {
+                tw->property = &device->instance.properties[j];
+                break;
             }
         }
-        free(device->instance.methods);
+    }
+    return device_setup(device, model);
+}
+
+// 销毁设备
+void device_free(Device *device) {
+    if (!device) return;
+    __atomic_store_n(&device->closing, 1, __ATOMIC_RELEASE);
+
+    // 不再无条件再次 stop，只有还在运行才停
+    if (device->dataThreadRunning || device->dataThread) {
+        device_stop(device);
     }
 
-    // model
-    free(device->model.name);
-    free(device->model.namespace_);
-    free(device->model.description);
-    if (device->model.properties) {
-        for (int i = 0; i < device->model.propertiesCount; i++) {
-            ModelProperty *prop = &device->model.properties[i];
-            free(prop->name);
-            free(prop->dataType);
-            free(prop->description);
-            free(prop->accessMode);
-            free(prop->minimum);
-            free(prop->maximum);
-            free(prop->unit);
-        }
-        free(device->model.properties);
+    // 释放客户端
+    if (device->client) {
+        FreeClient(device->client);
     }
 
+    // 模型在实例的 arena 中时随 device_instance_clear 一起释放
+    if (!device->instance.arena) device_model_clear(&device->model);
+    device_instance_clear(&device->instance);
+    free(device->twinIndex);
+    epoch_retire(device->twinSnapshot, NULL);
+
     free(device->status);
+    pthread_cond_destroy(&device->wakeCond);
     pthread_mutex_destroy(&device->mutex);
     free(device);
 }
@@ -575,30 +891,33 @@ static void device_runtime_rebuild(Device *device) {
             if (device->instance.twins[i].property == NULL) { rebuild = 1; break; }
         }
     }
+    Arena *arena = device->instance.arena;
     if (rebuild) {
-        free(device->instance.twins);
+        if (!arena) free(device->instance.twins);
         device->instance.twinsCount = device->instance.propertiesCount;
-        device->instance.twins = calloc(device->instance.twinsCount, sizeof(Twin));
+        device->instance.twins = spec_calloc(arena, device->instance.twinsCount, sizeof(Twin));
         for (int i = 0; i < device->instance.twinsCount; ++i) {
             DeviceProperty *p = &device->instance.properties[i];
             Twin *tw = &device->instance.twins[i];
-            tw->propertyName = p->name ? strdup(p->name) : strdup("unknown");
+            tw->propertyName = spec_name(arena, p->name ? p->name : "unknown");
             tw->property = p;
         }
         log_warn("Runtime rebuilt %d twins for device %s",
                  device->instance.twinsCount,
                  device->instance.name ? device->instance.name : "(unknown)");
+        device_twin_index_build(device);
+        devicetwin_snapshot_publish(device);
     }
     if (device->instance.methodsCount == 0 && device->instance.propertiesCount > 0) {
         device->instance.methodsCount = 1;
-        device->instance.methods = calloc(1, sizeof(DeviceMethod));
+        device->instance.methods = spec_calloc(arena, 1, sizeof(DeviceMethod));
         DeviceMethod *m = &device->instance.methods[0];
-        m->name = strdup("SetProperty");
+        m->name = spec_strdup(arena, "SetProperty");
         m->propertyNamesCount = device->instance.propertiesCount;
-        m->propertyNames = calloc(m->propertyNamesCount, sizeof(char*));
+        m->propertyNames = spec_calloc(arena, m->propertyNamesCount, sizeof(char*));
         for (int i = 0; i < m->propertyNamesCount; ++i) {
-            m->propertyNames[i] = device->instance.properties[i].name ?
-                                  strdup(device->instance.properties[i].name) : strdup("unknown");
+            const char *pn = device->instance.properties[i].name;
+            m->propertyNames[i] = spec_name(arena, pn ? pn : "unknown");
         }
         log_warn("Runtime rebuilt default method SetProperty (%d props)", m->propertyNamesCount);
     }
@@ -608,81 +927,143 @@ static void device_runtime_rebuild(Device *device) {
 int device_start(Device *device) {
     if (!device) return -1;
     
+    // 锁外初始化期间 update_spec 换下的旧客户端经 epoch 退役，不会被释放
+    epoch_read_enter();
     pthread_mutex_lock(&device->mutex);
-    device_runtime_rebuild(device);   // 新增：启动前兜底
-    log_info("Starting device: %s", device->instance.name);
-    
-    // 检查设备是否已启动
-    if (device->dataThreadRunning) {
-        log_warn("Device %s is already running", device->instance.name);
+    for (;;) {
+        // 上一次 device_stop 还在回收采集线程、或另一个 device_start 正在初始化时等它完成
+        while ((device->dataThreadRunning && !device->dataThread) || device->starting) {
+            pthread_cond_wait(&device->wakeCond, &device->mutex);
+        }
+        // 超时后仍在后台跑的启动可能晚于 device_stop 拿到锁，不能再清令牌、起新线程
+        if (__atomic_load_n(&device->closing, __ATOMIC_ACQUIRE)) {
+            pthread_mutex_unlock(&device->mutex);
+            epoch_read_exit();
+            return -1;
+        }
+        device_runtime_rebuild(device);   // 新增：启动前兜底
+        log_info("Starting device: %s", device->instance.name);
+        
+        // 已在采集则无事可做；线程在但连接断开（BACKOFF）时只重连客户端
+        if (device->dataThreadRunning && device_conn_collecting(device)) {
+            log_warn("Device %s is already running", device->instance.name);
+            pthread_mutex_unlock(&device->mutex);
+            epoch_read_exit();
+            return 0;
+        }
+        
+        if (!device->client && device->instance.pProtocol.protocolName) {
+            log_error("Device %s: no driver for protocol %s, not starting", device->instance.name,
+                      device->instance.pProtocol.protocolName);
+            device_conn_set(device, DEVICE_CONN_OFFLINE, "no driver");
+            pthread_mutex_unlock(&device->mutex);
+            epoch_read_exit();
+            return -1;
+        }
+
+        // 初始化设备客户端：可能有网络 I/O，放锁执行，该设备的读写与提交不必排在它后面
+        device_conn_set(device, DEVICE_CONN_CONNECTING, NULL);
+        CustomizedClient *client = device->client;
+        device->starting = 1;
         pthread_mutex_unlock(&device->mutex);
-        return 0;
-    }
-    
-    // 初始化设备客户端
-    if (device->client) {
-        if (InitDevice(device->client) != 0) {
+        int rc = client ? InitDevice(client) : 0;
+        pthread_mutex_lock(&device->mutex);
+        device->starting = 0;
+        pthread_cond_broadcast(&device->wakeCond);
+        if (device->client != client) continue;   // 期间协议变更换了客户端，按新客户端重来
+        if (rc != 0) {
             log_error("Failed to initialize device client for %s", device->instance.name);
-            device_set_status(device, DEVICE_STATUS_OFFLINE);
+            device_conn_connected(device, 0);
             pthread_mutex_unlock(&device->mutex);
+            epoch_read_exit();
             return -1;
         }
+        break;
+    }
+    if (__atomic_load_n(&device->closing, __ATOMIC_ACQUIRE)) {
+        device_conn_set(device, DEVICE_CONN_OFFLINE, "stopped");
+        pthread_mutex_unlock(&device->mutex);
+        epoch_read_exit();
+        return -1;
+    }
+    device_conn_connected(device, 1);
+    if (device->dataThreadRunning) {
+        pthread_cond_broadcast(&device->wakeCond);   // 采集线程立即恢复，不等满一个等待周期
+        pthread_mutex_unlock(&device->mutex);
+        epoch_read_exit();
+        log_info("Device %s reconnected", device->instance.name);
+        return 0;
     }
-    
-    device_set_status(device, DEVICE_STATUS_OK);  // 新增：确保数据线程进入采集
     
     // 启动数据处理线程
+    __atomic_store_n(&device->stopChan, 0, __ATOMIC_RELEASE);
     device->dataThreadRunning = 1;
     if (pthread_create(&device->dataThread, NULL, device_data_thread, device) != 0) {
         log_error("Failed to create data thread for device %s", device->instance.name);
         device->dataThreadRunning = 0;
-        device_set_status(device, DEVICE_STATUS_OFFLINE);
+        device->dataThread = 0;
+        device_conn_connected(device, 0);
         pthread_mutex_unlock(&device->mutex);
+        epoch_read_exit();
         return -1;
     }
     
-    // 不再 detach，清理阶段/stop 时可 join
-    
+    // 不再 detach，由 device_stop join
     pthread_mutex_unlock(&device->mutex);
     
     log_info("Device %s started successfully", device->instance.name);
+    epoch_read_exit();
     return 0;
 }
 
-// 停止设备
+// 发出停止令牌并唤醒等待中的采集线程，不等待其退出
+// 拿不到锁说明线程正在本轮读写中，它会在下一次读写前看到令牌
+static void device_request_stop(Device *device) {
+    __atomic_store_n(&device->stopChan, 1, __ATOMIC_RELEASE);
+    if (pthread_mutex_trylock(&device->mutex) == 0) {
+        pthread_cond_broadcast(&device->wakeCond);
+        pthread_mutex_unlock(&device->mutex);
+    }
+}
+
+// 停止设备：协作式退出，采集线程写完手上的样本后返回，不使用 pthread_cancel
 int device_stop(Device *device) {
     if (!device) return -1;
     
+    __atomic_store_n(&device->stopChan, 1, __ATOMIC_RELEASE);
     pthread_mutex_lock(&device->mutex);
     
     log_info("Stopping device: %s", device->instance.name);
+    // 正在锁外初始化的 device_start 先跑完，停止排在它之后
+    while (device->starting) pthread_cond_wait(&device->wakeCond, &device->mutex);
+    for (;;) {
+        if (device->dataThread) {
+            // 取走线程句柄的调用方负责 join；并发的 device_start 可能已清除令牌，这里重新置位
+            pthread_t thread = device->dataThread;
+            device->dataThread = 0;
+            __atomic_store_n(&device->stopChan, 1, __ATOMIC_RELEASE);
+            pthread_cond_broadcast(&device->wakeCond);
+            pthread_mutex_unlock(&device->mutex);
+            pthread_join(thread, NULL);
+            pthread_mutex_lock(&device->mutex);
+            device->dataThreadRunning = 0;
+            pthread_cond_broadcast(&device->wakeCond);
+            break;
+        }
+        if (!device->dataThreadRunning) break;
+        pthread_cond_wait(&device->wakeCond, &device->mutex);   // 另一个 stop 正在回收线程
+    }
     
-    // 设置停止标志
-    device->stopChan = 1;
-    device->dataThreadRunning = 0;
-    
-    // 停止设备客户端
+    // 线程已退出，此时关闭客户端不会与采集并发
     if (device->client) {
         StopDevice(device->client);
     }
     
-    // 设置设备状态
-    device_set_status(device, DEVICE_STATUS_OFFLINE);
+    // 主动停止的设备不再自动重连
+    device_conn_set(device, DEVICE_CONN_OFFLINE, "stopped");
     
     pthread_mutex_unlock(&device->mutex);
     
-    // 等待数据线程退出（最多等待 500ms * 10 次）
-    if (device->dataThread) {
-        for (int i = 0; i < 10; ++i) {
-            // 简单检查标志
-            if (!device->dataThreadRunning) break;
-            usleep(50000);
-        }
-        pthread_cancel(device->dataThread); // 若线程逻辑内已检查 stopChan 会自然退出; 取消作兜底
-        pthread_join(device->dataThread, NULL);
-        device->dataThread = 0;
-    }
-    
     log_info("Device %s stopped successfully", device->instance.name);
     return 0;
 }
@@ -698,11 +1079,9 @@ int device_restart(Device *device) {
         return -1;
     }
     
-    // 等待一段时间
-    usleep(100000); // 1秒
-    
+    // 失败时设备处于 BACKOFF，由连接巡检线程按退避继续重连
     if (device_start(device) != 0) {
-        log_error("Failed to start device %s during restart", device->instance.name);
+        log_error("Failed to start device %s during restart, will retry with backoff", device->instance.name);
         return -1;
     }
     
@@ -710,11 +1089,259 @@ int device_restart(Device *device) {
     return 0;
 }
 
-// 处理设备 Twin 数据（暂时简单实现）
-// 读取协议配置里的 ip/port（简易解析）
-int device_deal_twin(Device *device, const Twin *twin_in) {
-    if (!device || !twin_in) return -1;
-    Twin *twin = (Twin*)twin_in;
+#define SWAP_FIELD(a, b) do { __typeof__(a) swap_tmp_ = (a); (a) = (b); (b) = swap_tmp_; } while (0)
+
+static int str_eq(const char *a, const char *b) {
+    if (!a || !b) return a == b;
+    return intern_eq(a, b);
+}
+
+// twin 对应的属性配置；未绑定时按名称在 properties 中查找，只比驻留指针
+// （名字未驻留的外来实例在这里找不到，device_spec_same 随之判为不同，走完整更新）
+static const DeviceProperty *twin_property(const DeviceInstance *instance, const Twin *twin) {
+    if (twin->property) return twin->property;
+    const char *key = twin->propertyName ? intern_find(twin->propertyName) : NULL;
+    if (!key) return NULL;
+    for (int i = 0; i < instance->propertiesCount; i++) {
+        if (instance->properties[i].name == key) return &instance->properties[i];
+    }
+    return NULL;
+}
+
+// 两个属性的采集配置是否一致（名称、协议、visitor、周期）
+static int property_config_equal(const DeviceProperty *a, const DeviceProperty *b) {
+    if (!a || !b) return a == b;
+    return str_eq(a->name, b->name) && str_eq(a->propertyName, b->propertyName) &&
+           str_eq(a->protocol, b->protocol) && str_eq(a->visitors, b->visitors) &&
+           a->collectCycle == b->collectCycle && a->reportCycle == b->reportCycle &&
+           a->reportToCloud == b->reportToCloud;
+}
+
+static void device_free_retired(void *ptr) {
+    device_free((Device*)ptr);
+}
+
+static void model_free_retired(void *ptr) {
+    device_model_clear((DeviceModel*)ptr);
+    free(ptr);
+}
+
+static int model_property_equal(const ModelProperty *a, const ModelProperty *b) {
+    return str_eq(a->name, b->name) && str_eq(a->dataType, b->dataType) &&
+           str_eq(a->accessMode, b->accessMode) && str_eq(a->minimum, b->minimum) &&
+           str_eq(a->maximum, b->maximum);
+}
+
+static int method_equal(const DeviceMethod *a, const DeviceMethod *b) {
+    if (!str_eq(a->name, b->name) || a->propertyNamesCount != b->propertyNamesCount) return 0;
+    for (int i = 0; i < a->propertyNamesCount; i++) {
+        if (!str_eq(a->propertyNames[i], b->propertyNames[i])) return 0;
+    }
+    return 1;
+}
+
+// 新 spec 除 desired 外是否与当前完全一致，调用方需持有 device->mutex
+static int device_spec_same(const Device *device, const DeviceInstance *instance, const DeviceModel *model) {
+    // 命名空间由 device_setup 改写，不参与比较；twins/methods 缺省时按 device_setup 自动生成的形式比较
+    const DeviceInstance *cur = &device->instance;
+    if (!str_eq(cur->id, instance->id) ||
+        !str_eq(cur->protocolName, instance->protocolName) || !str_eq(cur->model, instance->model) ||
+        !str_eq(cur->pProtocol.protocolName, instance->pProtocol.protocolName) ||
+        !str_eq(cur->pProtocol.configData, instance->pProtocol.configData) ||
+        cur->status.reportToCloud != instance->status.reportToCloud ||
+        cur->status.reportCycle != instance->status.reportCycle) return 0;
+
+    if (cur->propertiesCount != instance->propertiesCount) return 0;
+    for (int i = 0; i < cur->propertiesCount; i++) {
+        if (!property_config_equal(&cur->properties[i], &instance->properties[i])) return 0;
+    }
+    if (instance->twinsCount > 0) {
+        if (cur->twinsCount != instance->twinsCount) return 0;
+        for (int i = 0; i < cur->twinsCount; i++) {
+            if (!str_eq(cur->twins[i].propertyName, instance->twins[i].propertyName) ||
+                !property_config_equal(twin_property(cur, &cur->twins[i]),
+                                       twin_property(instance, &instance->twins[i]))) return 0;
+        }
+    } else if (cur->twinsCount != instance->propertiesCount) {
+        return 0;
+    }
+    if (instance->methodsCount > 0 || instance->propertiesCount == 0) {
+        if (cur->methodsCount != instance->methodsCount) return 0;
+        for (int i = 0; i < cur->methodsCount; i++) {
+            if (!method_equal(&cur->methods[i], &instance->methods[i])) return 0;
+        }
+    }
+
+    if (!str_eq(device->model.name, model->name) ||
+        device->model.propertiesCount != model->propertiesCount) return 0;
+    for (int i = 0; i < model->propertiesCount; i++) {
+        if (!model_property_equal(&device->model.properties[i], &model->properties[i])) return 0;
+    }
+    return 1;
+}
+
+static void replace_str(char **dst, const char *src) {
+    free(*dst);
+    *dst = src ? strdup(src) : NULL;
+}
+
+// spec 未变时只原地更新 spec 中带来的 desired，调用方需持有 device->mutex
+static int device_apply_desired(Device *device, const DeviceInstance *instance) {
+    int updated = 0;
+    for (int i = 0; i < instance->twinsCount && i < device->instance.twinsCount; i++) {
+        const TwinProperty *nd = &instance->twins[i].observedDesired;
+        TwinProperty *od = &device->instance.twins[i].observedDesired;
+        if (!nd->value || (od->value && strcmp(od->value, nd->value) == 0)) continue;
+        replace_str(&od->value, nd->value);
+        replace_str(&od->metadata.timestamp, nd->metadata.timestamp);
+        replace_str(&od->metadata.type, nd->metadata.type);
+        updated++;
+    }
+    if (updated) {
+        device->twinSnapshotDirty = 1;
+        device_publish_twins(device);
+    }
+    return updated;
+}
+
+// 以新 spec 增量更新运行中的设备：
+// 名称与属性配置都未变的 twin 保留 reported（desired 以新 spec 为准，未带则沿用）；
+// 新增/变更的 twin 从空值开始，下一轮采集即按新配置读取；已删除的 twin 随旧数组一起退役。
+// 只有协议（protocolName/configData）变化时才停线程、换客户端并重新连接。
+// 名称与命名空间内容不变，旧 spec 经 epoch 延迟释放，无锁读者不受影响。
+// spec 除 desired 外完全未变时（例如只为下发 desired 的 UpdateDevice）不重建，只原地更新 desired。
+int device_update_spec(Device *device, const DeviceInstance *instance, const DeviceModel *model) {
+    if (!device || !instance || !model) return -1;
+
+    pthread_mutex_lock(&device->mutex);
+    if (device_spec_same(device, instance, model)) {
+        int updated = device_apply_desired(device, instance);
+        pthread_mutex_unlock(&device->mutex);
+        log_debug("Device %s spec unchanged, %d desired value(s) updated",
+                  instance->name ? instance->name : "(unknown)", updated);
+        return 0;
+    }
+    pthread_mutex_unlock(&device->mutex);
+
+    Device *fresh = device_new(instance, model);
+    if (!fresh) return -1;
+
+    pthread_mutex_lock(&device->mutex);
+    int protoChanged = !str_eq(device->instance.pProtocol.protocolName, fresh->instance.pProtocol.protocolName) ||
+                       !str_eq(device->instance.pProtocol.configData, fresh->instance.pProtocol.configData);
+    int wasRunning = device->dataThreadRunning;
+    pthread_mutex_unlock(&device->mutex);
+
+    if (protoChanged && wasRunning) device_stop(device);
+
+    pthread_mutex_lock(&device->mutex);
+    int kept = 0, changed = 0, added = 0;
+    for (int i = 0; i < fresh->instance.twinsCount; i++) {
+        Twin *nt = &fresh->instance.twins[i];
+        int j = nt->propertyName ? device_twin_index_lookup(device, nt->propertyName) : -1;
+        if (j < 0) {
+            added++;
+            continue;
+        }
+        Twin *ot = &device->instance.twins[j];
+        // 旧 twin 上的写入仍在锁外执行，由提交阶段按名称找到新 twin 清除标记
+        nt->writing = ot->writing;
+        if (protoChanged ||
+            !property_config_equal(twin_property(&device->instance, ot), twin_property(&fresh->instance, nt))) {
+            changed++;
+            continue;
+        }
+        SWAP_FIELD(nt->reported.value, ot->reported.value);
+        SWAP_FIELD(nt->reported.metadata.timestamp, ot->reported.metadata.timestamp);
+        SWAP_FIELD(nt->reported.metadata.type, ot->reported.metadata.type);
+        SWAP_FIELD(nt->appliedDesired, ot->appliedDesired);
+        if (!nt->observedDesired.value) {
+            SWAP_FIELD(nt->observedDesired.value, ot->observedDesired.value);
+            SWAP_FIELD(nt->observedDesired.metadata.timestamp, ot->observedDesired.metadata.timestamp);
+            SWAP_FIELD(nt->observedDesired.metadata.type, ot->observedDesired.metadata.type);
+        }
+        kept++;
+    }
+    int removed = device->instance.twinsCount - kept - changed;
+    if (removed < 0) removed = 0;
+
+    // spec 与模型都在各自实例的 arena 中，只能整体交换
+    SWAP_FIELD(device->instance, fresh->instance);
+    SWAP_FIELD(device->model, fresh->model);
+    if (protoChanged) SWAP_FIELD(device->client, fresh->client);
+    // fresh 已为新 twins 建好索引；旧索引随旧 spec 一起经 epoch 退役
+    SWAP_FIELD(device->twinIndex, fresh->twinIndex);
+    SWAP_FIELD(device->twinIndexMask, fresh->twinIndexMask);
+    device->twinSnapshotDirty = 1;
+    device_publish_twins(device);
+    pthread_mutex_unlock(&device->mutex);
+
+    // fresh 现在持有旧 spec（连同其 arena）与旧客户端（或未使用的新客户端）
+    epoch_retire(fresh, device_free_retired);
+
+    log_info("Device %s reconfigured: kept=%d changed=%d added=%d removed=%d protocol %s",
+             device->instance.name ? device->instance.name : "(unknown)",
+             kept, changed, added, removed, protoChanged ? "changed" : "unchanged");
+
+    if (protoChanged && wasRunning) return device_start(device);
+    return 0;
+}
+
+// 替换设备引用的模型副本，不影响采集
+// 设备有 arena 时新模型直接分配在其中，旧模型留到设备释放（模型更新很少，无需等待读者）；
+// 否则旧模型经 epoch 延迟释放
+int device_update_model(Device *device, const DeviceModel *model) {
+    if (!device || !model) return -1;
+    DeviceModel *old = NULL;
+    pthread_mutex_lock(&device->mutex);
+    Arena *arena = device->instance.arena;
+    if (!arena && !(old = calloc(1, sizeof(DeviceModel)))) {
+        pthread_mutex_unlock(&device->mutex);
+        return -1;
+    }
+    DeviceModel copy;
+    if (model_copy_into(&copy, model, arena) != 0) {
+        pthread_mutex_unlock(&device->mutex);
+        if (old) {
+            device_model_clear(&copy);
+            free(old);
+        }
+        return -1;
+    }
+    if (old) *old = device->model;
+    device->model = copy;
+    device_bind_model_properties(device);
+    pthread_mutex_unlock(&device->mutex);
+    if (old) epoch_retire(old, model_free_retired);
+    log_info("Device %s model updated to %s",
+             device->instance.name ? device->instance.name : "(unknown)",
+             model->name ? model->name : "(unknown)");
+    return 0;
+}
+
+void device_io_endpoint(const Device *device, char *out, size_t outsz) {
+    if (!out || outsz == 0) return;
+    const char *ep = device && device->client && device->client->endpoint[0] ? device->client->endpoint : "default";
+    snprintf(out, outsz, "%s", ep);
+}
+
+// desired 是否已在设备上生效：reported 正是按这个 desired 写入的结果（驱动可能取整，如 25.5 写入寄存器为 26），
+// 或按类型比较两者相同（线圈读回 true/false，desired 可能是 1/0）
+static int twin_desired_applied(const Twin *twin, const char *desired, const char *reported, const char *type) {
+    if (twin->appliedDesired && strcmp(twin->appliedDesired, desired) == 0) return 1;
+    if (!reported) return 0;
+    if (strcmp(reported, desired) == 0) return 1;
+    DriverValue d, r;
+    driver_value_parse(&d, desired, type);
+    driver_value_parse(&r, reported, type);
+    return driver_value_equal(&d, &r);
+}
+
+// 处理设备 Twin 数据：desired 与 reported 不一致时经协议驱动下发
+// 准备阶段：持 device->mutex，复制本次写入所需的全部状态并标记 twin 写入中
+int device_twin_write_prepare(Device *device, Twin *twin, DeviceTwinWrite *w) {
+    if (!device || !twin || !w) return 0;
+    memset(w, 0, sizeof(*w));
 
     if (sim_temperature_enabled() && twin->propertyName &&
         strcmp(twin->propertyName, "temperature") == 0) {
@@ -730,91 +1357,175 @@ int device_deal_twin(Device *device, const Twin *twin_in) {
         log_debug("Twin %s no desired, skip", prop);
         return 0;
     }
-    if (reported && strcmp(reported, desired) == 0) {
-        log_debug("Twin %s desired == reported (%s), skip", prop, desired);
+    const char *type = twin->observedDesired.metadata.type;
+    if (!type || !*type) type = twin->property && twin->property->pProperty ? twin->property->pProperty->dataType : NULL;
+    if (twin_desired_applied(twin, desired, reported, type)) {
+        log_debug("Twin %s desired %s already applied (reported %s), skip", prop, desired, reported ? reported : "-");
         return 0;
     }
-
-    // 解析协议配置
-    char ip[64] = "127.0.0.1";
-    int port = 1502;
-    if (device->instance.pProtocol.configData) {
-        json_get_str(device->instance.pProtocol.configData, "ip", ip, sizeof(ip));
-        json_get_int(device->instance.pProtocol.configData, "port", &port);
-        cleanup_escape_prefix(ip);   // 新增
+    // 另一路写入还在进行：它提交后若 desired 仍不一致，下一轮会再写
+    if (twin->writing) {
+        log_debug("Twin %s write in flight, skip", prop);
+        return 0;
     }
 
-    int offset = resolve_offset_by_name(twin->propertyName);
-    if (offset <= 0) {
-        log_warn("Twin %s: cannot resolve offset, skip", prop);
+    if (!device->client) {
+        log_debug("Twin %s: device has no protocol client, skip", prop);
         return 0;
     }
 
-    int value = atoi(desired);
-
-    // 注意：写保持寄存器不能带 -c
-    char hostBuf[128];
-    int portFixed;
-    normalize_host_port(ip, port, hostBuf, sizeof(hostBuf), &portFixed);
-
-    int timeout_s = 2;
-    const char *env_to = getenv("MAPPER_MBPOLL_TIMEOUT_S");
-    if (env_to && *env_to) {
-        int tv = atoi(env_to);
-        if (tv > 0 && tv < 30) timeout_s = tv;
+    w->value = strdup(desired);
+    w->desired = strdup(desired);
+    if (!w->value || !w->desired) {
+        free(w->value);
+        free(w->desired);
+        w->value = w->desired = NULL;
+        return 0;
     }
+    w->twin = twin;
+    w->namespace_ = device->instance.namespace_ ? device->instance.namespace_ : "default";
+    w->deviceName = device->instance.name ? device->instance.name : "unknown";
+    w->propertyName = twin->propertyName;
+    if (type) snprintf(w->type, sizeof(w->type), "%s", type);
+    w->client = device->client;
+    w->visitor.propertyName = twin->propertyName;
+    w->visitor.protocolName = device->instance.protocolName;
+    w->visitor.configData = twin->property ? twin->property->visitors : NULL;
+    device_io_endpoint(device, w->endpoint, sizeof(w->endpoint));
+    w->lane = IO_LANE_TELEMETRY;
+    w->rc = -1;
+    twin->writing = 1;
+    return 1;
+}
+
+// 一个样本（读取、写入成功或模拟数据）落库，publish 时同步发布
+static void twin_sample_sinks(const char *ns, const char *deviceName, const char *prop,
+                              const char *value, int publish) {
+    if (!prop) prop = "unknown";
+    mysql_recorder_record(ns, deviceName, prop, value, (long long)time(NULL) * 1000);
+    if (!publish || !g_publisher) return;
+    DataModel dm = (DataModel){0};
+    dm.namespace_   = (char*)ns;
+    dm.deviceName   = (char*)deviceName;
+    dm.propertyName = (char*)prop;
+    dm.type         = "string";
+    dm.value        = (char*)value;
+    dm.timeStamp    = (int64_t)time(NULL) * 1000;
+    int prc = publisher_publish_data(g_publisher, &dm);
+    if (prc != 0) log_warn("Publish failed for %s", dm.propertyName);
+}
 
-    char cmd[512];
-    snprintf(cmd, sizeof(cmd),
-             "timeout %d /usr/bin/mbpoll -1 -m tcp %s -p %d -a 1 -t 4 -r %d %d >/dev/null 2>&1",
-             timeout_s, hostBuf, portFixed, offset, value);
+static void twin_write_sinks(const DeviceTwinWrite *w) {
+    twin_sample_sinks(w->namespace_, w->deviceName, w->propertyName, w->value, !w->recordOnly);
+}
 
-    log_info("Twin %s: exec cmd=%s", prop, cmd);
+// 执行阶段：不持锁，只访问 w 中的副本
+void device_twin_write_execute(DeviceTwinWrite *w) {
+    device_twin_write_execute_batch(w, 1);
+}
 
-    int rcRaw = system(cmd);
-    int exit_code = -1;
-    if (rcRaw != -1) {
-        if (WIFEXITED(rcRaw)) exit_code = WEXITSTATUS(rcRaw);
-        else if (WIFSIGNALED(rcRaw)) exit_code = 128 + WTERMSIG(rcRaw);
+// 同一客户端的写入一起交给驱动，占一个端点调度名额，通道取其中最高优先级；
+// 驱动按各自协议合并（Modbus 把地址相邻的寄存器合并为一帧）
+void device_twin_write_execute_batch(DeviceTwinWrite *ws, int n) {
+    if (!ws || n <= 0) return;
+    DriverWriteItem *items = malloc((size_t)n * sizeof(*items));
+    int *owner = malloc((size_t)n * sizeof(*owner));
+    char *done = calloc((size_t)n, 1);
+    if (!items || !owner || !done) {
+        free(items);
+        free(owner);
+        free(done);
+        for (int i = 0; i < n; i++) ws[i].rc = -1;
+        return;
     }
-    if (exit_code != 0) {
-        log_error("Twin %s: mbpoll write failed (exit=%d raw=%d). cmd=%s",
-                  prop, exit_code, rcRaw, cmd);
-        return -1;
+    for (int i = 0; i < n; i++) {
+        if (done[i]) continue;
+        DeviceTwinWrite *w = &ws[i];
+        if (!w->value || w->recordOnly || !w->client) {
+            done[i] = 1;
+            w->rc = w->value && w->recordOnly ? 0 : -1;
+            if (w->rc == 0) twin_write_sinks(w);
+            continue;
+        }
+        int m = 0;
+        IoLane lane = w->lane;
+        for (int j = i; j < n; j++) {
+            if (done[j] || ws[j].client != w->client || !ws[j].value || ws[j].recordOnly) continue;
+            done[j] = 1;
+            owner[m] = j;
+            items[m].visitor = &ws[j].visitor;
+            driver_value_parse(&items[m].value, ws[j].value, ws[j].type[0] ? ws[j].type : NULL);
+            m++;
+            if (ws[j].lane < lane) lane = ws[j].lane;
+        }
+        IoSlot slot;
+        iosched_acquire(w->endpoint, lane, &slot);
+        int rc = DeviceDataWriteBatch(w->client, items, m);
+        iosched_release(&slot, rc == DRIVER_OK);
+        for (int k = 0; k < m; k++) {
+            DeviceTwinWrite *x = &ws[owner[k]];
+            x->rc = items[k].rc;
+            if (x->rc == DRIVER_ENOADDR) continue;   // 驱动已告警
+            if (x->rc != DRIVER_OK) {
+                log_error("Twin %s: write %s failed (rc=%d, %s)", x->propertyName ? x->propertyName : "(null)",
+                          x->value, x->rc, w->endpoint);
+                continue;
+            }
+            // 换成驱动实际写入的值（线圈 true/false、寄存器取整），回填 reported 后与下一次读回一致
+            char buf[DRIVER_VALUE_STR_MAX];
+            if (driver_value_format(&items[k].value, buf, sizeof(buf)) >= 0 && strcmp(buf, x->value) != 0) {
+                char *normalized = strdup(buf);
+                if (normalized) {
+                    free(x->value);
+                    x->value = normalized;
+                }
+            }
+            log_info("Twin %s write success: value=%s (%s)", x->propertyName ? x->propertyName : "(null)",
+                     x->value, w->endpoint);
+            twin_write_sinks(x);
+        }
     }
-    log_info("Twin %s: mbpoll write ok host=%s port=%d offset=%d val=%d",
-             prop, hostBuf, portFixed, offset, value);
-
-    // 回填 reported（本地内存）
-    free(twin->reported.value);
-    char ts[32]; now_iso8601(ts);
-    twin->reported.value = strdup(desired);
-    free(twin->reported.metadata.timestamp);
-    twin->reported.metadata.timestamp = strdup(ts);
+    free(items);
+    free(owner);
+    free(done);
+}
 
-    log_info("Twin %s write success: offset=%d value=%d (ip=%s:%d); reported updated",
-             prop, offset, value, hostBuf, portFixed);
-    // 写成功后落库
-    mysql_recorder_record(
-        device->instance.namespace_ ? device->instance.namespace_ : "default",
-        device->instance.name ? device->instance.name : "unknown",
-        twin->propertyName ? twin->propertyName : "unknown",
-        desired,
-        (long long)time(NULL) * 1000
-    );
-    // 同步发布
-    if (g_publisher) {
-        DataModel dm = (DataModel){0};
-        dm.namespace_   = device->instance.namespace_ ? device->instance.namespace_ : "default";
-        dm.deviceName   = device->instance.name ? device->instance.name : "unknown";
-        dm.propertyName = twin->propertyName ? twin->propertyName : "unknown";
-        dm.type         = "string";
-        dm.value        = (char*)desired;   // 去掉 const 警告
-        dm.timeStamp    = (int64_t)time(NULL) * 1000;
-        int prc = publisher_publish_data(g_publisher, &dm);
-        if (prc != 0) log_warn("Publish failed (write success) for %s", dm.propertyName);
+// 提交阶段：持 device->mutex。期间 update_spec 可能已替换 twins 数组，此时按名称找新的 twin
+int device_twin_write_commit(Device *device, DeviceTwinWrite *w) {
+    if (!device || !w) return -1;
+    int rc = w->rc;
+    Twin *twin = NULL;
+    if (w->twin && device->instance.twins &&
+        w->twin >= device->instance.twins &&
+        w->twin < device->instance.twins + device->instance.twinsCount) {
+        twin = w->twin;
+        twin->writing = 0;
+    } else if (w->propertyName) {
+        twin = device_find_twin(device, w->propertyName);
+        if (twin) twin->writing = 0;
     }
-    return 0;
+    // 寄存器里已是写入值，即使期间来了新的 desired 也如实回填，新值由下一轮写入；由调用方发布快照
+    if (rc == 0 && twin && !w->recordOnly) {
+        device_twin_set_reported(device, twin, w->value);
+        const char *desired = twin->observedDesired.value;
+        if (desired && strcmp(desired, w->desired) == 0) {
+            free(twin->appliedDesired);
+            twin->appliedDesired = w->desired;
+            w->desired = NULL;
+        }
+    }
+    free(w->value);
+    free(w->desired);
+    w->value = w->desired = NULL;
+    return rc;
+}
+
+int device_deal_twin(Device *device, const Twin *twin_in) {
+    if (!device || !twin_in) return -1;
+    DeviceTwinWrite w;
+    if (device_twin_write_prepare(device, (Twin*)twin_in, &w) != 1) return 0;
+    device_twin_write_execute(&w);
+    return device_twin_write_commit(device, &w);
 }
 
 // 创建设备管理器
@@ -834,7 +1545,18 @@ DeviceManager *device_manager_new(void) {
         free(manager);
         return NULL;
     }
-    
+    pthread_mutex_init(&manager->connMutex, NULL);
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_cond_init(&manager->connCond, &ca);
+    pthread_condattr_destroy(&ca);
+
+    manager->startOpts.concurrency = 32;
+    manager->startOpts.initTimeoutMs = 5000;
+    manager->startOpts.backoffMinMs = 1000;
+    manager->startOpts.backoffMaxMs = 60000;
+    manager->startOpts.probeIntervalSec = 10;
     manager->stopped = 0;   // 新增初始化
     return manager;
 }
@@ -850,8 +1572,14 @@ void device_manager_free(DeviceManager *manager) {
         device_free(manager->devices[i]);
     }
     free(manager->devices);
+    for (int i = 0; i < manager->modelCount; i++) {
+        device_model_clear(&manager->models[i]);
+    }
+    free(manager->models);
     pthread_mutex_unlock(&manager->managerMutex);
     pthread_mutex_destroy(&manager->managerMutex);
+    pthread_cond_destroy(&manager->connCond);
+    pthread_mutex_destroy(&manager->connMutex);
     free(manager);
 }
 
@@ -881,33 +1609,41 @@ int device_manager_add(DeviceManager *manager, Device *device) {
     return 0;
 }
 
-// 从管理器移除设备
+// 从管理器移除设备：先摘出数组再停止，释放交给 epoch，无锁读者可能仍持有该指针
 int device_manager_remove(DeviceManager *manager, const char *deviceId) {
     if (!manager || !deviceId) return -1;
     
+    Device *device = NULL;
     pthread_mutex_lock(&manager->managerMutex);
     
     for (int i = 0; i < manager->deviceCount; i++) {
         if (manager->devices[i] && manager->devices[i]->instance.name &&
             strcmp(manager->devices[i]->instance.name, deviceId) == 0) {
-            
-            device_free(manager->devices[i]);
+            device = manager->devices[i];
             
             // 移动数组元素
             for (int j = i; j < manager->deviceCount - 1; j++) {
                 manager->devices[j] = manager->devices[j + 1];
             }
             manager->deviceCount--;
-            
-            pthread_mutex_unlock(&manager->managerMutex);
-            log_info("Device %s removed from manager", deviceId);
-            return 0;
+            break;
         }
     }
     
     pthread_mutex_unlock(&manager->managerMutex);
-    log_warn("Device %s not found in manager", deviceId);
-    return -1;
+    if (!device) {
+        log_warn("Device %s not found in manager", deviceId);
+        return -1;
+    }
+
+    __atomic_store_n(&device->closing, 1, __ATOMIC_RELEASE);
+    device_stop(device);
+    // 采集已停，不会再追加
+    twinhistory_remove_device(device->instance.namespace_ ? device->instance.namespace_ : "default",
+                              device->instance.name);
+    epoch_retire(device, device_free_retired);
+    log_info("Device %s removed from manager", deviceId);
+    return 0;
 }
 
 // 从管理器获取设备
@@ -944,23 +1680,214 @@ Device *device_manager_get(DeviceManager *manager, const char *deviceId) {
     return NULL;
 }
 
-// 启动所有设备
-int device_manager_start_all(DeviceManager *manager) {
-    if (!manager) return -1;
-    
+Device *device_manager_find(DeviceManager *manager, const char *ns, const char *name) {
+    if (!manager || !name) return NULL;
+    if (!ns || !*ns) ns = "default";
+    // 设备名与命名空间都已驻留，没驻留过的名字一定不存在
+    const char *nameKey = intern_find(name);
+    const char *nsKey = intern_find(ns);
+    if (!nameKey || !nsKey) return NULL;
+    Device *found = NULL;
     pthread_mutex_lock(&manager->managerMutex);
-    
-    int success = 0;
-    for (int i = 0; i < manager->deviceCount; i++) {
-        if (device_start(manager->devices[i]) == 0) {
-            success++;
+    for (int i = 0; i < manager->deviceCount && !found; i++) {
+        Device *device = manager->devices[i];
+        if (device && device->instance.name == nameKey && device->instance.namespace_ == nsKey) {
+            found = device;
         }
     }
-    
     pthread_mutex_unlock(&manager->managerMutex);
-    
-    log_info("Started %d/%d devices", success, manager->deviceCount);
-    return success == manager->deviceCount ? 0 : -1;
+    return found;
+}
+
+// ==== 模型表：按名称保存深拷贝，供 RegisterDevice 等增量操作解析模型 ====
+// key 为驻留后的模型名（调用方在入口处 intern_find），只比指针
+static int model_index_locked(DeviceManager *manager, const char *key) {
+    if (!key) return -1;
+    for (int i = 0; i < manager->modelCount; i++) {
+        if (manager->models[i].name == key) return i;
+    }
+    return -1;
+}
+
+// 新增或替换同名模型
+int device_manager_put_model(DeviceManager *manager, const DeviceModel *model) {
+    if (!manager || !model || !model->name) return -1;
+    DeviceModel copy;
+    if (device_model_copy(&copy, model) != 0) {
+        device_model_clear(&copy);
+        return -1;
+    }
+
+    pthread_mutex_lock(&manager->managerMutex);
+    int i = model_index_locked(manager, copy.name);
+    if (i >= 0) {
+        device_model_clear(&manager->models[i]);
+        manager->models[i] = copy;
+        pthread_mutex_unlock(&manager->managerMutex);
+        return 0;
+    }
+    if (manager->modelCount >= manager->modelCapacity) {
+        int cap = manager->modelCapacity ? manager->modelCapacity * 2 : 8;
+        DeviceModel *models = realloc(manager->models, (size_t)cap * sizeof(DeviceModel));
+        if (!models) {
+            pthread_mutex_unlock(&manager->managerMutex);
+            device_model_clear(&copy);
+            return -1;
+        }
+        manager->models = models;
+        manager->modelCapacity = cap;
+    }
+    manager->models[manager->modelCount++] = copy;
+    pthread_mutex_unlock(&manager->managerMutex);
+    return 0;
+}
+
+int device_manager_remove_model(DeviceManager *manager, const char *name) {
+    if (!manager || !name) return -1;
+    const char *key = intern_find(name);
+    pthread_mutex_lock(&manager->managerMutex);
+    int i = model_index_locked(manager, key);
+    if (i < 0) {
+        pthread_mutex_unlock(&manager->managerMutex);
+        return -1;
+    }
+    device_model_clear(&manager->models[i]);
+    manager->models[i] = manager->models[--manager->modelCount];
+    pthread_mutex_unlock(&manager->managerMutex);
+    return 0;
+}
+
+// 找到时深拷贝到 out（调用方 device_model_clear），未找到返回 -1
+int device_manager_find_model(DeviceManager *manager, const char *name, DeviceModel *out) {
+    if (!manager || !name || !out) return -1;
+    const char *key = intern_find(name);
+    pthread_mutex_lock(&manager->managerMutex);
+    int i = model_index_locked(manager, key);
+    int rc = -1;
+    if (i >= 0) {
+        rc = device_model_copy(out, &manager->models[i]);
+        if (rc != 0) device_model_clear(out);
+    }
+    pthread_mutex_unlock(&manager->managerMutex);
+    return rc;
+}
+
+void device_manager_set_start_options(DeviceManager *manager, const DeviceStartOptions *opts) {
+    if (!manager || !opts) return;
+    pthread_mutex_lock(&manager->managerMutex);
+    if (opts->concurrency > 0) manager->startOpts.concurrency = opts->concurrency;
+    if (opts->initTimeoutMs >= 0) manager->startOpts.initTimeoutMs = opts->initTimeoutMs;
+    if (opts->backoffMinMs > 0) manager->startOpts.backoffMinMs = opts->backoffMinMs;
+    if (opts->backoffMaxMs > 0) manager->startOpts.backoffMaxMs = opts->backoffMaxMs;
+    if (opts->probeIntervalSec >= 0) manager->startOpts.probeIntervalSec = opts->probeIntervalSec;
+    device_conn_configure(&manager->startOpts);
+    pthread_mutex_unlock(&manager->managerMutex);
+}
+
+// 复制设备列表，调用方需在 epoch 读侧内使用：期间被移除的设备不会被释放
+static Device **collect_devices(DeviceManager *manager, int *count, DeviceStartOptions *opts) {
+    pthread_mutex_lock(&manager->managerMutex);
+    Device **list = manager->deviceCount > 0 ? malloc((size_t)manager->deviceCount * sizeof(Device*)) : NULL;
+    int n = 0;
+    for (int i = 0; list && i < manager->deviceCount; i++) {
+        if (manager->devices[i]) list[n++] = manager->devices[i];
+    }
+    *opts = manager->startOpts;
+    pthread_mutex_unlock(&manager->managerMutex);
+    *count = n;
+    return list;
+}
+
+#define CONN_TICK_MS 500
+
+// 连接巡检：BACKOFF 到期的设备交给并发启动池重连，在线设备按间隔用 GetDeviceStates 探测
+// 设备锁被采集轮次占用时跳过本轮（正在采集说明链路在用，结果由采集线程上报）
+static void *conn_supervisor_thread(void *arg) {
+    DeviceManager *manager = (DeviceManager*)arg;
+    for (;;) {
+        pthread_mutex_lock(&manager->connMutex);
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        ts.tv_nsec += CONN_TICK_MS * 1000000L;
+        if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+        if (!__atomic_load_n(&manager->stopped, __ATOMIC_ACQUIRE)) {
+            pthread_cond_timedwait(&manager->connCond, &manager->connMutex, &ts);
+        }
+        pthread_mutex_unlock(&manager->connMutex);
+        if (__atomic_load_n(&manager->stopped, __ATOMIC_ACQUIRE)) break;
+
+        DeviceStartOptions opts;
+        int n = 0, due = 0;
+        epoch_read_enter();
+        Device **list = collect_devices(manager, &n, &opts);
+        long long now = device_conn_now_ms();
+        for (int i = 0; i < n; i++) {
+            Device *d = list[i];
+            if (pthread_mutex_trylock(&d->mutex) != 0) continue;
+            int what = device_conn_due(d, now);
+            char endpoint[160];
+            if (what == 2) device_io_endpoint(d, endpoint, sizeof(endpoint));
+            pthread_mutex_unlock(&d->mutex);
+            if (what == 1) list[due++] = d;
+            if (what != 2) continue;
+            // 探测走采集通道排队，不让探测挡住控制写
+            IoSlot slot;
+            iosched_acquire(endpoint, IO_LANE_TELEMETRY, &slot);
+            pthread_mutex_lock(&d->mutex);
+            CustomizedClient *client = device_conn_collecting(d) ? d->client : NULL;
+            pthread_mutex_unlock(&d->mutex);
+            int ok = 1;
+            if (client) {
+                // 探测（TCP 为解析加连接）不持锁，处于 epoch 读区间，期间被换下的客户端不会被释放
+                const char *st = GetDeviceStates(client);
+                ok = st && strcmp(st, DEVICE_STATUS_OK) == 0;
+                pthread_mutex_lock(&d->mutex);
+                // 探测期间设备可能已停止或换了客户端，结果作废
+                if (d->client == client && device_conn_collecting(d)) device_conn_report(d, ok);
+                pthread_mutex_unlock(&d->mutex);
+            }
+            iosched_release(&slot, ok);
+        }
+        if (due > 0) {
+            log_info("Reconnecting %d device(s)", due);
+            device_start_parallel(list, due, &opts, &manager->stopped);
+        }
+        epoch_read_exit();
+        free(list);
+    }
+    return NULL;
+}
+
+static void start_conn_supervisor(DeviceManager *manager) {
+    pthread_mutex_lock(&manager->connMutex);
+    if (!manager->connRunning && !__atomic_load_n(&manager->stopped, __ATOMIC_ACQUIRE)) {
+        if (pthread_create(&manager->connThread, NULL, conn_supervisor_thread, manager) == 0) {
+            manager->connRunning = 1;
+        } else {
+            log_warn("Failed to create connection supervisor thread");
+        }
+    }
+    pthread_mutex_unlock(&manager->connMutex);
+}
+
+// 并发启动全部设备（device/startpool.h），失败的进入 BACKOFF 由连接巡检线程重连
+int device_manager_start_all(DeviceManager *manager) {
+    if (!manager) return -1;
+
+    DeviceStartOptions opts;
+    int count = 0;
+    epoch_read_enter();
+    Device **list = collect_devices(manager, &count, &opts);
+    int success = list ? device_start_parallel(list, count, &opts, &manager->stopped) : 0;
+    epoch_read_exit();
+    free(list);
+
+    log_info("Started %d/%d devices", success, count);
+    start_conn_supervisor(manager);
+    return success == count ? 0 : -1;
 }
 
 // 停止所有设备
@@ -970,13 +1897,33 @@ int device_manager_stop_all(DeviceManager *manager) {
         log_debug("device_manager_stop_all: already stopped");
         return 0;
     }
+    // 先置位：并发启动池与连接巡检线程不再领取新设备
+    __atomic_store_n(&manager->stopped, 1, __ATOMIC_RELEASE);
+    pthread_mutex_lock(&manager->connMutex);
+    pthread_cond_broadcast(&manager->connCond);
+    int joinConn = manager->connRunning;
+    manager->connRunning = 0;
+    pthread_mutex_unlock(&manager->connMutex);
+    if (joinConn) pthread_join(manager->connThread, NULL);
+
+    // 先给所有设备发停止令牌，再逐台回收：总耗时取决于最慢的一次在途读写，而非逐台累加
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
     pthread_mutex_lock(&manager->managerMutex);
+    for (int i = 0; i < manager->deviceCount; i++) {
+        if (!manager->devices[i]) continue;
+        __atomic_store_n(&manager->devices[i]->closing, 1, __ATOMIC_RELEASE);
+        device_request_stop(manager->devices[i]);
+    }
     for (int i = 0; i < manager->deviceCount; i++) {
         device_stop(manager->devices[i]);
     }
     pthread_mutex_unlock(&manager->managerMutex);
-    manager->stopped = 1;               // 标记
-    log_info("Stopped all devices");
+    // 启动超时后转入后台的 worker 仍引用设备，等它们退出后 device_manager_free 才能释放设备
+    device_start_pool_wait();
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    log_info("Stopped all devices in %lld ms",
+             (long long)(t1.tv_sec - t0.tv_sec) * 1000 + (t1.tv_nsec - t0.tv_nsec) / 1000000);
     return 0;
 }
 
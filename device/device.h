@@ -4,6 +4,7 @@
 #include "common/configmaptype.h"
 #include "common/eventtype.h"
 #include "driver/driver.h"
+#include "device/iosched.h"
 #include <pthread.h>
 
 /* 仅声明，不在公共头里引入具体数据库/流媒体实现，避免 C++ TU 冲突 */
@@ -12,6 +13,24 @@
 extern "C" {
 #endif
 
+// 设备连接状态机（devicestatus.c），字段受 device->mutex 保护
+typedef enum {
+    DEVICE_CONN_OFFLINE = 0,   // 未启动或已停止，不会自动重连
+    DEVICE_CONN_CONNECTING,    // 正在 InitDevice
+    DEVICE_CONN_ONLINE,
+    DEVICE_CONN_DEGRADED,      // 出现采集/探测失败，仍继续采集
+    DEVICE_CONN_BACKOFF,       // 连接失败，等待退避到期后由连接巡检线程重连
+} DeviceConnState;
+
+typedef struct {
+    DeviceConnState state;
+    int attempts;              // 连续失败的连接次数（连上但采集不到也算），决定退避时长
+    int failures;              // 在线期间连续失败的采集轮次/探测
+    long long retryAtMs;       // BACKOFF 到期时间（CLOCK_MONOTONIC）
+    long long probeAtMs;       // 下次健康探测时间
+    unsigned int seed;         // 退避抖动的随机数状态
+} DeviceConn;
+
 #ifndef DEVICE_TYPE_DEFINED
 #define DEVICE_TYPE_DEFINED
 typedef struct Device {
@@ -20,27 +39,93 @@ typedef struct Device {
     CustomizedClient *client;
     char *status;
     pthread_mutex_t mutex;
-    int stopChan;
+    pthread_cond_t wakeCond; // 唤醒采集线程（停止、重连成功）及等待线程退出的 device_stop
+    int stopChan;            // 停止令牌，原子读写；采集线程在每次读写之间检查
     pthread_t dataThread;
-    int dataThreadRunning;
+    int dataThreadRunning;   // 线程存在（含正在退出），由回收它的 device_stop 清零
+    int *twinIndex;          // 属性名 -> twins 下标（开放寻址哈希，-1 为空槽）
+    int twinIndexMask;       // 哈希表容量 - 1（容量为 2 的幂）
+    struct TwinSnapshot *twinSnapshot;  // 已发布的孪生值快照（原子替换，读侧无锁）
+    int twinSnapshotDirty;   // reported 已变更但尚未发布
+    DeviceConn conn;         // 连接状态
+    int closing;             // 管理器停止或设备移除后置位（原子读写），此后 device_start 直接失败
+    int starting;            // device_start 正在锁外初始化客户端，其他 start/stop 等它完成
 } Device;
 #endif
 
+// 启动与重连参数，来自 config.yaml common 段
+typedef struct {
+    int concurrency;         // 同时进行的 device_start 数
+    int initTimeoutMs;       // 单台启动超时，超时后不再等待它（0 为不限）
+    int backoffMinMs;        // 重连退避下限，每次失败翻倍
+    int backoffMaxMs;        // 重连退避上限
+    int probeIntervalSec;    // 在线设备的健康探测间隔（0 为不探测）
+} DeviceStartOptions;
+
 typedef struct {
     Device **devices;
     int deviceCount;
     int capacity;
     pthread_mutex_t managerMutex;
     int stopped;              // 新增：标记是否已经 stop_all
+    DeviceModel *models;      // 已知模型（启动时注册结果及 CreateDeviceModel 下发），受 managerMutex 保护
+    int modelCount;
+    int modelCapacity;
+    DeviceStartOptions startOpts;
+    pthread_t connThread;     // 连接巡检线程：到期重连、健康探测
+    int connRunning;
+    pthread_mutex_t connMutex;
+    pthread_cond_t connCond;
 } DeviceManager;
 
+// 一次 twin 写入的独立副本：持锁 prepare，锁外 execute（驱动下发、落库、发布），再持锁 commit
+// 名称、访问配置与客户端直接引用设备 spec，prepare 到 commit 之间调用方需处于 epoch 读区间
+typedef struct {
+    Twin *twin;                // 发起写入的 twin（commit 时可能已被 update_spec 替换）
+    const char *namespace_;
+    const char *deviceName;
+    const char *propertyName;
+    char *value;               // 写入值副本；执行成功后换成驱动实际写入的值
+    char *desired;             // 发起写入时 desired 文本的副本，commit 时释放
+    char type[16];             // 值类型提示（twin metadata 或物模型 dataType），驱动按此转换
+    CustomizedClient *client;  // 协议驱动客户端
+    VisitorConfig visitor;     // 属性访问配置（地址由驱动解析）
+    char endpoint[160];        // 端点调度键
+    int recordOnly;            // 只落库/发布（模拟数据），不下发
+    IoLane lane;               // 端点调度通道，prepare 默认为周期采集
+    int rc;                    // execute 结果
+} DeviceTwinWrite;
+
 /* 接口声明 */
 Device *device_new(const DeviceInstance *instance, const DeviceModel *model);
+// 接管 instance 中的全部内存（调用后 instance 被清零），启动时批量创建设备用
+Device *device_new_move(DeviceInstance *instance, const DeviceModel *model);
 void device_free(Device *device);
+void device_instance_clear(DeviceInstance *instance);
+int device_model_copy(DeviceModel *dst, const DeviceModel *src);
+void device_model_clear(DeviceModel *model);
+int device_update_spec(Device *device, const DeviceInstance *instance, const DeviceModel *model);
+int device_update_model(Device *device, const DeviceModel *model);
 int device_start(Device *device);
 int device_stop(Device *device);
 int device_restart(Device *device);
+// 持锁期间完成一次完整写入（I/O 也在锁内）；采集线程与 gRPC 下发使用下面的分阶段接口
 int device_deal_twin(Device *device, const Twin *twin);
+// 设备 I/O 端点（iosched 调度键，由驱动给出，如 "host:port"），调用方持锁或处于 epoch 读区间
+void device_io_endpoint(const Device *device, char *out, size_t outsz);
+// 返回 1 需要下发（须再调用 execute/commit），0 无需下发（已一致、无 desired 或已有写入进行中）
+int device_twin_write_prepare(Device *device, Twin *twin, DeviceTwinWrite *w);
+void device_twin_write_execute(DeviceTwinWrite *w);
+// 执行一批写入：同一客户端的写入一次交给驱动批量下发（Modbus 驱动合并相邻寄存器）
+void device_twin_write_execute_batch(DeviceTwinWrite *ws, int n);
+// 回填 reported 并清除进行中标记，返回 execute 结果
+int device_twin_write_commit(Device *device, DeviceTwinWrite *w);
+void device_twin_index_build(Device *device);
+int device_twin_index_lookup(const Device *device, const char *propertyName);
+Twin *device_find_twin(Device *device, const char *propertyName);
+unsigned int device_twin_name_hash(const char *name);
+void device_twin_set_reported(Device *device, Twin *twin, const char *value);
+void device_publish_twins(Device *device);
 int device_data_process(Device *device, const char *method, const char *config,
                         const char *propertyName, const void *data);
 const char *device_get_status(Device *device);
@@ -50,6 +135,12 @@ void device_manager_free(DeviceManager *manager);
 int device_manager_add(DeviceManager *manager, Device *device);
 int device_manager_remove(DeviceManager *manager, const char *deviceId);
 Device *device_manager_get(DeviceManager *manager, const char *deviceId);
+// 按 namespace 与名称精确查找（namespace 为空按 "default"），不做名称后缀兼容
+Device *device_manager_find(DeviceManager *manager, const char *ns, const char *name);
+int device_manager_put_model(DeviceManager *manager, const DeviceModel *model);
+int device_manager_remove_model(DeviceManager *manager, const char *name);
+int device_manager_find_model(DeviceManager *manager, const char *name, DeviceModel *out);
+void device_manager_set_start_options(DeviceManager *manager, const DeviceStartOptions *opts);
 int device_manager_start_all(DeviceManager *manager);
 int device_manager_stop_all(DeviceManager *manager);
 int device_init_from_config(Device *device, const char *configPath);
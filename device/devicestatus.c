@@ -2,10 +2,19 @@
 #include "device/device.h"
 #include "common/const.h"
 #include "log/log.h"
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <time.h>
 
+// 在线期间连续失败多少轮后断开重连
+#define DEVICE_CONN_FAIL_LIMIT 3
+
+static int g_backoff_min_ms = 1000;
+static int g_backoff_max_ms = 60000;
+static int g_probe_interval_ms = 10000;
+
 static long long now_ms(void) {
     struct timespec ts;
     clock_gettime(CLOCK_REALTIME, &ts);
@@ -84,4 +93,117 @@ int device_set_status(Device *device, const char *newStatus) {
 
 const char *device_get_status(Device *device) {
     return device_status_get_current(device);
-}
\ No newline at end of file
+}
+
+void device_conn_configure(const DeviceStartOptions *opts) {
+    if (!opts) return;
+    if (opts->backoffMinMs > 0) g_backoff_min_ms = opts->backoffMinMs;
+    if (opts->backoffMaxMs > 0) g_backoff_max_ms = opts->backoffMaxMs;
+    if (g_backoff_max_ms < g_backoff_min_ms) g_backoff_max_ms = g_backoff_min_ms;
+    if (opts->probeIntervalSec >= 0) g_probe_interval_ms = opts->probeIntervalSec * 1000;
+}
+
+long long device_conn_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000LL + ts.tv_nsec / 1000000LL;
+}
+
+const char *device_conn_state_name(DeviceConnState state) {
+    switch (state) {
+    case DEVICE_CONN_OFFLINE:    return "OFFLINE";
+    case DEVICE_CONN_CONNECTING: return "CONNECTING";
+    case DEVICE_CONN_ONLINE:     return "ONLINE";
+    case DEVICE_CONN_DEGRADED:   return "DEGRADED";
+    case DEVICE_CONN_BACKOFF:    return "BACKOFF";
+    }
+    return "UNKNOWN";
+}
+
+static const char *conn_status(DeviceConnState state) {
+    switch (state) {
+    case DEVICE_CONN_ONLINE:     return DEVICE_STATUS_OK;
+    case DEVICE_CONN_DEGRADED:   return DEVICE_STATUS_UNHEALTHY;
+    case DEVICE_CONN_CONNECTING:
+    case DEVICE_CONN_BACKOFF:    return DEVICE_STATUS_DISCONN;
+    case DEVICE_CONN_OFFLINE:    return DEVICE_STATUS_OFFLINE;
+    }
+    return DEVICE_STATUS_UNKNOWN;
+}
+
+void device_conn_set(Device *device, DeviceConnState state, const char *reason) {
+    if (!device) return;
+    DeviceConn *c = &device->conn;
+    if (state == DEVICE_CONN_OFFLINE) {
+        c->attempts = 0;
+        c->failures = 0;
+    }
+    if (c->state == state) return;
+    char msg[192];
+    snprintf(msg, sizeof(msg), "%s -> %s%s%s", device_conn_state_name(c->state),
+             device_conn_state_name(state), reason ? ": " : "", reason ? reason : "");
+    c->state = state;
+    device_status_update(device, conn_status(state));
+    device_status_send_event(device, "ConnectionStateChanged", msg);
+}
+
+// 指数退避 + 等量抖动：取 [d/2, d]，同一时刻掉线的设备不会同时重连
+static long long backoff_delay(DeviceConn *c) {
+    long long d = g_backoff_min_ms;
+    for (int i = 1; i < c->attempts && d < g_backoff_max_ms; i++) d *= 2;
+    if (d > g_backoff_max_ms) d = g_backoff_max_ms;
+    if (!c->seed) c->seed = (unsigned int)device_conn_now_ms() ^ (unsigned int)(uintptr_t)c;
+    return d / 2 + (long long)(rand_r(&c->seed) % (unsigned int)(d / 2 + 1));
+}
+
+void device_conn_connected(Device *device, int ok) {
+    if (!device) return;
+    DeviceConn *c = &device->conn;
+    long long now = device_conn_now_ms();
+    // InitDevice 成功不代表设备会应答（TCP 能连上、串口能打开），attempts 留到首轮采集或探测成功再清零
+    if (ok) {
+        c->failures = 0;
+        c->probeAtMs = now + g_probe_interval_ms;
+        device_conn_set(device, DEVICE_CONN_ONLINE, "connected");
+        return;
+    }
+    c->attempts++;
+    long long delay = backoff_delay(c);
+    c->retryAtMs = now + delay;
+    char reason[96];
+    snprintf(reason, sizeof(reason), "attempt %d failed, retry in %lld ms", c->attempts, delay);
+    device_conn_set(device, DEVICE_CONN_BACKOFF, reason);
+}
+
+void device_conn_report(Device *device, int ok) {
+    if (!device || !device_conn_collecting(device)) return;
+    DeviceConn *c = &device->conn;
+    if (ok) {
+        c->attempts = 0;
+        c->failures = 0;
+        if (c->state == DEVICE_CONN_DEGRADED) device_conn_set(device, DEVICE_CONN_ONLINE, "recovered");
+        return;
+    }
+    if (++c->failures < DEVICE_CONN_FAIL_LIMIT) {
+        device_conn_set(device, DEVICE_CONN_DEGRADED, "collection or probe failed");
+        return;
+    }
+    c->failures = 0;
+    device_conn_connected(device, 0);
+}
+
+int device_conn_collecting(const Device *device) {
+    return device && (device->conn.state == DEVICE_CONN_ONLINE ||
+                      device->conn.state == DEVICE_CONN_DEGRADED);
+}
+
+int device_conn_due(Device *device, long long nowMs) {
+    if (!device) return 0;
+    DeviceConn *c = &device->conn;
+    if (c->state == DEVICE_CONN_BACKOFF) return nowMs >= c->retryAtMs;
+    if (device_conn_collecting(device) && g_probe_interval_ms > 0 && nowMs >= c->probeAtMs) {
+        c->probeAtMs = nowMs + g_probe_interval_ms;
+        return 2;
+    }
+    return 0;
+}
@@ -3,14 +3,13 @@
 
 #include "common/const.h"
 #include "common/configmaptype.h"
+#include "device/device.h"
 #include <pthread.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-typedef struct Device Device;
-
 // 管理器也加 tag
 typedef struct DeviceStatusManager {
     int healthCheckRunning;
@@ -36,6 +35,23 @@ int device_status_stop_health_monitor(Device *device);
 int device_status_send_event(Device *device, const char *eventType, const char *message);
 int device_status_handle_offline(Device *device);
 int device_status_handle_online(Device *device);
+
+// 连接状态机：以下函数均要求调用方持有 device->mutex
+// 状态变化同步到 device->status（ONLINE=ok，DEGRADED=unhealthy，CONNECTING/BACKOFF=disconnected，
+// OFFLINE=offline），并通过 device_status_send_event 上报
+void device_conn_configure(const DeviceStartOptions *opts);   // 退避与探测参数，全局生效
+const char *device_conn_state_name(DeviceConnState state);
+void device_conn_set(Device *device, DeviceConnState state, const char *reason);
+// 一次连接尝试的结果：成功转 ONLINE，失败按指数退避 + 抖动转 BACKOFF
+void device_conn_connected(Device *device, int ok);
+// 一轮采集或一次健康探测的结果：成功才清零退避计数；在线期间失败转 DEGRADED，连续失败转 BACKOFF 重连
+void device_conn_report(Device *device, int ok);
+// 当前状态下是否应继续采集
+int device_conn_collecting(const Device *device);
+// 到期需要重连返回 1；在线且到了探测时间返回 2（并推迟下次探测）；否则返回 0
+int device_conn_due(Device *device, long long nowMs);
+long long device_conn_now_ms(void);
+
 DeviceStatusManager *device_status_manager_new(void);
 void device_status_manager_free(DeviceStatusManager *manager);
 int device_status_manager_add(DeviceStatusManager *manager, Device *device);
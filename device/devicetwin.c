@@ -1,6 +1,8 @@
 #include "devicetwin.h"
 #include "device.h"
 #include "log/log.h"
+#include "common/epoch.h"
+#include "common/intern.h"
 #include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
@@ -71,38 +73,47 @@ int devicetwin_get(Device *device, const char *propertyName, TwinResult *result)
     memset(result, 0, sizeof(TwinResult));
     result->timestamp = get_current_time_ms();
 
-    // 查找 twin
-    Twin *twin = NULL;
-    for (int i = 0; i < device->instance.twinsCount; i++) {
-        if (device->instance.twins[i].propertyName &&
-            strcmp(device->instance.twins[i].propertyName, propertyName) == 0) {
-            twin = &device->instance.twins[i];
-            break;
-        }
-    }
-
-    if (!twin) {
-        result->error = strdup("Property not found");
-        return -1;
-    }
-
-    // 优先直接返回已轮询的 reported 值
-    if (twin->reported.value) {
-        result->value = strdup(twin->reported.value);
+    // 优先直接返回已轮询的 reported 值（读已发布快照，不与采集线程争用）
+    epoch_read_enter();
+    const TwinSnapshotEntry *entry =
+        devicetwin_snapshot_find(devicetwin_snapshot_acquire(device), propertyName);
+    if (entry && entry->value) {
+        result->value = strdup(entry->value);
+        epoch_read_exit();
         result->success = 1;
         return 0;
     }
 
-    // 没 property 也继续（放宽）
+    // 快照未命中：持锁查找 twin 并取出访问配置与客户端，它们随 spec 经 epoch 退役，
+    // 在读侧区间内放锁做 I/O 仍然有效
     VisitorConfig visitorConfig = (VisitorConfig){0};
-    visitorConfig.propertyName = (char*)propertyName;
-    visitorConfig.protocolName = device->instance.protocolName;
-    if (twin->property && twin->property->visitors) {
-        visitorConfig.configData = twin->property->visitors;
+    char endpoint[160];
+    pthread_mutex_lock(&device->mutex);
+    Twin *twin = device_find_twin(device, propertyName);
+    CustomizedClient *client = device->client;
+    if (twin) {
+        // 没 property 也继续（放宽）
+        visitorConfig.propertyName = twin->propertyName;
+        visitorConfig.protocolName = device->instance.protocolName;
+        if (twin->property && twin->property->visitors) {
+            visitorConfig.configData = twin->property->visitors;
+        }
+    }
+    device_io_endpoint(device, endpoint, sizeof(endpoint));
+    pthread_mutex_unlock(&device->mutex);
+    if (!twin) {
+        epoch_read_exit();
+        result->error = strdup("Property not found");
+        return -1;
     }
 
+    // 走按需读通道，排在控制写之后、周期采集之前
+    IoSlot slot;
+    iosched_acquire(endpoint, IO_LANE_ONDEMAND, &slot);
     void *deviceData = NULL;
-    int ret = GetDeviceData(device->client, &visitorConfig, &deviceData);
+    int ret = GetDeviceData(client, &visitorConfig, &deviceData);
+    iosched_release(&slot, ret == 0 && deviceData);
+    epoch_read_exit();
     if (ret != 0 || !deviceData) {
         result->error = strdup("Failed to read device data");
         return -1;
@@ -124,48 +135,51 @@ int devicetwin_set(Device *device, const char *propertyName, const char *value,
     log_debug("Setting twin property %s for device %s to value: %s", 
               propertyName, device->instance.name, value);
     
-    // 查找对应的 twin 配置
-    Twin *twin = NULL;
-    for (int i = 0; i < device->instance.twinsCount; i++) {
-        if (device->instance.twins[i].propertyName &&
-            strcmp(device->instance.twins[i].propertyName, propertyName) == 0) {
-            twin = &device->instance.twins[i];
-            break;
-        }
+    // 持锁查找 twin 并取出访问配置与客户端；它们随 spec 经 epoch 退役，
+    // 在读侧区间内放锁做 I/O 仍然有效
+    VisitorConfig visitorConfig = {0};
+    char endpoint[160];
+    int valid = 0;
+    epoch_read_enter();
+    pthread_mutex_lock(&device->mutex);
+    Twin *twin = device_find_twin(device, propertyName);
+    CustomizedClient *client = device->client;
+    if (twin && twin->property) {
+        // 简化：跳过访问模式检查，因为 DeviceProperty 可能没有 accessMode 字段
+        valid = devicetwin_validate_data(twin, value) == 0 ? 1 : -1;
+        visitorConfig.propertyName = twin->propertyName;
+        visitorConfig.protocolName = device->instance.protocolName;
+        visitorConfig.configData = twin->property->visitors;
     }
-    
-    if (!twin || !twin->property) {
+    device_io_endpoint(device, endpoint, sizeof(endpoint));
+    pthread_mutex_unlock(&device->mutex);
+    if (valid == 0) {
+        epoch_read_exit();
         result->error = strdup("Property not found or not configured");
         return -1;
     }
-    
-    // 简化：跳过访问模式检查，因为 DeviceProperty 可能没有 accessMode 字段
-    
-    // 验证数据
-    if (devicetwin_validate_data(twin, value) != 0) {
+    if (valid < 0) {
+        epoch_read_exit();
         result->error = strdup("Invalid data value");
         return -1;
     }
     
-    // 构建访问配置
-    VisitorConfig visitorConfig = {0};
-    visitorConfig.propertyName = (char*)propertyName;
-    visitorConfig.protocolName = device->instance.protocolName;
-    
-    if (twin->property->visitors) {
-        visitorConfig.configData = twin->property->visitors;
-    }
-    
-    // 写入设备数据
-    int ret = DeviceDataWrite(device->client, &visitorConfig, "SetProperty", propertyName, value);
+    // 写入设备数据：写与回读占同一个控制通道名额
+    IoSlot slot;
+    iosched_acquire(endpoint, IO_LANE_CONTROL, &slot);
+    int ret = DeviceDataWrite(client, &visitorConfig, "SetProperty", propertyName, value);
     if (ret != 0) {
+        iosched_release(&slot, 0);
+        epoch_read_exit();
         result->error = strdup("Failed to write device data");
         return -1;
     }
     
     // 验证写入结果 - 重新读取
     void *deviceData = NULL;
-    ret = GetDeviceData(device->client, &visitorConfig, &deviceData);
+    ret = GetDeviceData(client, &visitorConfig, &deviceData);
+    iosched_release(&slot, 1);
+    epoch_read_exit();
     if (ret == 0 && deviceData) {
         result->value = strdup((char*)deviceData);
         result->success = 1;
@@ -179,6 +193,99 @@ int devicetwin_set(Device *device, const char *propertyName, const char *value,
     return 0;
 }
 
+// ==== 孪生值快照 ====
+static size_t str_size(const char *s) {
+    return s ? strlen(s) + 1 : 0;
+}
+
+static const char *str_put(char **cursor, const char *s) {
+    if (!s) return NULL;
+    size_t n = strlen(s) + 1;
+    char *dst = *cursor;
+    memcpy(dst, s, n);
+    *cursor += n;
+    return dst;
+}
+
+// 将当前 twins 的 reported 值复制进一块连续内存并原子发布
+int devicetwin_snapshot_publish(Device *device) {
+    if (!device) return -1;
+
+    int count = device->instance.twins ? device->instance.twinsCount : 0;
+    int idxCap = device->twinIndex ? device->twinIndexMask + 1 : 0;
+    // arena 模式下 twin 名已驻留、永不释放，快照直接引用，不再复制
+    int sharedNames = device->instance.arena != NULL;
+
+    size_t strBytes = 0;
+    for (int i = 0; i < count; i++) {
+        const Twin *tw = &device->instance.twins[i];
+        const char *type = tw->reported.metadata.type ? tw->reported.metadata.type
+                                                      : tw->observedDesired.metadata.type;
+        strBytes += (sharedNames ? 0 : str_size(tw->propertyName)) + str_size(tw->reported.value) +
+                    str_size(tw->reported.metadata.timestamp) + str_size(type);
+    }
+    size_t head = sizeof(TwinSnapshot) + (size_t)count * sizeof(TwinSnapshotEntry);
+    size_t idxBytes = (size_t)idxCap * sizeof(int);
+
+    TwinSnapshot *snap = malloc(head + idxBytes + strBytes);
+    if (!snap) {
+        log_error("Twin snapshot alloc failed for device %s",
+                  device->instance.name ? device->instance.name : "(unknown)");
+        return -1;
+    }
+    snap->count = count;
+    snap->indexMask = idxCap ? idxCap - 1 : 0;
+    snap->index = NULL;
+    if (idxCap) {
+        int *idx = (int*)((char*)snap + head);
+        memcpy(idx, device->twinIndex, idxBytes);
+        snap->index = idx;
+    }
+    char *cursor = (char*)snap + head + idxBytes;
+    for (int i = 0; i < count; i++) {
+        const Twin *tw = &device->instance.twins[i];
+        const char *type = tw->reported.metadata.type ? tw->reported.metadata.type
+                                                      : tw->observedDesired.metadata.type;
+        TwinSnapshotEntry *e = &snap->entries[i];
+        e->propertyName = sharedNames ? tw->propertyName : str_put(&cursor, tw->propertyName);
+        e->value = str_put(&cursor, tw->reported.value);
+        e->timestamp = str_put(&cursor, tw->reported.metadata.timestamp);
+        e->type = str_put(&cursor, type);
+    }
+
+    TwinSnapshot *old = __atomic_load_n(&device->twinSnapshot, __ATOMIC_ACQUIRE);
+    snap->version = old ? old->version + 1 : 1;
+    __atomic_store_n(&device->twinSnapshot, snap, __ATOMIC_SEQ_CST);
+    device->twinSnapshotDirty = 0;
+    epoch_retire(old, NULL);
+    return 0;
+}
+
+const TwinSnapshot *devicetwin_snapshot_acquire(const Device *device) {
+    if (!device) return NULL;
+    return __atomic_load_n(&((Device*)device)->twinSnapshot, __ATOMIC_SEQ_CST);
+}
+
+const TwinSnapshotEntry *devicetwin_snapshot_find(const TwinSnapshot *snap, const char *propertyName) {
+    if (!snap || !propertyName) return NULL;
+    if (!snap->index) {
+        for (int i = 0; i < snap->count; i++) {
+            if (intern_eq(snap->entries[i].propertyName, propertyName)) {
+                return &snap->entries[i];
+            }
+        }
+        return NULL;
+    }
+    unsigned int mask = (unsigned int)snap->indexMask;
+    unsigned int h = device_twin_name_hash(propertyName) & mask;
+    while (snap->index[h] >= 0) {
+        const TwinSnapshotEntry *e = &snap->entries[snap->index[h]];
+        if (intern_eq(e->propertyName, propertyName)) return e;
+        h = (h + 1) & mask;
+    }
+    return NULL;
+}
+
 // 处理孪生数据
 int devicetwin_process_data(Device *device, const Twin *twin, const void *data) {
     if (!device || !twin || !data) return -1;
@@ -18,6 +18,23 @@ typedef struct {
     long long timestamp;               // 时间戳
 } TwinResult;
 
+// 孪生值快照条目（指向快照内部的只读字符串）
+typedef struct {
+    const char *propertyName;
+    const char *value;                 // 尚未上报时为 NULL
+    const char *timestamp;
+    const char *type;
+} TwinSnapshotEntry;
+
+// 不可变的设备孪生值快照：写者整体替换，旧版本经 epoch 回收
+typedef struct TwinSnapshot {
+    unsigned long long version;        // 每次发布递增
+    int count;                         // 条目数，顺序与 instance.twins 一致
+    int indexMask;                     // 名称索引容量 - 1，无索引时为 0
+    const int *index;                  // 名称索引（同 device->twinIndex）
+    TwinSnapshotEntry entries[];
+} TwinSnapshot;
+
 // 孪生处理器
 typedef struct {
     char *propertyName;                // 属性名
@@ -67,6 +84,11 @@ int devicetwin_manager_add(TwinManager *manager, const Twin *twin);
 int devicetwin_manager_remove(TwinManager *manager, const char *propertyName);
 TwinProcessor *devicetwin_manager_get(TwinManager *manager, const char *propertyName);
 
+// 孪生值快照：publish 需持有 device->mutex；acquire/find 须处于 epoch_read_enter/exit 之间
+int devicetwin_snapshot_publish(Device *device);
+const TwinSnapshot *devicetwin_snapshot_acquire(const Device *device);
+const TwinSnapshotEntry *devicetwin_snapshot_find(const TwinSnapshot *snap, const char *propertyName);
+
 // 工具函数
 int devicetwin_parse_visitor_config(const char *configData, VisitorConfig *config);
 char *devicetwin_build_report_data(const char *propertyName, const char *value, long long timestamp);
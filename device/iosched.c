@@ -0,0 +1,204 @@
+#include "device/iosched.h"
+#include "common/intern.h"
+#include "log/log.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define IOSCHED_TABLE_SIZE 64   // 端点哈希桶数（2 的幂）
+
+const int iosched_bucket_ms[IOSCHED_BUCKETS] = {10, 50, 100, 250, 500, 1000, 5000, -1};
+
+typedef struct {
+    unsigned long long head;   // 下一个可放行的排队号
+    unsigned long long tail;   // 下一个发出的排队号，head == tail 时无人等待
+    int inflight;
+    long long ops;
+    long long failures;
+    long long sloMiss;
+    long long waitTotalUs;
+    long long waitMaxUs;
+    long long latTotalUs;
+    long long latMaxUs;
+    long long buckets[IOSCHED_BUCKETS];
+} IoLaneState;
+
+// 端点建立后不删除，数量受设备配置约束
+typedef struct IoEndpoint {
+    const char *name;          // 驻留字符串，按指针比较
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int inflight;
+    IoLaneState lanes[IO_LANE_COUNT];
+    struct IoEndpoint *next;   // 哈希桶链
+    struct IoEndpoint *allNext;
+} IoEndpoint;
+
+static pthread_mutex_t g_table_lock = PTHREAD_MUTEX_INITIALIZER;
+static IoEndpoint *g_table[IOSCHED_TABLE_SIZE];
+static IoEndpoint *g_all = NULL;
+static IoSchedOptions g_opts = {
+    .endpointConcurrency = 2,
+    .laneLimit = {0, 0, 1},    // 采集最多占一个名额，另一个始终留给控制写/按需读
+};
+
+static long long mono_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void iosched_configure(const IoSchedOptions *opts) {
+    if (!opts) return;
+    g_opts = *opts;
+    if (g_opts.endpointConcurrency <= 0) g_opts.endpointConcurrency = 1;
+    log_info("I/O scheduler: endpoint_concurrency=%d lanes control=%d ondemand=%d telemetry=%d",
+             g_opts.endpointConcurrency, g_opts.laneLimit[IO_LANE_CONTROL],
+             g_opts.laneLimit[IO_LANE_ONDEMAND], g_opts.laneLimit[IO_LANE_TELEMETRY]);
+}
+
+const char *iosched_lane_name(IoLane lane) {
+    switch (lane) {
+        case IO_LANE_CONTROL:   return "control";
+        case IO_LANE_ONDEMAND:  return "ondemand";
+        case IO_LANE_TELEMETRY: return "telemetry";
+        default:                return "unknown";
+    }
+}
+
+static int lane_limit(IoLane lane) {
+    int limit = g_opts.laneLimit[lane];
+    return (limit <= 0 || limit > g_opts.endpointConcurrency) ? g_opts.endpointConcurrency : limit;
+}
+
+static IoEndpoint *endpoint_get(const char *endpoint) {
+    const char *name = intern(endpoint && *endpoint ? endpoint : "default");
+    if (!name) return NULL;
+    unsigned int h = (unsigned int)(((uintptr_t)name >> 4) & (IOSCHED_TABLE_SIZE - 1));
+
+    pthread_mutex_lock(&g_table_lock);
+    IoEndpoint *ep = g_table[h];
+    while (ep && ep->name != name) ep = ep->next;
+    if (!ep && (ep = calloc(1, sizeof(*ep))) != NULL) {
+        ep->name = name;
+        pthread_mutex_init(&ep->mutex, NULL);
+        pthread_cond_init(&ep->cond, NULL);
+        ep->next = g_table[h];
+        g_table[h] = ep;
+        ep->allNext = g_all;
+        g_all = ep;
+    }
+    pthread_mutex_unlock(&g_table_lock);
+    return ep;
+}
+
+// 持 ep->mutex：排队号 ticket 是否可以放行
+static int can_run(const IoEndpoint *ep, IoLane lane, unsigned long long ticket) {
+    const IoLaneState *ls = &ep->lanes[lane];
+    if (ticket != ls->head) return 0;
+    if (ep->inflight >= g_opts.endpointConcurrency) return 0;
+    if (ls->inflight >= lane_limit(lane)) return 0;
+    // 更高优先级通道有人排队且其通道名额未满时让行
+    for (int h = 0; h < (int)lane; h++) {
+        const IoLaneState *hs = &ep->lanes[h];
+        if (hs->tail != hs->head && hs->inflight < lane_limit((IoLane)h)) return 0;
+    }
+    return 1;
+}
+
+void iosched_acquire(const char *endpoint, IoLane lane, IoSlot *slot) {
+    if (!slot) return;
+    memset(slot, 0, sizeof(*slot));
+    if (lane < 0 || lane >= IO_LANE_COUNT) lane = IO_LANE_TELEMETRY;
+    slot->lane = lane;
+    slot->queuedUs = mono_us();
+    IoEndpoint *ep = endpoint_get(endpoint);
+    if (!ep) {
+        // 内存不足时不调度，直接执行
+        slot->startUs = slot->queuedUs;
+        return;
+    }
+
+    pthread_mutex_lock(&ep->mutex);
+    IoLaneState *ls = &ep->lanes[lane];
+    unsigned long long ticket = ls->tail++;
+    while (!can_run(ep, lane, ticket)) {
+        pthread_cond_wait(&ep->cond, &ep->mutex);
+    }
+    ls->head++;
+    ls->inflight++;
+    ep->inflight++;
+    // 队首前移后同通道下一位可能也能放行
+    if (ls->tail != ls->head) pthread_cond_broadcast(&ep->cond);
+    pthread_mutex_unlock(&ep->mutex);
+
+    slot->ep = ep;
+    slot->startUs = mono_us();
+}
+
+void iosched_release(IoSlot *slot, int ok) {
+    if (!slot || !slot->ep) return;
+    IoEndpoint *ep = slot->ep;
+    long long now = mono_us();
+    long long wait = slot->startUs - slot->queuedUs;
+    long long lat = now - slot->queuedUs;
+    int b = 0;
+    while (b < IOSCHED_BUCKETS - 1 && lat > (long long)iosched_bucket_ms[b] * 1000) b++;
+    int slo = g_opts.sloMs[slot->lane];
+
+    pthread_mutex_lock(&ep->mutex);
+    IoLaneState *ls = &ep->lanes[slot->lane];
+    ls->inflight--;
+    ep->inflight--;
+    ls->ops++;
+    if (!ok) ls->failures++;
+    ls->waitTotalUs += wait;
+    if (wait > ls->waitMaxUs) ls->waitMaxUs = wait;
+    ls->latTotalUs += lat;
+    if (lat > ls->latMaxUs) ls->latMaxUs = lat;
+    ls->buckets[b]++;
+    if (slo > 0 && lat > (long long)slo * 1000) ls->sloMiss++;
+    pthread_cond_broadcast(&ep->cond);
+    pthread_mutex_unlock(&ep->mutex);
+
+    if (slo > 0 && lat > (long long)slo * 1000) {
+        log_debug("I/O %s on %s took %lld ms (queued %lld ms), SLO %d ms",
+                  iosched_lane_name(slot->lane), ep->name, lat / 1000, wait / 1000, slo);
+    }
+    slot->ep = NULL;
+}
+
+int iosched_stats(IoLaneStats **out) {
+    if (!out) return 0;
+    *out = NULL;
+    pthread_mutex_lock(&g_table_lock);
+    int n = 0;
+    for (IoEndpoint *ep = g_all; ep; ep = ep->allNext) n++;
+    IoLaneStats *stats = n > 0 ? calloc((size_t)n * IO_LANE_COUNT, sizeof(*stats)) : NULL;
+    int count = 0;
+    for (IoEndpoint *ep = g_all; ep && stats; ep = ep->allNext) {
+        pthread_mutex_lock(&ep->mutex);
+        for (int l = 0; l < IO_LANE_COUNT; l++) {
+            const IoLaneState *ls = &ep->lanes[l];
+            IoLaneStats *s = &stats[count++];
+            s->endpoint = ep->name;
+            s->lane = (IoLane)l;
+            s->inflight = ls->inflight;
+            s->queued = (int)(ls->tail - ls->head);
+            s->ops = ls->ops;
+            s->failures = ls->failures;
+            s->sloMiss = ls->sloMiss;
+            s->waitTotalUs = ls->waitTotalUs;
+            s->waitMaxUs = ls->waitMaxUs;
+            s->latTotalUs = ls->latTotalUs;
+            s->latMaxUs = ls->latMaxUs;
+            memcpy(s->buckets, ls->buckets, sizeof(s->buckets));
+        }
+        pthread_mutex_unlock(&ep->mutex);
+    }
+    pthread_mutex_unlock(&g_table_lock);
+    *out = stats;
+    return count;
+}
@@ -0,0 +1,69 @@
+#ifndef DEVICE_IOSCHED_H
+#define DEVICE_IOSCHED_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 按端点（host:port）调度设备 I/O：每个端点有三条优先级通道，
+// 有空闲名额时总是先放行控制写，再按需读，最后周期采集；同一通道内先来先服务。
+// 已在进行的 I/O 不会被打断，控制写最多等待一次在途操作，而不是整轮采集
+
+typedef enum {
+    IO_LANE_CONTROL = 0,     // 期望值下发（UpdateDevice、REST 写）
+    IO_LANE_ONDEMAND,        // 按需读（REST 读快照未命中）
+    IO_LANE_TELEMETRY,       // 周期采集与健康探测
+    IO_LANE_COUNT
+} IoLane;
+
+#define IOSCHED_BUCKETS 8    // 延迟直方图桶数，上界见 iosched_bucket_ms
+
+typedef struct {
+    int endpointConcurrency;         // 单个端点同时进行的 I/O 数
+    int laneLimit[IO_LANE_COUNT];    // 各通道在单个端点上的并发上限（<=0 取 endpointConcurrency）
+    int sloMs[IO_LANE_COUNT];        // 排队 + 执行耗时目标，超出计入 sloMiss（0 不统计）
+} IoSchedOptions;
+
+// 一次已放行的 I/O，iosched_acquire 填写，iosched_release 归还
+typedef struct {
+    struct IoEndpoint *ep;
+    IoLane lane;
+    long long queuedUs;      // 进入队列时间（CLOCK_MONOTONIC，微秒）
+    long long startUs;       // 放行时间
+} IoSlot;
+
+// 通道统计（从启动起累计）
+typedef struct {
+    const char *endpoint;    // 驻留字符串
+    IoLane lane;
+    int inflight;
+    int queued;
+    long long ops;
+    long long failures;
+    long long sloMiss;
+    long long waitTotalUs;   // 排队耗时
+    long long waitMaxUs;
+    long long latTotalUs;    // 排队 + 执行耗时
+    long long latMaxUs;
+    long long buckets[IOSCHED_BUCKETS];   // 按 latency 落桶
+} IoLaneStats;
+
+extern const int iosched_bucket_ms[IOSCHED_BUCKETS];   // 最后一桶为 -1（+Inf）
+
+// 启动前调用；未调用时按 endpointConcurrency=2、采集通道 1 个名额运行
+void iosched_configure(const IoSchedOptions *opts);
+const char *iosched_lane_name(IoLane lane);
+
+// 阻塞直到本通道在该端点上获得名额；endpoint 为空时归入 "default"
+void iosched_acquire(const char *endpoint, IoLane lane, IoSlot *slot);
+// ok 为 0 计入 failures
+void iosched_release(IoSlot *slot, int ok);
+
+// 所有端点 × 通道的统计快照，返回条数，*out 由调用方 free
+int iosched_stats(IoLaneStats **out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DEVICE_IOSCHED_H
@@ -0,0 +1,222 @@
+#include "device/startpool.h"
+#include "common/epoch.h"
+#include "log/log.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+
+enum {
+    START_PENDING = 0,
+    START_RUNNING,
+    START_OK,
+    START_FAILED,
+    START_TIMEOUT
+};
+
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    Device **devices;
+    int count;
+    int next;              // 下一个待启动下标
+    int finished;          // 已有结果（成功/失败/超时）的台数
+    int scanFrom;          // [scanFrom, next) 之外没有 RUNNING
+    unsigned char *state;
+    long long *startedAt;  // RUNNING 设备的开始时间（CLOCK_MONOTONIC，毫秒）
+    const int *stopFlag;
+    int refs;              // 调用方 + 尚未退出的 worker，归零时释放
+} StartPool;
+
+// 存活的 worker 线程数（跨所有池），device_start_pool_wait 等它归零
+static pthread_mutex_t g_workersMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_workersCond = PTHREAD_COND_INITIALIZER;
+static int g_workers;
+
+static long long mono_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void pool_unref_locked(StartPool *pool) {
+    if (--pool->refs > 0) {
+        pthread_mutex_unlock(&pool->mutex);
+        return;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    pthread_cond_destroy(&pool->cond);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool->devices);
+    free(pool->state);
+    free(pool->startedAt);
+    free(pool);
+}
+
+static int pool_stopping(const StartPool *pool) {
+    return pool->stopFlag && __atomic_load_n(pool->stopFlag, __ATOMIC_ACQUIRE);
+}
+
+// worker 依次领取设备；所领设备被判超时后名额已转给替补 worker，本线程跑完即退出
+static void *start_worker(void *arg) {
+    StartPool *pool = (StartPool*)arg;
+    // 领取设备前进入读侧，被并发移除的设备在本线程返回前不会被释放
+    epoch_read_enter();
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->next < pool->count && !pool_stopping(pool)) {
+        int i = pool->next++;
+        Device *device = pool->devices[i];
+        pool->state[i] = START_RUNNING;
+        pool->startedAt[i] = mono_ms();
+        // 调用方可能正无限期等待，唤醒它按新设备的开始时间设定超时
+        pthread_cond_broadcast(&pool->cond);
+        pthread_mutex_unlock(&pool->mutex);
+
+        int rc = device_start(device);   // 失败时设备已转入 BACKOFF
+
+        pthread_mutex_lock(&pool->mutex);
+        if (pool->state[i] == START_TIMEOUT) {
+            log_info("Device %s finished starting after timeout: %s",
+                     device->instance.name ? device->instance.name : "(unknown)",
+                     rc == 0 ? "ok" : "failed");
+            break;
+        }
+        pool->state[i] = rc == 0 ? START_OK : START_FAILED;
+        pool->finished++;
+        pthread_cond_broadcast(&pool->cond);
+    }
+    pthread_cond_broadcast(&pool->cond);
+    epoch_read_exit();
+    pool_unref_locked(pool);
+    return NULL;
+}
+
+static void *start_worker_thread(void *arg) {
+    start_worker(arg);
+    pthread_mutex_lock(&g_workersMutex);
+    if (--g_workers == 0) pthread_cond_broadcast(&g_workersCond);
+    pthread_mutex_unlock(&g_workersMutex);
+    return NULL;
+}
+
+static int spawn_worker(StartPool *pool) {
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_t tid;
+    pool->refs++;
+    pthread_mutex_lock(&g_workersMutex);
+    g_workers++;
+    pthread_mutex_unlock(&g_workersMutex);
+    int rc = pthread_create(&tid, &attr, start_worker_thread, pool);
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        pool->refs--;
+        pthread_mutex_lock(&g_workersMutex);
+        if (--g_workers == 0) pthread_cond_broadcast(&g_workersCond);
+        pthread_mutex_unlock(&g_workersMutex);
+        log_warn("start pool: failed to create worker (rc=%d)", rc);
+        return -1;
+    }
+    return 0;
+}
+
+int device_start_parallel(Device **devices, int count, const DeviceStartOptions *opts,
+                          const int *stopFlag) {
+    if (!devices || count <= 0) return 0;
+    int concurrency = opts && opts->concurrency > 0 ? opts->concurrency : 1;
+    if (concurrency > count) concurrency = count;
+    long long timeoutMs = opts && opts->initTimeoutMs > 0 ? opts->initTimeoutMs : 0;
+
+    StartPool *pool = calloc(1, sizeof(StartPool));
+    if (!pool) return -1;
+    pool->devices = malloc((size_t)count * sizeof(Device*));
+    pool->state = calloc((size_t)count, 1);
+    pool->startedAt = calloc((size_t)count, sizeof(long long));
+    if (!pool->devices || !pool->state || !pool->startedAt) {
+        free(pool->devices);
+        free(pool->state);
+        free(pool->startedAt);
+        free(pool);
+        return -1;
+    }
+    memcpy(pool->devices, devices, (size_t)count * sizeof(Device*));
+    pool->count = count;
+    pool->stopFlag = stopFlag;
+    pool->refs = 1;
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_cond_init(&pool->cond, &ca);
+    pthread_condattr_destroy(&ca);
+
+    // 调用方线程可能被取消，等待期间禁止取消，保证池内状态一致
+    int oldCancel;
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &oldCancel);
+
+    pthread_mutex_lock(&pool->mutex);
+    int workers = 0;
+    for (int i = 0; i < concurrency; i++) {
+        if (spawn_worker(pool) == 0) workers++;
+    }
+    if (workers == 0) {
+        // 无法建线程时退化为在当前线程顺序启动
+        pthread_mutex_unlock(&pool->mutex);
+        pool->refs++;
+        start_worker(pool);
+        pthread_mutex_lock(&pool->mutex);
+    }
+
+    int ok = 0, failed = 0, timedOut = 0;
+    for (;;) {
+        int inflight = 0;
+        long long now = mono_ms();
+        long long wake = 0;
+        while (pool->scanFrom < pool->next && pool->state[pool->scanFrom] >= START_OK) pool->scanFrom++;
+        for (int i = pool->scanFrom; i < pool->next; i++) {
+            if (pool->state[i] != START_RUNNING) continue;
+            long long due = pool->startedAt[i] + timeoutMs;
+            if (timeoutMs > 0 && due <= now) {
+                Device *d = pool->devices[i];
+                pool->state[i] = START_TIMEOUT;
+                pool->finished++;
+                log_warn("Device %s did not start within %lld ms, continuing with others",
+                         d->instance.name ? d->instance.name : "(unknown)", timeoutMs);
+                // 超时设备的线程不再领取新设备，补一个 worker 维持并发度
+                if (pool->next < pool->count && !pool_stopping(pool)) spawn_worker(pool);
+                continue;
+            }
+            inflight++;
+            if (timeoutMs > 0 && (wake == 0 || due < wake)) wake = due;
+        }
+        int remaining = pool_stopping(pool) ? pool->next : pool->count;
+        if (pool->finished >= remaining && inflight == 0) break;
+        if (pool->refs <= 1 && inflight == 0) break;   // worker 全部退出（建线程失败）
+        if (wake > 0) {
+            struct timespec ts = { .tv_sec = wake / 1000, .tv_nsec = (wake % 1000) * 1000000 };
+            pthread_cond_timedwait(&pool->cond, &pool->mutex, &ts);
+        } else {
+            pthread_cond_wait(&pool->cond, &pool->mutex);
+        }
+    }
+    for (int i = 0; i < pool->count; i++) {
+        if (pool->state[i] == START_OK) ok++;
+        else if (pool->state[i] == START_FAILED) failed++;
+        else if (pool->state[i] == START_TIMEOUT) timedOut++;
+    }
+    int skipped = pool->count - ok - failed - timedOut;
+    pool_unref_locked(pool);
+    pthread_setcancelstate(oldCancel, NULL);
+
+    log_info("Parallel start: %d ok, %d failed, %d timed out, %d skipped (concurrency=%d, timeout=%lldms)",
+             ok, failed, timedOut, skipped, concurrency, timeoutMs);
+    return ok;
+}
+
+void device_start_pool_wait(void) {
+    pthread_mutex_lock(&g_workersMutex);
+    while (g_workers > 0) pthread_cond_wait(&g_workersCond, &g_workersMutex);
+    pthread_mutex_unlock(&g_workersMutex);
+}
@@ -0,0 +1,24 @@
+#ifndef DEVICE_STARTPOOL_H
+#define DEVICE_STARTPOOL_H
+
+#include "device/device.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 并发启动一批设备：最多 opts->concurrency 个 device_start 同时进行
+// 单台设备超过 opts->initTimeoutMs 仍未返回时记为超时并释放名额给后续设备，
+// 其启动线程在后台继续跑完（成功则设备照常运行，失败则进入 BACKOFF 等待重连）
+// *stopFlag 非 0 时不再取新设备，已在进行的启动照常完成
+// 返回按时启动成功的台数
+int device_start_parallel(Device **devices, int count, const DeviceStartOptions *opts,
+                          const int *stopFlag);
+// 等待所有启动 worker（含超时后仍在后台跑的）退出；释放设备前调用
+void device_start_pool_wait(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DEVICE_STARTPOOL_H
@@ -0,0 +1,380 @@
+#include "device/twinhistory.h"
+#include "common/tsblock.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <pthread.h>
+
+#define TWINHISTORY_HASH_MIN 1024     // 初始桶数（2 的幂），序列数超过桶数时翻倍
+#define TWINHISTORY_BLOCK_POINTS 256    // 每块点数，写满后封存
+#define TWINHISTORY_DECODE_CHUNK 256
+
+// 压缩块及其摘要；摘要用于按时间跳过整块，以及整块落在区间内时免解码聚合
+typedef struct HistoryBlock {
+    TsBlock data;
+    unsigned char type;         // 同一块内类型一致，类型变化时切块
+    long long tMin;
+    long long tMax;
+    double min;
+    double max;
+    double sum;
+    struct HistoryBlock *next;  // 从旧到新
+} HistoryBlock;
+
+typedef struct HistorySeries {
+    char *ns;
+    char *device;
+    char *property;
+    unsigned int hash;
+    pthread_mutex_t mutex;      // 保护块链表，写者只有所属设备的采集线程
+    HistoryBlock *oldest;
+    HistoryBlock *newest;       // 仍可追加的块
+    size_t points;
+    struct HistorySeries *next;
+} HistorySeries;
+
+// 序列表：查找持读锁，新建序列（及扩容）、删除设备的序列持写锁；读写序列都先持读锁，持写锁时可直接释放序列
+static pthread_rwlock_t g_history_lock = PTHREAD_RWLOCK_INITIALIZER;
+static HistorySeries **g_table = NULL;
+static size_t g_buckets = 0;
+static size_t g_series = 0;
+static size_t g_capacity = 0;
+
+static unsigned int series_hash(const char *ns, const char *device, const char *property) {
+    unsigned int h = 2166136261u;   // FNV-1a
+    const char *parts[3] = {ns, device, property};
+    for (int i = 0; i < 3; i++) {
+        for (const unsigned char *p = (const unsigned char*)parts[i]; *p; p++) {
+            h ^= *p;
+            h *= 16777619u;
+        }
+        h ^= '/';
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static HistorySeries *series_find(unsigned int h, const char *ns, const char *device, const char *property) {
+    if (!g_table) return NULL;
+    for (HistorySeries *s = g_table[h & (g_buckets - 1)]; s; s = s->next) {
+        if (s->hash == h && strcmp(s->property, property) == 0 &&
+            strcmp(s->device, device) == 0 && strcmp(s->ns, ns) == 0) return s;
+    }
+    return NULL;
+}
+
+static void block_free(HistoryBlock *b) {
+    if (!b) return;
+    tsblock_free(&b->data);
+    free(b);
+}
+
+static void series_free(HistorySeries *s) {
+    if (!s) return;
+    HistoryBlock *b = s->oldest;
+    while (b) {
+        HistoryBlock *next = b->next;
+        block_free(b);
+        b = next;
+    }
+    pthread_mutex_destroy(&s->mutex);
+    free(s->ns);
+    free(s->device);
+    free(s->property);
+    free(s);
+}
+
+// 持写锁；负载因子超过 1 时桶数翻倍，失败时保持原表（链只是变长）
+static void table_grow(void) {
+    if (g_table && g_series <= g_buckets) return;
+    size_t buckets = g_table ? g_buckets * 2 : TWINHISTORY_HASH_MIN;
+    HistorySeries **table = calloc(buckets, sizeof(*table));
+    if (!table) return;
+    for (size_t i = 0; i < g_buckets; i++) {
+        HistorySeries *s = g_table[i];
+        while (s) {
+            HistorySeries *next = s->next;
+            s->next = table[s->hash & (buckets - 1)];
+            table[s->hash & (buckets - 1)] = s;
+            s = next;
+        }
+    }
+    free(g_table);
+    g_table = table;
+    g_buckets = buckets;
+}
+
+static HistorySeries *series_new(unsigned int h, const char *ns, const char *device, const char *property) {
+    HistorySeries *s = calloc(1, sizeof(HistorySeries));
+    if (!s) return NULL;
+    pthread_mutex_init(&s->mutex, NULL);
+    s->hash = h;
+    s->ns = strdup(ns);
+    s->device = strdup(device);
+    s->property = strdup(property);
+    if (!s->ns || !s->device || !s->property) {
+        series_free(s);
+        return NULL;
+    }
+    return s;
+}
+
+void twinhistory_init(size_t capacity) {
+    pthread_rwlock_wrlock(&g_history_lock);
+    g_capacity = capacity;
+    pthread_rwlock_unlock(&g_history_lock);
+}
+
+void twinhistory_shutdown(void) {
+    pthread_rwlock_wrlock(&g_history_lock);
+    for (size_t i = 0; i < g_buckets; i++) {
+        HistorySeries *s = g_table[i];
+        while (s) {
+            HistorySeries *next = s->next;
+            series_free(s);
+            s = next;
+        }
+    }
+    free(g_table);
+    g_table = NULL;
+    g_buckets = 0;
+    g_series = 0;
+    g_capacity = 0;
+    pthread_rwlock_unlock(&g_history_lock);
+}
+
+void twinhistory_remove_device(const char *ns, const char *device) {
+    if (!device) return;
+    if (!ns) ns = "default";
+    size_t removed = 0;
+    pthread_rwlock_wrlock(&g_history_lock);
+    for (size_t i = 0; i < g_buckets; i++) {
+        HistorySeries **link = &g_table[i];
+        while (*link) {
+            HistorySeries *s = *link;
+            if (strcmp(s->device, device) == 0 && strcmp(s->ns, ns) == 0) {
+                *link = s->next;
+                series_free(s);
+                removed++;
+            } else {
+                link = &s->next;
+            }
+        }
+    }
+    g_series -= removed;
+    pthread_rwlock_unlock(&g_history_lock);
+}
+
+static int parse_value(const char *value, double *out, unsigned char *type) {
+    if (strcasecmp(value, "true") == 0 || strcasecmp(value, "false") == 0) {
+        *out = (value[0] == 't' || value[0] == 'T') ? 1.0 : 0.0;
+        *type = TWIN_HISTORY_BOOL;
+        return 0;
+    }
+    char *endp = NULL;
+    double v = strtod(value, &endp);
+    if (endp == value || *endp != '\0') return -1;
+    *out = v;
+    *type = TWIN_HISTORY_NUMBER;
+    return 0;
+}
+
+// 追加一个点，调用方持有 s->mutex
+static void series_append(HistorySeries *s, size_t capacity, long long tsMs, double v, unsigned char type) {
+    HistoryBlock *b = s->newest;
+    if (b) {
+        // 保持时间戳单调，查询时可按块跳过
+        if (tsMs < b->tMax) tsMs = b->tMax;
+        if (b->data.count >= TWINHISTORY_BLOCK_POINTS || b->type != type) {
+            tsblock_seal(&b->data);
+            b = NULL;
+        }
+    }
+    if (!b) {
+        b = calloc(1, sizeof(HistoryBlock));
+        if (!b) return;
+        tsblock_init(&b->data);
+        b->type = type;
+        b->tMin = tsMs;
+        b->min = v;
+        b->max = v;
+        if (s->newest) s->newest->next = b;
+        else s->oldest = b;
+        s->newest = b;
+    }
+    if (tsblock_append(&b->data, tsMs, v) != 0) return;
+    b->tMax = tsMs;
+    if (v < b->min) b->min = v;
+    if (v > b->max) b->max = v;
+    b->sum += v;
+    s->points++;
+
+    // 以整块为单位淘汰，保留点数在 [capacity, capacity + 块大小) 之间
+    while (s->oldest != s->newest && s->points - s->oldest->data.count >= capacity) {
+        HistoryBlock *old = s->oldest;
+        s->oldest = old->next;
+        s->points -= old->data.count;
+        block_free(old);
+    }
+}
+
+void twinhistory_append(const char *ns, const char *device, const char *property,
+                        const char *value, long long tsMs) {
+    if (!device || !property || !value) return;
+    if (!ns) ns = "default";
+    double v;
+    unsigned char type;
+    if (parse_value(value, &v, &type) != 0) return;
+
+    unsigned int h = series_hash(ns, device, property);
+    pthread_rwlock_rdlock(&g_history_lock);
+    if (g_capacity == 0) {
+        pthread_rwlock_unlock(&g_history_lock);
+        return;
+    }
+    HistorySeries *s = series_find(h, ns, device, property);
+    if (!s) {
+        pthread_rwlock_unlock(&g_history_lock);
+        pthread_rwlock_wrlock(&g_history_lock);
+        s = g_capacity ? series_find(h, ns, device, property) : NULL;
+        if (!s && g_capacity) {
+            table_grow();
+            s = g_table ? series_new(h, ns, device, property) : NULL;
+            if (s) {
+                s->next = g_table[h & (g_buckets - 1)];
+                g_table[h & (g_buckets - 1)] = s;
+                g_series++;
+            }
+        }
+        if (!s) {
+            pthread_rwlock_unlock(&g_history_lock);
+            return;
+        }
+    }
+
+    pthread_mutex_lock(&s->mutex);
+    series_append(s, g_capacity, tsMs, v, type);
+    pthread_mutex_unlock(&s->mutex);
+    pthread_rwlock_unlock(&g_history_lock);
+}
+
+// 查找序列并加锁；成功时返回已持有 g_history_lock 读锁与 s->mutex 的序列
+static HistorySeries *series_lock(const char *ns, const char *device, const char *property) {
+    unsigned int h = series_hash(ns, device, property);
+    pthread_rwlock_rdlock(&g_history_lock);
+    HistorySeries *s = g_capacity ? series_find(h, ns, device, property) : NULL;
+    if (!s) {
+        pthread_rwlock_unlock(&g_history_lock);
+        return NULL;
+    }
+    pthread_mutex_lock(&s->mutex);
+    return s;
+}
+
+static void series_unlock(HistorySeries *s) {
+    pthread_mutex_unlock(&s->mutex);
+    pthread_rwlock_unlock(&g_history_lock);
+}
+
+int twinhistory_query(const char *ns, const char *device, const char *property,
+                      long long sinceMs, long long untilMs, size_t maxPoints,
+                      TwinHistorySlice *out) {
+    if (!device || !property || !out) return -1;
+    if (!ns) ns = "default";
+    memset(out, 0, sizeof(*out));
+
+    HistorySeries *s = series_lock(ns, device, property);
+    if (!s) return -1;
+
+    // 先按块摘要估算上限，一次分配
+    size_t bound = 0;
+    for (HistoryBlock *b = s->oldest; b; b = b->next) {
+        if (b->tMax >= sinceMs && b->tMin <= untilMs) bound += b->data.count;
+    }
+    int rc = 0;
+    if (bound > 0) {
+        out->timestamps = malloc(sizeof(long long) * bound);
+        out->values = malloc(sizeof(double) * bound);
+        out->types = malloc(bound);
+        if (!out->timestamps || !out->values || !out->types) rc = -1;
+    }
+    int64_t ts[TWINHISTORY_DECODE_CHUNK];
+    double vals[TWINHISTORY_DECODE_CHUNK];
+    for (HistoryBlock *b = s->oldest; rc == 0 && b; b = b->next) {
+        if (b->tMax < sinceMs || b->tMin > untilMs) continue;
+        TsBlockIter it;
+        tsblock_iter_init(&it, &b->data);
+        size_t k;
+        while ((k = tsblock_decode(&it, ts, vals, TWINHISTORY_DECODE_CHUNK)) > 0) {
+            for (size_t i = 0; i < k; i++) {
+                if (ts[i] < sinceMs || ts[i] > untilMs) continue;
+                out->timestamps[out->count] = ts[i];
+                out->values[out->count] = vals[i];
+                out->types[out->count] = b->type;
+                out->count++;
+            }
+        }
+    }
+    series_unlock(s);
+    if (rc != 0) {
+        twinhistory_slice_free(out);
+        return -1;
+    }
+    // 只保留最新的 maxPoints 个点
+    if (maxPoints > 0 && out->count > maxPoints) {
+        size_t skip = out->count - maxPoints;
+        memmove(out->timestamps, out->timestamps + skip, sizeof(long long) * maxPoints);
+        memmove(out->values, out->values + skip, sizeof(double) * maxPoints);
+        memmove(out->types, out->types + skip, maxPoints);
+        out->count = maxPoints;
+    }
+    return 0;
+}
+
+int twinhistory_aggregate(const char *ns, const char *device, const char *property,
+                          long long sinceMs, long long untilMs, TwinHistoryAggregate *out) {
+    if (!device || !property || !out) return -1;
+    if (!ns) ns = "default";
+    memset(out, 0, sizeof(*out));
+
+    HistorySeries *s = series_lock(ns, device, property);
+    if (!s) return -1;
+
+    double sum = 0;
+    int64_t ts[TWINHISTORY_DECODE_CHUNK];
+    double vals[TWINHISTORY_DECODE_CHUNK];
+    for (HistoryBlock *b = s->oldest; b; b = b->next) {
+        if (b->tMax < sinceMs || b->tMin > untilMs) continue;
+        if (b->tMin >= sinceMs && b->tMax <= untilMs) {
+            // 整块落在区间内，直接合并摘要
+            if (out->count == 0 || b->min < out->min) out->min = b->min;
+            if (out->count == 0 || b->max > out->max) out->max = b->max;
+            sum += b->sum;
+            out->count += b->data.count;
+            continue;
+        }
+        TsBlockIter it;
+        tsblock_iter_init(&it, &b->data);
+        size_t k;
+        while ((k = tsblock_decode(&it, ts, vals, TWINHISTORY_DECODE_CHUNK)) > 0) {
+            for (size_t i = 0; i < k; i++) {
+                if (ts[i] < sinceMs || ts[i] > untilMs) continue;
+                if (out->count == 0 || vals[i] < out->min) out->min = vals[i];
+                if (out->count == 0 || vals[i] > out->max) out->max = vals[i];
+                sum += vals[i];
+                out->count++;
+            }
+        }
+    }
+    series_unlock(s);
+    out->avg = out->count > 0 ? sum / (double)out->count : 0;
+    return 0;
+}
+
+void twinhistory_slice_free(TwinHistorySlice *slice) {
+    if (!slice) return;
+    free(slice->timestamps);
+    free(slice->values);
+    free(slice->types);
+    memset(slice, 0, sizeof(*slice));
+}
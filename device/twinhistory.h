@@ -0,0 +1,58 @@
+#ifndef DEVICE_TWINHISTORY_H
+#define DEVICE_TWINHISTORY_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 近期历史缓存：每个属性按 Gorilla 方式压缩成块链（见 common/tsblock.h），
+// 由采集写入，供“最近 N 分钟”类查询直接从内存返回。只缓存数值与布尔值
+
+typedef enum {
+    TWIN_HISTORY_NUMBER = 0,
+    TWIN_HISTORY_BOOL = 1,
+} TwinHistoryType;
+
+typedef struct {
+    size_t count;
+    long long *timestamps;      // 毫秒，升序
+    double *values;             // 布尔值存为 0 / 1
+    unsigned char *types;       // TwinHistoryType
+} TwinHistorySlice;
+
+typedef struct {
+    size_t count;
+    double min;
+    double max;
+    double avg;
+} TwinHistoryAggregate;
+
+// capacity 为每个属性至少保留的点数（按块淘汰，实际略多），0 表示关闭
+void twinhistory_init(size_t capacity);
+void twinhistory_shutdown(void);
+
+// 删除设备全部属性的历史；设备移除后调用，此后的查询返回 -1
+void twinhistory_remove_device(const char *ns, const char *device);
+
+// 非数值/布尔的值被忽略
+void twinhistory_append(const char *ns, const char *device, const char *property,
+                        const char *value, long long tsMs);
+
+// 取 [sinceMs, untilMs] 内最新的至多 maxPoints 个点（0 不限制）
+// 成功返回 0；缓存关闭或无该属性返回 -1
+int twinhistory_query(const char *ns, const char *device, const char *property,
+                      long long sinceMs, long long untilMs, size_t maxPoints,
+                      TwinHistorySlice *out);
+void twinhistory_slice_free(TwinHistorySlice *slice);
+
+// [sinceMs, untilMs] 内的 min/max/avg/count；整块落在区间内时不解码
+int twinhistory_aggregate(const char *ns, const char *device, const char *property,
+                          long long sinceMs, long long untilMs, TwinHistoryAggregate *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DEVICE_TWINHISTORY_H
@@ -0,0 +1,190 @@
+#include "device/twinwatch.h"
+#include <stdlib.h>
+#include <string.h>
+#include <fnmatch.h>
+#include <pthread.h>
+
+#define TWINWATCH_DEFAULT_QUEUE 256
+
+struct TwinWatcher {
+    char *ns;
+    char **devices;
+    int deviceCount;
+    char *pattern;
+
+    pthread_mutex_t mutex;      // 保护队列
+    TwinChange *queue;          // 环形队列
+    size_t cap;
+    size_t head;
+    size_t count;
+    unsigned long long dropped;
+
+    TwinWatchNotify notify;
+    void *arg;
+    struct TwinWatcher *next;
+};
+
+// 订阅者链表：发布持读锁，订阅/退订持写锁，保证退订返回后不再回调
+static pthread_rwlock_t g_watch_lock = PTHREAD_RWLOCK_INITIALIZER;
+static TwinWatcher *g_watchers = NULL;
+static int g_watcher_count = 0;
+static unsigned long long g_seq = 0;
+
+static void watcher_free(TwinWatcher *w) {
+    if (!w) return;
+    for (size_t i = 0; i < w->count; i++) {
+        twinwatch_change_clear(&w->queue[(w->head + i) % w->cap]);
+    }
+    free(w->queue);
+    for (int i = 0; i < w->deviceCount; i++) free(w->devices[i]);
+    free(w->devices);
+    free(w->ns);
+    free(w->pattern);
+    pthread_mutex_destroy(&w->mutex);
+    free(w);
+}
+
+TwinWatcher *twinwatch_subscribe(const char *ns, const char *devices, const char *propertyPattern,
+                                 size_t queueCap, TwinWatchNotify notify, void *arg) {
+    TwinWatcher *w = calloc(1, sizeof(TwinWatcher));
+    if (!w) return NULL;
+    pthread_mutex_init(&w->mutex, NULL);
+    w->cap = queueCap ? queueCap : TWINWATCH_DEFAULT_QUEUE;
+    w->queue = calloc(w->cap, sizeof(TwinChange));
+    w->notify = notify;
+    w->arg = arg;
+    if (ns && *ns) w->ns = strdup(ns);
+    if (propertyPattern && *propertyPattern && strcmp(propertyPattern, "*") != 0) {
+        w->pattern = strdup(propertyPattern);
+    }
+    if (devices && *devices) {
+        int cap = 1;
+        for (const char *p = devices; *p; p++) if (*p == ',') cap++;
+        w->devices = calloc((size_t)cap, sizeof(char*));
+        const char *p = devices;
+        while (w->devices && *p) {
+            const char *end = strchr(p, ',');
+            size_t len = end ? (size_t)(end - p) : strlen(p);
+            if (len > 0) w->devices[w->deviceCount++] = strndup(p, len);
+            p += len;
+            if (*p == ',') p++;
+        }
+    }
+    if (!w->queue) {
+        watcher_free(w);
+        return NULL;
+    }
+
+    pthread_rwlock_wrlock(&g_watch_lock);
+    w->next = g_watchers;
+    g_watchers = w;
+    __atomic_add_fetch(&g_watcher_count, 1, __ATOMIC_RELEASE);
+    pthread_rwlock_unlock(&g_watch_lock);
+    return w;
+}
+
+void twinwatch_unsubscribe(TwinWatcher *watcher) {
+    if (!watcher) return;
+    pthread_rwlock_wrlock(&g_watch_lock);
+    for (TwinWatcher **pp = &g_watchers; *pp; pp = &(*pp)->next) {
+        if (*pp == watcher) {
+            *pp = watcher->next;
+            __atomic_sub_fetch(&g_watcher_count, 1, __ATOMIC_RELEASE);
+            break;
+        }
+    }
+    pthread_rwlock_unlock(&g_watch_lock);
+    watcher_free(watcher);
+}
+
+// 设备名既可写 name，也可写 namespace.name
+static int watcher_matches(const TwinWatcher *w, const char *ns, const char *device, const char *property) {
+    if (w->ns && strcmp(w->ns, ns) != 0) return 0;
+    if (w->deviceCount > 0) {
+        size_t nsLen = strlen(ns);
+        int hit = 0;
+        for (int i = 0; i < w->deviceCount && !hit; i++) {
+            const char *want = w->devices[i];
+            if (strcmp(want, device) == 0) hit = 1;
+            else if (strncmp(want, ns, nsLen) == 0 && want[nsLen] == '.' &&
+                     strcmp(want + nsLen + 1, device) == 0) hit = 1;
+        }
+        if (!hit) return 0;
+    }
+    if (w->pattern && fnmatch(w->pattern, property, 0) != 0) return 0;
+    return 1;
+}
+
+void twinwatch_publish(const char *ns, const char *device, const char *property,
+                       const char *value, const char *timestamp) {
+    if (__atomic_load_n(&g_watcher_count, __ATOMIC_ACQUIRE) == 0) return;
+    if (!device || !property) return;
+    if (!ns) ns = "default";
+
+    unsigned long long seq = __atomic_add_fetch(&g_seq, 1, __ATOMIC_RELAXED);
+    pthread_rwlock_rdlock(&g_watch_lock);
+    for (TwinWatcher *w = g_watchers; w; w = w->next) {
+        if (!watcher_matches(w, ns, device, property)) continue;
+
+        TwinChange c = {
+            .seq = seq,
+            .deviceNamespace = strdup(ns),
+            .deviceName = strdup(device),
+            .propertyName = strdup(property),
+            .value = value ? strdup(value) : NULL,
+            .timestamp = timestamp ? strdup(timestamp) : NULL,
+        };
+        pthread_mutex_lock(&w->mutex);
+        int wasEmpty = (w->count == 0);
+        if (w->count == w->cap) {
+            // 队列满：丢弃最旧的一条，慢订阅者不会拖慢采集
+            twinwatch_change_clear(&w->queue[w->head]);
+            w->head = (w->head + 1) % w->cap;
+            w->count--;
+            w->dropped++;
+        }
+        w->queue[(w->head + w->count) % w->cap] = c;
+        w->count++;
+        pthread_mutex_unlock(&w->mutex);
+
+        if (wasEmpty && w->notify) w->notify(w->arg);
+    }
+    pthread_rwlock_unlock(&g_watch_lock);
+}
+
+int twinwatch_pop(TwinWatcher *watcher, TwinChange *out, unsigned long long *dropped) {
+    if (!watcher || !out) return 0;
+    pthread_mutex_lock(&watcher->mutex);
+    if (dropped) {
+        *dropped = watcher->dropped;
+        watcher->dropped = 0;
+    }
+    if (watcher->count == 0) {
+        pthread_mutex_unlock(&watcher->mutex);
+        return 0;
+    }
+    *out = watcher->queue[watcher->head];
+    memset(&watcher->queue[watcher->head], 0, sizeof(TwinChange));
+    watcher->head = (watcher->head + 1) % watcher->cap;
+    watcher->count--;
+    pthread_mutex_unlock(&watcher->mutex);
+    return 1;
+}
+
+void twinwatch_change_clear(TwinChange *change) {
+    if (!change) return;
+    free(change->deviceNamespace);
+    free(change->deviceName);
+    free(change->propertyName);
+    free(change->value);
+    free(change->timestamp);
+    memset(change, 0, sizeof(*change));
+}
+
+void twinwatch_kick_all(void) {
+    pthread_rwlock_rdlock(&g_watch_lock);
+    for (TwinWatcher *w = g_watchers; w; w = w->next) {
+        if (w->notify) w->notify(w->arg);
+    }
+    pthread_rwlock_unlock(&g_watch_lock);
+}
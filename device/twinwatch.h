@@ -0,0 +1,48 @@
+#ifndef DEVICE_TWINWATCH_H
+#define DEVICE_TWINWATCH_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 孪生值变化通知总线：写者在 reported 值变化时发布，订阅者各自持有有界队列
+// 无订阅者时发布只是一次原子读
+
+typedef struct {
+    unsigned long long seq;     // 全局递增序号
+    char *deviceNamespace;
+    char *deviceName;
+    char *propertyName;
+    char *value;
+    char *timestamp;
+} TwinChange;
+
+typedef struct TwinWatcher TwinWatcher;
+
+// 队列由空变为非空或被 twinwatch_kick_all 唤醒时调用；在发布者线程中执行，不可阻塞
+typedef void (*TwinWatchNotify)(void *arg);
+
+// ns / propertyPattern 为 NULL 或空表示不过滤；devices 为逗号分隔的设备名
+// propertyPattern 使用 fnmatch 通配；queueCap 为 0 时使用默认容量
+TwinWatcher *twinwatch_subscribe(const char *ns, const char *devices, const char *propertyPattern,
+                                 size_t queueCap, TwinWatchNotify notify, void *arg);
+// 返回后不会再有 notify 回调
+void twinwatch_unsubscribe(TwinWatcher *watcher);
+
+void twinwatch_publish(const char *ns, const char *device, const char *property,
+                       const char *value, const char *timestamp);
+
+// 取出一条变化，成功返回 1，队列为空返回 0；*dropped 返回自上次取出以来因队列满丢弃的条数
+int twinwatch_pop(TwinWatcher *watcher, TwinChange *out, unsigned long long *dropped);
+void twinwatch_change_clear(TwinChange *change);
+
+// 唤醒全部订阅者（心跳、关闭服务时使用）
+void twinwatch_kick_all(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DEVICE_TWINWATCH_H
@@ -1,9 +1,14 @@
 #include "driver/driver.h"
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <cjson/cJSON.h>
 #include "common/const.h"
+#include "log/log.h"
 
-// 构造函数
+// 构造函数：按协议名选择驱动
 CustomizedClient *NewClient(const ProtocolConfig *protocol) {
     CustomizedClient *client = (CustomizedClient *)calloc(1, sizeof(CustomizedClient));
     if (!client) return NULL;
@@ -12,12 +17,32 @@ CustomizedClient *NewClient(const ProtocolConfig *protocol) {
         client->protocolConfig.configData = protocol->configData ? strdup(protocol->configData) : NULL;
     }
     pthread_mutex_init(&client->deviceMutex, NULL);
+
+    const char *name = client->protocolConfig.protocolName;
+    client->ops = driver_lookup(name);
+    if (!client->ops) {
+        // 拼写错误或插件加载失败：不能悄悄换成 modbus-tcp 去连默认地址
+        log_error("No driver registered for protocol '%s'", name ? name : "(null)");
+        FreeClient(client);
+        return NULL;
+    }
+    if (client->ops && client->ops->open && client->ops->open(client) != 0) {
+        log_error("Driver %s rejected protocol config: %s", client->ops->name,
+                  client->protocolConfig.configData ? client->protocolConfig.configData : "(null)");
+        client->ops = NULL;   // open 失败时驱动不应留下 priv
+        FreeClient(client);
+        return NULL;
+    }
+    if (!client->endpoint[0]) {
+        snprintf(client->endpoint, sizeof(client->endpoint), "%s", name ? name : "default");
+    }
     return client;
 }
 
 // 析构函数
 void FreeClient(CustomizedClient *client) {
     if (!client) return;
+    if (client->ops && client->ops->close) client->ops->close(client);
     free(client->protocolConfig.protocolName);
     free(client->protocolConfig.configData);
     pthread_mutex_destroy(&client->deviceMutex);
@@ -27,59 +52,226 @@ void FreeClient(CustomizedClient *client) {
 // 设备初始化
 int InitDevice(CustomizedClient *client) {
     if (!client) return -1;
-    pthread_mutex_lock(&client->deviceMutex);
-    // TODO: 初始化设备，使用 client->protocolConfig
-    pthread_mutex_unlock(&client->deviceMutex);
-    return 0;
+    if (!client->ops || !client->ops->init) return 0;
+    return client->ops->init(client) == 0 ? 0 : -1;
 }
 
-// 读取设备数据 - 修复实现以返回实际数据
+int GetDeviceDataBatch(CustomizedClient *client, DriverReadItem *items, int n) {
+    if (!client || (!items && n > 0)) return DRIVER_EIO;
+    for (int i = 0; i < n; i++) {
+        items[i].value.type = DRIVER_VALUE_NONE;
+        items[i].rc = DRIVER_EIO;
+    }
+    if (n <= 0) return DRIVER_OK;
+    if (!client->ops || !client->ops->read_batch) return DRIVER_EIO;
+    return client->ops->read_batch(client, items, n) == 0 ? DRIVER_OK : DRIVER_EIO;
+}
+
+int DeviceDataWriteBatch(CustomizedClient *client, DriverWriteItem *items, int n) {
+    if (!client || (!items && n > 0)) return DRIVER_EIO;
+    for (int i = 0; i < n; i++) items[i].rc = DRIVER_EIO;
+    if (n <= 0) return DRIVER_OK;
+    if (!client->ops || !client->ops->write_batch) return DRIVER_EIO;
+    return client->ops->write_batch(client, items, n) == 0 ? DRIVER_OK : DRIVER_EIO;
+}
+
+// 读取设备数据：单项批量读，*out_data 为 malloc 的字符串
 int GetDeviceData(CustomizedClient *client, const VisitorConfig *visitor, void **out_data) {
     if (!client || !visitor || !out_data) return -1;
-    
-    pthread_mutex_lock(&client->deviceMutex);
-    
-    // TODO: 根据 visitor 配置读取实际设备数据
-    // 这里提供一个示例实现，返回模拟数据
-    char *data = strdup("sample_device_data_value");
-    *out_data = (void*)data;
-    
-    pthread_mutex_unlock(&client->deviceMutex);
+    DriverReadItem item = { .visitor = visitor };
+    GetDeviceDataBatch(client, &item, 1);
+    char buf[DRIVER_VALUE_STR_MAX];
+    if (item.rc != DRIVER_OK || driver_value_format(&item.value, buf, sizeof(buf)) < 0) return -1;
+    char *data = strdup(buf);
+    if (!data) return -1;
+    *out_data = data;
     return 0;
 }
 
-// 写设备数据
+// 写设备数据：data 为字符串值；visitor 未带属性名时用 propertyName
 int DeviceDataWrite(CustomizedClient *client, const VisitorConfig *visitor, const char *deviceMethodName, const char *propertyName, const void *data) {
-    if (!client || !visitor) return -1;
-    pthread_mutex_lock(&client->deviceMutex);
-    // TODO: 写设备数据，使用 client->protocolConfig 和 visitor
-    pthread_mutex_unlock(&client->deviceMutex);
-    return 0;
+    if (!client || !visitor || !data) return -1;
+    VisitorConfig v = *visitor;
+    if (!v.propertyName) v.propertyName = (char *)propertyName;
+    DriverWriteItem item = { .visitor = &v };
+    driver_value_parse(&item.value, (const char *)data, NULL);
+    DeviceDataWriteBatch(client, &item, 1);
+    return item.rc == DRIVER_OK ? 0 : -1;
 }
 
 // 设置设备数据
 int SetDeviceData(CustomizedClient *client, const void *data, const VisitorConfig *visitor) {
     if (!client || !visitor) return -1;
-    pthread_mutex_lock(&client->deviceMutex);
-    // TODO: 设置设备数据
-    pthread_mutex_unlock(&client->deviceMutex);
-    return 0;
+    return DeviceDataWrite(client, visitor, NULL, visitor->propertyName, data);
 }
 
 // 停止设备
 int StopDevice(CustomizedClient *client) {
     if (!client) return -1;
-    pthread_mutex_lock(&client->deviceMutex);
-    // TODO: 停止设备
-    pthread_mutex_unlock(&client->deviceMutex);
-    return 0;
+    if (!client->ops || !client->ops->stop) return 0;
+    return client->ops->stop(client) == 0 ? 0 : -1;
 }
 
 // 获取设备状态
 const char *GetDeviceStates(CustomizedClient *client) {
     if (!client) return DEVICE_STATUS_UNKNOWN;
-    pthread_mutex_lock(&client->deviceMutex);
-    // TODO: 获取设备状态
-    pthread_mutex_unlock(&client->deviceMutex);
-    return DEVICE_STATUS_OK;
-}
\ No newline at end of file
+    if (!client->ops || !client->ops->status) return DEVICE_STATUS_OK;
+    const char *st = client->ops->status(client);
+    return st ? st : DEVICE_STATUS_UNKNOWN;
+}
+
+// ==== 值槽 ====
+static int type_is(const char *hint, const char *a, const char *b) {
+    return hint && (strcasecmp(hint, a) == 0 || (b && strcasecmp(hint, b) == 0));
+}
+
+int driver_value_parse(DriverValue *v, const char *text, const char *typeHint) {
+    if (!v) return -1;
+    if (!text) {
+        v->type = DRIVER_VALUE_NONE;
+        return -1;
+    }
+    char *end = NULL;
+    if (type_is(typeHint, "int", "integer") || type_is(typeHint, "long", NULL)) {
+        long long i = strtoll(text, &end, 10);
+        if (end != text && *end == 0) {
+            v->type = DRIVER_VALUE_INT;
+            v->as.i = i;
+            return 0;
+        }
+    } else if (type_is(typeHint, "float", "double")) {
+        double f = strtod(text, &end);
+        if (end != text && *end == 0) {
+            v->type = DRIVER_VALUE_FLOAT;
+            v->as.f = f;
+            return 0;
+        }
+    } else if (type_is(typeHint, "boolean", "bool")) {
+        if (strcasecmp(text, "true") == 0 || strcmp(text, "1") == 0 ||
+            strcasecmp(text, "false") == 0 || strcmp(text, "0") == 0) {
+            v->type = DRIVER_VALUE_BOOL;
+            v->as.i = (strcasecmp(text, "true") == 0 || strcmp(text, "1") == 0);
+            return 0;
+        }
+    } else {
+        v->type = DRIVER_VALUE_STRING;
+        snprintf(v->as.s, sizeof(v->as.s), "%s", text);
+        return 0;
+    }
+    v->type = DRIVER_VALUE_STRING;
+    snprintf(v->as.s, sizeof(v->as.s), "%s", text);
+    return -1;
+}
+
+int driver_value_format(const DriverValue *v, char *buf, size_t bufsz) {
+    if (!v || !buf || bufsz == 0) return -1;
+    switch (v->type) {
+        case DRIVER_VALUE_INT:    return snprintf(buf, bufsz, "%lld", v->as.i);
+        case DRIVER_VALUE_FLOAT:  return snprintf(buf, bufsz, "%.10g", v->as.f);
+        case DRIVER_VALUE_BOOL:   return snprintf(buf, bufsz, "%s", v->as.i ? "true" : "false");
+        case DRIVER_VALUE_STRING: return snprintf(buf, bufsz, "%s", v->as.s);
+        default:                  return -1;
+    }
+}
+
+int driver_value_int(const DriverValue *v, long long *out) {
+    if (!v || !out) return -1;
+    switch (v->type) {
+        case DRIVER_VALUE_INT:
+        case DRIVER_VALUE_BOOL:
+            *out = v->as.i;
+            return 0;
+        case DRIVER_VALUE_FLOAT:
+            *out = llround(v->as.f);
+            return 0;
+        case DRIVER_VALUE_STRING: {
+            const char *s = v->as.s;
+            if (strcasecmp(s, "true") == 0 || strcasecmp(s, "on") == 0) { *out = 1; return 0; }
+            if (strcasecmp(s, "false") == 0 || strcasecmp(s, "off") == 0) { *out = 0; return 0; }
+            char *end = NULL;
+            double d = strtod(s, &end);
+            if (end == s) return -1;
+            *out = llround(d);
+            return 0;
+        }
+        default:
+            return -1;
+    }
+}
+
+// 数值或布尔取 double；字符串须整体是数字或 true/false/on/off
+static int value_number(const DriverValue *v, double *out) {
+    switch (v->type) {
+        case DRIVER_VALUE_INT:
+        case DRIVER_VALUE_BOOL:
+            *out = (double)v->as.i;
+            return 0;
+        case DRIVER_VALUE_FLOAT:
+            *out = v->as.f;
+            return 0;
+        case DRIVER_VALUE_STRING: {
+            const char *s = v->as.s;
+            if (strcasecmp(s, "true") == 0 || strcasecmp(s, "on") == 0) { *out = 1; return 0; }
+            if (strcasecmp(s, "false") == 0 || strcasecmp(s, "off") == 0) { *out = 0; return 0; }
+            char *end = NULL;
+            *out = strtod(s, &end);
+            return (end != s && *end == 0) ? 0 : -1;
+        }
+        default:
+            return -1;
+    }
+}
+
+int driver_value_equal(const DriverValue *a, const DriverValue *b) {
+    if (!a || !b || a->type == DRIVER_VALUE_NONE || b->type == DRIVER_VALUE_NONE) return 0;
+    if (a->type == DRIVER_VALUE_STRING && b->type == DRIVER_VALUE_STRING && strcmp(a->as.s, b->as.s) == 0) return 1;
+    double x, y;
+    if (value_number(a, &x) == 0 && value_number(b, &y) == 0) return x == y;
+    char sa[DRIVER_VALUE_STR_MAX], sb[DRIVER_VALUE_STR_MAX];
+    return driver_value_format(a, sa, sizeof(sa)) >= 0 && driver_value_format(b, sb, sizeof(sb)) >= 0 &&
+           strcmp(sa, sb) == 0;
+}
+
+// ==== 配置解析 ====
+struct cJSON *driver_config_parse(const char *json, struct cJSON **config) {
+    *config = NULL;
+    if (!json || !*json) return NULL;
+    cJSON *root = cJSON_Parse(json);
+    if (!root) return NULL;
+    cJSON *cfg = cJSON_GetObjectItemCaseSensitive(root, "configData");
+    if (cJSON_IsString(cfg) && cfg->valuestring) {
+        // configData 以 JSON 字符串嵌套：解析后替换进根节点，随根节点一起释放
+        cJSON *inner = cJSON_Parse(cfg->valuestring);
+        if (inner) {
+            cJSON_ReplaceItemInObjectCaseSensitive(root, "configData", inner);
+            cfg = inner;
+        }
+    }
+    *config = cJSON_IsObject(cfg) ? cfg : root;
+    return root;
+}
+
+const char *driver_config_str(const struct cJSON *config, const char *key, const char *def, char *buf, size_t bufsz) {
+    const cJSON *item = config ? cJSON_GetObjectItem(config, key) : NULL;
+    if (cJSON_IsString(item) && item->valuestring && *item->valuestring) {
+        snprintf(buf, bufsz, "%s", item->valuestring);
+    } else if (cJSON_IsNumber(item)) {
+        snprintf(buf, bufsz, "%g", item->valuedouble);
+    } else if (def) {
+        snprintf(buf, bufsz, "%s", def);
+    } else {
+        return NULL;
+    }
+    return buf;
+}
+
+int driver_config_int(const struct cJSON *config, const char *key, int def) {
+    const cJSON *item = config ? cJSON_GetObjectItem(config, key) : NULL;
+    if (cJSON_IsNumber(item)) return item->valueint;
+    if (cJSON_IsString(item) && item->valuestring && *item->valuestring) {
+        char *end = NULL;
+        long v = strtol(item->valuestring, &end, 0);
+        if (end != item->valuestring) return (int)v;
+    }
+    return def;
+}
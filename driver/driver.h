@@ -3,7 +3,11 @@
 
 #include "common/configmaptype.h"
 #include <pthread.h>
+#include <stddef.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 // 访问信息结构体（可根据你的 VisitorConfig 定义调整）
 typedef struct {
@@ -12,23 +16,123 @@ typedef struct {
     char *configData; // 推荐用 JSON 字符串
 } VisitorConfig;
 
+typedef struct DriverOps DriverOps;
+
 // 驱动客户端结构体
 typedef struct {
     ProtocolConfig protocolConfig;
-    pthread_mutex_t deviceMutex;
-    // 你可以在这里添加更多成员变量
+    pthread_mutex_t deviceMutex;   // 保护驱动私有状态；I/O 本身不在此锁内串行，由端点调度限流
+    const DriverOps *ops;          // 按 protocolName 从驱动注册表选出
+    void *priv;                    // 驱动私有状态，ops->open 分配、ops->close 释放
+    char endpoint[160];            // I/O 调度键（host:port、串口路径等），ops->open 填写
 } CustomizedClient;
 
-// 构造与析构
+// 驱动返回码
+#define DRIVER_OK        0
+#define DRIVER_EIO      -1   // 通信失败或设备拒绝
+#define DRIVER_ENOADDR  -2   // 访问配置里解析不出地址，该属性不归此驱动读写
+#define DRIVER_EINVAL   -3   // 值无法转换为该地址的数据类型
+
+typedef enum {
+    DRIVER_VALUE_NONE = 0,
+    DRIVER_VALUE_INT,
+    DRIVER_VALUE_FLOAT,
+    DRIVER_VALUE_BOOL,
+    DRIVER_VALUE_STRING,
+} DriverValueType;
+
+#define DRIVER_VALUE_STR_MAX 64
+
+// 定长值槽，由调用方提供，读写都不分配堆内存；字符串超出 DRIVER_VALUE_STR_MAX-1 字节时截断
+typedef struct {
+    DriverValueType type;
+    union {
+        long long i;   // INT；BOOL 为 0/1
+        double f;      // FLOAT
+        char s[DRIVER_VALUE_STR_MAX];
+    } as;
+} DriverValue;
+
+// 按类型提示（物模型 dataType："int"、"float"、"boolean"、"string" 等，可为 NULL）解析文本；
+// 文本与提示不符时按字符串保存并返回 -1
+int driver_value_parse(DriverValue *v, const char *text, const char *typeHint);
+// 格式化为 twin 使用的文本，返回写入长度，NONE 返回 -1
+int driver_value_format(const DriverValue *v, char *buf, size_t bufsz);
+// 取整数（浮点四舍五入，字符串按数字或 true/false 解析），无法转换返回 -1
+int driver_value_int(const DriverValue *v, long long *out);
+// 两个值是否相同：数值/布尔按数值比较（"1" 与 "true"、"5" 与 "5.0" 相同），其余按文本比较
+int driver_value_equal(const DriverValue *a, const DriverValue *b);
+
+// 批量读写中的一项；visitor->configData 为空时驱动可按 propertyName 兜底
+typedef struct {
+    const VisitorConfig *visitor;
+    DriverValue value;   // 读：成功时由驱动填写
+    int rc;              // DRIVER_*
+} DriverReadItem;
+
+typedef struct {
+    const VisitorConfig *visitor;
+    DriverValue value;   // 写入值，驱动按地址类型转换；成功时可改为设备上实际保存的值（与读回一致）
+    int rc;
+} DriverWriteItem;
+
+#define DRIVER_ABI_VERSION 2
+
+// 协议驱动。批量接口按数组下标逐项填写 rc，驱动可自行合并同一设备上的相邻地址；
+// 函数返回 0 表示全部成功，否则返回 DRIVER_EIO。open/close 之外的回调可能被多个线程并发调用
+struct DriverOps {
+    int abiVersion;        // DRIVER_ABI_VERSION
+    const char *name;      // 协议名，与 ProtocolConfig.protocolName 比较（不区分大小写）
+    int  (*open)(CustomizedClient *client);    // 解析 protocolConfig，NewClient 时调用
+    void (*close)(CustomizedClient *client);   // FreeClient 时调用
+    int  (*init)(CustomizedClient *client);
+    int  (*read_batch)(CustomizedClient *client, DriverReadItem *items, int n);
+    int  (*write_batch)(CustomizedClient *client, DriverWriteItem *items, int n);
+    int  (*stop)(CustomizedClient *client);
+    const char *(*status)(CustomizedClient *client);   // DEVICE_STATUS_*
+};
+
+// ==== 驱动注册表 ====
+// 内置 modbus-tcp（别名 modbus）、modbus-rtu、simulated；同名后注册者覆盖先注册者
+int driver_register(const DriverOps *ops);
+// 找不到时返回 NULL
+const DriverOps *driver_lookup(const char *protocolName);
+// 加载目录下全部 *.so 插件，返回成功注册的驱动数；插件导出
+//   const DriverOps *mapper_driver_entry(void);
+#define DRIVER_PLUGIN_ENTRY "mapper_driver_entry"
+int driver_load_plugins(const char *dir);
+
+// 内置驱动
+extern const DriverOps modbus_tcp_driver;
+extern const DriverOps modbus_rtu_driver;
+extern const DriverOps simulated_driver;
+
+// 构造与析构；协议未注册或驱动拒绝配置时返回 NULL
 CustomizedClient *NewClient(const ProtocolConfig *protocol);
 void FreeClient(CustomizedClient *client);
 
 // 设备操作接口
 int InitDevice(CustomizedClient *client);
+// 单属性读写：值为字符串，GetDeviceData 的 *out_data 由调用方 free
 int GetDeviceData(CustomizedClient *client, const VisitorConfig *visitor, void **out_data);
 int DeviceDataWrite(CustomizedClient *client, const VisitorConfig *visitor, const char *deviceMethodName, const char *propertyName, const void *data);
+// 批量读写：一次调用读/写同一设备的多个属性，逐项返回 rc；全部成功返回 0，否则 DRIVER_EIO
+int GetDeviceDataBatch(CustomizedClient *client, DriverReadItem *items, int n);
+int DeviceDataWriteBatch(CustomizedClient *client, DriverWriteItem *items, int n);
 int SetDeviceData(CustomizedClient *client, const void *data, const VisitorConfig *visitor);
 int StopDevice(CustomizedClient *client);
 const char *GetDeviceStates(CustomizedClient *client);
 
-#endif // DRIVER_DRIVER_H
\ No newline at end of file
+// 解析协议/访问配置：{"configData": {...}} 或平铺对象，configData 也可能是嵌套的 JSON 字符串。
+// 返回 cJSON 根节点（调用方 cJSON_Delete），*config 指向配置对象
+struct cJSON;
+struct cJSON *driver_config_parse(const char *json, struct cJSON **config);
+// 读取字符串或数字字段，缺失时返回 def
+const char *driver_config_str(const struct cJSON *config, const char *key, const char *def, char *buf, size_t bufsz);
+int driver_config_int(const struct cJSON *config, const char *key, int def);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DRIVER_DRIVER_H
@@ -0,0 +1,416 @@
+#include "driver/driver.h"
+#include "common/const.h"
+#include "log/log.h"
+#include <cjson/cJSON.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Modbus TCP / RTU 驱动：每次读写调用一次 mbpoll，同一寄存器表内地址连续的项合并为一帧
+#define MODBUS_MAX_REGS 123   // Write Multiple Registers 单帧上限（读为 125，统一取小值）
+#define MODBUS_BUS_LOCKS 8
+
+typedef struct {
+    int rtu;
+    char host[128];
+    int port;
+    char serial[128];      // 串口设备路径
+    int baud;
+    char parity[8];        // none / even / odd
+    int dataBits;
+    int stopBits;
+    int slave;
+} ModbusConn;
+
+typedef struct {
+    int table;    // mbpoll -t：0 线圈，1 离散输入，3 输入寄存器，4 保持寄存器
+    int offset;   // mbpoll -r 引用地址
+    int idx;      // 在批量数组中的下标
+    int word;     // 写入值（寄存器为 16 位，线圈为 0/1）
+} ModbusAddr;
+
+// 同一串口总线上同时只能有一帧，按路径分段加锁
+static pthread_mutex_t g_bus_locks[MODBUS_BUS_LOCKS] = {
+    PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER,
+    PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER,
+};
+
+static pthread_mutex_t *bus_lock(const ModbusConn *c) {
+    if (!c->rtu) return NULL;
+    unsigned int h = 2166136261u;   // FNV-1a
+    for (const char *p = c->serial; *p; p++) {
+        h ^= (unsigned char)*p;
+        h *= 16777619u;
+    }
+    return &g_bus_locks[h % MODBUS_BUS_LOCKS];
+}
+
+// 仅保留允许字符：主机/IP 或串口路径（防止拼进 shell 命令）
+static void sanitize(char *s, int path) {
+    size_t w = 0;
+    for (size_t r = 0; s[r]; ++r) {
+        unsigned char ch = (unsigned char)s[r];
+        if (isalnum(ch) || ch == '.' || ch == '-' || ch == '_' || ch == ':' || (path && ch == '/')) {
+            s[w++] = (char)ch;
+        }
+    }
+    s[w] = 0;
+}
+
+static int mbpoll_timeout_s(void) {
+    int timeout_s = 2;
+    const char *env_to = getenv("MAPPER_MBPOLL_TIMEOUT_S");
+    if (env_to && *env_to) {
+        int tv = atoi(env_to);
+        if (tv > 0 && tv < 30) timeout_s = tv;
+    }
+    return timeout_s;
+}
+
+static int modbus_open(CustomizedClient *client, int rtu) {
+    ModbusConn *c = calloc(1, sizeof(*c));
+    if (!c) return -1;
+    c->rtu = rtu;
+    cJSON *cfg = NULL;
+    cJSON *root = driver_config_parse(client->protocolConfig.configData, &cfg);
+    char buf[128];
+
+    c->slave = driver_config_int(cfg, "slaveID", 1);
+    if (rtu) {
+        driver_config_str(cfg, "serialPort", "/dev/ttyS0", c->serial, sizeof(c->serial));
+        sanitize(c->serial, 1);
+        c->baud = driver_config_int(cfg, "baudRate", 9600);
+        c->dataBits = driver_config_int(cfg, "dataBits", 8);
+        c->stopBits = driver_config_int(cfg, "stopBits", 1);
+        driver_config_str(cfg, "parity", "none", buf, sizeof(buf));
+        // KubeEdge 配置常写 N/E/O
+        const char *parity = (buf[0] == 'E' || buf[0] == 'e') ? "even" :
+                             (buf[0] == 'O' || buf[0] == 'o') ? "odd" : "none";
+        snprintf(c->parity, sizeof(c->parity), "%s", parity);
+        snprintf(client->endpoint, sizeof(client->endpoint), "%s", c->serial);
+    } else {
+        // 配置未给出时用环境变量，最后回落到本机 1502
+        const char *h = driver_config_str(cfg, "ip", NULL, buf, sizeof(buf));
+        if (!h) h = driver_config_str(cfg, "addr", NULL, buf, sizeof(buf));
+        if (!h) h = getenv("MAPPER_MODBUS_ADDR");
+        snprintf(c->host, sizeof(c->host), "%s", h ? h : "");
+        sanitize(c->host, 0);
+        if (!c->host[0]) snprintf(c->host, sizeof(c->host), "127.0.0.1");
+        int port = driver_config_int(cfg, "port", 0);
+        if (port <= 0 || port > 65535) {
+            const char *envp = getenv("MAPPER_MODBUS_PORT");
+            port = envp && *envp ? atoi(envp) : 0;
+        }
+        c->port = (port > 0 && port <= 65535) ? port : 1502;
+        snprintf(client->endpoint, sizeof(client->endpoint), "%s:%d", c->host, c->port);
+    }
+    cJSON_Delete(root);
+    if (c->slave <= 0 || c->slave > 247) c->slave = 1;
+    client->priv = c;
+    return 0;
+}
+
+static int modbus_tcp_open(CustomizedClient *client) {
+    return modbus_open(client, 0);
+}
+
+static int modbus_rtu_open(CustomizedClient *client) {
+    return modbus_open(client, 1);
+}
+
+static void modbus_close(CustomizedClient *client) {
+    free(client->priv);
+    client->priv = NULL;
+}
+
+static int modbus_init(CustomizedClient *client) {
+    ModbusConn *c = client->priv;
+    if (!c) return -1;
+    if (c->rtu && access(c->serial, R_OK | W_OK) != 0) {
+        log_error("Modbus RTU: serial port %s not accessible", c->serial);
+        return -1;
+    }
+    return 0;
+}
+
+static int modbus_stop(CustomizedClient *client) {
+    return 0;   // 每帧一个 mbpoll 进程，没有常驻连接
+}
+
+// TCP 探测端口可连；RTU 检查串口可读写
+static const char *modbus_status(CustomizedClient *client) {
+    ModbusConn *c = client->priv;
+    if (!c) return DEVICE_STATUS_UNKNOWN;
+    if (c->rtu) return access(c->serial, R_OK | W_OK) == 0 ? DEVICE_STATUS_OK : DEVICE_STATUS_OFFLINE;
+
+    char port[16];
+    snprintf(port, sizeof(port), "%d", c->port);
+    struct addrinfo hints = {0}, *res = NULL;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(c->host, port, &hints, &res) != 0 || !res) return DEVICE_STATUS_OFFLINE;
+    int ok = 0;
+    int fd = socket(res->ai_family, res->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, res->ai_protocol);
+    if (fd >= 0) {
+        if (connect(fd, res->ai_addr, res->ai_addrlen) == 0) {
+            ok = 1;
+        } else if (errno == EINPROGRESS) {
+            struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+            int err = 0;
+            socklen_t len = sizeof(err);
+            ok = poll(&pfd, 1, 1000) == 1 &&
+                 getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0;
+        }
+        close(fd);
+    }
+    freeaddrinfo(res);
+    return ok ? DEVICE_STATUS_OK : DEVICE_STATUS_OFFLINE;
+}
+
+// 访问配置：{"register": "HoldingRegister", "offset": 1}；没有 offset 的属性不可访问
+static int modbus_resolve(const VisitorConfig *v, ModbusAddr *a, int writing) {
+    a->table = 4;
+    a->offset = -1;
+    cJSON *cfg = NULL;
+    cJSON *root = v ? driver_config_parse(v->configData, &cfg) : NULL;
+    char reg[64];
+    driver_config_str(cfg, "register", "HoldingRegister", reg, sizeof(reg));
+    if (strcasecmp(reg, "CoilRegister") == 0 || strcasecmp(reg, "Coil") == 0) a->table = 0;
+    else if (strcasecmp(reg, "DiscreteInputRegister") == 0) a->table = 1;
+    else if (strcasecmp(reg, "InputRegister") == 0) a->table = 3;
+    a->offset = driver_config_int(cfg, "offset", -1);
+    cJSON_Delete(root);
+
+    if (a->offset < 0) {
+        // 周期采集会对每个属性尝试读取，没有地址的属性只在下发时告警
+        if (writing) log_warn("Modbus: cannot resolve address for %s", v && v->propertyName ? v->propertyName : "(null)");
+        return DRIVER_ENOADDR;
+    }
+    return DRIVER_OK;
+}
+
+static int addr_order(const void *x, const void *y) {
+    const ModbusAddr *a = x, *b = y;
+    if (a->table != b->table) return a->table - b->table;
+    if (a->offset != b->offset) return a->offset < b->offset ? -1 : 1;
+    return a->idx - b->idx;   // 同一地址按提交顺序，后写的值生效
+}
+
+// 从 sorted[i] 起地址连续的一组，返回组长度
+static int addr_run(const ModbusAddr *sorted, int i, int n) {
+    int j = i + 1;
+    while (j < n && j - i < MODBUS_MAX_REGS && sorted[j].table == sorted[i].table &&
+           sorted[j].offset == sorted[j - 1].offset + 1) {
+        j++;
+    }
+    return j - i;
+}
+
+// 命令前缀（不含取值），写入 cmd 并返回长度
+static int mbpoll_prefix(const ModbusConn *c, char *cmd, size_t cap, int table, int start, int readCount) {
+    char count[16] = "";
+    if (readCount > 0) snprintf(count, sizeof(count), " -c %d", readCount);   // 写入不能带 -c
+    if (c->rtu) {
+        return snprintf(cmd, cap, "timeout %d /usr/bin/mbpoll -1 -m rtu -b %d -P %s -d %d -s %d -a %d -t %d -r %d%s %s",
+                        mbpoll_timeout_s(), c->baud, c->parity, c->dataBits, c->stopBits,
+                        c->slave, table, start, count, c->serial);
+    }
+    return snprintf(cmd, cap, "timeout %d /usr/bin/mbpoll -1 -m tcp -p %d -a %d -t %d -r %d%s %s",
+                    mbpoll_timeout_s(), c->port, c->slave, table, start, count, c->host);
+}
+
+static int exit_code_of(int raw) {
+    if (raw == -1) return -1;
+    return WIFEXITED(raw) ? WEXITSTATUS(raw) : 128 + (WIFSIGNALED(raw) ? WTERMSIG(raw) : 0);
+}
+
+static int modbus_write_run(ModbusConn *c, const ModbusAddr *run, int count) {
+    size_t cap = 512 + (size_t)count * 12;
+    char *cmd = malloc(cap);
+    if (!cmd) return -1;
+    int len = mbpoll_prefix(c, cmd, cap, run[0].table, run[0].offset, 0);
+    for (int k = 0; k < count; k++) {
+        len += snprintf(cmd + len, cap - (size_t)len, " %d", run[k].word);
+    }
+    snprintf(cmd + len, cap - (size_t)len, " >/dev/null 2>&1");
+    log_info("Modbus write: %s", cmd);
+
+    pthread_mutex_t *bus = bus_lock(c);
+    if (bus) pthread_mutex_lock(bus);
+    int raw = system(cmd);
+    if (bus) pthread_mutex_unlock(bus);
+    int code = exit_code_of(raw);
+    if (code != 0) log_error("Modbus write failed (exit=%d raw=%d). cmd=%s", code, raw, cmd);
+    free(cmd);
+    return code;
+}
+
+// 读一组连续地址，mbpoll 输出形如 "[40001]: 	123"
+static int modbus_read_run(ModbusConn *c, const ModbusAddr *run, int count, DriverReadItem *items) {
+    char cmd[512];
+    int len = mbpoll_prefix(c, cmd, sizeof(cmd), run[0].table, run[0].offset, count);
+    snprintf(cmd + len, sizeof(cmd) - (size_t)len, " 2>/dev/null");
+    log_debug("Modbus read: %s", cmd);
+
+    pthread_mutex_t *bus = bus_lock(c);
+    if (bus) pthread_mutex_lock(bus);
+    FILE *fp = popen(cmd, "r");
+    int got = 0;
+    if (fp) {
+        char line[256];
+        while (fgets(line, sizeof(line), fp)) {
+            int ref = 0, val = 0;
+            if (sscanf(line, " [%d]: %d", &ref, &val) != 2) continue;
+            int k = ref - run[0].offset;
+            if (k < 0 || k >= count) continue;
+            DriverReadItem *it = &items[run[k].idx];
+            // 线圈与离散输入为布尔，寄存器按 16 位整数
+            it->value.type = run[0].table <= 1 ? DRIVER_VALUE_BOOL : DRIVER_VALUE_INT;
+            it->value.as.i = run[0].table <= 1 ? (val != 0) : val;
+            it->rc = DRIVER_OK;
+            got++;
+        }
+    }
+    int code = fp ? exit_code_of(pclose(fp)) : -1;
+    if (bus) pthread_mutex_unlock(bus);
+    if (code != 0 || got < count) {
+        log_error("Modbus read failed (exit=%d, %d/%d values). cmd=%s", code, got, count, cmd);
+        for (int k = 0; k < count; k++) {
+            DriverReadItem *it = &items[run[k].idx];
+            it->value.type = DRIVER_VALUE_NONE;
+            it->rc = DRIVER_EIO;
+        }
+        return -1;
+    }
+    return 0;
+}
+
+// 解析第 idx 项的地址（写入时 value 非空并换算为寄存器值），成功时追加到 addrs；返回该项的 rc
+static int resolve_into(const VisitorConfig *v, const DriverValue *value, int idx, ModbusAddr *addrs, int *m) {
+    ModbusAddr a;
+    int rc = modbus_resolve(v, &a, value != NULL);
+    if (rc != DRIVER_OK) return rc;
+    const char *prop = v && v->propertyName ? v->propertyName : "(null)";
+    a.word = 0;
+    if (value) {
+        if (a.table == 1 || a.table == 3) {
+            log_warn("Modbus: %s is read-only", prop);
+            return DRIVER_EIO;
+        }
+        long long word = 0;
+        if (driver_value_int(value, &word) != 0 || word < -32768 || word > 65535) {
+            log_warn("Modbus: value for %s is not a 16-bit register value", prop);
+            return DRIVER_EINVAL;
+        }
+        a.word = a.table == 0 ? word != 0 : (int)word;
+    }
+    a.idx = idx;
+    addrs[(*m)++] = a;
+    return DRIVER_OK;
+}
+
+static int modbus_write_batch(CustomizedClient *client, DriverWriteItem *items, int n) {
+    ModbusConn *c = client->priv;
+    if (!c) return DRIVER_EIO;
+    ModbusAddr *addrs = malloc((size_t)n * sizeof(*addrs));
+    if (!addrs) return DRIVER_EIO;
+    int m = 0;
+    for (int i = 0; i < n; i++) {
+        items[i].rc = resolve_into(items[i].visitor, &items[i].value, i, addrs, &m);
+        if (items[i].rc != DRIVER_OK) continue;
+        // 回填换算后的值：线圈为布尔，寄存器为整数（浮点已四舍五入），与读回的形式一致
+        const ModbusAddr *a = &addrs[m - 1];
+        items[i].value.type = a->table == 0 ? DRIVER_VALUE_BOOL : DRIVER_VALUE_INT;
+        items[i].value.as.i = a->word;
+    }
+    qsort(addrs, (size_t)m, sizeof(*addrs), addr_order);
+    for (int i = 0; i < m; ) {
+        int count = addr_run(addrs, i, m);
+        // 组内同一地址重复时不合并（addr_run 要求严格 +1），逐帧按提交顺序写
+        int rc = modbus_write_run(c, &addrs[i], count) == 0 ? DRIVER_OK : DRIVER_EIO;
+        for (int k = i; k < i + count; k++) items[addrs[k].idx].rc = rc;
+        i += count;
+    }
+    free(addrs);
+    for (int i = 0; i < n; i++) {
+        if (items[i].rc != DRIVER_OK) return DRIVER_EIO;
+    }
+    return DRIVER_OK;
+}
+
+static int modbus_read_batch(CustomizedClient *client, DriverReadItem *items, int n) {
+    ModbusConn *c = client->priv;
+    if (!c) return DRIVER_EIO;
+    ModbusAddr *addrs = malloc((size_t)n * sizeof(*addrs));
+    if (!addrs) return DRIVER_EIO;
+    int m = 0;
+    for (int i = 0; i < n; i++) items[i].rc = resolve_into(items[i].visitor, NULL, i, addrs, &m);
+    qsort(addrs, (size_t)m, sizeof(*addrs), addr_order);
+    for (int i = 0; i < m; ) {
+        // 同一地址被多个属性引用时读一次即可，结果复制给其余项
+        int j = i + 1;
+        int count = 1;
+        while (j < m && count < MODBUS_MAX_REGS && addrs[j].table == addrs[i].table &&
+               addrs[j].offset <= addrs[j - 1].offset + 1) {
+            if (addrs[j].offset != addrs[j - 1].offset) count++;
+            j++;
+        }
+        ModbusAddr run[MODBUS_MAX_REGS];
+        int r = 0;
+        for (int k = i; k < j; k++) {
+            if (r == 0 || addrs[k].offset != run[r - 1].offset) run[r++] = addrs[k];
+        }
+        for (int k = i; k < j; k++) items[addrs[k].idx].rc = DRIVER_EIO;
+        modbus_read_run(c, run, r, items);
+        for (int k = i; k < j; k++) {
+            DriverReadItem *it = &items[addrs[k].idx];
+            if (it->rc == DRIVER_OK) continue;
+            for (int q = 0; q < r; q++) {
+                const DriverReadItem *src = &items[run[q].idx];
+                if (run[q].offset == addrs[k].offset && src->rc == DRIVER_OK && src != it) {
+                    it->value = src->value;
+                    it->rc = DRIVER_OK;
+                }
+            }
+        }
+        i = j;
+    }
+    free(addrs);
+    for (int i = 0; i < n; i++) {
+        if (items[i].rc != DRIVER_OK) return DRIVER_EIO;
+    }
+    return DRIVER_OK;
+}
+
+const DriverOps modbus_tcp_driver = {
+    .abiVersion = DRIVER_ABI_VERSION,
+    .name = "modbus-tcp",
+    .open = modbus_tcp_open,
+    .close = modbus_close,
+    .init = modbus_init,
+    .read_batch = modbus_read_batch,
+    .write_batch = modbus_write_batch,
+    .stop = modbus_stop,
+    .status = modbus_status,
+};
+
+const DriverOps modbus_rtu_driver = {
+    .abiVersion = DRIVER_ABI_VERSION,
+    .name = "modbus-rtu",
+    .open = modbus_rtu_open,
+    .close = modbus_close,
+    .init = modbus_init,
+    .read_batch = modbus_read_batch,
+    .write_batch = modbus_write_batch,
+    .stop = modbus_stop,
+    .status = modbus_status,
+};
@@ -0,0 +1,108 @@
+#include "driver/driver.h"
+#include "log/log.h"
+#include <dirent.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#define DRIVER_MAX 32
+
+typedef struct {
+    const char *name;        // 查找名（别名与 ops->name 不同）
+    const DriverOps *ops;
+} DriverEntry;
+
+// 注册只发生在启动阶段，表项不删除；插件句柄不 dlclose，客户端可能一直引用其 ops
+static pthread_mutex_t g_drivers_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t g_builtin_once = PTHREAD_ONCE_INIT;
+static DriverEntry g_drivers[DRIVER_MAX];
+static int g_driver_count = 0;
+
+static int register_as(const char *name, const DriverOps *ops) {
+    if (!name || !*name || !ops) return -1;
+    if (ops->abiVersion != DRIVER_ABI_VERSION) {
+        log_error("Driver %s: ABI version %d, expected %d", name, ops->abiVersion, DRIVER_ABI_VERSION);
+        return -1;
+    }
+    if (!ops->read_batch || !ops->write_batch) {
+        log_error("Driver %s: read_batch/write_batch are required", name);
+        return -1;
+    }
+    pthread_mutex_lock(&g_drivers_lock);
+    int rc = 0;
+    int i = 0;
+    while (i < g_driver_count && strcasecmp(g_drivers[i].name, name) != 0) i++;
+    if (i < g_driver_count) {
+        log_info("Driver %s replaced", name);
+        g_drivers[i].ops = ops;
+    } else if (g_driver_count < DRIVER_MAX) {
+        g_drivers[g_driver_count].name = name;
+        g_drivers[g_driver_count].ops = ops;
+        g_driver_count++;
+    } else {
+        log_error("Driver table full (%d), %s not registered", DRIVER_MAX, name);
+        rc = -1;
+    }
+    pthread_mutex_unlock(&g_drivers_lock);
+    return rc;
+}
+
+static void register_builtin(void) {
+    register_as(modbus_tcp_driver.name, &modbus_tcp_driver);
+    register_as("modbus", &modbus_tcp_driver);
+    register_as(modbus_rtu_driver.name, &modbus_rtu_driver);
+    register_as(simulated_driver.name, &simulated_driver);
+}
+
+int driver_register(const DriverOps *ops) {
+    pthread_once(&g_builtin_once, register_builtin);
+    return ops ? register_as(ops->name, ops) : -1;
+}
+
+const DriverOps *driver_lookup(const char *protocolName) {
+    pthread_once(&g_builtin_once, register_builtin);
+    if (!protocolName || !*protocolName) return NULL;
+    const DriverOps *ops = NULL;
+    pthread_mutex_lock(&g_drivers_lock);
+    for (int i = 0; i < g_driver_count && !ops; i++) {
+        if (strcasecmp(g_drivers[i].name, protocolName) == 0) ops = g_drivers[i].ops;
+    }
+    pthread_mutex_unlock(&g_drivers_lock);
+    return ops;
+}
+
+int driver_load_plugins(const char *dir) {
+    if (!dir || !*dir) return 0;
+    DIR *d = opendir(dir);
+    if (!d) {
+        log_warn("Driver plugin dir %s not readable", dir);
+        return 0;
+    }
+    int loaded = 0;
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL) {
+        size_t len = strlen(ent->d_name);
+        if (len < 4 || strcmp(ent->d_name + len - 3, ".so") != 0) continue;
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s", dir, ent->d_name);
+        void *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+        if (!handle) {
+            log_error("Driver plugin %s: %s", path, dlerror());
+            continue;
+        }
+        const DriverOps *(*entry)(void) = NULL;
+        *(void **)&entry = dlsym(handle, DRIVER_PLUGIN_ENTRY);
+        const DriverOps *ops = entry ? entry() : NULL;
+        if (!ops || driver_register(ops) != 0) {
+            log_error("Driver plugin %s: no usable %s()", path, DRIVER_PLUGIN_ENTRY);
+            dlclose(handle);
+            continue;
+        }
+        log_info("Driver plugin loaded: %s (%s)", ops->name, path);
+        loaded++;
+    }
+    closedir(d);
+    return loaded;
+}
@@ -0,0 +1,140 @@
+#include "driver/driver.h"
+#include "common/const.h"
+#include <cjson/cJSON.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 模拟设备：属性值保存在内存里，写入什么读回什么，未写过的属性读到访问配置中的 "initial"（默认 "0"）。
+// 用于联调和压测，不访问任何硬件
+typedef struct {
+    char **names;
+    DriverValue *values;
+    int count;
+    int cap;
+} SimState;
+
+// iosched 的端点只增不删，端点名必须来自配置而不是运行时计数：
+// 协议配置里有 "id" 时每个 id 一个端点（重建客户端后端点不变），否则所有模拟客户端共用 "simulated"
+static int sim_open(CustomizedClient *client) {
+    SimState *s = calloc(1, sizeof(*s));
+    if (!s) return -1;
+    client->priv = s;
+    char id[64];
+    cJSON *cfg = NULL;
+    cJSON *root = driver_config_parse(client->protocolConfig.configData, &cfg);
+    if (driver_config_str(cfg, "id", NULL, id, sizeof(id))) {
+        snprintf(client->endpoint, sizeof(client->endpoint), "simulated/%s", id);
+    }
+    cJSON_Delete(root);
+    return 0;
+}
+
+static void sim_close(CustomizedClient *client) {
+    SimState *s = client->priv;
+    if (!s) return;
+    for (int i = 0; i < s->count; i++) {
+        free(s->names[i]);
+    }
+    free(s->names);
+    free(s->values);
+    free(s);
+    client->priv = NULL;
+}
+
+static int sim_init(CustomizedClient *client) {
+    return client->priv ? 0 : -1;
+}
+
+static int sim_stop(CustomizedClient *client) {
+    return 0;
+}
+
+static const char *sim_status(CustomizedClient *client) {
+    return client->priv ? DEVICE_STATUS_OK : DEVICE_STATUS_UNKNOWN;
+}
+
+// 持 client->deviceMutex
+static int sim_find(const SimState *s, const char *name) {
+    for (int i = 0; i < s->count; i++) {
+        if (strcmp(s->names[i], name) == 0) return i;
+    }
+    return -1;
+}
+
+static int sim_read_batch(CustomizedClient *client, DriverReadItem *items, int n) {
+    SimState *s = client->priv;
+    if (!s) return DRIVER_EIO;
+    int rc = DRIVER_OK;
+    pthread_mutex_lock(&client->deviceMutex);
+    for (int i = 0; i < n; i++) {
+        const VisitorConfig *v = items[i].visitor;
+        if (!v || !v->propertyName) {
+            items[i].rc = DRIVER_ENOADDR;
+            rc = DRIVER_EIO;
+            continue;
+        }
+        int k = sim_find(s, v->propertyName);
+        if (k >= 0) {
+            items[i].value = s->values[k];
+        } else {
+            char buf[DRIVER_VALUE_STR_MAX];
+            cJSON *cfg = NULL;
+            cJSON *root = driver_config_parse(v->configData, &cfg);
+            driver_value_parse(&items[i].value, driver_config_str(cfg, "initial", "0", buf, sizeof(buf)), NULL);
+            cJSON_Delete(root);
+        }
+        items[i].rc = DRIVER_OK;
+    }
+    pthread_mutex_unlock(&client->deviceMutex);
+    return rc;
+}
+
+static int sim_write_batch(CustomizedClient *client, DriverWriteItem *items, int n) {
+    SimState *s = client->priv;
+    if (!s) return DRIVER_EIO;
+    int rc = DRIVER_OK;
+    pthread_mutex_lock(&client->deviceMutex);
+    for (int i = 0; i < n; i++) {
+        const VisitorConfig *v = items[i].visitor;
+        items[i].rc = DRIVER_EIO;
+        if (!v || !v->propertyName || items[i].value.type == DRIVER_VALUE_NONE) {
+            rc = DRIVER_EIO;
+            continue;
+        }
+        int k = sim_find(s, v->propertyName);
+        if (k < 0 && s->count == s->cap) {
+            int cap = s->cap ? s->cap * 2 : 8;
+            char **names = realloc(s->names, (size_t)cap * sizeof(*names));
+            if (names) s->names = names;
+            DriverValue *values = names ? realloc(s->values, (size_t)cap * sizeof(*values)) : NULL;
+            if (values) {
+                s->values = values;
+                s->cap = cap;
+            }
+        }
+        if (k < 0 && s->count < s->cap && (s->names[s->count] = strdup(v->propertyName)) != NULL) {
+            k = s->count++;
+        }
+        if (k < 0) {
+            rc = DRIVER_EIO;
+            continue;
+        }
+        s->values[k] = items[i].value;
+        items[i].rc = DRIVER_OK;
+    }
+    pthread_mutex_unlock(&client->deviceMutex);
+    return rc;
+}
+
+const DriverOps simulated_driver = {
+    .abiVersion = DRIVER_ABI_VERSION,
+    .name = "simulated",
+    .open = sim_open,
+    .close = sim_close,
+    .init = sim_init,
+    .read_batch = sim_read_batch,
+    .write_batch = sim_write_batch,
+    .stop = sim_stop,
+    .status = sim_status,
+};
@@ -11,8 +11,7 @@
 #include "config/config.h"
 #include "common/const.h"
 #include "dmi/v1beta1/api.grpc.pb.h"
-#include "dmi/v1beta1/api.pb-c.h"
-#include "util/parse/grpc.h"
+#include "util/parse/grpc_pb.h"
 #include "common/datamodel.h"
 #include "log/log.h"  // 新增
 
@@ -105,8 +104,11 @@ static int RegisterMapperCpp(
     log_info("MapperRegister ok: devices=%d, models=%d",
              resp.devicelist_size(), resp.modellist_size());
 
-    deviceList.assign(resp.devicelist().begin(), resp.devicelist().end());
-    modelList.assign(resp.modellist().begin(), resp.modellist().end());
+    // 移动而非复制：resp 不再使用
+    deviceList.reserve(resp.devicelist_size());
+    for (auto &dev : *resp.mutable_devicelist()) deviceList.push_back(std::move(dev));
+    modelList.reserve(resp.modellist_size());
+    for (auto &mdl : *resp.mutable_modellist()) modelList.push_back(std::move(mdl));
     if (cfg) config_free(cfg);
     return 0;
 }
@@ -127,39 +129,15 @@ extern "C" int RegisterMapper(
         *outDeviceCount = devList.size();
         *outDeviceList = (DeviceInstance*)calloc(*outDeviceCount, sizeof(DeviceInstance));
         for (int i = 0; i < *outDeviceCount; ++i) {
-            // 正确做法：先把 C++ protobuf 序列化，再用 protobuf-c 解包
-            std::string buf;
-            if (!devList[i].SerializeToString(&buf)) {
-                log_error("Serialize device[%d] failed", i);
-                continue;
-            }
-            V1beta1__Device* pb_dev =
-                v1beta1__device__unpack(NULL, buf.size(), (const uint8_t*)buf.data());
-            if (!pb_dev) {
-                log_error("Unpack device[%d] failed", i);
-                continue;
-            }
-            get_device_from_grpc(pb_dev, NULL, &((*outDeviceList)[i]));
-            v1beta1__device__free_unpacked(pb_dev, NULL);
+            // 直接从 C++ 对象转换，不再经过序列化 + protobuf-c 解包
+            device_instance_from_pb(devList[i], NULL, &(*outDeviceList)[i]);
         }
     }
     if (outModelList && outModelCount) {
         *outModelCount = mdlList.size();
         *outModelList = (DeviceModel*)calloc(*outModelCount, sizeof(DeviceModel));
         for (int i = 0; i < *outModelCount; ++i) {
-            std::string buf;
-            if (!mdlList[i].SerializeToString(&buf)) {
-                log_error("Serialize model[%d] failed", i);
-                continue;
-            }
-            V1beta1__DeviceModel* pb_model =
-                v1beta1__device_model__unpack(NULL, buf.size(), (const uint8_t*)buf.data());
-            if (!pb_model) {
-                log_error("Unpack model[%d] failed", i);
-                continue;
-            }
-            get_device_model_from_grpc(pb_model, &((*outModelList)[i]));
-            v1beta1__device_model__free_unpacked(pb_model, NULL);
+            device_model_from_pb(mdlList[i], &(*outModelList)[i]);
         }
     }
     return 0;
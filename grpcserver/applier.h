@@ -0,0 +1,204 @@
+#ifndef GRPCSERVER_APPLIER_H
+#define GRPCSERVER_APPLIER_H
+
+// 期望值下发队列：RPC 线程只构造计划并入队，后台线程按设备串行执行
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <cstddef>
+#include "log/log.h"
+
+// 一次 UpdateDevice 的下发计划：同一设备的全部期望值作为一批，在设备锁内一次下发
+struct WritePlanItem {
+    int index;              // 云端 spec 中的下标，名称匹配不到时按下标兜底
+    std::string property;
+    std::string value;
+};
+
+struct WritePlan {
+    std::string ns;
+    std::string name;
+    std::vector<WritePlanItem> items;
+    bool forceDirect = false;   // MAPPER_FORCE_FALLBACK=1 时先直写
+    std::chrono::steady_clock::time_point readyAt;   // 合并窗口结束前不执行，期间同属性的新值覆盖旧值
+    // 非空时为配置变更任务（注册/删除/模型下发），与同一 key 的写计划按到达顺序串行，不参与合并
+    std::function<int()> task;
+    // 设备 spec 任务（注册/UpdateDevice）：尚未执行时被同设备后到的 spec 替换，items 为该 spec 带的期望值
+    bool spec = false;
+
+    std::string key() const { return ns + "/" + name; }
+};
+
+// 有界工作队列 + 后台下发线程：RPC 线程只构造计划并入队，不等待设备 I/O
+// 同一设备同一时刻只有一个计划在执行，保证按到达顺序生效
+class DesiredApplier {
+public:
+    using Executor = std::function<int(const WritePlan &)>;
+    static constexpr int kDefaultDrainMs = 2000;
+
+    DesiredApplier(size_t capacity, int workers, int coalesceMs, Executor execute)
+        : capacity_(capacity), workers_(workers), coalesce_(std::chrono::milliseconds(coalesceMs)),
+          execute_(std::move(execute)) {}
+    ~DesiredApplier() { Stop(); }
+
+    void Start() {
+        for (int i = 0; i < workers_; ++i) {
+            threads_.emplace_back([this]() { Run(); });
+        }
+    }
+
+    // 不再接受新计划，已入队的计划跳过合并窗口继续执行，最多等 drain；
+    // 到期仍未执行的计划丢弃，等待执行中的计划完成
+    void Stop(std::chrono::milliseconds drain = std::chrono::milliseconds(kDefaultDrainMs)) {
+        {
+            std::unique_lock<std::mutex> lk(mu_);
+            if (stopping_ && threads_.empty()) return;
+            draining_ = true;
+            cv_.notify_all();
+            if (!threads_.empty()) {
+                cv_.wait_for(lk, drain, [this]() { return queue_.empty() && active_.empty(); });
+            }
+            stopping_ = true;
+            if (!queue_.empty()) {
+                log_warn("DesiredApplier: dropping %zu pending plan(s) after %lld ms drain",
+                         queue_.size(), (long long)drain.count());
+                queue_.clear();
+            }
+        }
+        cv_.notify_all();
+        for (auto &t : threads_) t.join();
+        threads_.clear();
+    }
+
+    // 入队成功返回 true，队列满或已停止返回 false
+    // 同一设备排在最后的尚未执行的写计划直接合并，后到的值覆盖；
+    // spec 任务排到同设备尚未执行的写计划之前（已有排队的 spec 则顶替它），不把前后的写计划隔开；
+    // 其余配置变更任务不合并
+    bool Submit(WritePlan &&plan) {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (draining_) return false;
+        const std::string key = plan.key();
+        if (plan.spec && ReplaceSpec(key, plan)) return true;
+        for (auto rit = queue_.rbegin(); rit != queue_.rend(); ++rit) {
+            auto &queued = *rit;
+            if (queued.key() != key) continue;
+            if (queued.task || plan.task) break;
+            MergeItems(queued, plan.items);
+            queued.forceDirect = queued.forceDirect || plan.forceDirect;
+            return true;
+        }
+        if (queue_.size() >= capacity_) return false;
+        plan.readyAt = std::chrono::steady_clock::now() + (plan.task ? std::chrono::milliseconds(0) : coalesce_);
+        queue_.push_back(std::move(plan));
+        cv_.notify_one();
+        return true;
+    }
+
+private:
+    static void MergeItems(WritePlan &into, const std::vector<WritePlanItem> &items) {
+        for (const auto &item : items) {
+            bool replaced = false;
+            for (auto &old : into.items) {
+                if (old.property == item.property) {
+                    old.value = item.value;
+                    replaced = true;
+                    break;
+                }
+            }
+            if (!replaced) into.items.push_back(item);
+        }
+    }
+
+    // 持 mu_。同设备排队中的写计划之前放入新 spec（顶替尚未执行的旧 spec，或插到这些写计划之前），
+    // 新 spec 因此先于这些写计划执行，其带的期望值并入最靠后的写计划，保证最终生效的仍是最新值；
+    // 中间隔着其他配置任务、或没有排队的写计划时按普通任务入队
+    bool ReplaceSpec(const std::string &key, WritePlan &plan) {
+        size_t pending = queue_.size();   // 最靠后的同设备写计划
+        size_t first = queue_.size();     // 最靠前的同设备写计划
+        for (size_t i = queue_.size(); i-- > 0; ) {
+            WritePlan &queued = queue_[i];
+            if (queued.key() != key) continue;
+            if (queued.spec) {
+                queued.task = std::move(plan.task);
+                queued.items = plan.items;
+                if (pending < queue_.size()) MergeItems(queue_[pending], plan.items);
+                return true;
+            }
+            if (queued.task) return false;
+            if (pending == queue_.size()) pending = i;
+            first = i;
+        }
+        if (pending == queue_.size() || queue_.size() >= capacity_) return false;
+        MergeItems(queue_[pending], plan.items);
+        plan.readyAt = std::chrono::steady_clock::now();
+        queue_.insert(queue_.begin() + (std::ptrdiff_t)first, std::move(plan));
+        cv_.notify_one();
+        return true;
+    }
+
+    void Run() {
+        std::unique_lock<std::mutex> lk(mu_);
+        while (true) {
+            auto it = queue_.end();
+            auto wakeAt = std::chrono::steady_clock::time_point::max();
+            // 找第一个可执行的计划：设备不在执行中且合并窗口已过；同一设备靠前的计划未就绪时后面的也不执行
+            auto runnable = [&]() {
+                auto now = std::chrono::steady_clock::now();
+                std::set<std::string> blocked;
+                wakeAt = std::chrono::steady_clock::time_point::max();
+                for (it = queue_.begin(); it != queue_.end(); ++it) {
+                    const std::string key = it->key();
+                    if (active_.count(key) || blocked.count(key)) continue;
+                    if (draining_ || it->readyAt <= now) return true;
+                    blocked.insert(key);
+                    if (it->readyAt < wakeAt) wakeAt = it->readyAt;
+                }
+                return false;
+            };
+            while (!stopping_ && !runnable()) {
+                if (wakeAt == std::chrono::steady_clock::time_point::max()) cv_.wait(lk);
+                else cv_.wait_until(lk, wakeAt);
+            }
+            if (stopping_) return;
+            WritePlan plan = std::move(*it);
+            queue_.erase(it);
+            const std::string key = plan.key();
+            active_.insert(key);
+            lk.unlock();
+
+            if (plan.task) {
+                int rc = plan.task();
+                log_info("reconfigure %s rc=%d", key.c_str(), rc);
+            } else {
+                int rc = execute_(plan);
+                log_info("apply_write_plan %s items=%zu rc=%d", key.c_str(), plan.items.size(), rc);
+            }
+
+            lk.lock();
+            active_.erase(key);
+            // 该设备可能有等待中的计划
+            cv_.notify_all();
+        }
+    }
+
+    size_t capacity_;
+    int workers_;
+    std::chrono::milliseconds coalesce_;
+    Executor execute_;
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::deque<WritePlan> queue_;
+    std::set<std::string> active_;
+    std::vector<std::thread> threads_;
+    bool draining_ = false;   // Stop 已开始，拒绝新计划
+    bool stopping_ = false;
+};
+
+#endif // GRPCSERVER_APPLIER_H
@@ -7,41 +7,44 @@
 #include "log/log.h"
 #include "common/configmaptype.h"
 #include "server.h"
+#include "applier.h"
 // 把这行改为 extern "C" 包裹，避免 C/C++ 符号不一致
 extern "C" {
 #include "device/device.h"
+#include "device/dev_panel.h"
+#include "device/devicetwin.h"
+#include "common/epoch.h"
 }
+#include "util/parse/grpc_pb.h"
 #include <grpcpp/health_check_service_interface.h>
+#include <grpcpp/resource_quota.h>
 #include <grpcpp/ext/proto_server_reflection_plugin.h> 
 #include <fcntl.h>
 #include <string.h>   // 新增：strdup/free 需要
 #include <cstdlib>   // system, getenv
-#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <set>
+#include <functional>
 #include <chrono>
 
 // 提前定义/声明，供类内使用
 static DeviceManager *g_device_manager = nullptr;
-static int apply_desired_to_device(DeviceManager *mgr, const v1beta1::Device &dev);
 // 新增：声明直写函数原型（定义在文件下方）
 static int write_modbus_direct(const std::string &prop, const std::string &val);
-// 新增：整体验证超时（默认1500ms，可用 MAPPER_APPLY_TIMEOUT_MS 覆盖）
-static int get_apply_timeout_ms() {
-    const char *v = std::getenv("MAPPER_APPLY_TIMEOUT_MS");
-    if (!v || !*v) return 1500;
-    int n = std::atoi(v);
-    return n > 0 ? n : 1500;
-}
-static int apply_desired_to_device_with_timeout(DeviceManager *mgr, const v1beta1::Device &dev, int timeout_ms) {
-    using namespace std::chrono;
-    auto fut = std::async(std::launch::async, [mgr, &dev]() {
-        return apply_desired_to_device(mgr, dev);
-    });
-    if (fut.wait_for(milliseconds(timeout_ms)) == std::future_status::ready) {
-        return fut.get();
-    }
-    log_warn("apply_desired_to_device timeout after %d ms", timeout_ms);
-    return -2;
-}
+
+// RAII 读侧临界区：期间经 device_manager_get 取得的设备即使被并发移除也不会释放
+struct EpochReadGuard {
+    EpochReadGuard() { epoch_read_enter(); }
+    ~EpochReadGuard() { epoch_read_exit(); }
+    EpochReadGuard(const EpochReadGuard&) = delete;
+    EpochReadGuard &operator=(const EpochReadGuard&) = delete;
+};
+
+static int apply_write_plan(DeviceManager *mgr, const WritePlan &plan);
 
 class DevPanel {
 public:
@@ -52,27 +55,208 @@ public:
     }
 };
 
-class DeviceMapperServiceImpl final : public v1beta1::DeviceMapperService::Service {
+// 以默认 reactor 立即结束一元调用；回调在 gRPC 线程上执行，处理函数不可阻塞
+static ::grpc::ServerUnaryReactor *finish_unary(::grpc::CallbackServerContext *context,
+                                                const ::grpc::Status &status) {
+    ::grpc::ServerUnaryReactor *reactor = context->DefaultReactor();
+    reactor->Finish(status);
+    return reactor;
+}
+
+// 按新 spec 新增或增量更新设备，在下发线程执行（可能涉及设备停启）
+static int apply_device_spec(DeviceManager *mgr, const ::v1beta1::Device &dev) {
+    const std::string &modelName = dev.spec().devicemodelreference();
+    DeviceModel model = {};
+    if (device_manager_find_model(mgr, modelName.c_str(), &model) != 0) {
+        log_error("device %s: model %s not found", dev.name().c_str(), modelName.c_str());
+        return -1;
+    }
+    DeviceInstance instance = {};
+    int rc = device_instance_from_pb(dev, &model, &instance);
+    if (rc == 0) rc = dev_panel_update_dev(mgr, &model, &instance);
+    device_instance_clear(&instance);
+    device_model_clear(&model);
+    return rc;
+}
+
+// spec 中带期望值的属性
+static std::vector<WritePlanItem> desired_items(const ::v1beta1::Device &dev) {
+    std::vector<WritePlanItem> items;
+    if (!dev.has_spec()) return items;
+    const auto &spec = dev.spec();
+    for (int i = 0; i < spec.properties_size(); ++i) {
+        const auto &p = spec.properties(i);
+        const bool hd = p.has_desired();
+        const std::string dv = hd ? p.desired().value() : std::string();
+        log_info("CloudProp[%d]: name=%s hasDesired=%d desired=%s", i, p.name().c_str(), hd, dv.c_str());
+        if (!hd || dv.empty()) continue;
+        items.push_back(WritePlanItem{i, p.name(), dv});
+    }
+    return items;
+}
+
+static bool model_known(DeviceManager *mgr, const std::string &name) {
+    DeviceModel model = {};
+    if (device_manager_find_model(mgr, name.c_str(), &model) != 0) return false;
+    device_model_clear(&model);
+    return true;
+}
+
+class DeviceMapperServiceImpl final : public v1beta1::DeviceMapperService::CallbackService {
 public:
-    explicit DeviceMapperServiceImpl(std::shared_ptr<DevPanel> devPanel) : devPanel_(devPanel) {}
+    DeviceMapperServiceImpl(std::shared_ptr<DevPanel> devPanel, DesiredApplier *applier)
+        : devPanel_(devPanel), applier_(applier) {}
 
-    ::grpc::Status RegisterDevice(::grpc::ServerContext* context,
-                                  const ::v1beta1::RegisterDeviceRequest* request,
-                                  ::v1beta1::RegisterDeviceResponse* response) override {
+    ::grpc::ServerUnaryReactor* RegisterDevice(::grpc::CallbackServerContext* context,
+                                               const ::v1beta1::RegisterDeviceRequest* request,
+                                               ::v1beta1::RegisterDeviceResponse* response) override {
         log_info("RegisterDevice called");
-        return ::grpc::Status::OK;
+        return finish_unary(context, registerDevice(request, response));
     }
     
-    ::grpc::Status RemoveDevice(::grpc::ServerContext* context,
-                                const ::v1beta1::RemoveDeviceRequest* request,
-                                ::v1beta1::RemoveDeviceResponse* response) override {
-        log_info("RemoveDevice called");
-        return ::grpc::Status::OK;
+    ::grpc::ServerUnaryReactor* RemoveDevice(::grpc::CallbackServerContext* context,
+                                             const ::v1beta1::RemoveDeviceRequest* request,
+                                             ::v1beta1::RemoveDeviceResponse* response) override {
+        log_info("RemoveDevice called: name=%s ns=%s",
+                 request->devicename().c_str(), request->devicenamespace().c_str());
+        if (request->devicename().empty()) {
+            return finish_unary(context, ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT, "empty device name"));
+        }
+        WritePlan plan;
+        plan.ns = request->devicenamespace();
+        plan.name = request->devicename();
+        const std::string name = plan.name;
+        plan.task = [name]() { return dev_panel_remove_device(g_device_manager, name.c_str()); };
+        return finish_unary(context, submit(std::move(plan)));
+    }
+    
+    ::grpc::ServerUnaryReactor* UpdateDevice(::grpc::CallbackServerContext* context,
+                                             const ::v1beta1::UpdateDeviceRequest* request,
+                                             ::v1beta1::UpdateDeviceResponse* response) override {
+        return finish_unary(context, updateDevice(request));
+    }
+    
+    ::grpc::ServerUnaryReactor* CreateDeviceModel(::grpc::CallbackServerContext* context,
+                                                  const ::v1beta1::CreateDeviceModelRequest* request,
+                                                  ::v1beta1::CreateDeviceModelResponse* response) override {
+        log_info("CreateDeviceModel called");
+        ::grpc::Status st = putModel(request->has_model() ? &request->model() : nullptr, false);
+        if (st.ok()) {
+            response->set_devicemodelname(request->model().name());
+            response->set_devicemodelnamespace(request->model().namespace_());
+        }
+        return finish_unary(context, st);
+    }
+    
+    ::grpc::ServerUnaryReactor* RemoveDeviceModel(::grpc::CallbackServerContext* context,
+                                                  const ::v1beta1::RemoveDeviceModelRequest* request,
+                                                  ::v1beta1::RemoveDeviceModelResponse* response) override {
+        log_info("RemoveDeviceModel called: name=%s", request->modelname().c_str());
+        // 只删除模型表中的条目，已创建的设备保留各自的模型副本
+        if (dev_panel_remove_model(g_device_manager, request->modelname().c_str()) != 0) {
+            return finish_unary(context, ::grpc::Status(::grpc::StatusCode::NOT_FOUND, "model not found"));
+        }
+        return finish_unary(context, ::grpc::Status::OK);
+    }
+    
+    ::grpc::ServerUnaryReactor* UpdateDeviceModel(::grpc::CallbackServerContext* context,
+                                                  const ::v1beta1::UpdateDeviceModelRequest* request,
+                                                  ::v1beta1::UpdateDeviceModelResponse* response) override {
+        log_info("UpdateDeviceModel called");
+        return finish_unary(context, putModel(request->has_model() ? &request->model() : nullptr, true));
     }
     
-    ::grpc::Status UpdateDevice(::grpc::ServerContext* context,
-                            const ::v1beta1::UpdateDeviceRequest* request,
-                            ::v1beta1::UpdateDeviceResponse* response) override {
+    ::grpc::ServerUnaryReactor* GetDevice(::grpc::CallbackServerContext* context,
+                                          const ::v1beta1::GetDeviceRequest* request,
+                                          ::v1beta1::GetDeviceResponse* response) override {
+        log_info("GetDevice called: name=%s", request->devicename().c_str());
+        return finish_unary(context, getDevice(request, response));
+    }
+
+private:
+    ::grpc::Status submit(WritePlan &&plan) {
+        if (!applier_ || !applier_->Submit(std::move(plan))) {
+            return ::grpc::Status(::grpc::StatusCode::RESOURCE_EXHAUSTED, "apply queue full");
+        }
+        return ::grpc::Status::OK;
+    }
+
+    // 校验后入队，设备的创建/增量更新在下发线程执行，不阻塞回调线程
+    ::grpc::Status registerDevice(const ::v1beta1::RegisterDeviceRequest *request,
+                                  ::v1beta1::RegisterDeviceResponse *response) {
+        if (!request->has_device() || request->device().name().empty() || !request->device().has_spec()) {
+            return ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT, "device name and spec required");
+        }
+        const auto &dev = request->device();
+        if (!model_known(g_device_manager, dev.spec().devicemodelreference())) {
+            log_error("RegisterDevice %s: model %s not found",
+                      dev.name().c_str(), dev.spec().devicemodelreference().c_str());
+            return ::grpc::Status(::grpc::StatusCode::NOT_FOUND, "device model not found");
+        }
+        WritePlan plan;
+        plan.ns = dev.namespace_();
+        plan.name = dev.name();
+        auto copy = std::make_shared<::v1beta1::Device>(dev);
+        plan.task = [copy]() { return apply_device_spec(g_device_manager, *copy); };
+        plan.spec = true;
+        plan.items = desired_items(dev);
+        ::grpc::Status st = submit(std::move(plan));
+        if (st.ok()) {
+            response->set_devicename(dev.name());
+            response->set_devicenamespace(dev.namespace_());
+        }
+        return st;
+    }
+
+    // 模型表同步更新（后续 RegisterDevice 立即可见），已有设备的副本替换放到下发线程
+    ::grpc::Status putModel(const ::v1beta1::DeviceModel *mdl, bool propagate) {
+        if (!mdl || mdl->name().empty()) {
+            return ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT, "model name required");
+        }
+        auto model = std::shared_ptr<DeviceModel>(new DeviceModel(), [](DeviceModel *m) {
+            device_model_clear(m);
+            delete m;
+        });
+        if (device_model_from_pb(*mdl, model.get()) != 0 ||
+            device_manager_put_model(g_device_manager, model.get()) != 0) {
+            return ::grpc::Status(::grpc::StatusCode::INTERNAL, "parse device model failed");
+        }
+        if (!propagate) return ::grpc::Status::OK;
+        WritePlan plan;
+        plan.ns = mdl->namespace_();
+        plan.name = "@model/" + mdl->name();   // 与设备 key 不冲突（设备名不含 '@'）
+        plan.task = [model]() { return dev_panel_update_model(g_device_manager, model.get()); };
+        return submit(std::move(plan));
+    }
+
+    // 名称/命名空间/模型引用来自设备实例，孪生值读已发布快照，不取设备锁
+    ::grpc::Status getDevice(const ::v1beta1::GetDeviceRequest *request,
+                             ::v1beta1::GetDeviceResponse *response) {
+        EpochReadGuard guard;
+        Device *device = g_device_manager ? device_manager_get(g_device_manager, request->devicename().c_str()) : nullptr;
+        if (!device) {
+            return ::grpc::Status(::grpc::StatusCode::NOT_FOUND, "device not found");
+        }
+        auto *out = response->mutable_device();
+        out->set_name(device->instance.name ? device->instance.name : "");
+        out->set_namespace_(device->instance.namespace_ ? device->instance.namespace_ : "");
+        if (device->instance.model) out->mutable_spec()->set_devicemodelreference(device->instance.model);
+        const TwinSnapshot *snap = devicetwin_snapshot_acquire(device);
+        for (int i = 0; snap && i < snap->count; i++) {
+            const TwinSnapshotEntry *e = &snap->entries[i];
+            if (!e->propertyName) continue;
+            auto *twin = out->mutable_status()->add_twins();
+            twin->set_propertyname(e->propertyName);
+            auto *reported = twin->mutable_reported();
+            reported->set_value(e->value ? e->value : "");
+            auto &meta = *reported->mutable_metadata();
+            meta["type"] = e->type ? e->type : "string";
+            if (e->timestamp) meta["timestamp"] = e->timestamp;
+        }
+        return ::grpc::Status::OK;
+    }
+
+    ::grpc::Status updateDevice(const ::v1beta1::UpdateDeviceRequest* request) {
         if (!request || !request->has_device()) {
             return ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT, "empty request");
         }
@@ -83,120 +267,81 @@ public:
                  dev.has_spec(),
                  dev.has_spec() ? dev.spec().properties_size() : 0);
 
-        if (dev.has_spec()) {
-            const auto &spec = dev.spec();
-            for (int i = 0; i < spec.properties_size(); ++i) {
-                const auto &p = spec.properties(i);
-                const std::string pn = p.name();
-                const bool hd = p.has_desired();
-                const std::string dv = hd ? p.desired().value() : std::string();
-                log_info("CloudProp[%d]: name=%s hasDesired=%d desired=%s", i, pn.c_str(), hd, dv.c_str());
+        // 只构造计划并入队，实际下发由 DesiredApplier 在后台完成
+        WritePlan plan;
+        plan.ns = dev.namespace_();
+        plan.name = dev.name();
+        plan.items = desired_items(dev);
+
+        // 先按新 spec 增量更新设备配置（属性增删、visitor/协议变化），排在本次写计划之前；
+        // 连续的 UpdateDevice 只保留最新 spec，写计划照常合并（见 DesiredApplier::Submit）
+        if (dev.has_spec() && !dev.name().empty() &&
+            model_known(g_device_manager, dev.spec().devicemodelreference())) {
+            WritePlan spec;
+            spec.ns = dev.namespace_();
+            spec.name = dev.name();
+            auto copy = std::make_shared<::v1beta1::Device>(dev);
+            spec.task = [copy]() { return apply_device_spec(g_device_manager, *copy); };
+            spec.spec = true;
+            spec.items = plan.items;
+            ::grpc::Status st = submit(std::move(spec));
+            if (!st.ok()) {
+                log_warn("UpdateDevice %s: apply queue full, rejected", dev.name().c_str());
+                return st;
             }
         }
 
-        // 1) 强制直写：提前短路，避免因 apply 阻塞而卡住
-        const char *force = std::getenv("MAPPER_FORCE_FALLBACK");
-        if (force && std::strcmp(force, "1") == 0 && dev.has_spec()) {
-            int ok = 0;
-            const auto &spec = dev.spec();
-            for (int i = 0; i < spec.properties_size(); ++i) {
-                const auto &p = spec.properties(i);
-                if (!p.has_desired()) continue;
-                const std::string propName = p.name();
-                const std::string desired  = p.desired().value();
-                if (desired.empty()) continue;
-                int wrc = write_modbus_direct(propName, desired);
-                log_info("Force DirectWrite prop=%s val=%s rc=%d", propName.c_str(), desired.c_str(), wrc);
-                if (wrc == 0) {
-                    ok++;
-                    // 同步更新本地 twin，避免数据线程继续写旧值
-                    Device *local = device_manager_get(g_device_manager, dev.name().c_str());
-                    if (!local && !dev.namespace_().empty()) {
-                        std::string key = dev.namespace_() + "/" + dev.name();
-                        local = device_manager_get(g_device_manager, key.c_str());
-                    }
-                    if (local && local->instance.twins) {
-                        for (int t = 0; t < local->instance.twinsCount; ++t) {
-                            Twin *tw = &local->instance.twins[t];
-                            if (tw && tw->propertyName &&
-                                propName == tw->propertyName) {
-                                free(tw->observedDesired.value);
-                                tw->observedDesired.value = strdup(desired.c_str());
-                                free(tw->reported.value);
-                                tw->reported.value = strdup(desired.c_str());
-                                char ts[32]; time_t tt=time(NULL); struct tm tm; gmtime_r(&tt,&tm);
-                                strftime(ts,32,"%Y-%m-%dT%H:%M:%SZ",&tm);
-                                free(tw->reported.metadata.timestamp);
-                                tw->reported.metadata.timestamp = strdup(ts);
-                                break;
-                            }
-                        }
-                    }
-                }
-            }
-            if (ok > 0) return ::grpc::Status::OK;
-            // 强制直写失败则继续尝试正常路径
+        if (plan.items.empty()) return ::grpc::Status::OK;
+        if (plan.name.empty()) {
+            return ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT, "empty device name");
         }
 
-        // 2) 正常路径：整体验证超时
-        int arc = apply_desired_to_device_with_timeout(g_device_manager, dev, get_apply_timeout_ms());
-        log_info("apply_desired_to_device rc=%d", arc);
-
-        // 3) 兜底直写：仅当正常路径未成功时
-        if (arc != 0 && dev.has_spec()) {
-            int ok = 0;
-            const auto &spec = dev.spec();
-            for (int i = 0; i < spec.properties_size(); ++i) {
-                const auto &p = spec.properties(i);
-                if (!p.has_desired()) continue;
-                const std::string propName = p.name();
-                const std::string desired  = p.desired().value();
-                if (desired.empty()) continue;
-                int wrc = write_modbus_direct(propName, desired);
-                log_info("DirectWrite prop=%s val=%s rc=%d", propName.c_str(), desired.c_str(), wrc);
-                if (wrc == 0) ok++;
-            }
-            if (ok > 0) return ::grpc::Status::OK;
-            return ::grpc::Status(::grpc::StatusCode::NOT_FOUND, "device or properties not applied");
+        const char *force = std::getenv("MAPPER_FORCE_FALLBACK");
+        plan.forceDirect = force && std::strcmp(force, "1") == 0;
+
+        size_t n = plan.items.size();
+        if (!applier_ || !applier_->Submit(std::move(plan))) {
+            log_warn("UpdateDevice %s: apply queue full, rejected", dev.name().c_str());
+            return ::grpc::Status(::grpc::StatusCode::RESOURCE_EXHAUSTED, "apply queue full");
         }
-        return ::grpc::Status::OK;
-    }
-    
-    ::grpc::Status CreateDeviceModel(::grpc::ServerContext* context,
-                                     const ::v1beta1::CreateDeviceModelRequest* request,
-                                     ::v1beta1::CreateDeviceModelResponse* response) override {
-        log_info("CreateDeviceModel called");
-        return ::grpc::Status::OK;
-    }
-    
-    ::grpc::Status RemoveDeviceModel(::grpc::ServerContext* context,
-                                     const ::v1beta1::RemoveDeviceModelRequest* request,
-                                     ::v1beta1::RemoveDeviceModelResponse* response) override {
-        log_info("RemoveDeviceModel called");
-        return ::grpc::Status::OK;
-    }
-    
-    ::grpc::Status UpdateDeviceModel(::grpc::ServerContext* context,
-                                     const ::v1beta1::UpdateDeviceModelRequest* request,
-                                     ::v1beta1::UpdateDeviceModelResponse* response) override {
-        log_info("UpdateDeviceModel called");
-        return ::grpc::Status::OK;
-    }
-    
-    ::grpc::Status GetDevice(::grpc::ServerContext* context,
-                             const ::v1beta1::GetDeviceRequest* request,
-                             ::v1beta1::GetDeviceResponse* response) override {
-        log_info("GetDevice called");
+        log_info("UpdateDevice %s: plan with %zu item(s) accepted", dev.name().c_str(), n);
         return ::grpc::Status::OK;
     }
 
-private:
     std::shared_ptr<DevPanel> devPanel_;
+    DesiredApplier *applier_;
 };
 
 
 ServerConfig::ServerConfig(const std::string& sock_path, const std::string& protocol)
-    : sockPath(sock_path), protocol(protocol) {}
+    : sockPath(sock_path), protocol(protocol), tuning() {}
+
+// 线程、内存、消息大小与 keepalive 参数；取值 <=0 的项保持 gRPC 默认
+static void apply_server_tuning(grpc::ServerBuilder &builder, const GRPCServerConfig &t) {
+    if (t.max_threads > 0 || t.memory_quota_mb > 0) {
+        grpc::ResourceQuota quota("mapper_dmi_quota");
+        if (t.max_threads > 0) quota.SetMaxThreads(t.max_threads);
+        if (t.memory_quota_mb > 0) quota.Resize((size_t)t.memory_quota_mb * 1024 * 1024);
+        builder.SetResourceQuota(quota);
+    }
+    // 轮询线程数只作用于同步服务（健康检查、反射）；DMI 服务走回调 API
+    if (t.min_pollers > 0) builder.SetSyncServerOption(grpc::ServerBuilder::MIN_POLLERS, t.min_pollers);
+    if (t.max_pollers > 0) builder.SetSyncServerOption(grpc::ServerBuilder::MAX_POLLERS, t.max_pollers);
+    if (t.max_recv_msg_size > 0) builder.SetMaxReceiveMessageSize(t.max_recv_msg_size);
+    if (t.max_send_msg_size > 0) builder.SetMaxSendMessageSize(t.max_send_msg_size);
+    if (t.keepalive_time_ms > 0) {
+        builder.AddChannelArgument(GRPC_ARG_KEEPALIVE_TIME_MS, t.keepalive_time_ms);
+        // 允许客户端按相同间隔发送 ping，避免被判定为滥用
+        builder.AddChannelArgument(GRPC_ARG_HTTP2_MIN_RECV_PING_INTERVAL_WITHOUT_DATA_MS, t.keepalive_time_ms);
+    }
+    if (t.keepalive_timeout_ms > 0) builder.AddChannelArgument(GRPC_ARG_KEEPALIVE_TIMEOUT_MS, t.keepalive_timeout_ms);
+    builder.AddChannelArgument(GRPC_ARG_KEEPALIVE_PERMIT_WITHOUT_CALLS, t.keepalive_permit_without_calls ? 1 : 0);
+    log_info("grpc tuning: max_threads=%d memory_quota_mb=%d pollers=[%d,%d] msg=[recv %d, send %d] "
+             "keepalive=%d/%d ms permit_without_calls=%d",
+             t.max_threads, t.memory_quota_mb, t.min_pollers, t.max_pollers,
+             t.max_recv_msg_size, t.max_send_msg_size,
+             t.keepalive_time_ms, t.keepalive_timeout_ms, t.keepalive_permit_without_calls);
+}
 
 
 GrpcServer::GrpcServer(const ServerConfig& cfg, std::shared_ptr<DevPanel> devPanel)
@@ -216,15 +361,24 @@ int GrpcServer::Start() {
     grpc::reflection::InitProtoReflectionServerBuilderPlugin();
 
     std::string server_address = "unix://" + cfg_.sockPath;
-    DeviceMapperServiceImpl service(devPanel_);
+    // 写入合并窗口从该设备第一条待下发的值开始计，窗口内的连续更新（如 UI 拖动滑块）只写最后一个值
+    const GRPCServerConfig &t = cfg_.tuning;
+    DesiredApplier applier(t.apply_queue > 0 ? (size_t)t.apply_queue : 64, t.apply_workers > 0 ? t.apply_workers : 2,
+                           t.write_coalesce_ms >= 0 ? t.write_coalesce_ms : 50,
+                           [](const WritePlan &plan) { return apply_write_plan(g_device_manager, plan); });
+    const std::chrono::milliseconds drain(t.apply_drain_ms >= 0 ? t.apply_drain_ms : DesiredApplier::kDefaultDrainMs);
+    applier.Start();
+    DeviceMapperServiceImpl service(devPanel_, &applier);
 
     grpc::ServerBuilder builder;
     builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
     builder.RegisterService(&service);
+    apply_server_tuning(builder, cfg_.tuning);
 
     server_ = builder.BuildAndStart();
     if (!server_) {
         log_error("failed to start grpc server");
+        applier.Stop(drain);
         return -1;
     }
     // 等待 socket 出现
@@ -239,6 +393,7 @@ int GrpcServer::Start() {
     }
     log_info("start grpc server on %s", server_address.c_str());
     server_->Wait();  // 被 Stop()->Shutdown() 唤醒
+    applier.Stop(drain);
     return 0;
 }
 
@@ -252,187 +407,139 @@ void GrpcServer::Stop() {
     log_info("gRPC server stopped");
 }
 
-// 获取直写目标（可通过环境变量覆盖）
-static void get_modbus_target(std::string &host, int &port) {
-    const char *h = std::getenv("MAPPER_MODBUS_ADDR");
-    const char *p = std::getenv("MAPPER_MODBUS_PORT");
-    host = (h && *h) ? h : "127.0.0.1";
-    port = (p && *p) ? std::atoi(p) : 1502;
-    if (port <= 0) port = 1502;
+// 兜底直写客户端：不依赖 DeviceManager，目标取 MAPPER_MODBUS_ADDR/MAPPER_MODBUS_PORT（默认 127.0.0.1:1502）
+static CustomizedClient *fallback_client() {
+    static CustomizedClient *client = []() {
+        ProtocolConfig proto = {};
+        proto.protocolName = (char*)"modbus-tcp";
+        return NewClient(&proto);
+    }();
+    return client;
 }
 
-// 简单映射：属性名 -> Modbus 寄存器偏移（按你的demo）
-static int map_offset_by_prop(const std::string &name) {
-    if (name == "threshold") return 2;    // 40002
-    if (name == "temperature") return 1;  // 40001
-    return -1;
-}
-
-// 读取超时（毫秒），默认 1000，可用 MAPPER_DEVICE_TIMEOUT_MS 覆盖
-static int get_device_timeout_ms() {
-    const char *v = std::getenv("MAPPER_DEVICE_TIMEOUT_MS");
-    if (!v || !*v) return 1000;
-    int n = std::atoi(v);
-    return n > 0 ? n : 1000;
-}
-
-// 带超时调用 device_deal_twin，超时返回 -2
-static int device_deal_twin_with_timeout(Device* device, Twin* twin, int timeout_ms) {
-    using namespace std::chrono;
-    auto fut = std::async(std::launch::async, [device, twin]() {
-        return device_deal_twin(device, twin);
-    });
-    if (fut.wait_for(milliseconds(timeout_ms)) == std::future_status::ready) {
-        return fut.get();
-    }
-    log_warn("device_deal_twin timeout after %d ms", timeout_ms);
-    return -2;
-}
-
-// 兜底直写：不依赖 DeviceManager（打印命令与返回码）
+// 兜底直写：按属性名经 Modbus TCP 驱动写入（打印目标与返回码）
 static int write_modbus_direct(const std::string &prop, const std::string &val) {
-    int offset = map_offset_by_prop(prop);
-    if (offset < 0) {
-        log_warn("Fallback skip: unknown prop %s", prop.c_str());
-        return -1;
-    }
-    std::string host; int port;
-    get_modbus_target(host, port);
-
-    int iv = std::atoi(val.c_str());
-    char cmd[512];
-    std::snprintf(cmd, sizeof(cmd),
-                  "/usr/bin/mbpoll -1 -m tcp %s -p %d -a 1 -t 4 -r %d %d",
-                  host.c_str(), port, offset, iv);
-    log_info("DirectWrite exec: %s", cmd);
-    int rc = std::system(cmd);
-    log_info("DirectWrite rc=%d (prop=%s, val=%s)", rc, prop.c_str(), val.c_str());
+    CustomizedClient *client = fallback_client();
+    if (!client) return -1;
+    VisitorConfig visitor = {};
+    visitor.propertyName = (char*)prop.c_str();
+    visitor.protocolName = client->protocolConfig.protocolName;
+    IoSlot slot;
+    iosched_acquire(client->endpoint, IO_LANE_CONTROL, &slot);
+    int rc = DeviceDataWrite(client, &visitor, "SetProperty", prop.c_str(), val.c_str());
+    iosched_release(&slot, rc == 0);
     if (rc != 0) {
-        log_error("DirectWrite failed rc=%d to %s:%d HR[%d]=%d", rc, host.c_str(), port, offset, iv);
+        log_error("DirectWrite failed to %s (prop=%s, val=%s)", client->endpoint, prop.c_str(), val.c_str());
         return -1;
     }
-    log_info("DirectWrite OK to %s:%d HR[%d]=%d (prop=%s)",
-             host.c_str(), port, offset, iv, prop.c_str());
+    log_info("DirectWrite OK to %s (prop=%s, val=%s)", client->endpoint, prop.c_str(), val.c_str());
     return 0;
 }
 
-// 新增：把云端 desired 写入本地 twin，并触发一次下发
-static int apply_desired_to_device(DeviceManager *mgr, const v1beta1::Device &dev) {
-    if (!mgr) {
-        log_warn("apply_desired_to_device: mgr is null, fallback to direct writes");
+// 直写成功后同步本地 twin，避免数据线程继续写旧值
+static void sync_local_twin(Device *local, const std::string &prop, const std::string &value) {
+    if (!local) return;
+    pthread_mutex_lock(&local->mutex);
+    Twin *tw = device_find_twin(local, prop.c_str());
+    if (tw) {
+        free(tw->observedDesired.value);
+        tw->observedDesired.value = strdup(value.c_str());
+        device_twin_set_reported(local, tw, value.c_str());
+        device_publish_twins(local);
+    }
+    pthread_mutex_unlock(&local->mutex);
+}
+
+static Device *find_local_device(DeviceManager *mgr, const WritePlan &plan) {
+    if (!mgr) return nullptr;
+    Device *local = device_manager_get(mgr, plan.name.c_str());
+    if (!local && !plan.ns.empty()) {
+        local = device_manager_get(mgr, plan.key().c_str());
+    }
+    return local;
+}
+
+// 执行一个下发计划：持锁写入 desired 并生成写入副本，锁外经驱动下发，再持锁回填并统一发布快照；
+// 失败的属性再走直写兜底
+static int apply_write_plan(DeviceManager *mgr, const WritePlan &plan) {
+    EpochReadGuard guard;   // 设备与写入副本引用的 spec 名称在整个计划期间有效
+    Device *local = find_local_device(mgr, plan);
+
+    if (plan.forceDirect) {
         int ok = 0;
-        if (dev.has_spec()) {
-            const auto &spec = dev.spec();
-            for (int i = 0; i < spec.properties_size(); ++i) {
-                const auto &p = spec.properties(i);
-                if (!p.has_desired()) continue;
-                const std::string propName = p.name();
-                const std::string desired = p.desired().value();
-                if (desired.empty()) continue;
-                ok += (write_modbus_direct(propName, desired) == 0);
+        for (const auto &item : plan.items) {
+            int wrc = write_modbus_direct(item.property, item.value);
+            log_info("Force DirectWrite prop=%s val=%s rc=%d", item.property.c_str(), item.value.c_str(), wrc);
+            if (wrc == 0) {
+                ok++;
+                sync_local_twin(local, item.property, item.value);
             }
         }
-        return ok > 0 ? 0 : -1;
-    }
-
-    const std::string ns = dev.namespace_();
-    const std::string devName = dev.name();
-    if (devName.empty()) {
-        log_warn("UpdateDevice: empty device name");
-        return -1;
+        if (ok > 0) return 0;
+        // 强制直写失败则继续尝试正常路径
     }
 
-    Device *local = device_manager_get(mgr, devName.c_str());
-    if (!local && !ns.empty()) {
-        std::string key = ns + "/" + devName;
-        local = device_manager_get(mgr, key.c_str());
-    }
     if (!local) {
-        log_warn("UpdateDevice: device %s (ns=%s) not found locally, use fallback", devName.c_str(), ns.c_str());
+        log_warn("UpdateDevice: device %s not found locally, use fallback", plan.key().c_str());
         int ok = 0;
-        if (dev.has_spec()) {
-            const auto &spec = dev.spec();
-            for (int i = 0; i < spec.properties_size(); ++i) {
-                const auto &p = spec.properties(i);
-                if (!p.has_desired()) continue;
-                const std::string propName = p.name();
-                const std::string desired = p.desired().value();
-                if (desired.empty()) continue;
-                ok += (write_modbus_direct(propName, desired) == 0);
-            }
+        for (const auto &item : plan.items) {
+            ok += (write_modbus_direct(item.property, item.value) == 0);
         }
         return ok > 0 ? 0 : -1;
     }
 
+    std::vector<const WritePlanItem*> failed;
+    std::vector<const WritePlanItem*> writeItems;
+    std::vector<DeviceTwinWrite> writes;
+    int updated = 0;
+    pthread_mutex_lock(&local->mutex);
     const int twinsCount = local->instance.twinsCount;
-    const int cloudProps = dev.has_spec() ? dev.spec().properties_size() : 0;
-    log_info("UpdateDevice target %s/%s: localTwins=%d cloudProps=%d",
-             ns.c_str(), devName.c_str(), twinsCount, cloudProps);
-
-    for (int t = 0; t < twinsCount; ++t) {
-        Twin *tw = &local->instance.twins[t];
-        log_info("LocalTwin[%d] name=%s desired=%s reported=%s",
-                 t,
-                 tw && tw->propertyName ? tw->propertyName : "(null)",
-                 tw && tw->observedDesired.value ? tw->observedDesired.value : "(nil)",
-                 tw && tw->reported.value ? tw->reported.value : "(nil)");
-    }
-
-    int updated = 0, fallback_ok = 0;
-    if (dev.has_spec()) {
-        const auto &spec = dev.spec();
-        for (int i = 0; i < spec.properties_size(); ++i) {
-            const auto &p = spec.properties(i);
-            const std::string propName = p.name();
-            const bool hasDesired = p.has_desired();
-            const std::string desired = hasDesired ? p.desired().value() : std::string();
-            log_info("CloudProp[%d] name=%s hasDesired=%d desired=%s",
-                     i, propName.c_str(), hasDesired, desired.c_str());
-            if (!hasDesired || desired.empty()) continue;
-
-            // 名称匹配
-            int matchIdx = -1;
-            for (int t = 0; t < twinsCount; ++t) {
-                Twin *tw = &local->instance.twins[t];
-                if (tw && tw->propertyName && propName == tw->propertyName) {
-                    matchIdx = t; break;
-                }
-            }
-            // 索引兜底
-            if (matchIdx < 0 && i < twinsCount) {
-                log_warn("No twin matched by name '%s', fallback to index %d", propName.c_str(), i);
-                matchIdx = i;
-            }
-
-            if (matchIdx >= 0) {
-                Twin *tw = &local->instance.twins[matchIdx];
-                free(tw->observedDesired.value);
-                tw->observedDesired.value = strdup(desired.c_str());
-                log_info("Apply desired -> twin[%d](%s) = %s",
-                         matchIdx,
-                         tw->propertyName ? tw->propertyName : "(null)",
-                         desired.c_str());
-
-                int timeout_ms = get_device_timeout_ms();
-                int drc = device_deal_twin_with_timeout(local, tw, timeout_ms);
-                log_info("device_deal_twin rc=%d for prop=%s", drc, propName.c_str());
-                if (drc == 0) {
-                    updated++;
-                } else {
-                    int wrc = write_modbus_direct(propName, desired);
-                    log_info("Fallback DirectWrite after device_deal_twin rc=%d: prop=%s val=%s rc=%d",
-                             drc, propName.c_str(), desired.c_str(), wrc);
-                    if (wrc == 0) fallback_ok++;
-                }
-            } else {
-                // 最后兜底：直写
-                int wrc = write_modbus_direct(propName, desired);
-                log_info("Fallback DirectWrite (no twin matched): prop=%s val=%s rc=%d",
-                         propName.c_str(), desired.c_str(), wrc);
-                if (wrc == 0) fallback_ok++;
-            }
+    for (const auto &item : plan.items) {
+        // 名称匹配（按设备的 twin 索引查找），匹配不到按下标兜底
+        int matchIdx = device_twin_index_lookup(local, item.property.c_str());
+        if (matchIdx < 0 && item.index < twinsCount) {
+            log_warn("No twin matched by name '%s', fallback to index %d", item.property.c_str(), item.index);
+            matchIdx = item.index;
+        }
+        if (matchIdx < 0) {
+            failed.push_back(&item);
+            continue;
+        }
+        Twin *tw = &local->instance.twins[matchIdx];
+        free(tw->observedDesired.value);
+        tw->observedDesired.value = strdup(item.value.c_str());
+        DeviceTwinWrite w;
+        if (device_twin_write_prepare(local, tw, &w) == 1) {
+            w.lane = IO_LANE_CONTROL;   // 下发优先于采集
+            writeItems.push_back(&item);
+            writes.push_back(w);
+        } else {
+            updated++;   // 已一致，或已有写入进行中（新 desired 由采集线程下一轮写入）
         }
     }
+    pthread_mutex_unlock(&local->mutex);
+
+    // 整批交给驱动，Modbus 驱动把地址相邻的寄存器合并为一次多寄存器写
+    device_twin_write_execute_batch(writes.data(), (int)writes.size());
+
+    pthread_mutex_lock(&local->mutex);
+    for (size_t i = 0; i < writes.size(); i++) {
+        int drc = device_twin_write_commit(local, &writes[i]);
+        log_info("Apply desired -> twin(%s) = %s rc=%d", writeItems[i]->property.c_str(),
+                 writeItems[i]->value.c_str(), drc);
+        if (drc == 0) updated++;
+        else failed.push_back(writeItems[i]);
+    }
+    device_publish_twins(local);
+    pthread_mutex_unlock(&local->mutex);
+
+    // 直写兜底在设备锁外执行
+    int fallback_ok = 0;
+    for (const WritePlanItem *item : failed) {
+        int wrc = write_modbus_direct(item->property, item->value);
+        log_info("Fallback DirectWrite prop=%s val=%s rc=%d", item->property.c_str(), item->value.c_str(), wrc);
+        if (wrc == 0) fallback_ok++;
+    }
     return (updated > 0 || fallback_ok > 0) ? 0 : -1;
 }
 
@@ -452,6 +559,11 @@ ServerConfig *server_config_new(const char *sock_path, const char *protocol) {
     }
 }
 
+void server_config_set_tuning(ServerConfig *config, const GRPCServerConfig *tuning) {
+    if (!config || !tuning) return;
+    config->tuning = *tuning;
+}
+
 void server_config_free(ServerConfig *config) {
     if (config) {
         delete config;
@@ -1,6 +1,8 @@
 #ifndef GRPC_SERVER_H
 #define GRPC_SERVER_H
 
+#include "config/config.h"
+
 #ifdef __cplusplus
 // C++ 部分
 #include <string>
@@ -13,6 +15,7 @@ class DevPanel;
 struct ServerConfig {
     std::string sockPath;
     std::string protocol;
+    GRPCServerConfig tuning;    // 线程/内存/消息大小/keepalive，来自 config.yaml grpc_server
     ServerConfig(const std::string& sock_path, const std::string& protocol);
 };
 
@@ -36,6 +39,8 @@ typedef struct GrpcServer GrpcServer;
 
 // C 接口函数
 ServerConfig *server_config_new(const char *sock_path, const char *protocol);
+// 复制 grpc_server 段的调优参数，需在 grpcserver_new 之前调用
+void server_config_set_tuning(ServerConfig *config, const GRPCServerConfig *tuning);
 void server_config_free(ServerConfig *config);
 
 GrpcServer *grpcserver_new(ServerConfig *config, DeviceManager *device_manager);
@@ -3,12 +3,23 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <limits.h>
 #include <cjson/cJSON.h>
 #include "util/parse/grpc.h"
 #include "common/datamodel.h"
 #include "common/datamethod.h"
 #include "device/device.h"
 #include "device/dev_panel.h"
+#include "httpserver/router.h"
+#include "device/twinwatch.h"
+#include "device/twinhistory.h"
+#include "device/iosched.h"
+#include "common/epoch.h"
+#include "data/dbmethod/mysql/recorder.h"
+#include "data/dbmethod/redis/redis_client.h"
+#ifdef TAOS_FOUND
+#include "data/dbmethod/tdengine/tdengine_client.h"
+#endif
 #include "log/log.h"
 
 // 路由常量
@@ -16,12 +27,19 @@
 #define API_BASE "/api/" API_VERSION
 #define API_PING API_BASE "/ping"
 #define API_DEVICE API_BASE "/device"
+#define API_DEVICES API_BASE "/devices"
 #define API_DEVICE_METHOD API_BASE "/devicemethod"
 #define API_META API_BASE "/meta"
 #define API_DATABASE API_BASE "/database"
+#define API_WATCH API_BASE "/watch"
+#define API_HISTORY API_BASE "/history"
+#define API_METRICS API_BASE "/metrics"
 #define CONTENT_TYPE "Content-Type"
 #define CONTENT_TYPE_JSON "application/json"
 #define CORRELATION_HEADER "X-Correlation-ID"
+#define MAX_REQUEST_BODY (64 * 1024)
+#define SSE_HEARTBEAT_SEC 15
+#define SSE_QUEUE_SIZE 1024
 
 // 工具函数：获取当前时间字符串
 static void get_time_str(char *buf, size_t buflen) {
@@ -40,26 +58,64 @@ static int send_json_response(struct MHD_Connection *connection, cJSON *resp, in
     return ret;
 }
 
-// Ping
-static int handle_ping(struct MHD_Connection *connection) {
+// 工具函数：错误响应
+static int send_error_response(struct MHD_Connection *connection, int status_code, const char *message) {
     cJSON *resp = cJSON_CreateObject();
     char timebuf[64];
     get_time_str(timebuf, sizeof(timebuf));
     cJSON_AddStringToObject(resp, "apiVersion", API_VERSION);
-    cJSON_AddNumberToObject(resp, "statusCode", 200);
+    cJSON_AddNumberToObject(resp, "statusCode", status_code);
     cJSON_AddStringToObject(resp, "timeStamp", timebuf);
-    cJSON_AddStringToObject(resp, "message", "This is v1 API, the server is running normally.");
-    int ret = send_json_response(connection, resp, MHD_HTTP_OK);
+    cJSON_AddStringToObject(resp, "message", message);
+    int ret = send_json_response(connection, resp, status_code);
     cJSON_Delete(resp);
     return ret;
 }
 
+// 工具函数：按实际长度拼接 namespace.name，调用者 free
+static char *make_resource_id(const char *ns, const char *name) {
+    size_t n = strlen(ns) + strlen(name) + 2;
+    char *id = malloc(n);
+    if (id) get_resource_id(ns, name, id, n);
+    return id;
+}
+
+// Ping：响应体只随秒级时间戳变化，每秒至多重建一次，其余请求复用同一 MHD_Response
+static int handle_ping(RestServer *server, struct MHD_Connection *connection) {
+    time_t now = time(NULL);
+    pthread_mutex_lock(&server->pingMutex);
+    if (!server->pingResponse || server->pingTime != now) {
+        char timebuf[64];
+        char body[256];
+        get_time_str(timebuf, sizeof(timebuf));
+        int n = snprintf(body, sizeof(body),
+                         "{\"apiVersion\":\"%s\",\"statusCode\":200,\"timeStamp\":\"%s\","
+                         "\"message\":\"This is v1 API, the server is running normally.\"}",
+                         API_VERSION, timebuf);
+        struct MHD_Response *response =
+            MHD_create_response_from_buffer((size_t)n, body, MHD_RESPMEM_MUST_COPY);
+        if (response) {
+            MHD_add_response_header(response, CONTENT_TYPE, CONTENT_TYPE_JSON);
+            // 已入队的连接持有自己的引用，这里只释放缓存的引用
+            if (server->pingResponse) MHD_destroy_response(server->pingResponse);
+            server->pingResponse = response;
+            server->pingTime = now;
+        }
+    }
+    int ret = server->pingResponse
+            ? MHD_queue_response(connection, MHD_HTTP_OK, server->pingResponse)
+            : MHD_NO;
+    pthread_mutex_unlock(&server->pingMutex);
+    return ret;
+}
+
 // DeviceRead
 static int handle_device_read(RestServer *server, struct MHD_Connection *connection, const char *namespace, const char *name, const char *property) {
-    char deviceID[256];
-    get_resource_id(namespace, name, deviceID, sizeof(deviceID));
+    char *deviceID = make_resource_id(namespace, name);
+    if (!deviceID) return MHD_NO;
     char *value = NULL, *datatype = NULL;
     int err = dev_panel_get_twin_result(server->dev_panel, deviceID, property, &value, &datatype);
+    free(deviceID);
     if (err != 0) {
         cJSON *resp = cJSON_CreateObject();
         char timebuf[64];
@@ -96,16 +152,349 @@ static int handle_device_read(RestServer *server, struct MHD_Connection *connect
     return ret;
 }
 
+// 批量读取：逐设备序列化到小缓冲，经 chunked 响应流式输出，不构造完整文档
+#define BULK_READ_BLOCK_SIZE (32 * 1024)
+
+typedef struct {
+    RestServer *server;
+    char **deviceNames;         // 请求开始时匹配到的设备名
+    char **deviceNamespaces;    // 与 deviceNames 一一对应，不同 namespace 下可能同名
+    int deviceCount;
+    int next;                   // 下一个待输出的设备
+    char *pattern;              // 属性名通配，NULL 表示全部
+    TwinJsonBuf buf;            // 待发送数据
+    size_t off;                 // buf 中已发送的偏移
+    int stage;                  // 0 未输出头部，1 输出设备，2 已结束
+    int first;
+} BulkReadCtx;
+
+static void bulk_read_free(void *cls) {
+    BulkReadCtx *ctx = (BulkReadCtx*)cls;
+    if (!ctx) return;
+    for (int i = 0; i < ctx->deviceCount; i++) {
+        free(ctx->deviceNames[i]);
+        free(ctx->deviceNamespaces[i]);
+    }
+    free(ctx->deviceNames);
+    free(ctx->deviceNamespaces);
+    free(ctx->pattern);
+    twin_json_buf_free(&ctx->buf);
+    free(ctx);
+}
+
+// 填充下一段待发送数据；无更多数据返回 0，出错返回 -1
+static int bulk_read_fill(BulkReadCtx *ctx) {
+    ctx->buf.len = 0;
+    ctx->off = 0;
+    if (ctx->stage == 0) {
+        char head[160];
+        char timebuf[64];
+        get_time_str(timebuf, sizeof(timebuf));
+        int n = snprintf(head, sizeof(head),
+                         "{\"apiVersion\":\"%s\",\"statusCode\":200,\"timeStamp\":\"%s\",\"data\":[",
+                         API_VERSION, timebuf);
+        ctx->stage = 1;
+        return twin_json_buf_append(&ctx->buf, head, (size_t)n) == 0 ? 1 : -1;
+    }
+    while (ctx->stage == 1 && ctx->next < ctx->deviceCount) {
+        // 按 namespace + 名称重新查找，期间被移除的设备直接跳过
+        epoch_read_enter();
+        Device *device = device_manager_find(ctx->server->dev_panel, ctx->deviceNamespaces[ctx->next],
+                                             ctx->deviceNames[ctx->next]);
+        ctx->next++;
+        int n = device ? dev_panel_append_twins_json(device, ctx->pattern, &ctx->first, &ctx->buf) : 0;
+        epoch_read_exit();
+        if (n < 0) return -1;
+        if (n > 0) return 1;
+    }
+    if (ctx->stage == 1) {
+        ctx->stage = 2;
+        return twin_json_buf_append(&ctx->buf, "]}", 2) == 0 ? 1 : -1;
+    }
+    return 0;
+}
+
+static ssize_t bulk_read_reader(void *cls, uint64_t pos, char *out, size_t max) {
+    BulkReadCtx *ctx = (BulkReadCtx*)cls;
+    size_t written = 0;
+    while (written < max) {
+        if (ctx->off >= ctx->buf.len) {
+            int rc = bulk_read_fill(ctx);
+            if (rc < 0) return MHD_CONTENT_READER_END_WITH_ERROR;
+            if (rc == 0) break;
+            continue;
+        }
+        size_t n = ctx->buf.len - ctx->off;
+        if (n > max - written) n = max - written;
+        memcpy(out + written, ctx->buf.data + ctx->off, n);
+        ctx->off += n;
+        written += n;
+    }
+    if (written == 0) return MHD_CONTENT_READER_END_OF_STREAM;
+    return (ssize_t)written;
+}
+
+// devices 参数为逗号分隔的设备名，也接受 namespace.name 形式
+static int bulk_device_selected(const Device *device, char **names, int count) {
+    if (count == 0) return 1;
+    const char *name = device->instance.name;
+    const char *ns = device->instance.namespace_ ? device->instance.namespace_ : "default";
+    size_t nsLen = strlen(ns);
+    for (int i = 0; i < count; i++) {
+        const char *want = names[i];
+        if (strcmp(want, name) == 0) return 1;
+        if (strncmp(want, ns, nsLen) == 0 && want[nsLen] == '.' &&
+            strcmp(want + nsLen + 1, name) == 0) return 1;
+    }
+    return 0;
+}
+
+// GET /api/v1/devices?namespace=&devices=a,b&property=glob
+static int handle_devices_bulk_read(RestServer *server, struct MHD_Connection *connection) {
+    const char *ns = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "namespace");
+    const char *devices = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "devices");
+    const char *property = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "property");
+
+    BulkReadCtx *ctx = calloc(1, sizeof(BulkReadCtx));
+    if (!ctx) return MHD_NO;
+    ctx->server = server;
+    ctx->first = 1;
+    if (property && *property && strcmp(property, "*") != 0) ctx->pattern = strdup(property);
+
+    // 拆分设备名列表
+    char *list = (devices && *devices) ? strdup(devices) : NULL;
+    char **wanted = NULL;
+    int wantedCount = 0;
+    if (list) {
+        int cap = 1;
+        for (const char *p = list; *p; p++) if (*p == ',') cap++;
+        wanted = calloc((size_t)cap, sizeof(char*));
+        char *save = NULL;
+        for (char *tok = strtok_r(list, ",", &save); tok && wanted; tok = strtok_r(NULL, ",", &save)) {
+            if (*tok) wanted[wantedCount++] = tok;
+        }
+    }
+
+    // 只在此处短暂持有 managerMutex 收集设备名，输出阶段不再持锁
+    DeviceManager *manager = server->dev_panel;
+    pthread_mutex_lock(&manager->managerMutex);
+    size_t slots = manager->deviceCount > 0 ? (size_t)manager->deviceCount : 1;
+    ctx->deviceNames = calloc(slots, sizeof(char*));
+    ctx->deviceNamespaces = calloc(slots, sizeof(char*));
+    for (int i = 0; ctx->deviceNames && ctx->deviceNamespaces && i < manager->deviceCount; i++) {
+        Device *device = manager->devices[i];
+        if (!device || !device->instance.name) continue;
+        const char *devNs = device->instance.namespace_ ? device->instance.namespace_ : "default";
+        if (ns && *ns && strcmp(ns, devNs) != 0) continue;
+        if (!bulk_device_selected(device, wanted, wantedCount)) continue;
+        char *name = strdup(device->instance.name);
+        char *nsDup = strdup(devNs);
+        if (!name || !nsDup) {
+            free(name);
+            free(nsDup);
+            continue;
+        }
+        ctx->deviceNames[ctx->deviceCount] = name;
+        ctx->deviceNamespaces[ctx->deviceCount++] = nsDup;
+    }
+    pthread_mutex_unlock(&manager->managerMutex);
+    free(wanted);
+    free(list);
+
+    struct MHD_Response *response = MHD_create_response_from_callback(
+        MHD_SIZE_UNKNOWN, BULK_READ_BLOCK_SIZE, &bulk_read_reader, ctx, &bulk_read_free);
+    if (!response) {
+        bulk_read_free(ctx);
+        return MHD_NO;
+    }
+    MHD_add_response_header(response, CONTENT_TYPE, CONTENT_TYPE_JSON);
+    int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+    MHD_destroy_response(response);
+    return ret;
+}
+
+// 孪生变化订阅（SSE）：无数据时挂起连接，twinwatch 有新变化时恢复
+typedef struct {
+    RestServer *server;
+    struct MHD_Connection *connection;
+    TwinWatcher *watcher;
+    pthread_mutex_t mutex;      // 串行化挂起与恢复，避免丢失唤醒
+    int suspended;
+    int started;
+    time_t lastWrite;
+    TwinJsonBuf buf;
+    size_t off;
+} SseStream;
+
+static void sse_notify(void *arg) {
+    SseStream *stream = (SseStream*)arg;
+    pthread_mutex_lock(&stream->mutex);
+    if (stream->suspended) {
+        stream->suspended = 0;
+        MHD_resume_connection(stream->connection);
+    }
+    pthread_mutex_unlock(&stream->mutex);
+}
+
+static void sse_stream_free(void *cls) {
+    SseStream *stream = (SseStream*)cls;
+    if (!stream) return;
+    // 退订返回后不会再有 sse_notify 回调
+    twinwatch_unsubscribe(stream->watcher);
+    twin_json_buf_free(&stream->buf);
+    pthread_mutex_destroy(&stream->mutex);
+    free(stream);
+}
+
+static int sse_append_change(TwinJsonBuf *buf, const TwinChange *c) {
+    cJSON *data = cJSON_CreateObject();
+    cJSON_AddStringToObject(data, "deviceName", c->deviceName ? c->deviceName : "");
+    cJSON_AddStringToObject(data, "deviceNamespace", c->deviceNamespace ? c->deviceNamespace : "");
+    cJSON_AddStringToObject(data, "propertyName", c->propertyName ? c->propertyName : "");
+    cJSON_AddStringToObject(data, "value", c->value ? c->value : "");
+    cJSON_AddStringToObject(data, "timeStamp", c->timestamp ? c->timestamp : "");
+    char *json = cJSON_PrintUnformatted(data);
+    cJSON_Delete(data);
+    if (!json) return -1;
+    char head[64];
+    int n = snprintf(head, sizeof(head), "id: %llu\nevent: twin\ndata: ", c->seq);
+    int rc = (twin_json_buf_append(buf, head, (size_t)n) == 0 &&
+              twin_json_buf_append(buf, json, strlen(json)) == 0 &&
+              twin_json_buf_append(buf, "\n\n", 2) == 0) ? 0 : -1;
+    free(json);
+    return rc;
+}
+
+// 填充下一段事件，调用方持有 stream->mutex；无数据返回 0
+static int sse_fill(SseStream *stream) {
+    stream->buf.len = 0;
+    stream->off = 0;
+    if (!stream->started) {
+        stream->started = 1;
+        static const char hello[] = "retry: 3000\n: connected\n\n";
+        return twin_json_buf_append(&stream->buf, hello, sizeof(hello) - 1) == 0 ? 1 : -1;
+    }
+    // 每次最多合并 64 条，避免单个连接长时间占用工作线程
+    for (int i = 0; i < 64; i++) {
+        TwinChange c = {0};
+        unsigned long long dropped = 0;
+        int got = twinwatch_pop(stream->watcher, &c, &dropped);
+        if (dropped > 0) {
+            char ev[96];
+            int n = snprintf(ev, sizeof(ev), "event: overflow\ndata: {\"dropped\":%llu}\n\n", dropped);
+            if (twin_json_buf_append(&stream->buf, ev, (size_t)n) != 0) {
+                twinwatch_change_clear(&c);
+                return -1;
+            }
+        }
+        if (!got) break;
+        int rc = sse_append_change(&stream->buf, &c);
+        twinwatch_change_clear(&c);
+        if (rc != 0) return -1;
+    }
+    if (stream->buf.len > 0) return 1;
+    if (time(NULL) - stream->lastWrite >= SSE_HEARTBEAT_SEC) {
+        static const char ping[] = ": keepalive\n\n";
+        return twin_json_buf_append(&stream->buf, ping, sizeof(ping) - 1) == 0 ? 1 : -1;
+    }
+    return 0;
+}
+
+static ssize_t sse_reader(void *cls, uint64_t pos, char *out, size_t max) {
+    SseStream *stream = (SseStream*)cls;
+    pthread_mutex_lock(&stream->mutex);
+    // 在锁内检查：rest_server_stop 置位后的唤醒不会被错过
+    if (__atomic_load_n(&stream->server->stopping, __ATOMIC_ACQUIRE)) {
+        pthread_mutex_unlock(&stream->mutex);
+        return MHD_CONTENT_READER_END_OF_STREAM;
+    }
+    size_t written = 0;
+    while (written < max) {
+        if (stream->off >= stream->buf.len) {
+            int rc = sse_fill(stream);
+            if (rc < 0) {
+                pthread_mutex_unlock(&stream->mutex);
+                return MHD_CONTENT_READER_END_WITH_ERROR;
+            }
+            if (rc == 0) break;
+            continue;
+        }
+        size_t n = stream->buf.len - stream->off;
+        if (n > max - written) n = max - written;
+        memcpy(out + written, stream->buf.data + stream->off, n);
+        stream->off += n;
+        written += n;
+    }
+    if (written > 0) {
+        stream->lastWrite = time(NULL);
+    } else {
+        // 队列已空：持锁挂起，之后的 sse_notify 一定能看到 suspended 并恢复
+        stream->suspended = 1;
+        MHD_suspend_connection(stream->connection);
+    }
+    pthread_mutex_unlock(&stream->mutex);
+    return (ssize_t)written;
+}
+
+// GET /api/v1/watch?namespace=&devices=a,b&property=glob
+static int handle_watch(RestServer *server, struct MHD_Connection *connection) {
+    const char *ns = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "namespace");
+    const char *devices = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "devices");
+    const char *property = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "property");
+
+    SseStream *stream = calloc(1, sizeof(SseStream));
+    if (!stream) return MHD_NO;
+    stream->server = server;
+    stream->connection = connection;
+    stream->lastWrite = time(NULL);
+    pthread_mutex_init(&stream->mutex, NULL);
+    stream->watcher = twinwatch_subscribe(ns, devices, property, SSE_QUEUE_SIZE, sse_notify, stream);
+    if (!stream->watcher) {
+        sse_stream_free(stream);
+        return send_error_response(connection, MHD_HTTP_SERVICE_UNAVAILABLE, "Failed to subscribe twin changes");
+    }
+
+    struct MHD_Response *response = MHD_create_response_from_callback(
+        MHD_SIZE_UNKNOWN, 4096, &sse_reader, stream, &sse_stream_free);
+    if (!response) {
+        sse_stream_free(stream);
+        return MHD_NO;
+    }
+    MHD_add_response_header(response, CONTENT_TYPE, "text/event-stream");
+    MHD_add_response_header(response, "Cache-Control", "no-cache");
+    int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+    MHD_destroy_response(response);
+    return ret;
+}
+
+// 心跳线程：定期唤醒所有挂起的订阅连接，由 sse_reader 决定是否发送 keepalive
+static void *sse_heartbeat_thread(void *arg) {
+    RestServer *server = (RestServer*)arg;
+    pthread_mutex_lock(&server->heartbeatMutex);
+    while (!server->stopping) {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += SSE_HEARTBEAT_SEC;
+        pthread_cond_timedwait(&server->heartbeatCond, &server->heartbeatMutex, &ts);
+        if (server->stopping) break;
+        pthread_mutex_unlock(&server->heartbeatMutex);
+        twinwatch_kick_all();
+        pthread_mutex_lock(&server->heartbeatMutex);
+    }
+    pthread_mutex_unlock(&server->heartbeatMutex);
+    return NULL;
+}
+
 // DeviceWrite
 static int handle_device_write(RestServer *server, struct MHD_Connection *connection, const char *namespace, const char *name, const char *method, const char *property, const char *data) {
-    char deviceID[256];
-    get_resource_id(namespace, name, deviceID, sizeof(deviceID));
+    char *deviceID = make_resource_id(namespace, name);
+    if (!deviceID) return MHD_NO;
     int err = dev_panel_write_device(server->dev_panel, method, deviceID, property, data);
     cJSON *resp = cJSON_CreateObject();
     char timebuf[64];
     get_time_str(timebuf, sizeof(timebuf));
     cJSON_AddStringToObject(resp, "apiVersion", API_VERSION);
-    cJSON_AddNumberToObject(resp, "statusCode", err == 0 ? 200 : 500);
+    cJSON_AddNumberToObject(resp, "statusCode", err == 0 ? 200 : err == DEV_PANEL_ENOMETHOD ? 404 : 500);
     cJSON_AddStringToObject(resp, "timeStamp", timebuf);
     if (err == 0) {
         char msg[512];
@@ -113,6 +502,15 @@ static int handle_device_write(RestServer *server, struct MHD_Connection *connec
         cJSON_AddStringToObject(resp, "message", msg);
         int ret = send_json_response(connection, resp, MHD_HTTP_OK);
         cJSON_Delete(resp);
+        free(deviceID);
+        return ret;
+    } else if (err == DEV_PANEL_ENOMETHOD) {
+        char msg[512];
+        snprintf(msg, sizeof(msg), "Device %s has no method %s for property %s", deviceID, method, property);
+        cJSON_AddStringToObject(resp, "message", msg);
+        int ret = send_json_response(connection, resp, MHD_HTTP_NOT_FOUND);
+        cJSON_Delete(resp);
+        free(deviceID);
         return ret;
     } else {
         char msg[512];
@@ -120,19 +518,21 @@ static int handle_device_write(RestServer *server, struct MHD_Connection *connec
         cJSON_AddStringToObject(resp, "message", msg);
         int ret = send_json_response(connection, resp, MHD_HTTP_INTERNAL_SERVER_ERROR);
         cJSON_Delete(resp);
+        free(deviceID);
         return ret;
     }
 }
 
 // GetDeviceMethod
 static int handle_get_device_method(RestServer *server, struct MHD_Connection *connection, const char *namespace, const char *name) {
-    char deviceID[256];
-    get_resource_id(namespace, name, deviceID, sizeof(deviceID));
+    char *deviceID = make_resource_id(namespace, name);
+    if (!deviceID) return MHD_NO;
     char **method_map = NULL;
     int method_count = 0;
     char **property_map = NULL;
     int property_count = 0;
     int err = dev_panel_get_device_method(server->dev_panel, deviceID, &method_map, &method_count, &property_map, &property_count);
+    free(deviceID);
     if (err != 0) {
         char msg[512];
         snprintf(msg, sizeof(msg), "Get device method error: %d", err);
@@ -158,8 +558,8 @@ for (int i = 0; i < method_count; ++i) {
         cJSON_AddStringToObject(method, "name", method_map[i]);
         
         // 路径格式
-        char path[256];
-        snprintf(path, sizeof(path), API_DEVICE_METHOD "/%s/%s/%s/{propertyName}/{data}", 
+        char path[512];
+        snprintf(path, sizeof(path), API_DEVICE_METHOD "/%s/%s/%s/{propertyName}",
                  namespace, name, method_map[i]);
         cJSON_AddStringToObject(method, "path", path);
         
@@ -197,10 +597,11 @@ for (int i = 0; i < method_count; ++i) {
 
 // MetaGetModel
 static int handle_meta_get_model(RestServer *server, struct MHD_Connection *connection, const char *namespace, const char *name) {
-    char deviceID[256];
-    get_resource_id(namespace, name, deviceID, sizeof(deviceID));
+    char *deviceID = make_resource_id(namespace, name);
+    if (!deviceID) return MHD_NO;
     DeviceInstance instance = {0};
     int err = dev_panel_get_device(server->dev_panel, deviceID, &instance);
+    free(deviceID);
     if (err != 0) {
         char msg[512];
         snprintf(msg, sizeof(msg), "Get device error: %d", err);
@@ -209,10 +610,12 @@ static int handle_meta_get_model(RestServer *server, struct MHD_Connection *conn
         MHD_destroy_response(response);
         return ret;
     }
-    char modelID[256];
-    get_resource_id(instance.namespace_, instance.model, modelID, sizeof(modelID));
+    char *modelID = make_resource_id(instance.namespace_ ? instance.namespace_ : "default",
+                                     instance.model ? instance.model : "");
+    if (!modelID) return MHD_NO;
     DeviceModel model = {0};
     err = dev_panel_get_model(server->dev_panel, modelID, &model);
+    free(modelID);
     if (err != 0) {
         char msg[512];
         snprintf(msg, sizeof(msg), "Get device model error: %d", err);
@@ -239,74 +642,676 @@ static int handle_meta_get_model(RestServer *server, struct MHD_Connection *conn
     return ret;
 }
 
-// DataBaseGetDataByID（仅返回空）
-static int handle_database_get_data(RestServer *server, struct MHD_Connection *connection) {
+// 历史数据查询：经数据库游标逐批读取、逐批序列化后流式输出，内存占用与总行数无关
+#define DB_QUERY_DEFAULT_LIMIT 10000
+#define DB_QUERY_MAX_LIMIT 1000000
+#define DB_QUERY_DEFAULT_RANGE 3600
+
+typedef struct {
+    // 本次查询独占的连接，按 backend 只有一个非空
+    MySQLDataBaseConfig *db;
+    RedisDataBaseConfig *redis;
+#ifdef TAOS_FOUND
+    TDEngineDataBaseConfig *tdengine;
+#endif
+    DbCursor *cursor;
+    int filterProperty;         // 后端按设备存储（Redis/TDengine），需按 propertyName 过滤行
+    int rowSeconds;             // 行时间戳为秒（Redis 分值即写入时的秒级 timeStamp）
+    char table[400];
+    char *ns;
+    char *name;
+    char *property;
+    long long start;            // [start, end)，秒
+    long long end;
+    long long limit;            // 最多输出条数
+    long long emitted;
+    long long step;             // 降采样桶宽（秒），0 表示原始数据
+
+    // 当前降采样桶：数值取平均，非数值取最后一个值
+    int bucketOpen;
+    long long bucketStart;
+    long long bucketCount;
+    double bucketSum;
+    int bucketNumeric;
+    char *bucketLast;
+
+    TwinJsonBuf buf;
+    size_t off;
+    int stage;                  // 0 未输出头部，1 输出数据，2 已结束
+    int exhausted;
+} DbQueryCtx;
+
+static void db_query_free(void *cls) {
+    DbQueryCtx *ctx = (DbQueryCtx*)cls;
+    if (!ctx) return;
+    // 先关闭游标再断开连接
+    db_cursor_close(ctx->cursor);
+    FreeMySQLDataBaseClient(ctx->db);
+    if (ctx->redis) {
+        redis_close_client(ctx->redis);
+        free(ctx->redis->config.addr);
+        free(ctx->redis->config.password);
+        free(ctx->redis);
+    }
+#ifdef TAOS_FOUND
+    if (ctx->tdengine) {
+        tdengine_close_client(ctx->tdengine);
+        free(ctx->tdengine->config.addr);
+        free(ctx->tdengine->config.dbName);
+        free(ctx->tdengine->config.username);
+        free(ctx->tdengine->config.password);
+        free(ctx->tdengine);
+    }
+#endif
+    free(ctx->ns);
+    free(ctx->name);
+    free(ctx->property);
+    free(ctx->bucketLast);
+    twin_json_buf_free(&ctx->buf);
+    free(ctx);
+}
+
+static int db_query_emit(DbQueryCtx *ctx, long long ts, const char *value, long long count) {
+    char head[64];
+    int n = snprintf(head, sizeof(head), "%s{\"timeStamp\":%lld,\"value\":",
+                     ctx->emitted > 0 ? "," : "", ts);
+    if (twin_json_buf_append(&ctx->buf, head, (size_t)n) != 0 ||
+        twin_json_buf_append_str(&ctx->buf, value) != 0) return -1;
+    if (count > 0) {
+        n = snprintf(head, sizeof(head), ",\"count\":%lld", count);
+        if (twin_json_buf_append(&ctx->buf, head, (size_t)n) != 0) return -1;
+    }
+    ctx->emitted++;
+    return twin_json_buf_append(&ctx->buf, "}", 1);
+}
+
+static int db_query_flush_bucket(DbQueryCtx *ctx) {
+    if (!ctx->bucketOpen) return 0;
+    ctx->bucketOpen = 0;
+    if (ctx->bucketNumeric) {
+        char avg[64];
+        snprintf(avg, sizeof(avg), "%.10g", ctx->bucketSum / (double)ctx->bucketCount);
+        return db_query_emit(ctx, ctx->bucketStart, avg, ctx->bucketCount);
+    }
+    return db_query_emit(ctx, ctx->bucketStart, ctx->bucketLast ? ctx->bucketLast : "", ctx->bucketCount);
+}
+
+// 行回调：返回非 0 表示已达到 limit 或出错，停止本页
+static int db_query_row(DbQueryCtx *ctx, long long tsSec, const char *value) {
+    if (ctx->step <= 0) {
+        if (db_query_emit(ctx, tsSec, value, 0) != 0) return -1;
+        return ctx->emitted >= ctx->limit;
+    }
+
+    long long bucket = tsSec - ((tsSec % ctx->step) + ctx->step) % ctx->step;
+    if (ctx->bucketOpen && bucket != ctx->bucketStart) {
+        if (db_query_flush_bucket(ctx) != 0) return -1;
+        if (ctx->emitted >= ctx->limit) return 1;
+    }
+    if (!ctx->bucketOpen) {
+        ctx->bucketOpen = 1;
+        ctx->bucketStart = bucket;
+        ctx->bucketCount = 0;
+        ctx->bucketSum = 0;
+        ctx->bucketNumeric = 1;
+    }
+    char *endp = NULL;
+    double v = strtod(value, &endp);
+    if (endp == value || *endp != '\0') ctx->bucketNumeric = 0;
+    else ctx->bucketSum += v;
+    ctx->bucketCount++;
+    free(ctx->bucketLast);
+    ctx->bucketLast = strdup(value);
+    return 0;
+}
+
+// 填充下一段待发送数据；无更多数据返回 0，出错返回 -1
+static int db_query_fill(DbQueryCtx *ctx) {
+    ctx->buf.len = 0;
+    ctx->off = 0;
+    if (ctx->stage == 0) {
+        char timebuf[64];
+        get_time_str(timebuf, sizeof(timebuf));
+        char head[160];
+        int n = snprintf(head, sizeof(head),
+                         "{\"apiVersion\":\"%s\",\"statusCode\":200,\"timeStamp\":\"%s\",\"data\":{",
+                         API_VERSION, timebuf);
+        if (twin_json_buf_append(&ctx->buf, head, (size_t)n) != 0 ||
+            twin_json_buf_append(&ctx->buf, "\"deviceNamespace\":", 18) != 0 ||
+            twin_json_buf_append_str(&ctx->buf, ctx->ns) != 0 ||
+            twin_json_buf_append(&ctx->buf, ",\"deviceName\":", 14) != 0 ||
+            twin_json_buf_append_str(&ctx->buf, ctx->name) != 0 ||
+            twin_json_buf_append(&ctx->buf, ",\"propertyName\":", 16) != 0 ||
+            twin_json_buf_append_str(&ctx->buf, ctx->property) != 0) return -1;
+        n = snprintf(head, sizeof(head), ",\"start\":%lld,\"end\":%lld,\"step\":%lld,\"values\":[",
+                     ctx->start, ctx->end, ctx->step);
+        ctx->stage = 1;
+        return twin_json_buf_append(&ctx->buf, head, (size_t)n) == 0 ? 1 : -1;
+    }
+    while (ctx->stage == 1 && !ctx->exhausted) {
+        int rows = db_cursor_next(ctx->cursor);
+        if (rows < 0) return -1;
+        if (rows == 0) ctx->exhausted = 1;
+        for (int i = 0; i < rows; i++) {
+            const DbRow *row = &ctx->cursor->rows[i];
+            if (ctx->filterProperty &&
+                (!row->propertyName || strcmp(row->propertyName, ctx->property) != 0)) continue;
+            long long ts = ctx->rowSeconds ? (long long)row->timeStamp : (long long)(row->timeStamp / 1000);
+            int rc = db_query_row(ctx, ts, row->value);
+            if (rc < 0) return -1;
+            if (rc > 0) {
+                ctx->exhausted = 1;
+                break;
+            }
+        }
+        if (ctx->buf.len > 0) return 1;
+    }
+    if (ctx->stage == 1) {
+        ctx->stage = 2;
+        if (ctx->emitted < ctx->limit && db_query_flush_bucket(ctx) != 0) return -1;
+        return twin_json_buf_append(&ctx->buf, "]}}", 3) == 0 ? 1 : -1;
+    }
+    return 0;
+}
+
+static ssize_t db_query_reader(void *cls, uint64_t pos, char *out, size_t max) {
+    DbQueryCtx *ctx = (DbQueryCtx*)cls;
+    size_t written = 0;
+    while (written < max) {
+        if (ctx->off >= ctx->buf.len) {
+            int rc = db_query_fill(ctx);
+            if (rc < 0) return MHD_CONTENT_READER_END_WITH_ERROR;
+            if (rc == 0) break;
+            continue;
+        }
+        size_t n = ctx->buf.len - ctx->off;
+        if (n > max - written) n = max - written;
+        memcpy(out + written, ctx->buf.data + ctx->off, n);
+        ctx->off += n;
+        written += n;
+    }
+    if (written == 0) return MHD_CONTENT_READER_END_OF_STREAM;
+    return (ssize_t)written;
+}
+
+// 时间参数为 Unix 秒，超过 1e11 视为毫秒
+static long long query_time_arg(struct MHD_Connection *connection, const char *key, long long def) {
+    const char *v = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, key);
+    if (!v || !*v) return def;
+    long long t = atoll(v);
+    return t > 100000000000LL ? t / 1000 : t;
+}
+
+// 按 backend 建立本次查询独占的连接并打开游标；后端未配置返回 1，连接或查询失败返回 -1
+static int db_query_open(RestServer *server, DbQueryCtx *ctx, const char *backend) {
+    if (strcmp(backend, "redis") == 0) {
+        if (!server->redisClientConfig) return 1;
+        ctx->redis = calloc(1, sizeof(RedisDataBaseConfig));
+        if (!ctx->redis || redis_parse_client_config(server->redisClientConfig, &ctx->redis->config) != 0 ||
+            redis_init_client(ctx->redis) != 0) return -1;
+        // 以设备名为 key、写入时的秒级 timeStamp 为分值，同一 key 下混有该设备的所有属性
+        ctx->filterProperty = 1;
+        ctx->rowSeconds = 1;
+        ctx->cursor = redis_open_range_cursor(ctx->redis, ctx->name, ctx->start, ctx->end - 1);
+        return ctx->cursor ? 0 : -1;
+    }
+    if (strcmp(backend, "tdengine") == 0) {
+#ifdef TAOS_FOUND
+        if (!server->tdengineClientConfig) return 1;
+        ctx->tdengine = calloc(1, sizeof(TDEngineDataBaseConfig));
+        if (!ctx->tdengine ||
+            tdengine_parse_client_config(server->tdengineClientConfig, &ctx->tdengine->config) != 0 ||
+            tdengine_init_client(ctx->tdengine) != 0) return -1;
+        // 超级表按 namespace/name 建立（见 tdengine_add_data），各属性为其子表
+        char stable[400];
+        snprintf(stable, sizeof(stable), "%s/%s", ctx->ns, ctx->name);
+        ctx->filterProperty = 1;
+        ctx->cursor = tdengine_open_range_cursor(ctx->tdengine, stable, ctx->start * 1000, ctx->end * 1000);
+        return ctx->cursor ? 0 : -1;
+#else
+        return 1;
+#endif
+    }
+    MySQLDataBaseConfig *shared = mysql_recorder_get_db();
+    if (!shared) return 1;
+    mysql_recorder_table_name(ctx->ns, ctx->name, ctx->property, ctx->table, sizeof(ctx->table));
+    // 采集线程占用共享连接，查询单独建连
+    ctx->db = mysql_clone_client(shared);
+    if (!ctx->db) return -1;
+    // 原始数据可在 SQL 中限制行数；降采样时行数未知，不加限制（游标按页查询，提前结束时不会读完剩余行）
+    ctx->cursor = mysql_open_range_cursor(ctx->db, ctx->table, ctx->start, ctx->end,
+                                          ctx->step > 0 ? 0 : ctx->limit);
+    return ctx->cursor ? 0 : -1;
+}
+
+// GET /api/v1/database/{namespace}/{name}[/{property}]?property=&start=&end=&limit=&step=&backend=mysql|redis|tdengine
+static int handle_database_get_data(RestServer *server, struct MHD_Connection *connection,
+                                    const char *namespace, const char *name, const char *property) {
+    if (!property || !*property) {
+        property = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "property");
+    }
+    if (!property || !*property) {
+        return send_error_response(connection, MHD_HTTP_BAD_REQUEST, "Missing property");
+    }
+    const char *backend = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "backend");
+    if (!backend || !*backend) backend = "mysql";
+    if (strcmp(backend, "mysql") != 0 && strcmp(backend, "redis") != 0 && strcmp(backend, "tdengine") != 0) {
+        return send_error_response(connection, MHD_HTTP_BAD_REQUEST, "Unknown backend");
+    }
+
+    long long end = query_time_arg(connection, "end", (long long)time(NULL) + 1);
+    long long start = query_time_arg(connection, "start", end - DB_QUERY_DEFAULT_RANGE);
+    const char *limitStr = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "limit");
+    const char *stepStr = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "step");
+    long long limit = limitStr ? atoll(limitStr) : 0;
+    if (limit <= 0) limit = DB_QUERY_DEFAULT_LIMIT;
+    if (limit > DB_QUERY_MAX_LIMIT) limit = DB_QUERY_MAX_LIMIT;
+    long long step = stepStr ? atoll(stepStr) : 0;
+    if (start >= end || step < 0) {
+        return send_error_response(connection, MHD_HTTP_BAD_REQUEST, "Invalid time range or step");
+    }
+
+    DbQueryCtx *ctx = calloc(1, sizeof(DbQueryCtx));
+    if (!ctx) return MHD_NO;
+    ctx->ns = strdup(namespace);
+    ctx->name = strdup(name);
+    ctx->property = strdup(property);
+    ctx->start = start;
+    ctx->end = end;
+    ctx->limit = limit;
+    ctx->step = step;
+    if (!ctx->ns || !ctx->name || !ctx->property) {
+        db_query_free(ctx);
+        return MHD_NO;
+    }
+    int rc = db_query_open(server, ctx, backend);
+    if (rc != 0) {
+        db_query_free(ctx);
+        return send_error_response(connection, MHD_HTTP_SERVICE_UNAVAILABLE,
+                                   rc > 0 ? "Database is not configured" : "Failed to connect database");
+    }
+
+    struct MHD_Response *response = MHD_create_response_from_callback(
+        MHD_SIZE_UNKNOWN, BULK_READ_BLOCK_SIZE, &db_query_reader, ctx, &db_query_free);
+    if (!response) {
+        db_query_free(ctx);
+        return MHD_NO;
+    }
+    MHD_add_response_header(response, CONTENT_TYPE, CONTENT_TYPE_JSON);
+    int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+    MHD_destroy_response(response);
+    return ret;
+}
+
+// 近期历史：直接读内存压缩块，按列输出 timestamps / values（毫秒）；aggregate=true 时只返回 min/max/avg/count
+#define HISTORY_DEFAULT_MINUTES 10
+
+// GET /api/v1/history/{namespace}/{name}/{property}?minutes=&start=&end=&limit=&aggregate=
+static int handle_history_get(RestServer *server, struct MHD_Connection *connection,
+                              const char *namespace, const char *name, const char *property) {
+    const char *minutesStr = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "minutes");
+    const char *limitStr = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "limit");
+    long long nowSec = (long long)time(NULL);
+    long long minutes = minutesStr ? atoll(minutesStr) : HISTORY_DEFAULT_MINUTES;
+    if (minutes <= 0) minutes = HISTORY_DEFAULT_MINUTES;
+    long long end = query_time_arg(connection, "end", 0);
+    long long start = query_time_arg(connection, "start", (end > 0 ? end : nowSec) - minutes * 60);
+    long long limit = limitStr ? atoll(limitStr) : 0;
+    if (limit < 0 || (end > 0 && start > end)) {
+        return send_error_response(connection, MHD_HTTP_BAD_REQUEST, "Invalid time range or limit");
+    }
+
+    long long sinceMs = start * 1000;
+    long long untilMs = end > 0 ? end * 1000 + 999 : LLONG_MAX;
+    const char *aggStr = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "aggregate");
+    if (aggStr && (strcmp(aggStr, "true") == 0 || strcmp(aggStr, "1") == 0)) {
+        TwinHistoryAggregate agg;
+        if (twinhistory_aggregate(namespace, name, property, sinceMs, untilMs, &agg) != 0) {
+            return send_error_response(connection, MHD_HTTP_NOT_FOUND, "No history for property");
+        }
+        cJSON *resp = cJSON_CreateObject();
+        char timebuf[64];
+        get_time_str(timebuf, sizeof(timebuf));
+        cJSON_AddStringToObject(resp, "apiVersion", API_VERSION);
+        cJSON_AddNumberToObject(resp, "statusCode", 200);
+        cJSON_AddStringToObject(resp, "timeStamp", timebuf);
+        cJSON *data = cJSON_CreateObject();
+        cJSON_AddStringToObject(data, "deviceNamespace", namespace);
+        cJSON_AddStringToObject(data, "deviceName", name);
+        cJSON_AddStringToObject(data, "propertyName", property);
+        cJSON_AddNumberToObject(data, "count", (double)agg.count);
+        if (agg.count > 0) {
+            cJSON_AddNumberToObject(data, "min", agg.min);
+            cJSON_AddNumberToObject(data, "max", agg.max);
+            cJSON_AddNumberToObject(data, "avg", agg.avg);
+        }
+        cJSON_AddItemToObject(resp, "data", data);
+        int ret = send_json_response(connection, resp, MHD_HTTP_OK);
+        cJSON_Delete(resp);
+        return ret;
+    }
+
+    TwinHistorySlice slice;
+    if (twinhistory_query(namespace, name, property, sinceMs,
+                          untilMs, (size_t)limit, &slice) != 0) {
+        return send_error_response(connection, MHD_HTTP_NOT_FOUND, "No history for property");
+    }
+
+    TwinJsonBuf buf = {0};
+    char timebuf[64];
+    char num[64];
+    get_time_str(timebuf, sizeof(timebuf));
+    int n = snprintf(num, sizeof(num), "{\"apiVersion\":\"%s\",\"statusCode\":200,\"timeStamp\":", API_VERSION);
+    int rc = twin_json_buf_append(&buf, num, (size_t)n);
+    rc |= twin_json_buf_append_str(&buf, timebuf);
+    rc |= twin_json_buf_append(&buf, ",\"data\":{\"deviceNamespace\":", 27);
+    rc |= twin_json_buf_append_str(&buf, namespace);
+    rc |= twin_json_buf_append(&buf, ",\"deviceName\":", 14);
+    rc |= twin_json_buf_append_str(&buf, name);
+    rc |= twin_json_buf_append(&buf, ",\"propertyName\":", 16);
+    rc |= twin_json_buf_append_str(&buf, property);
+    n = snprintf(num, sizeof(num), ",\"count\":%zu,\"timestamps\":[", slice.count);
+    rc |= twin_json_buf_append(&buf, num, (size_t)n);
+    for (size_t i = 0; rc == 0 && i < slice.count; i++) {
+        n = snprintf(num, sizeof(num), "%s%lld", i ? "," : "", slice.timestamps[i]);
+        rc |= twin_json_buf_append(&buf, num, (size_t)n);
+    }
+    rc |= twin_json_buf_append(&buf, "],\"values\":[", 12);
+    for (size_t i = 0; rc == 0 && i < slice.count; i++) {
+        if (slice.types[i] == TWIN_HISTORY_BOOL) {
+            n = snprintf(num, sizeof(num), "%s%s", i ? "," : "", slice.values[i] != 0 ? "true" : "false");
+        } else {
+            n = snprintf(num, sizeof(num), "%s%.15g", i ? "," : "", slice.values[i]);
+        }
+        rc |= twin_json_buf_append(&buf, num, (size_t)n);
+    }
+    rc |= twin_json_buf_append(&buf, "]}}", 3);
+    twinhistory_slice_free(&slice);
+    if (rc != 0) {
+        twin_json_buf_free(&buf);
+        return send_error_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, "Out of memory");
+    }
+
+    struct MHD_Response *response =
+        MHD_create_response_from_buffer(buf.len, buf.data, MHD_RESPMEM_MUST_FREE);
+    if (!response) {
+        twin_json_buf_free(&buf);
+        return MHD_NO;
+    }
+    MHD_add_response_header(response, CONTENT_TYPE, CONTENT_TYPE_JSON);
+    int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+    MHD_destroy_response(response);
+    return ret;
+}
+
+// GET /api/v1/metrics/io：各设备端点按通道（control/ondemand/telemetry）的排队与延迟统计
+static int handle_io_metrics(RestServer *server, struct MHD_Connection *connection) {
+    IoLaneStats *stats = NULL;
+    int n = iosched_stats(&stats);
+
     cJSON *resp = cJSON_CreateObject();
     char timebuf[64];
     get_time_str(timebuf, sizeof(timebuf));
     cJSON_AddStringToObject(resp, "apiVersion", API_VERSION);
     cJSON_AddNumberToObject(resp, "statusCode", 200);
     cJSON_AddStringToObject(resp, "timeStamp", timebuf);
-    cJSON *data = cJSON_CreateArray();
-    cJSON_AddItemToObject(resp, "data", data);
+    cJSON *data = cJSON_AddArrayToObject(resp, "data");
+    for (int i = 0; i < n; i++) {
+        const IoLaneStats *s = &stats[i];
+        cJSON *item = cJSON_CreateObject();
+        cJSON_AddStringToObject(item, "endpoint", s->endpoint);
+        cJSON_AddStringToObject(item, "lane", iosched_lane_name(s->lane));
+        cJSON_AddNumberToObject(item, "inflight", s->inflight);
+        cJSON_AddNumberToObject(item, "queued", s->queued);
+        cJSON_AddNumberToObject(item, "ops", (double)s->ops);
+        cJSON_AddNumberToObject(item, "failures", (double)s->failures);
+        cJSON_AddNumberToObject(item, "sloMiss", (double)s->sloMiss);
+        cJSON_AddNumberToObject(item, "waitAvgMs", s->ops ? s->waitTotalUs / 1000.0 / s->ops : 0);
+        cJSON_AddNumberToObject(item, "waitMaxMs", s->waitMaxUs / 1000.0);
+        cJSON_AddNumberToObject(item, "latencyAvgMs", s->ops ? s->latTotalUs / 1000.0 / s->ops : 0);
+        cJSON_AddNumberToObject(item, "latencyMaxMs", s->latMaxUs / 1000.0);
+        // 累计直方图：le 为桶上界（毫秒），最后一桶为 +Inf
+        cJSON *hist = cJSON_AddArrayToObject(item, "latencyHistogram");
+        long long cum = 0;
+        for (int b = 0; b < IOSCHED_BUCKETS; b++) {
+            cum += s->buckets[b];
+            cJSON *bucket = cJSON_CreateObject();
+            if (iosched_bucket_ms[b] < 0) cJSON_AddStringToObject(bucket, "le", "+Inf");
+            else cJSON_AddNumberToObject(bucket, "le", iosched_bucket_ms[b]);
+            cJSON_AddNumberToObject(bucket, "count", (double)cum);
+            cJSON_AddItemToArray(hist, bucket);
+        }
+        cJSON_AddItemToArray(data, item);
+    }
+    free(stats);
     int ret = send_json_response(connection, resp, MHD_HTTP_OK);
     cJSON_Delete(resp);
     return ret;
 }
 
+// 路由适配：参数按注册模式中的顺序取出
+#define ROUTE_ARG(m, i) ((m)->params[(i)].ptr)
+
+static int route_ping(void *ctx, struct MHD_Connection *connection,
+                      const RouteMatch *m, const char *body, size_t bodyLen) {
+    return handle_ping((RestServer*)ctx, connection);
+}
+
+static int route_io_metrics(void *ctx, struct MHD_Connection *connection,
+                            const RouteMatch *m, const char *body, size_t bodyLen) {
+    return handle_io_metrics((RestServer*)ctx, connection);
+}
+
+static int route_devices_bulk_read(void *ctx, struct MHD_Connection *connection,
+                                   const RouteMatch *m, const char *body, size_t bodyLen) {
+    return handle_devices_bulk_read((RestServer*)ctx, connection);
+}
+
+static int route_watch(void *ctx, struct MHD_Connection *connection,
+                       const RouteMatch *m, const char *body, size_t bodyLen) {
+    return handle_watch((RestServer*)ctx, connection);
+}
+
+static int route_device_read(void *ctx, struct MHD_Connection *connection,
+                             const RouteMatch *m, const char *body, size_t bodyLen) {
+    return handle_device_read((RestServer*)ctx, connection, ROUTE_ARG(m, 0), ROUTE_ARG(m, 1), ROUTE_ARG(m, 2));
+}
+
+// 从 JSON 请求体中取出写入值：字符串原样使用，数字/布尔等按 JSON 文本使用，调用者 free
+static char *body_get_value(const char *body, size_t bodyLen, const char *key, char **method) {
+    if (!body || bodyLen == 0) return NULL;
+    cJSON *root = cJSON_Parse(body);   // body 已以 '\0' 结尾
+    if (!root) return NULL;
+    char *value = NULL;
+    cJSON *item = cJSON_GetObjectItemCaseSensitive(root, key);
+    if (cJSON_IsString(item) && item->valuestring) {
+        value = strdup(item->valuestring);
+    } else if (item && !cJSON_IsNull(item)) {
+        value = cJSON_PrintUnformatted(item);
+    }
+    if (method) {
+        cJSON *m = cJSON_GetObjectItemCaseSensitive(root, "method");
+        *method = (cJSON_IsString(m) && m->valuestring) ? strdup(m->valuestring) : NULL;
+    }
+    cJSON_Delete(root);
+    return value;
+}
+
+// PUT/POST /api/v1/device/{namespace}/{name}/{property}  body: {"value": ..., "method": "..."}
+static int route_device_write(void *ctx, struct MHD_Connection *connection,
+                              const RouteMatch *m, const char *body, size_t bodyLen) {
+    char *method = NULL;
+    char *value = body_get_value(body, bodyLen, "value", &method);
+    if (!value) {
+        free(method);
+        return send_error_response(connection, MHD_HTTP_BAD_REQUEST, "Request body must be JSON with a \"value\" field");
+    }
+    int ret = handle_device_write((RestServer*)ctx, connection, ROUTE_ARG(m, 0), ROUTE_ARG(m, 1),
+                                  method ? method : "", ROUTE_ARG(m, 2), value);
+    free(method);
+    free(value);
+    return ret;
+}
+
+// PUT/POST /api/v1/devicemethod/{namespace}/{name}/{method}/{property}  body: {"data": ...}
+static int route_device_method_write(void *ctx, struct MHD_Connection *connection,
+                                     const RouteMatch *m, const char *body, size_t bodyLen) {
+    char *data = body_get_value(body, bodyLen, "data", NULL);
+    if (!data) {
+        return send_error_response(connection, MHD_HTTP_BAD_REQUEST, "Request body must be JSON with a \"data\" field");
+    }
+    int ret = handle_device_write((RestServer*)ctx, connection, ROUTE_ARG(m, 0), ROUTE_ARG(m, 1),
+                                  ROUTE_ARG(m, 2), ROUTE_ARG(m, 3), data);
+    free(data);
+    return ret;
+}
+
+// 兼容旧接口：GET /api/v1/devicemethod/{namespace}/{name}/{method}/{property}/{data}
+static int route_device_method_write_legacy(void *ctx, struct MHD_Connection *connection,
+                                            const RouteMatch *m, const char *body, size_t bodyLen) {
+    return handle_device_write((RestServer*)ctx, connection, ROUTE_ARG(m, 0), ROUTE_ARG(m, 1),
+                               ROUTE_ARG(m, 2), ROUTE_ARG(m, 3), ROUTE_ARG(m, 4));
+}
+
+static int route_get_device_method(void *ctx, struct MHD_Connection *connection,
+                                   const RouteMatch *m, const char *body, size_t bodyLen) {
+    return handle_get_device_method((RestServer*)ctx, connection, ROUTE_ARG(m, 0), ROUTE_ARG(m, 1));
+}
+
+static int route_meta_get_model(void *ctx, struct MHD_Connection *connection,
+                                const RouteMatch *m, const char *body, size_t bodyLen) {
+    return handle_meta_get_model((RestServer*)ctx, connection, ROUTE_ARG(m, 0), ROUTE_ARG(m, 1));
+}
+
+static int route_database_get_data(void *ctx, struct MHD_Connection *connection,
+                                   const RouteMatch *m, const char *body, size_t bodyLen) {
+    return handle_database_get_data((RestServer*)ctx, connection, ROUTE_ARG(m, 0), ROUTE_ARG(m, 1),
+                                    m->count > 2 ? ROUTE_ARG(m, 2) : NULL);
+}
+
+static int route_history_get(void *ctx, struct MHD_Connection *connection,
+                             const RouteMatch *m, const char *body, size_t bodyLen) {
+    return handle_history_get((RestServer*)ctx, connection, ROUTE_ARG(m, 0), ROUTE_ARG(m, 1), ROUTE_ARG(m, 2));
+}
+
+// 路由表：启动时编译一次
+static Router *build_router(void) {
+    Router *router = router_new();
+    if (!router) return NULL;
+    int rc = 0;
+    rc |= router_add(router, ROUTE_GET, API_PING, route_ping);
+    rc |= router_add(router, ROUTE_GET, API_DEVICES, route_devices_bulk_read);
+    rc |= router_add(router, ROUTE_GET, API_WATCH, route_watch);
+    rc |= router_add(router, ROUTE_GET, API_DEVICE "/{namespace}/{name}/{property}", route_device_read);
+    rc |= router_add(router, ROUTE_PUT | ROUTE_POST, API_DEVICE "/{namespace}/{name}/{property}", route_device_write);
+    rc |= router_add(router, ROUTE_GET, API_DEVICE_METHOD "/{namespace}/{name}", route_get_device_method);
+    rc |= router_add(router, ROUTE_PUT | ROUTE_POST, API_DEVICE_METHOD "/{namespace}/{name}/{method}/{property}", route_device_method_write);
+    rc |= router_add(router, ROUTE_GET, API_DEVICE_METHOD "/{namespace}/{name}/{method}/{property}/{data}", route_device_method_write_legacy);
+    rc |= router_add(router, ROUTE_GET, API_META "/model/{namespace}/{name}", route_meta_get_model);
+    rc |= router_add(router, ROUTE_GET, API_DATABASE "/{namespace}/{name}", route_database_get_data);
+    rc |= router_add(router, ROUTE_GET, API_DATABASE "/{namespace}/{name}/{property}", route_database_get_data);
+    rc |= router_add(router, ROUTE_GET, API_HISTORY "/{namespace}/{name}/{property}", route_history_get);
+    rc |= router_add(router, ROUTE_GET, API_METRICS "/io", route_io_metrics);
+    if (rc != 0) {
+        router_free(router);
+        return NULL;
+    }
+    return router;
+}
+
+// 单个请求的上下文：带请求体的方法需要跨多次回调累积数据
+typedef struct {
+    char *path;                 // 路由切分用的 URL 副本，路径参数指向其中
+    RouteMatch match;
+    RouteHandler handler;
+    char *body;
+    size_t bodyLen;
+    int tooLarge;
+} RequestCtx;
+
+static void request_ctx_free(RequestCtx *req) {
+    if (!req) return;
+    free(req->path);
+    free(req->body);
+    free(req);
+}
+
+static void request_completed(void *cls, struct MHD_Connection *connection,
+                              void **con_cls, enum MHD_RequestTerminationCode toe) {
+    request_ctx_free((RequestCtx*)*con_cls);
+    *con_cls = NULL;
+}
+
+static int queue_empty_response(RestServer *server, struct MHD_Connection *connection,
+                                unsigned int status, const char *allow) {
+    if (!allow && status == MHD_HTTP_NOT_FOUND && server->notFoundResponse) {
+        return MHD_queue_response(connection, status, server->notFoundResponse);
+    }
+    struct MHD_Response *response = MHD_create_response_from_buffer(0, "", MHD_RESPMEM_PERSISTENT);
+    if (allow) MHD_add_response_header(response, MHD_HTTP_HEADER_ALLOW, allow);
+    int ret = MHD_queue_response(connection, status, response);
+    MHD_destroy_response(response);
+    return ret;
+}
+
 // 路由分发
 static enum MHD_Result router_callback(void *cls, struct MHD_Connection *connection,
                            const char *url, const char *method,
                            const char *version, const char *upload_data,
                            size_t *upload_data_size, void **con_cls) {
     RestServer *server = (RestServer*)cls;
-    if (strcmp(method, "GET") != 0) {
-        struct MHD_Response *response = MHD_create_response_from_buffer(0, "", MHD_RESPMEM_PERSISTENT);
-        int ret = MHD_queue_response(connection, MHD_HTTP_METHOD_NOT_ALLOWED, response);
-        MHD_destroy_response(response);
-        return ret;
-    }
-    // /api/v1/ping
-    if (strcmp(url, API_PING) == 0) {
-        return handle_ping(connection);
-    }
-    // /api/v1/device/{namespace}/{name}/{property}
-    if (strncmp(url, API_DEVICE, strlen(API_DEVICE)) == 0) {
-        char namespace[64], name[64], property[64];
-        if (sscanf(url, API_DEVICE "/%63[^/]/%63[^/]/%63[^/]", namespace, name, property) == 3) {
-            return handle_device_read(server, connection, namespace, name, property);
+    RequestCtx *req = (RequestCtx*)*con_cls;
+
+    if (!req) {
+        unsigned int routeMethod = router_method_from_string(method);
+        req = calloc(1, sizeof(RequestCtx));
+        if (!req || !(req->path = strdup(url))) {
+            request_ctx_free(req);
+            return MHD_NO;
         }
-    }
-    // /api/v1/devicemethod/{namespace}/{name}/{method}/{property}/{data}
-    if (strncmp(url, API_DEVICE_METHOD, strlen(API_DEVICE_METHOD)) == 0) {
-        char namespace[64], name[64], method[64], property[64], data[128];
-        if (sscanf(url, API_DEVICE_METHOD "/%63[^/]/%63[^/]/%63[^/]/%63[^/]/%127[^/]", namespace, name, method, property, data) == 5) {
-            return handle_device_write(server, connection, namespace, name, method, property, data);
+        unsigned int allowed = 0;
+        int rc = router_lookup(server->router, routeMethod, req->path, &req->match, &req->handler, &allowed);
+        if (rc != 0) {
+            request_ctx_free(req);
+            if (rc == -2) {
+                char allow[64];
+                router_format_allow(allowed, allow, sizeof(allow));
+                return queue_empty_response(server, connection, MHD_HTTP_METHOD_NOT_ALLOWED, allow);
+            }
+            return queue_empty_response(server, connection, MHD_HTTP_NOT_FOUND, NULL);
         }
-        // /api/v1/devicemethod/{namespace}/{name}
-        if (sscanf(url, API_DEVICE_METHOD "/%63[^/]/%63[^/]", namespace, name) == 2) {
-            return handle_get_device_method(server, connection, namespace, name);
+        if (routeMethod == ROUTE_PUT || routeMethod == ROUTE_POST) {
+            // 等待请求体，完成后由 request_completed 释放
+            *con_cls = req;
+            return MHD_YES;
         }
+        int ret = req->handler(server, connection, &req->match, NULL, 0);
+        request_ctx_free(req);
+        return ret;
     }
-    // /api/v1/meta/model/{namespace}/{name}
-    if (strncmp(url, API_META "/model", strlen(API_META "/model")) == 0) {
-        char namespace[64], name[64];
-        if (sscanf(url, API_META "/model/%63[^/]/%63[^/]", namespace, name) == 2) {
-            return handle_meta_get_model(server, connection, namespace, name);
+
+    // 累积请求体
+    if (*upload_data_size > 0) {
+        if (!req->tooLarge) {
+            if (req->bodyLen + *upload_data_size > MAX_REQUEST_BODY) {
+                req->tooLarge = 1;
+            } else {
+                char *p = realloc(req->body, req->bodyLen + *upload_data_size + 1);
+                if (!p) return MHD_NO;
+                memcpy(p + req->bodyLen, upload_data, *upload_data_size);
+                req->body = p;
+                req->bodyLen += *upload_data_size;
+                req->body[req->bodyLen] = '\0';
+            }
         }
+        *upload_data_size = 0;
+        return MHD_YES;
     }
-    // /api/v1/database/{namespace}/{name}
-    if (strncmp(url, API_DATABASE, strlen(API_DATABASE)) == 0) {
-        char namespace[64], name[64];
-        if (sscanf(url, API_DATABASE "/%63[^/]/%63[^/]", namespace, name) == 2) {
-            return handle_database_get_data(server, connection);
-        }
+
+    if (req->tooLarge) {
+        return send_error_response(connection, MHD_HTTP_PAYLOAD_TOO_LARGE, "Request body too large");
     }
-    // 未匹配
-    struct MHD_Response *response = MHD_create_response_from_buffer(0, "", MHD_RESPMEM_PERSISTENT);
-    int ret = MHD_queue_response(connection, MHD_HTTP_NOT_FOUND, response);
-    MHD_destroy_response(response);
-    return ret;
+    return req->handler(server, connection, &req->match, req->body, req->bodyLen);
 }
 
 RestServer *rest_server_new(DeviceManager *panel, const char *port) {
@@ -314,20 +1319,81 @@ RestServer *rest_server_new(DeviceManager *panel, const char *port) {
     strcpy(server->ip, "0.0.0.0");
     strcpy(server->port, port ? port : "7777");
     server->dev_panel = panel;
+    server->router = build_router();
+    if (!server->router) {
+        log_error("Failed to build HTTP route table");
+        free(server);
+        return NULL;
+    }
+    pthread_mutex_init(&server->pingMutex, NULL);
+    pthread_mutex_init(&server->heartbeatMutex, NULL);
+    pthread_cond_init(&server->heartbeatCond, NULL);
+    server->notFoundResponse = MHD_create_response_from_buffer(0, "", MHD_RESPMEM_PERSISTENT);
+    server->threadPoolSize = 4;
+    server->connectionLimit = 1024;
+    server->connectionTimeout = 30;
     return server;
 }
 
+void rest_server_set_limits(RestServer *server, int threads, int connectionLimit, int connectionTimeout) {
+    if (!server) return;
+    if (threads > 0) server->threadPoolSize = (unsigned int)threads;
+    if (connectionLimit > 0) server->connectionLimit = (unsigned int)connectionLimit;
+    if (connectionTimeout > 0) server->connectionTimeout = (unsigned int)connectionTimeout;
+}
+
+void rest_server_set_history_backends(RestServer *server, const char *redisClientConfig,
+                                      const char *tdengineClientConfig) {
+    if (!server) return;
+    free(server->redisClientConfig);
+    free(server->tdengineClientConfig);
+    server->redisClientConfig = redisClientConfig && *redisClientConfig ? strdup(redisClientConfig) : NULL;
+    server->tdengineClientConfig = tdengineClientConfig && *tdengineClientConfig ? strdup(tdengineClientConfig) : NULL;
+}
+
+static struct MHD_Daemon *rest_server_start_daemon(RestServer *server, unsigned int flags) {
+    return MHD_start_daemon(flags, (uint16_t)atoi(server->port),
+                            NULL, NULL, &router_callback, server,
+                            MHD_OPTION_NOTIFY_COMPLETED, &request_completed, NULL,
+                            MHD_OPTION_THREAD_POOL_SIZE, server->threadPoolSize > 1 ? server->threadPoolSize : 1u,
+                            MHD_OPTION_CONNECTION_LIMIT, server->connectionLimit,
+                            MHD_OPTION_CONNECTION_TIMEOUT, server->connectionTimeout,
+                            MHD_OPTION_END);
+}
+
 void rest_server_start(RestServer *server) {
-    server->daemon = MHD_start_daemon(MHD_USE_SELECT_INTERNALLY, atoi(server->port),
-                                      NULL, NULL, &router_callback, server, MHD_OPTION_END);
+    // epoll + 线程池：连接数不受 FD_SETSIZE 限制，请求可并发处理
+    server->stopping = 0;
+    server->daemon = rest_server_start_daemon(server, MHD_USE_EPOLL_INTERNALLY | MHD_ALLOW_SUSPEND_RESUME | MHD_USE_ERROR_LOG);
+    if (!server->daemon) {
+        // libmicrohttpd 未编译 epoll 支持时回退到 select
+        log_warn("HTTP server: epoll unavailable, falling back to select");
+        server->daemon = rest_server_start_daemon(server, MHD_USE_SELECT_INTERNALLY | MHD_ALLOW_SUSPEND_RESUME | MHD_USE_ERROR_LOG);
+    }
     if (!server->daemon) {
         log_error("Failed to start HTTP server");
     } else {
-        log_info("HTTP server started on port %s", server->port);
+        log_info("HTTP server started on port %s (threads=%u, max_conn=%u, timeout=%us)",
+                 server->port, server->threadPoolSize, server->connectionLimit, server->connectionTimeout);
+        if (pthread_create(&server->heartbeatThread, NULL, sse_heartbeat_thread, server) == 0) {
+            server->heartbeatRunning = 1;
+        } else {
+            log_warn("Failed to start SSE heartbeat thread");
+        }
     }
 }
 
 void rest_server_stop(RestServer *server) {
+    // 先让订阅流结束：MHD_stop_daemon 要求不存在挂起的连接
+    pthread_mutex_lock(&server->heartbeatMutex);
+    __atomic_store_n(&server->stopping, 1, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&server->heartbeatCond);
+    pthread_mutex_unlock(&server->heartbeatMutex);
+    if (server->heartbeatRunning) {
+        pthread_join(server->heartbeatThread, NULL);
+        server->heartbeatRunning = 0;
+    }
+    twinwatch_kick_all();
     if (server->daemon) {
         MHD_stop_daemon(server->daemon);
         server->daemon = NULL;
@@ -335,5 +1401,14 @@ void rest_server_stop(RestServer *server) {
 }
 
 void rest_server_free(RestServer *server) {
-    if (server) free(server);
+    if (!server) return;
+    router_free(server->router);
+    if (server->pingResponse) MHD_destroy_response(server->pingResponse);
+    if (server->notFoundResponse) MHD_destroy_response(server->notFoundResponse);
+    pthread_mutex_destroy(&server->pingMutex);
+    pthread_mutex_destroy(&server->heartbeatMutex);
+    pthread_cond_destroy(&server->heartbeatCond);
+    free(server->redisClientConfig);
+    free(server->tdengineClientConfig);
+    free(server);
 }
\ No newline at end of file
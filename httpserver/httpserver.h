@@ -2,17 +2,41 @@
 #define HTTPSERVER_HTTPSERVER_H
 
 #include <microhttpd.h>
+#include <pthread.h>
+#include <time.h>
 #include "device/device.h"
 
+struct Router;
+
 typedef struct {
     char ip[32];
     char port[8];
     struct MHD_Daemon *daemon;
     DeviceManager*dev_panel;
+    unsigned int threadPoolSize;     // 工作线程数，<=1 时单线程
+    unsigned int connectionLimit;    // 最大并发连接数，0 为 MHD 默认
+    unsigned int connectionTimeout;  // 空闲连接超时（秒），0 不超时
+    struct Router *router;           // 启动时编译的路由表
+    struct MHD_Response *pingResponse;      // 预生成的 /ping 响应，每秒刷新
+    time_t pingTime;
+    pthread_mutex_t pingMutex;
+    struct MHD_Response *notFoundResponse;  // 预生成的 404 空响应
+    int stopping;                    // 置位后订阅流结束
+    pthread_t heartbeatThread;       // 定期唤醒 SSE 订阅连接
+    int heartbeatRunning;
+    pthread_mutex_t heartbeatMutex;
+    pthread_cond_t heartbeatCond;
+    char *redisClientConfig;         // 历史查询 backend=redis 的客户端配置（JSON），NULL 表示未启用
+    char *tdengineClientConfig;      // 历史查询 backend=tdengine 的客户端配置（JSON），NULL 表示未启用
     // 可扩展：TLS配置、数据库client等
 } RestServer;
 
 RestServer *rest_server_new(DeviceManager *panel, const char *port);
+// 需在 rest_server_start 之前调用；参数 <=0 时保持默认值
+void rest_server_set_limits(RestServer *server, int threads, int connectionLimit, int connectionTimeout);
+// 历史查询的 Redis / TDengine 后端，传 NULL 表示不启用；需在 rest_server_start 之前调用
+void rest_server_set_history_backends(RestServer *server, const char *redisClientConfig,
+                                      const char *tdengineClientConfig);
 void rest_server_start(RestServer *server);
 void rest_server_stop(RestServer *server);
 void rest_server_free(RestServer *server);
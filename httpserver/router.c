@@ -0,0 +1,186 @@
+#include "httpserver/router.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#define ROUTE_METHOD_SLOTS 4
+
+typedef struct RouteNode {
+    char *segment;                      // 静态段文本；参数节点为 NULL
+    size_t segmentLen;
+    struct RouteNode **children;        // 静态子节点
+    int childCount;
+    struct RouteNode *paramChild;       // {xxx} 子节点，静态段优先匹配
+    RouteHandler handlers[ROUTE_METHOD_SLOTS];
+} RouteNode;
+
+struct Router {
+    RouteNode *root;
+};
+
+static int method_slot(unsigned int method) {
+    switch (method) {
+        case ROUTE_GET:    return 0;
+        case ROUTE_PUT:    return 1;
+        case ROUTE_POST:   return 2;
+        case ROUTE_DELETE: return 3;
+        default:           return -1;
+    }
+}
+
+static void node_free(RouteNode *node) {
+    if (!node) return;
+    for (int i = 0; i < node->childCount; i++) node_free(node->children[i]);
+    free(node->children);
+    node_free(node->paramChild);
+    free(node->segment);
+    free(node);
+}
+
+Router *router_new(void) {
+    Router *router = calloc(1, sizeof(Router));
+    if (!router) return NULL;
+    router->root = calloc(1, sizeof(RouteNode));
+    if (!router->root) {
+        free(router);
+        return NULL;
+    }
+    return router;
+}
+
+void router_free(Router *router) {
+    if (!router) return;
+    node_free(router->root);
+    free(router);
+}
+
+static RouteNode *node_static_child(const RouteNode *node, const char *seg, size_t len) {
+    for (int i = 0; i < node->childCount; i++) {
+        RouteNode *c = node->children[i];
+        if (c->segmentLen == len && memcmp(c->segment, seg, len) == 0) return c;
+    }
+    return NULL;
+}
+
+static RouteNode *node_add_static(RouteNode *node, const char *seg, size_t len) {
+    RouteNode *c = node_static_child(node, seg, len);
+    if (c) return c;
+    RouteNode **children = realloc(node->children, sizeof(RouteNode*) * (size_t)(node->childCount + 1));
+    if (!children) return NULL;
+    node->children = children;
+    c = calloc(1, sizeof(RouteNode));
+    if (!c) return NULL;
+    c->segment = strndup(seg, len);
+    if (!c->segment) {
+        free(c);
+        return NULL;
+    }
+    c->segmentLen = len;
+    node->children[node->childCount++] = c;
+    return c;
+}
+
+int router_add(Router *router, unsigned int methods, const char *pattern, RouteHandler handler) {
+    if (!router || !pattern || !handler || pattern[0] != '/') return -1;
+    RouteNode *node = router->root;
+    int params = 0;
+    const char *p = pattern;
+    while (*p) {
+        while (*p == '/') p++;
+        if (!*p) break;
+        const char *end = strchr(p, '/');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        if (len >= 2 && p[0] == '{' && p[len - 1] == '}') {
+            if (++params > ROUTE_MAX_PARAMS) return -1;
+            if (!node->paramChild) {
+                node->paramChild = calloc(1, sizeof(RouteNode));
+                if (!node->paramChild) return -1;
+            }
+            node = node->paramChild;
+        } else {
+            node = node_add_static(node, p, len);
+            if (!node) return -1;
+        }
+        p += len;
+    }
+    for (unsigned int m = ROUTE_GET; m <= ROUTE_DELETE; m <<= 1) {
+        if (methods & m) node->handlers[method_slot(m)] = handler;
+    }
+    return 0;
+}
+
+unsigned int router_method_from_string(const char *method) {
+    if (!method) return 0;
+    if (strcmp(method, "GET") == 0) return ROUTE_GET;
+    if (strcmp(method, "PUT") == 0) return ROUTE_PUT;
+    if (strcmp(method, "POST") == 0) return ROUTE_POST;
+    if (strcmp(method, "DELETE") == 0) return ROUTE_DELETE;
+    return 0;
+}
+
+// 递归匹配：静态段优先，失败时回溯到参数节点
+// 匹配过程不修改路径，命中后再统一截断参数
+static const RouteNode *node_match(const RouteNode *node, char *seg, RouteMatch *match) {
+    while (*seg == '/') seg++;
+    if (!*seg) return node;
+
+    char *end = strchr(seg, '/');
+    size_t len = end ? (size_t)(end - seg) : strlen(seg);
+    char *rest = seg + len;
+
+    RouteNode *c = node_static_child(node, seg, len);
+    if (c) {
+        const RouteNode *r = node_match(c, rest, match);
+        if (r) return r;
+    }
+    if (node->paramChild && match->count < ROUTE_MAX_PARAMS) {
+        int saved = match->count;
+        match->params[match->count].ptr = seg;
+        match->params[match->count].len = len;
+        match->count++;
+        const RouteNode *r = node_match(node->paramChild, rest, match);
+        if (r) return r;
+        match->count = saved;
+    }
+    return NULL;
+}
+
+int router_lookup(const Router *router, unsigned int method, char *path,
+                  RouteMatch *match, RouteHandler *handler, unsigned int *allowed) {
+    if (!router || !path || !match || !handler) return -1;
+    match->count = 0;
+    const RouteNode *node = node_match(router->root, path, match);
+
+    unsigned int mask = 0;
+    for (unsigned int m = ROUTE_GET; node && m <= ROUTE_DELETE; m <<= 1) {
+        if (node->handlers[method_slot(m)]) mask |= m;
+    }
+    if (allowed) *allowed = mask;
+    if (!node || mask == 0) return -1;
+
+    // 参数后面只可能是 '/' 或结尾，原地截断即得到以 '\0' 结尾的参数
+    for (int i = 0; i < match->count; i++) {
+        ((char*)match->params[i].ptr)[match->params[i].len] = '\0';
+    }
+
+    int slot = method_slot(method);
+    if (slot < 0 || !node->handlers[slot]) return -2;
+    *handler = node->handlers[slot];
+    return 0;
+}
+
+void router_format_allow(unsigned int allowed, char *buf, size_t buflen) {
+    static const char *names[] = {"GET", "PUT", "POST", "DELETE"};
+    size_t off = 0;
+    if (buflen == 0) return;
+    buf[0] = '\0';
+    for (int i = 0; i < ROUTE_METHOD_SLOTS; i++) {
+        if (!(allowed & (1u << i))) continue;
+        int n = snprintf(buf + off, buflen - off, "%s%s", off ? ", " : "", names[i]);
+        if (n < 0 || (size_t)n >= buflen - off) {
+            buf[off] = '\0';   // 放不下的方法整个丢掉，不留半截
+            break;
+        }
+        off += (size_t)n;
+    }
+}
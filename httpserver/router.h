@@ -0,0 +1,52 @@
+#ifndef HTTPSERVER_ROUTER_H
+#define HTTPSERVER_ROUTER_H
+
+#include <stddef.h>
+#include <microhttpd.h>
+
+// 预编译的路由树：启动时注册路由，请求时按路径段逐级匹配
+// 路径参数不复制：匹配时把请求路径副本中的 '/' 原地改为 '\0'，参数直接指向该缓冲
+
+#define ROUTE_MAX_PARAMS 8
+
+typedef enum {
+    ROUTE_GET    = 1 << 0,
+    ROUTE_PUT    = 1 << 1,
+    ROUTE_POST   = 1 << 2,
+    ROUTE_DELETE = 1 << 3,
+} RouteMethod;
+
+typedef struct {
+    const char *ptr;   // 以 '\0' 结尾，指向请求路径缓冲
+    size_t len;
+} RouteParam;
+
+typedef struct {
+    RouteParam params[ROUTE_MAX_PARAMS];
+    int count;
+} RouteMatch;
+
+// body 仅对 PUT/POST 有效，未带请求体时为 NULL
+typedef int (*RouteHandler)(void *ctx, struct MHD_Connection *connection,
+                            const RouteMatch *match, const char *body, size_t bodyLen);
+
+typedef struct Router Router;
+
+Router *router_new(void);
+void router_free(Router *router);
+
+// pattern 形如 "/api/v1/device/{namespace}/{name}/{property}"，methods 为 RouteMethod 位或
+// 同一路径重复注册同一方法时后者覆盖前者；成功返回 0，失败返回 -1
+int router_add(Router *router, unsigned int methods, const char *pattern, RouteHandler handler);
+
+// 将 HTTP 方法名映射为 RouteMethod，未知方法返回 0
+unsigned int router_method_from_string(const char *method);
+
+// path 会被原地切分；返回 0 命中，-1 无此路径，-2 路径存在但方法不允许（*allowed 返回可用方法）
+int router_lookup(const Router *router, unsigned int method, char *path,
+                  RouteMatch *match, RouteHandler *handler, unsigned int *allowed);
+
+// 生成 Allow 头内容，如 "GET, PUT"
+void router_format_allow(unsigned int allowed, char *buf, size_t buflen);
+
+#endif // HTTPSERVER_ROUTER_H
@@ -1,4 +1,4 @@
-// 放在所有 include 之前，启用 GNU 扩展（pthread_timedjoin_np）
+// 放在所有 include 之前，启用 GNU 扩展
 #define _GNU_SOURCE
 
 #include <stdio.h>
@@ -20,6 +20,8 @@
 #include "httpserver/httpserver.h"     
 #include "common/configmaptype.h"
 #include "common/const.h"
+#include "common/epoch.h"
+#include "device/twinhistory.h"
 #include "data/dbmethod/mysql/mysql_client.h"  // 新增
 #include "data/dbmethod/mysql/recorder.h"   // 新增
 #include "data/publish/publisher.h"   // 新增
@@ -59,7 +61,7 @@ static void setup_signal_handlers(void) {
 static void cleanup_resources(void) {
     log_info("Cleaning up resources...");
 
-    // 1) HTTP
+    // 1) HTTP / gRPC：先停入口，关停期间不再有请求触达设备
     log_info("[cleanup] stopping HTTP...");
     if (g_httpServer) {
         rest_server_stop(g_httpServer);
@@ -68,41 +70,6 @@ static void cleanup_resources(void) {
     }
     log_info("[cleanup] HTTP done");
 
-    // 2) 设备：先发 stop
-    log_info("[cleanup] stopping devices...");
-    if (g_deviceManager) {
-        device_manager_stop_all(g_deviceManager);
-    }
-    log_info("[cleanup] devices stop_all issued");
-
-    // 2.1) 限时等待设备启动线程退出；先尝试 cancel，再 timedjoin
-#ifdef __linux__
-    if (g_devStartThread) {
-        log_info("[cleanup] joining device_start_thread...");
-        // 先请求取消（若 start_all 内部阻塞，join 可能等不到）
-        pthread_cancel(g_devStartThread);
-        struct timespec ts;
-        clock_gettime(CLOCK_REALTIME, &ts);
-        ts.tv_sec += 3; // 最多等 3 秒
-        if (pthread_timedjoin_np(g_devStartThread, NULL, &ts) != 0) {
-            log_warn("device_start_thread timed out, force cancel+join");
-            pthread_cancel(g_devStartThread);
-            pthread_join(g_devStartThread, NULL);
-        }
-        g_devStartThread = 0;
-    }
-#endif
-    log_info("[cleanup] device_start_thread done");
-
-    // 2.2) 释放设备管理器
-    log_info("[cleanup] freeing device manager...");
-    if (g_deviceManager) {
-        device_manager_free(g_deviceManager);
-        g_deviceManager = NULL;
-    }
-    log_info("[cleanup] device manager freed");
-
-    // 3) gRPC
     log_info("[cleanup] stopping gRPC...");
     if (g_grpcServer) {
         grpcserver_stop(g_grpcServer);
@@ -128,8 +95,34 @@ static void cleanup_resources(void) {
     }
     log_info("[cleanup] gRPC done");
 
-    // 4) MySQL
+    // 2) 设备：发停止令牌并等采集线程写完在途样本后退出（不取消线程）
+    log_info("[cleanup] stopping devices...");
+    if (g_deviceManager) {
+        device_manager_stop_all(g_deviceManager);
+    }
+    log_info("[cleanup] devices stopped");
+
+    // 2.1) stop_all 已置位停止标志，启动池不再领取设备，启动线程很快返回
+    if (g_devStartThread) {
+        log_info("[cleanup] joining device_start_thread...");
+        pthread_join(g_devStartThread, NULL);
+        g_devStartThread = 0;
+    }
+    log_info("[cleanup] device_start_thread done");
+
+    // 2.2) 释放设备管理器
+    log_info("[cleanup] freeing device manager...");
+    if (g_deviceManager) {
+        device_manager_free(g_deviceManager);
+        g_deviceManager = NULL;
+    }
+    twinhistory_shutdown();
+    log_info("[cleanup] device manager freed");
+
+    // 3) MySQL：采集线程已全部退出，写出未结束的汇总桶后再断开
     log_info("[cleanup] closing MySQL...");
+    mysql_recorder_stop_rollup();   // 写出未结束的汇总桶
+    mysql_recorder_set_db(NULL);
     if (g_mysql) {
         mysql_close_client(g_mysql);
         free(g_mysql->config.addr);
@@ -141,13 +134,16 @@ static void cleanup_resources(void) {
     }
     log_info("[cleanup] MySQL done");
 
-    // 5) Publisher
+    // 4) Publisher（MQTT 会在限定时间内等待在途消息确认）
     if (g_publisher) {
         publisher_free(g_publisher);
         g_publisher = NULL;
         log_info("[cleanup] publisher freed");
     }
 
+    // 5) 所有读者已退出，释放延迟回收的快照
+    epoch_shutdown();
+
     log_info("Cleanup completed");
 }
 
@@ -160,8 +156,6 @@ static void* grpc_server_thread(void *arg) {
 
 // 新增：设备启动线程函数（避免主线程阻塞在 start_all）
 static void* device_start_thread(void *arg) {
-    pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
-    pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED, NULL);
     DeviceManager *mgr = (DeviceManager*)arg;
     device_manager_start_all(mgr);
     return NULL;
@@ -271,6 +265,12 @@ int main(int argc, char **argv) {
                     log_error("MySQL self-test insert failed");
                 }
                 mysql_recorder_set_db(g_mysql);
+                if (config->database.rollup.enabled) {
+                    const DatabaseRollupConfig *rc = &config->database.rollup;
+                    if (mysql_recorder_start_rollup(rc->windows, rc->store_raw, rc->raw_retention) != 0) {
+                        log_warn("MySQL rollup not started, raw data only");
+                    }
+                }
             }
         }
     } else {
@@ -293,6 +293,12 @@ int main(int argc, char **argv) {
     }
 
     // 先创建 DeviceManager（供 gRPC 回调使用）
+    // 插件驱动须在创建任何设备客户端之前注册
+    if (config->common.driver_plugin_dir[0]) {
+        int loaded = driver_load_plugins(config->common.driver_plugin_dir);
+        log_info("Loaded %d driver plugin(s) from %s", loaded, config->common.driver_plugin_dir);
+    }
+
     g_deviceManager = device_manager_new();
     if (!g_deviceManager) {
         log_error("Failed to create device manager");
@@ -310,6 +316,7 @@ int main(int argc, char **argv) {
 
     log_info("Starting GRPC server on socket: %s", grpc_sock);
     ServerConfig *grpcConfig = server_config_new(grpc_sock, "customized");
+    server_config_set_tuning(grpcConfig, &config->grpc_server);
     g_grpcServer = grpcserver_new(grpcConfig, g_deviceManager);
     if (!g_grpcServer) {
         log_error("Failed to create GRPC server");
@@ -342,6 +349,11 @@ int main(int argc, char **argv) {
     }
     log_info("Mapper register finished (devices: %d, models: %d)", deviceCount, modelCount);
     
+    // 模型存入设备管理器，供后续 RegisterDevice/UpdateDeviceModel 增量使用
+    for (int j = 0; j < modelCount; j++) {
+        device_manager_put_model(g_deviceManager, &deviceModelList[j]);
+    }
+
     log_info("Initializing devices...");
     for (int i = 0; i < deviceCount; i++) {
         DeviceModel *model = NULL;
@@ -358,21 +370,31 @@ int main(int argc, char **argv) {
             continue;
         }
         
-        Device *device = device_new(&deviceList[i], model);
+        char name[128];   // 实例被接管后仍用于日志
+        snprintf(name, sizeof(name), "%s", deviceList[i].name ? deviceList[i].name : "(unknown)");
+        Device *device = device_new_move(&deviceList[i], model);
         if (!device) {
-            log_error("Failed to create device %s", deviceList[i].name);
+            log_error("Failed to create device %s", name);
             continue;
         }
         
         if (device_manager_add(g_deviceManager, device) != 0) {
-            log_error("Failed to add device %s to manager", deviceList[i].name);
+            log_error("Failed to add device %s to manager", name);
             device_free(device);
             continue;
         }
         
-        log_info("Device %s initialized successfully", deviceList[i].name);
+        log_info("Device %s initialized successfully", name);
     }
     
+    // 实例已被设备接管（未创建的在此释放），模型已复制到设备管理器
+    for (int i = 0; i < deviceCount; i++) device_instance_clear(&deviceList[i]);
+    free(deviceList);
+    deviceList = NULL;
+    for (int j = 0; j < modelCount; j++) device_model_clear(&deviceModelList[j]);
+    free(deviceModelList);
+    deviceModelList = NULL;
+
     if (g_deviceManager->deviceCount == 0) {
         log_warn("No devices initialized - mapper will run with empty device list");
     } else {
@@ -380,6 +402,28 @@ int main(int argc, char **argv) {
                  g_deviceManager->deviceCount);
     }
     
+    twinhistory_init(config->common.history_capacity > 0 ? (size_t)config->common.history_capacity : 0);
+
+    DeviceStartOptions startOpts = {
+        .concurrency = config->common.start_concurrency,
+        .initTimeoutMs = config->common.start_timeout_ms,
+        .backoffMinMs = config->common.reconnect_backoff_min_ms,
+        .backoffMaxMs = config->common.reconnect_backoff_max_ms,
+        .probeIntervalSec = config->common.health_probe_interval,
+    };
+    device_manager_set_start_options(g_deviceManager, &startOpts);
+
+    IoSchedOptions ioOpts = {
+        .endpointConcurrency = config->common.io_endpoint_concurrency,
+        .laneLimit = { [IO_LANE_TELEMETRY] = config->common.io_telemetry_concurrency },
+        .sloMs = {
+            [IO_LANE_CONTROL] = config->common.io_slo_control_ms,
+            [IO_LANE_ONDEMAND] = config->common.io_slo_ondemand_ms,
+            [IO_LANE_TELEMETRY] = config->common.io_slo_telemetry_ms,
+        },
+    };
+    iosched_configure(&ioOpts);
+
     log_info("Starting all devices...");
     // 原来是：device_manager_start_all(g_deviceManager);
     // 改为放到独立线程，避免主线程被阻塞，便于 Ctrl+C 立即生效
@@ -394,6 +438,12 @@ int main(int argc, char **argv) {
         if (!g_httpServer) {
             log_error("Failed to create HTTP server");
         } else {
+            rest_server_set_limits(g_httpServer, config->common.http_threads,
+                                   config->common.http_connection_limit,
+                                   config->common.http_connection_timeout);
+            rest_server_set_history_backends(g_httpServer,
+                config->database.redis.enabled ? config->database.redis.client_config : NULL,
+                config->database.tdengine.enabled ? config->database.tdengine.client_config : NULL);
             rest_server_start(g_httpServer);
             log_info("HTTP server started successfully");
         }
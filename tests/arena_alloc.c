@@ -0,0 +1,112 @@
+// arena：对齐与清零、块内连续分配、大块单独挂链不浪费当前块、字符串去重与扩容、溢出保护
+#include "common/arena.h"
+#include "data/publish/publisher.h"
+#include "tests/check.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+Publisher *g_publisher = NULL;
+
+static int all_zero(const void *p, size_t n) {
+    const unsigned char *b = p;
+    for (size_t i = 0; i < n; i++) {
+        if (b[i]) return 0;
+    }
+    return 1;
+}
+
+static void test_alloc(void) {
+    Arena *a = arena_new(256);
+    CHECK(a != NULL);
+    CHECK(arena_bytes(a) == 0);
+
+    // 8 字节对齐、已清零，同一块内依次排列
+    char *p1 = arena_alloc(a, 1);
+    char *p2 = arena_alloc(a, 13);
+    char *p3 = arena_alloc(a, 0);
+    CHECK(p1 && p2 && p3);
+    CHECK((uintptr_t)p1 % 8 == 0 && (uintptr_t)p2 % 8 == 0 && (uintptr_t)p3 % 8 == 0);
+    CHECK(p2 == p1 + 8);
+    CHECK(p3 == p2 + 16);
+    CHECK(all_zero(p2, 13));
+    memset(p2, 0xab, 13);
+    CHECK(arena_bytes(a) == 256);
+
+    // 当前块放不下、且超过块大小 1/4 的分配单独成块，当前块的剩余空间继续使用
+    char *big = arena_alloc(a, 240);
+    CHECK(big && all_zero(big, 240));
+    CHECK(arena_bytes(a) == 256 + 240);
+    char *p4 = arena_alloc(a, 8);
+    CHECK(p4 == p3 + 8);
+
+    // 当前块（已用 40）放不下的小分配换新块
+    char *fill[4];
+    for (int i = 0; i < 4; i++) fill[i] = arena_alloc(a, 64);
+    CHECK(fill[0] == p4 + 8 && fill[2] == fill[1] + 64);
+    CHECK(fill[3] && fill[3] != fill[2] + 64);
+    CHECK(arena_bytes(a) == 256 + 240 + 256);
+    CHECK(all_zero(fill[3], 64));
+
+    // 首次分配就超过块大小
+    Arena *b = arena_new(64);
+    char *huge = arena_alloc(b, 1000);
+    CHECK(huge && all_zero(huge, 1000));
+    CHECK(arena_bytes(b) == 1000);
+    arena_free(b);
+
+    // 溢出保护
+    CHECK(arena_alloc(a, SIZE_MAX) == NULL);
+    CHECK(arena_calloc(a, SIZE_MAX / 2, 4) == NULL);
+    int *arr = arena_calloc(a, 10, sizeof(int));
+    CHECK(arr && all_zero(arr, 10 * sizeof(int)));
+    CHECK(arena_alloc(NULL, 8) == NULL);
+
+    arena_free(a);
+    arena_free(NULL);
+}
+
+static void test_strdup(void) {
+    Arena *a = arena_new(0);
+    CHECK(arena_strdup(a, NULL) == NULL);
+    CHECK(arena_find(a, "temperature") == NULL);   // 去重表尚未建立
+
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%s", "temperature");
+    char *t1 = arena_strdup(a, buf);
+    char *t2 = arena_strdup(a, "temperature");
+    CHECK(t1 && t1 != buf && strcmp(t1, "temperature") == 0);
+    CHECK(t1 == t2);
+    CHECK(arena_find(a, "temperature") == t1);
+    CHECK(arena_find(a, "humidity") == NULL);
+    char *empty = arena_strdup(a, "");
+    CHECK(empty && empty[0] == '\0' && arena_strdup(a, "") == empty);
+
+    // 多次扩容后已有字符串仍去重到原指针
+    char *names[500];
+    for (int i = 0; i < 500; i++) {
+        snprintf(buf, sizeof(buf), "prop-%d", i);
+        names[i] = arena_strdup(a, buf);
+        CHECK(names[i] != NULL);
+    }
+    for (int i = 0; i < 500; i++) {
+        snprintf(buf, sizeof(buf), "prop-%d", i);
+        CHECK(arena_strdup(a, buf) == names[i]);
+        CHECK(arena_find(a, buf) == names[i]);
+    }
+    CHECK(arena_strdup(a, "temperature") == t1);
+
+    // 不同 arena 之间不共享
+    Arena *b = arena_new(0);
+    char *t3 = arena_strdup(b, "temperature");
+    CHECK(t3 && t3 != t1);
+    arena_free(b);
+    arena_free(a);
+}
+
+int main(void) {
+    test_alloc();
+    test_strdup();
+    printf("arena_alloc: ok\n");
+    return 0;
+}
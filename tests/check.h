@@ -0,0 +1,15 @@
+#ifndef TESTS_CHECK_H
+#define TESTS_CHECK_H
+
+// 测试断言：不受 NDEBUG 影响，失败时打印位置并以非 0 退出
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+        exit(1); \
+    } \
+} while (0)
+
+#endif // TESTS_CHECK_H
@@ -0,0 +1,89 @@
+// 连续的 UpdateDevice（每次都带 spec 和期望值）：spec 任务不应把写计划隔开，合并窗口内只下发一次
+// 不依赖时序：第一个 spec 执行时卡住该设备，其余请求全部在它执行期间到达；合并窗口设得很长，写计划只在 Stop 的 drain 中执行
+#include "grpcserver/applier.h"
+extern "C" {
+#include "data/publish/publisher.h"
+#include "tests/check.h"
+}
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+extern "C" {
+Publisher *g_publisher = NULL;
+}
+
+static std::mutex g_mu;
+static std::condition_variable g_cv;
+static bool g_firstSpecRunning = false;
+static bool g_releaseFirstSpec = false;
+static int g_writes = 0;
+static std::string g_lastValue;
+static int g_specs = 0;
+static int g_lastSpec = -1;
+
+static int record_write(const WritePlan &plan) {
+    std::lock_guard<std::mutex> lk(g_mu);
+    g_writes++;
+    for (const auto &item : plan.items) {
+        if (item.property == "setpoint") g_lastValue = item.value;
+    }
+    return 0;
+}
+
+static int run_spec(int generation) {
+    std::unique_lock<std::mutex> lk(g_mu);
+    g_specs++;
+    g_lastSpec = generation;
+    if (g_specs == 1) {
+        g_firstSpecRunning = true;
+        g_cv.notify_all();
+        g_cv.wait(lk, []() { return g_releaseFirstSpec; });
+    }
+    return 0;
+}
+
+// 与 updateDevice 相同：先提交 spec 任务，再提交同一请求的写计划
+static void update_device(DesiredApplier &applier, int generation) {
+    WritePlan plan;
+    plan.ns = "default";
+    plan.name = "thermostat";
+    plan.items.push_back(WritePlanItem{0, "setpoint", std::to_string(generation)});
+
+    WritePlan spec;
+    spec.ns = plan.ns;
+    spec.name = plan.name;
+    spec.spec = true;
+    spec.items = plan.items;
+    spec.task = [generation]() { return run_spec(generation); };
+    CHECK(applier.Submit(std::move(spec)));
+    CHECK(applier.Submit(std::move(plan)));
+}
+
+int main() {
+    const int n = 20;
+    DesiredApplier applier(64, 2, 3600 * 1000, record_write);
+    applier.Start();
+
+    update_device(applier, 0);
+    {
+        std::unique_lock<std::mutex> lk(g_mu);
+        g_cv.wait(lk, []() { return g_firstSpecRunning; });
+    }
+    for (int i = 1; i < n; i++) update_device(applier, i);
+    {
+        std::lock_guard<std::mutex> lk(g_mu);
+        g_releaseFirstSpec = true;
+    }
+    g_cv.notify_all();
+    applier.Stop();
+
+    std::printf("desired_applier: specs=%d writes=%d last=%s\n", g_specs, g_writes, g_lastValue.c_str());
+    // 第一个 spec 之后到达的 spec 只保留最新一个，写计划合并为一次
+    CHECK(g_specs == 2);
+    CHECK(g_lastSpec == n - 1);
+    CHECK(g_writes == 1);
+    CHECK(g_lastValue == std::to_string(n - 1));
+    return 0;
+}
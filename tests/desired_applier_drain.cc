@@ -0,0 +1,45 @@
+// Stop 时已入队的计划不丢弃：跳过合并窗口执行完，之后拒绝新计划
+#include "grpcserver/applier.h"
+extern "C" {
+#include "data/publish/publisher.h"
+#include "tests/check.h"
+}
+#include <mutex>
+#include <set>
+#include <string>
+
+extern "C" {
+Publisher *g_publisher = NULL;
+}
+
+static std::mutex g_mu;
+static std::set<std::string> g_applied;
+
+static int record_write(const WritePlan &plan) {
+    std::lock_guard<std::mutex> lk(g_mu);
+    g_applied.insert(plan.key());
+    return 0;
+}
+
+static WritePlan make_plan(const std::string &name) {
+    WritePlan plan;
+    plan.ns = "default";
+    plan.name = name;
+    plan.items.push_back(WritePlanItem{0, "setpoint", "1"});
+    return plan;
+}
+
+int main() {
+    // 合并窗口远长于 drain，计划只能靠 Stop 的 drain 执行
+    DesiredApplier applier(64, 2, 3600 * 1000, record_write);
+    applier.Start();
+    const char *names[] = {"a", "b", "c"};
+    for (const char *name : names) CHECK(applier.Submit(make_plan(name)));
+    applier.Stop();
+
+    CHECK(g_applied.size() == 3);
+    for (const char *name : names) CHECK(g_applied.count(std::string("default/") + name) == 1);
+    CHECK(!applier.Submit(make_plan("late")));
+    std::printf("desired_applier_drain: ok\n");
+    return 0;
+}
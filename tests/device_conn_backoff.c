@@ -0,0 +1,67 @@
+// 连得上但从不应答的设备：每次重连后采集都失败，退避应逐次翻倍而不是停在下限
+#include "device/device.h"
+#include "device/devicestatus.h"
+#include "data/publish/publisher.h"
+#include "common/epoch.h"
+#include "tests/check.h"
+#include <stdio.h>
+#include <string.h>
+
+Publisher *g_publisher = NULL;
+
+#define BACKOFF_MIN_MS 100
+#define BACKOFF_MAX_MS 100000
+
+// 一次重连：InitDevice 成功，随后每轮采集都失败直到转回 BACKOFF
+// 退避从转入 BACKOFF 的时刻算起，该时刻落在 [before, after] 内，退避时长因此落在 [*minDelay, *maxDelay] 内
+static void reconnect_then_fail(Device *d, long long *minDelay, long long *maxDelay) {
+    device_conn_set(d, DEVICE_CONN_CONNECTING, NULL);
+    device_conn_connected(d, 1);
+    CHECK(d->conn.state == DEVICE_CONN_ONLINE);
+    long long before = device_conn_now_ms();
+    while (d->conn.state != DEVICE_CONN_BACKOFF) device_conn_report(d, 0);
+    long long after = device_conn_now_ms();
+    *minDelay = d->conn.retryAtMs - after;
+    *maxDelay = d->conn.retryAtMs - before;
+}
+
+int main(void) {
+    DeviceStartOptions opts = {
+        .backoffMinMs = BACKOFF_MIN_MS,
+        .backoffMaxMs = BACKOFF_MAX_MS,
+        .probeIntervalSec = 0,
+    };
+    device_conn_configure(&opts);
+
+    DeviceModel model = { .name = "silent-model" };
+    DeviceInstance instance = { .name = "silent-device", .pProtocol = { .protocolName = "simulated" } };
+    Device *d = device_new(&instance, &model);
+    CHECK(d);
+
+    pthread_mutex_lock(&d->mutex);
+    long long full = BACKOFF_MIN_MS;
+    for (int attempt = 1; attempt <= 6; attempt++) {
+        long long lo, hi;
+        reconnect_then_fail(d, &lo, &hi);
+        CHECK(d->conn.attempts == attempt);
+        // 抖动取 [d/2, d]
+        CHECK(hi >= full / 2 && lo <= full);
+        full *= 2;
+    }
+
+    // 重连后有一轮采集成功才清零
+    device_conn_set(d, DEVICE_CONN_CONNECTING, NULL);
+    device_conn_connected(d, 1);
+    CHECK(d->conn.attempts == 6);
+    device_conn_report(d, 1);
+    CHECK(d->conn.attempts == 0);
+    long long lo, hi;
+    reconnect_then_fail(d, &lo, &hi);
+    CHECK(lo <= BACKOFF_MIN_MS);
+    pthread_mutex_unlock(&d->mutex);
+
+    device_free(d);
+    epoch_shutdown();
+    printf("device_conn_backoff: ok\n");
+    return 0;
+}
@@ -0,0 +1,89 @@
+// 启动超时后仍在后台跑的 device_start：初始化不持设备锁；停止/释放管理器要等它退出，且它不能再起采集线程
+#include "device/device.h"
+#include "driver/driver.h"
+#include "common/epoch.h"
+#include "data/publish/publisher.h"
+#include "tests/check.h"
+#include <stdio.h>
+#include <unistd.h>
+
+Publisher *g_publisher = NULL;
+
+#define INIT_MS 300
+#define TIMEOUT_MS 50
+
+static int g_inflight;   // 正在 InitDevice 中的启动
+static int g_reads;
+
+static int slow_init(CustomizedClient *client) {
+    __atomic_add_fetch(&g_inflight, 1, __ATOMIC_SEQ_CST);
+    usleep(INIT_MS * 1000);
+    __atomic_sub_fetch(&g_inflight, 1, __ATOMIC_SEQ_CST);
+    return 0;
+}
+
+static int slow_read(CustomizedClient *client, DriverReadItem *items, int n) {
+    __atomic_add_fetch(&g_reads, 1, __ATOMIC_SEQ_CST);
+    for (int i = 0; i < n; i++) items[i].rc = DRIVER_EIO;
+    return DRIVER_EIO;
+}
+
+static int slow_write(CustomizedClient *client, DriverWriteItem *items, int n) {
+    for (int i = 0; i < n; i++) items[i].rc = DRIVER_EIO;
+    return DRIVER_EIO;
+}
+
+static const DriverOps slow_driver = {
+    .abiVersion = DRIVER_ABI_VERSION,
+    .name = "test-slow",
+    .init = slow_init,
+    .read_batch = slow_read,
+    .write_batch = slow_write,
+};
+
+int main(void) {
+    CHECK(driver_register(&slow_driver) == 0);
+
+    DeviceManager *manager = device_manager_new();
+    CHECK(manager);
+    DeviceStartOptions opts = {
+        .concurrency = 2,
+        .initTimeoutMs = TIMEOUT_MS,
+        .backoffMinMs = 1000,
+        .backoffMaxMs = 1000,
+        .probeIntervalSec = 0,
+    };
+    device_manager_set_start_options(manager, &opts);
+
+    DeviceModel model = { .name = "slow-model" };
+    const char *names[2] = { "slow-a", "slow-b" };
+    for (int i = 0; i < 2; i++) {
+        DeviceInstance instance = { .name = (char*)names[i], .pProtocol = { .protocolName = "test-slow" } };
+        Device *d = device_new(&instance, &model);
+        CHECK(d);
+        CHECK(device_manager_add(manager, d) == 0);
+    }
+
+    // 两台都超时，启动线程转入后台
+    CHECK(device_manager_start_all(manager) != 0);
+    CHECK(__atomic_load_n(&g_inflight, __ATOMIC_SEQ_CST) > 0);
+    // 初始化在锁外进行，其他线程可以照常拿设备锁
+    for (int i = 0; i < 2; i++) {
+        Device *d = manager->devices[i];
+        CHECK(pthread_mutex_trylock(&d->mutex) == 0);
+        pthread_mutex_unlock(&d->mutex);
+    }
+
+    // 停止要等后台启动跑完；之后设备已关闭，再启动直接失败
+    CHECK(device_manager_stop_all(manager) == 0);
+    CHECK(__atomic_load_n(&g_inflight, __ATOMIC_SEQ_CST) == 0);
+    Device *d = manager->devices[0];
+    CHECK(d->dataThreadRunning == 0);
+    CHECK(device_start(d) != 0);
+    CHECK(d->dataThreadRunning == 0);
+
+    device_manager_free(manager);
+    epoch_shutdown();
+    printf("device_start_shutdown: ok\n");
+    return 0;
+}
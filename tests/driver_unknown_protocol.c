@@ -0,0 +1,40 @@
+// 未注册的协议不再悄悄换成 modbus-tcp：NewClient 返回 NULL，设备保留但不启动
+#include "device/device.h"
+#include "driver/driver.h"
+#include "common/epoch.h"
+#include "data/publish/publisher.h"
+#include "tests/check.h"
+#include <stdio.h>
+#include <string.h>
+
+Publisher *g_publisher = NULL;
+
+int main(void) {
+    ProtocolConfig proto = { .protocolName = "modbus-tpc" };
+    CHECK(NewClient(&proto) == NULL);
+
+    ProtocolConfig sim = { .protocolName = "simulated" };
+    CustomizedClient *client = NewClient(&sim);
+    CHECK(client != NULL);
+    // 模拟驱动的调度端点必须稳定，反复重建客户端不能产生新端点
+    CustomizedClient *again = NewClient(&sim);
+    CHECK(again != NULL);
+    CHECK(strcmp(client->endpoint, "simulated") == 0);
+    CHECK(strcmp(again->endpoint, client->endpoint) == 0);
+    FreeClient(again);
+    FreeClient(client);
+
+    DeviceModel model = { .name = "typo-model" };
+    DeviceInstance instance = { .name = "typo-device", .pProtocol = { .protocolName = "modbus-tpc" } };
+    Device *d = device_new(&instance, &model);
+    CHECK(d != NULL);
+    CHECK(d->client == NULL);
+    CHECK(device_start(d) != 0);
+    CHECK(d->conn.state == DEVICE_CONN_OFFLINE);
+    CHECK(d->dataThreadRunning == 0);
+
+    device_free(d);
+    epoch_shutdown();
+    printf("driver_unknown_protocol: ok\n");
+    return 0;
+}
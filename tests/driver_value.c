@@ -0,0 +1,130 @@
+// 驱动值槽：按类型提示解析、格式化、取整与跨类型相等
+#include "driver/driver.h"
+#include "data/publish/publisher.h"
+#include "tests/check.h"
+#include <stdio.h>
+#include <string.h>
+
+Publisher *g_publisher = NULL;
+
+static DriverValue parsed(const char *text, const char *hint) {
+    DriverValue v;
+    memset(&v, 0, sizeof(v));
+    driver_value_parse(&v, text, hint);
+    return v;
+}
+
+static const char *formatted(const DriverValue *v) {
+    static char buf[DRIVER_VALUE_STR_MAX];
+    if (driver_value_format(v, buf, sizeof(buf)) < 0) return NULL;
+    return buf;
+}
+
+static void test_parse(void) {
+    DriverValue v;
+    CHECK(driver_value_parse(&v, "-42", "int") == 0 && v.type == DRIVER_VALUE_INT && v.as.i == -42);
+    CHECK(driver_value_parse(&v, "7", "Integer") == 0 && v.type == DRIVER_VALUE_INT && v.as.i == 7);
+    CHECK(driver_value_parse(&v, "9000000000", "long") == 0 && v.as.i == 9000000000LL);
+    CHECK(driver_value_parse(&v, "25.5", "float") == 0 && v.type == DRIVER_VALUE_FLOAT && v.as.f == 25.5);
+    CHECK(driver_value_parse(&v, "1e3", "DOUBLE") == 0 && v.as.f == 1000.0);
+    CHECK(driver_value_parse(&v, "TRUE", "boolean") == 0 && v.type == DRIVER_VALUE_BOOL && v.as.i == 1);
+    CHECK(driver_value_parse(&v, "0", "bool") == 0 && v.type == DRIVER_VALUE_BOOL && v.as.i == 0);
+    CHECK(driver_value_parse(&v, "hello", "string") == 0 && v.type == DRIVER_VALUE_STRING);
+    CHECK(driver_value_parse(&v, "12", NULL) == 0 && v.type == DRIVER_VALUE_STRING && strcmp(v.as.s, "12") == 0);
+
+    // 与类型提示不符：按字符串保存并返回 -1
+    CHECK(driver_value_parse(&v, "25.5", "int") == -1 && v.type == DRIVER_VALUE_STRING);
+    CHECK(strcmp(v.as.s, "25.5") == 0);
+    CHECK(driver_value_parse(&v, "12abc", "float") == -1 && v.type == DRIVER_VALUE_STRING);
+    CHECK(driver_value_parse(&v, "", "int") == -1 && v.type == DRIVER_VALUE_STRING);
+    CHECK(driver_value_parse(&v, "yes", "boolean") == -1 && v.type == DRIVER_VALUE_STRING);
+    CHECK(driver_value_parse(&v, NULL, "int") == -1 && v.type == DRIVER_VALUE_NONE);
+    CHECK(driver_value_parse(NULL, "1", "int") == -1);
+
+    // 超长字符串截断到 DRIVER_VALUE_STR_MAX - 1 字节
+    char longText[200];
+    memset(longText, 'x', sizeof(longText) - 1);
+    longText[sizeof(longText) - 1] = '\0';
+    CHECK(driver_value_parse(&v, longText, NULL) == 0);
+    CHECK(strlen(v.as.s) == DRIVER_VALUE_STR_MAX - 1);
+}
+
+static void test_format(void) {
+    DriverValue v = parsed("-42", "int");
+    CHECK(strcmp(formatted(&v), "-42") == 0);
+    v = parsed("25.5", "float");
+    CHECK(strcmp(formatted(&v), "25.5") == 0);
+    v = parsed("0.1", "float");
+    CHECK(strcmp(formatted(&v), "0.1") == 0);
+    v = parsed("1", "boolean");
+    CHECK(strcmp(formatted(&v), "true") == 0);
+    v = parsed("false", "boolean");
+    CHECK(strcmp(formatted(&v), "false") == 0);
+    v = parsed("on", NULL);
+    CHECK(strcmp(formatted(&v), "on") == 0);
+
+    DriverValue none = {.type = DRIVER_VALUE_NONE};
+    CHECK(formatted(&none) == NULL);
+    char small[4];
+    v = parsed("123456", "int");
+    CHECK(driver_value_format(&v, small, sizeof(small)) == 6);   // 与 snprintf 一样返回完整长度
+    CHECK(strcmp(small, "123") == 0);
+    CHECK(driver_value_format(&v, small, 0) == -1);
+}
+
+static void test_int(void) {
+    long long i = -1;
+    DriverValue v = parsed("25.5", "float");
+    CHECK(driver_value_int(&v, &i) == 0 && i == 26);      // 四舍五入
+    v = parsed("-2.5", "float");
+    CHECK(driver_value_int(&v, &i) == 0 && i == -3);
+    v = parsed("true", "boolean");
+    CHECK(driver_value_int(&v, &i) == 0 && i == 1);
+    v = parsed("17", "int");
+    CHECK(driver_value_int(&v, &i) == 0 && i == 17);
+    v = parsed("ON", NULL);
+    CHECK(driver_value_int(&v, &i) == 0 && i == 1);
+    v = parsed("off", NULL);
+    CHECK(driver_value_int(&v, &i) == 0 && i == 0);
+    v = parsed("99.6", NULL);
+    CHECK(driver_value_int(&v, &i) == 0 && i == 100);
+    v = parsed("abc", NULL);
+    CHECK(driver_value_int(&v, &i) == -1);
+    DriverValue none = {.type = DRIVER_VALUE_NONE};
+    CHECK(driver_value_int(&none, &i) == -1);
+}
+
+static void test_equal(void) {
+    DriverValue a, b;
+    a = parsed("1", NULL);
+    b = parsed("true", "boolean");
+    CHECK(driver_value_equal(&a, &b));
+    a = parsed("5", "int");
+    b = parsed("5.0", NULL);
+    CHECK(driver_value_equal(&a, &b));
+    a = parsed("on", NULL);
+    b = parsed("1", "int");
+    CHECK(driver_value_equal(&a, &b));
+    a = parsed("25.5", "float");
+    b = parsed("26", "int");
+    CHECK(!driver_value_equal(&a, &b));
+    a = parsed("auto", NULL);
+    b = parsed("auto", NULL);
+    CHECK(driver_value_equal(&a, &b));
+    b = parsed("Auto", NULL);
+    CHECK(!driver_value_equal(&a, &b));
+    b = parsed("0", "int");
+    CHECK(!driver_value_equal(&a, &b));
+    DriverValue none = {.type = DRIVER_VALUE_NONE};
+    CHECK(!driver_value_equal(&none, &none));
+    CHECK(!driver_value_equal(&a, NULL));
+}
+
+int main(void) {
+    test_parse();
+    test_format();
+    test_int();
+    test_equal();
+    printf("driver_value: ok\n");
+    return 0;
+}
@@ -0,0 +1,157 @@
+// iosched：高优先级通道先放行、通道并发上限、同一通道按排队号先来先服务
+// 不依赖时序：每个等待者确认已排上队（iosched_stats 的 queued）后才进行下一步
+#include "device/iosched.h"
+#include "data/publish/publisher.h"
+#include "tests/check.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+Publisher *g_publisher = NULL;
+
+typedef struct {
+    const char *endpoint;
+    IoLane lane;
+    int id;
+    pthread_t thread;
+} Waiter;
+
+static pthread_mutex_t g_mu = PTHREAD_MUTEX_INITIALIZER;
+static int g_order[16];
+static int g_granted = 0;
+
+static void lane_counts(const char *endpoint, IoLane lane, int *inflight, int *queued) {
+    IoLaneStats *stats = NULL;
+    int n = iosched_stats(&stats);
+    *inflight = *queued = 0;
+    for (int i = 0; i < n; i++) {
+        if (stats[i].lane == lane && strcmp(stats[i].endpoint, endpoint) == 0) {
+            *inflight = stats[i].inflight;
+            *queued = stats[i].queued;
+        }
+    }
+    free(stats);
+}
+
+static int lane_queued(const char *endpoint, IoLane lane) {
+    int inflight, queued;
+    lane_counts(endpoint, lane, &inflight, &queued);
+    return queued;
+}
+
+static void wait_queued(const char *endpoint, IoLane lane, int want) {
+    while (lane_queued(endpoint, lane) < want) usleep(1000);
+}
+
+// 放行后记下自己的 id 立即归还
+static void *waiter_run(void *arg) {
+    Waiter *w = arg;
+    IoSlot slot;
+    iosched_acquire(w->endpoint, w->lane, &slot);
+    pthread_mutex_lock(&g_mu);
+    g_order[g_granted++] = w->id;
+    pthread_mutex_unlock(&g_mu);
+    iosched_release(&slot, 1);
+    return NULL;
+}
+
+static void spawn(Waiter *w, const char *endpoint, IoLane lane, int id) {
+    w->endpoint = endpoint;
+    w->lane = lane;
+    w->id = id;
+    CHECK(pthread_create(&w->thread, NULL, waiter_run, w) == 0);
+    wait_queued(endpoint, lane, 1);
+}
+
+static void reset_order(void) {
+    pthread_mutex_lock(&g_mu);
+    g_granted = 0;
+    pthread_mutex_unlock(&g_mu);
+}
+
+// 端点只有一个名额：先排队的采集也要让给后到的控制写，再让给按需读
+static void test_lane_priority(void) {
+    IoSchedOptions opts = {.endpointConcurrency = 1};
+    iosched_configure(&opts);
+    const char *ep = "test/priority";
+    reset_order();
+
+    IoSlot held;
+    iosched_acquire(ep, IO_LANE_TELEMETRY, &held);
+    Waiter telemetry, ondemand, control;
+    spawn(&telemetry, ep, IO_LANE_TELEMETRY, IO_LANE_TELEMETRY);
+    spawn(&ondemand, ep, IO_LANE_ONDEMAND, IO_LANE_ONDEMAND);
+    spawn(&control, ep, IO_LANE_CONTROL, IO_LANE_CONTROL);
+    iosched_release(&held, 1);
+    pthread_join(telemetry.thread, NULL);
+    pthread_join(ondemand.thread, NULL);
+    pthread_join(control.thread, NULL);
+
+    CHECK(g_granted == 3);
+    CHECK(g_order[0] == IO_LANE_CONTROL);
+    CHECK(g_order[1] == IO_LANE_ONDEMAND);
+    CHECK(g_order[2] == IO_LANE_TELEMETRY);
+}
+
+// 采集通道上限 1：端点还有空闲名额时第二个采集仍要等，按需读不受影响
+static void test_lane_limit(void) {
+    IoSchedOptions opts = {.endpointConcurrency = 2, .laneLimit = {0, 0, 1}};
+    iosched_configure(&opts);
+    const char *ep = "test/limit";
+    reset_order();
+
+    IoSlot first;
+    iosched_acquire(ep, IO_LANE_TELEMETRY, &first);
+    Waiter second;
+    spawn(&second, ep, IO_LANE_TELEMETRY, 1);
+
+    IoSlot read;
+    iosched_acquire(ep, IO_LANE_ONDEMAND, &read);   // 不阻塞
+    iosched_release(&read, 1);
+    int inflight, queued;
+    lane_counts(ep, IO_LANE_TELEMETRY, &inflight, &queued);
+    CHECK(inflight == 1);
+    CHECK(queued == 1);
+    CHECK(g_granted == 0);
+
+    iosched_release(&first, 1);
+    pthread_join(second.thread, NULL);
+    CHECK(g_granted == 1);
+    lane_counts(ep, IO_LANE_TELEMETRY, &inflight, &queued);
+    CHECK(inflight == 0 && queued == 0);
+}
+
+// 同一通道按排队顺序放行
+static void test_fifo(void) {
+    IoSchedOptions opts = {.endpointConcurrency = 1};
+    iosched_configure(&opts);
+    const char *ep = "test/fifo";
+    reset_order();
+
+    IoSlot held;
+    iosched_acquire(ep, IO_LANE_CONTROL, &held);
+    enum { N = 6 };
+    Waiter waiters[N];
+    for (int i = 0; i < N; i++) {
+        waiters[i].endpoint = ep;
+        waiters[i].lane = IO_LANE_ONDEMAND;
+        waiters[i].id = i;
+        CHECK(pthread_create(&waiters[i].thread, NULL, waiter_run, &waiters[i]) == 0);
+        wait_queued(ep, IO_LANE_ONDEMAND, i + 1);
+    }
+    iosched_release(&held, 1);
+    for (int i = 0; i < N; i++) pthread_join(waiters[i].thread, NULL);
+
+    CHECK(g_granted == N);
+    for (int i = 0; i < N; i++) CHECK(g_order[i] == i);
+}
+
+int main(void) {
+    test_lane_priority();
+    test_lane_limit();
+    test_fifo();
+    printf("iosched_lanes: ok\n");
+    return 0;
+}
@@ -0,0 +1,166 @@
+// rollup：窗口对齐与 min/max/avg/count/last、非数值样本、迟到样本、待写出环形缓冲溢出、时长与窗口解析
+// 样本时间都在很久以前，不启动后台线程，由 rollup_stop 同步写出，结果与当前时间无关
+#include "data/rollup/rollup.h"
+#include "data/publish/publisher.h"
+#include "tests/check.h"
+#include <stdio.h>
+#include <string.h>
+
+Publisher *g_publisher = NULL;
+
+typedef struct {
+    char ns[32];
+    char device[32];
+    long long windowSec;
+    long long startSec;
+    long long count;
+    long long numericCount;
+    double min, max, avg;
+    char last[ROLLUP_LAST_MAX];
+} Written;
+
+static Written g_out[256];
+static int g_n = 0;
+
+static int record(void *arg, const RollupPoint *p) {
+    CHECK(g_n < 256);
+    Written *w = &g_out[g_n++];
+    snprintf(w->ns, sizeof(w->ns), "%s", p->ns);
+    snprintf(w->device, sizeof(w->device), "%s", p->device);
+    w->windowSec = p->windowSec;
+    w->startSec = p->startSec;
+    w->count = p->count;
+    w->numericCount = p->numericCount;
+    w->min = p->min;
+    w->max = p->max;
+    w->avg = p->avg;
+    snprintf(w->last, sizeof(w->last), "%s", p->last);
+    return 0;
+}
+
+static const Written *find(const char *device, long long windowSec, long long startSec) {
+    for (int i = 0; i < g_n; i++) {
+        if (strcmp(g_out[i].device, device) == 0 && g_out[i].windowSec == windowSec &&
+            g_out[i].startSec == startSec) return &g_out[i];
+    }
+    return NULL;
+}
+
+static void test_parse(void) {
+    CHECK(rollup_parse_duration("10s") == 10);
+    CHECK(rollup_parse_duration("1m") == 60);
+    CHECK(rollup_parse_duration(" 2H ") == 7200);
+    CHECK(rollup_parse_duration("1d") == 86400);
+    CHECK(rollup_parse_duration("30") == 30);
+    CHECK(rollup_parse_duration("") == -1);
+    CHECK(rollup_parse_duration("m") == -1);
+    CHECK(rollup_parse_duration("-1s") == -1);
+    CHECK(rollup_parse_duration("5y") == -1);
+    CHECK(rollup_parse_duration("1m5") == -1);
+    CHECK(rollup_parse_duration(NULL) == -1);
+
+    long long w[ROLLUP_MAX_WINDOWS];
+    CHECK(rollup_parse_windows("10s,1m,1h", w, ROLLUP_MAX_WINDOWS) == 3);
+    CHECK(w[0] == 10 && w[1] == 60 && w[2] == 3600);
+    CHECK(rollup_parse_windows(",,5m,", w, ROLLUP_MAX_WINDOWS) == 1 && w[0] == 300);
+    CHECK(rollup_parse_windows("1s,2s,3s,4s,5s", w, ROLLUP_MAX_WINDOWS) == -1);
+    CHECK(rollup_parse_windows("10s,0s", w, ROLLUP_MAX_WINDOWS) == -1);
+    CHECK(rollup_parse_windows("10s,abc", w, ROLLUP_MAX_WINDOWS) == -1);
+
+    char label[16];
+    rollup_window_label(10, label, sizeof(label));
+    CHECK(strcmp(label, "10s") == 0);
+    rollup_window_label(120, label, sizeof(label));
+    CHECK(strcmp(label, "2m") == 0);
+    rollup_window_label(3600, label, sizeof(label));
+    CHECK(strcmp(label, "1h") == 0);
+    rollup_window_label(172800, label, sizeof(label));
+    CHECK(strcmp(label, "2d") == 0);
+    rollup_window_label(90, label, sizeof(label));
+    CHECK(strcmp(label, "90s") == 0);
+}
+
+static void test_aggregate(void) {
+    RollupOptions opts = {.windows = {10, 60}, .windowCount = 2, .storeRaw = 1};
+    RollupSink sink = {.write = record};
+    RollupEngine *e = rollup_new(&opts, &sink);
+    CHECK(e != NULL);
+    g_n = 0;
+
+    CHECK(rollup_ingest(e, NULL, "pump", "flow", "1", 1000 * 1000) == 0);
+    CHECK(rollup_ingest(e, NULL, "pump", "flow", "3", 1005 * 1000) == 0);
+    CHECK(rollup_ingest(e, NULL, "pump", "flow", "abc", 1009 * 1000 + 999) == 0);
+    CHECK(rollup_ingest(e, NULL, "pump", "flow", "5", 1010 * 1000) == 0);
+    // 迟到：10s 窗口的 [1000, 1010) 桶已关闭而被忽略，仍落在 60s 窗口未关闭的 [960, 1020) 桶内
+    CHECK(rollup_ingest(e, NULL, "pump", "flow", "9", 1002 * 1000) == 0);
+    CHECK(rollup_ingest(e, NULL, "pump", "flow", "7", 1061 * 1000) == 0);
+    CHECK(rollup_ingest(e, "plant", "fan", "on", "true", 1000 * 1000) == 0);
+    CHECK(rollup_ingest(e, NULL, NULL, "flow", "1", 0) == -1);
+
+    rollup_stop(e, 1);
+    CHECK(g_n == 5 + 2);
+
+    const Written *w = find("pump", 10, 1000);
+    CHECK(w && strcmp(w->ns, "default") == 0);
+    CHECK(w->count == 3 && w->numericCount == 2);
+    CHECK(w->min == 1 && w->max == 3 && w->avg == 2);
+    CHECK(strcmp(w->last, "abc") == 0);
+    w = find("pump", 10, 1010);
+    CHECK(w && w->count == 1 && w->min == 5 && strcmp(w->last, "5") == 0);
+    w = find("pump", 10, 1060);
+    CHECK(w && w->count == 1 && w->avg == 7);
+    w = find("pump", 60, 960);
+    CHECK(w && w->count == 5 && w->numericCount == 4);
+    CHECK(w->min == 1 && w->max == 9 && w->avg == 4.5);
+    CHECK(strcmp(w->last, "9") == 0);
+    w = find("pump", 60, 1020);
+    CHECK(w && w->count == 1 && strcmp(w->last, "7") == 0);
+
+    w = find("fan", 10, 1000);
+    CHECK(w && strcmp(w->ns, "plant") == 0);
+    CHECK(w->count == 1 && w->numericCount == 0 && strcmp(w->last, "true") == 0);
+    CHECK(find("fan", 60, 960) != NULL);
+    rollup_free(e);
+}
+
+// 每秒一个桶，写出前关闭 70 个：环形缓冲只留最新的 ROLLUP_RING_SIZE 个
+static void test_ring_overflow(void) {
+    RollupOptions opts = {.windows = {1}, .windowCount = 1};
+    RollupSink sink = {.write = record};
+    RollupEngine *e = rollup_new(&opts, &sink);
+    CHECK(e != NULL);
+    g_n = 0;
+    const long long base = 5000;
+    for (int i = 0; i < 70; i++) {
+        char v[16];
+        snprintf(v, sizeof(v), "%d", i);
+        CHECK(rollup_ingest(e, NULL, "meter", "kwh", v, (base + i) * 1000) == 0);
+    }
+    rollup_stop(e, 1);
+    CHECK(g_n == ROLLUP_RING_SIZE);
+    CHECK(g_out[0].startSec == base + 70 - ROLLUP_RING_SIZE);
+    CHECK(g_out[g_n - 1].startSec == base + 69);
+    for (int i = 1; i < g_n; i++) CHECK(g_out[i].startSec == g_out[i - 1].startSec + 1);
+    rollup_free(e);
+}
+
+static void test_invalid(void) {
+    RollupSink sink = {.write = record};
+    RollupSink noWrite = {0};
+    RollupOptions none = {.windowCount = 0};
+    RollupOptions tooMany = {.windowCount = ROLLUP_MAX_WINDOWS + 1};
+    RollupOptions ok = {.windows = {60}, .windowCount = 1};
+    CHECK(rollup_new(&none, &sink) == NULL);
+    CHECK(rollup_new(&tooMany, &sink) == NULL);
+    CHECK(rollup_new(&ok, &noWrite) == NULL);
+    CHECK(rollup_store_raw(NULL) == 1);
+}
+
+int main(void) {
+    test_parse();
+    test_aggregate();
+    test_ring_overflow();
+    test_invalid();
+    printf("rollup_windows: ok\n");
+    return 0;
+}
@@ -0,0 +1,93 @@
+// 路由树：静态段优先并可回溯到参数段、参数原地截断、方法不允许时返回可用方法
+#include "httpserver/router.h"
+#include "data/publish/publisher.h"
+#include "tests/check.h"
+#include <stdio.h>
+#include <string.h>
+
+Publisher *g_publisher = NULL;
+
+static int h_get_device(void *ctx, struct MHD_Connection *c, const RouteMatch *m, const char *b, size_t n) { return 1; }
+static int h_put_device(void *ctx, struct MHD_Connection *c, const RouteMatch *m, const char *b, size_t n) { return 2; }
+static int h_health(void *ctx, struct MHD_Connection *c, const RouteMatch *m, const char *b, size_t n) { return 3; }
+static int h_static(void *ctx, struct MHD_Connection *c, const RouteMatch *m, const char *b, size_t n) { return 4; }
+static int h_param_tail(void *ctx, struct MHD_Connection *c, const RouteMatch *m, const char *b, size_t n) { return 5; }
+static int h_replaced(void *ctx, struct MHD_Connection *c, const RouteMatch *m, const char *b, size_t n) { return 6; }
+
+// path 复制到可写缓冲后查找，返回 router_lookup 的结果
+static int lookup(const Router *r, const char *method, const char *path, char *buf, size_t buflen,
+                  RouteMatch *m, RouteHandler *h, unsigned int *allowed) {
+    snprintf(buf, buflen, "%s", path);
+    *h = NULL;
+    return router_lookup(r, router_method_from_string(method), buf, m, h, allowed);
+}
+
+int main(void) {
+    Router *r = router_new();
+    CHECK(r != NULL);
+    CHECK(router_add(r, ROUTE_GET, "/api/v1/device/{namespace}/{name}/{property}", h_get_device) == 0);
+    CHECK(router_add(r, ROUTE_PUT | ROUTE_POST, "/api/v1/device/{namespace}/{name}/{property}", h_put_device) == 0);
+    CHECK(router_add(r, ROUTE_GET, "/api/v1/health", h_health) == 0);
+    CHECK(router_add(r, ROUTE_GET, "/a/b/c", h_static) == 0);
+    CHECK(router_add(r, ROUTE_GET, "/a/{p}/x", h_param_tail) == 0);
+    CHECK(router_add(r, ROUTE_GET, "relative", h_health) == -1);
+    CHECK(router_add(r, ROUTE_GET, "/{1}/{2}/{3}/{4}/{5}/{6}/{7}/{8}/{9}", h_health) == -1);
+
+    char buf[256];
+    RouteMatch m;
+    RouteHandler h;
+    unsigned int allowed = 0;
+
+    // 参数按顺序返回，并在请求缓冲中原地以 '\0' 结尾
+    CHECK(lookup(r, "GET", "/api/v1/device/default/pump-1/flow", buf, sizeof(buf), &m, &h, &allowed) == 0);
+    CHECK(h == h_get_device);
+    CHECK(m.count == 3);
+    CHECK(strcmp(m.params[0].ptr, "default") == 0 && m.params[0].len == 7);
+    CHECK(strcmp(m.params[1].ptr, "pump-1") == 0);
+    CHECK(strcmp(m.params[2].ptr, "flow") == 0);
+    CHECK(m.params[0].ptr >= buf && m.params[2].ptr < buf + sizeof(buf));
+    CHECK(allowed == (ROUTE_GET | ROUTE_PUT | ROUTE_POST));
+
+    CHECK(lookup(r, "POST", "/api/v1/device/ns/dev/prop", buf, sizeof(buf), &m, &h, &allowed) == 0);
+    CHECK(h == h_put_device);
+
+    // 重复与结尾的 '/' 被忽略
+    CHECK(lookup(r, "GET", "//api/v1//health/", buf, sizeof(buf), &m, &h, &allowed) == 0);
+    CHECK(h == h_health && m.count == 0);
+
+    // 静态段优先；其后失配时回溯到同层的参数段
+    CHECK(lookup(r, "GET", "/a/b/c", buf, sizeof(buf), &m, &h, &allowed) == 0);
+    CHECK(h == h_static && m.count == 0);
+    CHECK(lookup(r, "GET", "/a/b/x", buf, sizeof(buf), &m, &h, &allowed) == 0);
+    CHECK(h == h_param_tail && m.count == 1 && strcmp(m.params[0].ptr, "b") == 0);
+
+    // 路径存在但方法不允许：-2，并给出可用方法
+    CHECK(lookup(r, "DELETE", "/api/v1/device/ns/dev/prop", buf, sizeof(buf), &m, &h, &allowed) == -2);
+    CHECK(h == NULL);
+    CHECK(allowed == (ROUTE_GET | ROUTE_PUT | ROUTE_POST));
+    char allow[64];
+    router_format_allow(allowed, allow, sizeof(allow));
+    CHECK(strcmp(allow, "GET, PUT, POST") == 0);
+    router_format_allow(ROUTE_DELETE, allow, sizeof(allow));
+    CHECK(strcmp(allow, "DELETE") == 0);
+    router_format_allow(ROUTE_GET | ROUTE_PUT, allow, 6);    // 放不下的方法不输出半截
+    CHECK(strcmp(allow, "GET") == 0);
+    CHECK(lookup(r, "PATCH", "/api/v1/health", buf, sizeof(buf), &m, &h, &allowed) == -2);
+    CHECK(router_method_from_string("PATCH") == 0);
+
+    // 中间节点、过长或未知路径都不命中
+    CHECK(lookup(r, "GET", "/api/v1/device/ns/dev", buf, sizeof(buf), &m, &h, &allowed) == -1);
+    CHECK(allowed == 0);
+    CHECK(lookup(r, "GET", "/api/v1/device/ns/dev/prop/extra", buf, sizeof(buf), &m, &h, &allowed) == -1);
+    CHECK(lookup(r, "GET", "/nope", buf, sizeof(buf), &m, &h, &allowed) == -1);
+    CHECK(lookup(r, "GET", "/", buf, sizeof(buf), &m, &h, &allowed) == -1);
+
+    // 同一路径同一方法再次注册时覆盖
+    CHECK(router_add(r, ROUTE_GET, "/api/v1/health", h_replaced) == 0);
+    CHECK(lookup(r, "GET", "/api/v1/health", buf, sizeof(buf), &m, &h, &allowed) == 0);
+    CHECK(h == h_replaced);
+
+    router_free(r);
+    printf("router_match: ok\n");
+    return 0;
+}
@@ -0,0 +1,139 @@
+// tsblock 编码/解码往返：二阶差分的每个分桶及其边界、64 位转义、大幅时间跳变、重复值与 NaN/Inf/-0
+#include "common/tsblock.h"
+#include "data/publish/publisher.h"
+#include "tests/check.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+Publisher *g_publisher = NULL;
+
+#define MAX_POINTS 4096
+
+static int64_t g_ts[MAX_POINTS];
+static double g_values[MAX_POINTS];
+static size_t g_count;
+
+static void add(int64_t ts, double v) {
+    CHECK(g_count < MAX_POINTS);
+    g_ts[g_count] = ts;
+    g_values[g_count] = v;
+    g_count++;
+}
+
+// 按给定二阶差分追加下一个点
+static void add_dod(int64_t dod, double v) {
+    int64_t prev = g_ts[g_count - 1];
+    int64_t delta = g_count >= 2 ? (int64_t)((uint64_t)prev - (uint64_t)g_ts[g_count - 2]) : 0;
+    add((int64_t)((uint64_t)prev + (uint64_t)delta + (uint64_t)dod), v);
+}
+
+static uint64_t bits_of(double v) {
+    uint64_t u;
+    memcpy(&u, &v, sizeof(u));
+    return u;
+}
+
+// 编码全部点后按 chunk 分批解码，时间戳与数值的位模式都须一致
+static void roundtrip(const char *name, size_t chunk, int seal) {
+    TsBlock block;
+    tsblock_init(&block);
+    for (size_t i = 0; i < g_count; i++) CHECK(tsblock_append(&block, g_ts[i], g_values[i]) == 0);
+    if (seal) tsblock_seal(&block);
+    CHECK(block.count == g_count);
+
+    int64_t ts[64];
+    double values[64];
+    TsBlockIter it;
+    tsblock_iter_init(&it, &block);
+    size_t got = 0, k;
+    while ((k = tsblock_decode(&it, ts, values, chunk)) > 0) {
+        CHECK(k <= chunk);
+        for (size_t i = 0; i < k; i++) {
+            CHECK(got + i < g_count);
+            if (ts[i] != g_ts[got + i] || bits_of(values[i]) != bits_of(g_values[got + i])) {
+                fprintf(stderr, "%s: point %zu: got (%lld, %a) want (%lld, %a)\n", name, got + i,
+                        (long long)ts[i], values[i], (long long)g_ts[got + i], g_values[got + i]);
+                exit(1);
+            }
+        }
+        got += k;
+    }
+    CHECK(got == g_count);
+    CHECK(it.pos == block.bits);
+    tsblock_free(&block);
+}
+
+static void check_all(const char *name) {
+    roundtrip(name, 1, 0);
+    roundtrip(name, 7, 1);
+    roundtrip(name, 64, 1);
+}
+
+int main(void) {
+    // 每个分桶的两端及桶外第一个值：1 位 0；7 位 [-63, 64]；9 位 [-255, 256]；12 位 [-2047, 2048]；其余 64 位转义
+    static const int64_t dods[] = {
+        0, 1, -1, 64, -63, 65, -64, 256, -255, 257, -256, 2048, -2047, 2049, -2048,
+        100000, -100000, 0, 0, 5, -5,
+    };
+    g_count = 0;
+    add(1700000000000LL, 20.0);
+    add(1700000001000LL, 20.0);
+    for (size_t i = 0; i < sizeof(dods) / sizeof(dods[0]); i++) add_dod(dods[i], 20.0 + (double)i * 0.25);
+    check_all("dod buckets");
+
+    // 大幅时间跳变：差值超出 int64 时靠无符号回绕编码，解码须还原原值
+    g_count = 0;
+    add(INT64_MIN, 1.0);
+    add(0, 1.0);
+    add(INT64_MAX, 1.0);
+    add(INT64_MAX, 1.0);
+    add(-1, 2.0);
+    add(INT64_MIN + 1, 3.0);
+    add(1, 4.0);
+    check_all("time jumps");
+
+    // 重复值、NaN、无穷、±0、次正规数（与 0 异或的前导零超过 5 位能表示的 31）与有效位达 64 的异或
+    g_count = 0;
+    double special[] = {
+        0.0, 0.0, 5e-324, 0.0, -0.0, 0.0, NAN, NAN, -NAN, INFINITY, -INFINITY, INFINITY,
+        5e-324, -5e-324, 1.0, -1.0, 1.0, 1.0, 1.0, 1e308, -1e-308, 123.456, 123.456,
+    };
+    uint64_t allOnes = 0x7ff8000000000001ULL;    // 带 payload 的 NaN
+    double payloadNan;
+    memcpy(&payloadNan, &allOnes, sizeof(payloadNan));
+    for (size_t i = 0; i < sizeof(special) / sizeof(special[0]); i++) add(1000 + (int64_t)i * 1000, special[i]);
+    add(30000, payloadNan);
+    add(31000, -payloadNan);
+    add(32000, payloadNan);
+    check_all("special values");
+
+    // 单点块
+    g_count = 0;
+    add(42, NAN);
+    check_all("single point");
+
+    // 伪随机序列：不规则间隔与随机位模式，覆盖有效位窗口的复用与重建
+    srand(12345);
+    g_count = 0;
+    int64_t t = 0;
+    for (int i = 0; i < MAX_POINTS; i++) {
+        int r = rand() % 8;
+        if (r < 3) t += 1000;
+        else if (r < 5) t += 1000 + rand() % 300 - 150;
+        else if (r < 7) t += rand() % 5000;
+        else t += (int64_t)rand() * 1000;
+        uint64_t u = ((uint64_t)rand() << 40) ^ ((uint64_t)rand() << 20) ^ (uint64_t)rand();
+        double v;
+        if (rand() % 4 == 0) v = g_count ? g_values[g_count - 1] : 0.0;
+        else if (rand() % 2) v = (double)(rand() % 1000) / 10.0;
+        else memcpy(&v, &u, sizeof(v));
+        add(t, v);
+    }
+    check_all("random");
+
+    printf("tsblock_roundtrip: ok\n");
+    return 0;
+}
@@ -0,0 +1,165 @@
+// desired 与驱动换算后的读回值对齐：线圈读回 true/false、浮点写入寄存器被取整后，不应反复下发
+#include "device/device.h"
+#include "driver/driver.h"
+#include "common/epoch.h"
+#include "data/publish/publisher.h"
+#include "tests/check.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <cjson/cJSON.h>
+
+Publisher *g_publisher = NULL;
+
+// 仿 Modbus 的内存驱动：线圈存布尔，寄存器存 16 位整数，记录写入次数
+#define REGS 16
+static long long g_regs[REGS];
+static int g_writes;
+
+static int regs_addr(const VisitorConfig *v, int *coil) {
+    cJSON *cfg = NULL;
+    cJSON *root = driver_config_parse(v ? v->configData : NULL, &cfg);
+    char reg[32];
+    driver_config_str(cfg, "register", "HoldingRegister", reg, sizeof(reg));
+    *coil = strcasecmp(reg, "CoilRegister") == 0;
+    int offset = driver_config_int(cfg, "offset", -1);
+    cJSON_Delete(root);
+    return offset >= 0 && offset < REGS ? offset : -1;
+}
+
+static int regs_read(CustomizedClient *client, DriverReadItem *items, int n) {
+    for (int i = 0; i < n; i++) {
+        int coil, a = regs_addr(items[i].visitor, &coil);
+        if (a < 0) { items[i].rc = DRIVER_ENOADDR; continue; }
+        items[i].value.type = coil ? DRIVER_VALUE_BOOL : DRIVER_VALUE_INT;
+        items[i].value.as.i = g_regs[a];
+        items[i].rc = DRIVER_OK;
+    }
+    return DRIVER_OK;
+}
+
+static int regs_write(CustomizedClient *client, DriverWriteItem *items, int n) {
+    for (int i = 0; i < n; i++) {
+        long long word;
+        int coil, a = regs_addr(items[i].visitor, &coil);
+        if (a < 0 || driver_value_int(&items[i].value, &word) != 0) { items[i].rc = DRIVER_EINVAL; continue; }
+        g_regs[a] = coil ? word != 0 : word;
+        items[i].value.type = coil ? DRIVER_VALUE_BOOL : DRIVER_VALUE_INT;
+        items[i].value.as.i = g_regs[a];
+        items[i].rc = DRIVER_OK;
+        g_writes++;
+    }
+    return DRIVER_OK;
+}
+
+static const DriverOps regs_driver = {
+    .abiVersion = DRIVER_ABI_VERSION,
+    .name = "test-regs",
+    .read_batch = regs_read,
+    .write_batch = regs_write,
+};
+
+// 一轮写入：prepare / execute / commit，返回下发次数
+static int write_round(Device *d) {
+    DeviceTwinWrite w[4];
+    int n = 0;
+    int before = g_writes;
+    epoch_read_enter();
+    pthread_mutex_lock(&d->mutex);
+    for (int i = 0; i < d->instance.twinsCount; i++) {
+        if (device_twin_write_prepare(d, &d->instance.twins[i], &w[n]) == 1) n++;
+    }
+    pthread_mutex_unlock(&d->mutex);
+    device_twin_write_execute_batch(w, n);
+    pthread_mutex_lock(&d->mutex);
+    for (int i = 0; i < n; i++) device_twin_write_commit(d, &w[i]);
+    pthread_mutex_unlock(&d->mutex);
+    epoch_read_exit();
+    return g_writes - before;
+}
+
+// 一轮采集：按驱动读回值更新 reported
+static void read_round(Device *d) {
+    pthread_mutex_lock(&d->mutex);
+    for (int i = 0; i < d->instance.twinsCount; i++) {
+        Twin *tw = &d->instance.twins[i];
+        VisitorConfig v = { .propertyName = tw->propertyName, .configData = tw->property->visitors };
+        DriverReadItem item = { .visitor = &v };
+        char buf[DRIVER_VALUE_STR_MAX];
+        regs_read(NULL, &item, 1);
+        driver_value_format(&item.value, buf, sizeof(buf));
+        device_twin_set_reported(d, tw, buf);
+    }
+    pthread_mutex_unlock(&d->mutex);
+}
+
+static void set_desired(Device *d, int i, const char *value) {
+    pthread_mutex_lock(&d->mutex);
+    free(d->instance.twins[i].observedDesired.value);
+    d->instance.twins[i].observedDesired.value = strdup(value);
+    pthread_mutex_unlock(&d->mutex);
+}
+
+int main(void) {
+    driver_register(&regs_driver);
+
+    ModelProperty mp[2] = {
+        { .name = "switch", .dataType = "boolean" },
+        { .name = "setpoint", .dataType = "float" },
+    };
+    DeviceModel model = { .name = "regs-model", .properties = mp, .propertiesCount = 2 };
+    DeviceProperty props[2] = {
+        { .name = "switch", .visitors = "{\"register\":\"CoilRegister\",\"offset\":3}" },
+        { .name = "setpoint", .visitors = "{\"register\":\"HoldingRegister\",\"offset\":4}" },
+    };
+    Twin twins[2] = {
+        { .propertyName = "switch", .observedDesired = { .value = "1" } },
+        { .propertyName = "setpoint", .observedDesired = { .value = "25.5" } },
+    };
+    DeviceInstance instance = {
+        .name = "regs-device",
+        .pProtocol = { .protocolName = "test-regs" },
+        .properties = props, .propertiesCount = 2,
+        .twins = twins, .twinsCount = 2,
+    };
+    Device *d = device_new(&instance, &model);
+    CHECK(d);
+
+    // 首次下发，reported 回填驱动实际写入的值
+    CHECK(write_round(d) == 2);
+    CHECK(strcmp(d->instance.twins[0].reported.value, "true") == 0);
+    CHECK(strcmp(d->instance.twins[1].reported.value, "26") == 0);
+
+    // 读回与回填一致，desired 未变则不再下发
+    for (int round = 0; round < 3; round++) {
+        read_round(d);
+        CHECK(write_round(d) == 0);
+    }
+
+    // 设备上的值被外部改掉后重新下发
+    g_regs[4] = 30;
+    read_round(d);
+    CHECK(write_round(d) == 1);
+    CHECK(g_regs[4] == 26);
+
+    // 新 desired 与读回值按类型相同（true 与 1、26.0 与 26）时不下发
+    read_round(d);
+    set_desired(d, 0, "true");
+    set_desired(d, 1, "26.0");
+    CHECK(write_round(d) == 0);
+
+    // 已生效的 desired 按文本比较：两个 FNV-1a 哈希相同的值也要各自下发
+    set_desired(d, 1, "40189.5");
+    CHECK(write_round(d) == 1);
+    CHECK(g_regs[4] == 40190);
+    set_desired(d, 1, "797186.5");
+    CHECK(write_round(d) == 1);
+    CHECK(g_regs[4] == 797187);
+
+    device_free(d);
+    epoch_reclaim();
+    epoch_shutdown();
+    printf("twin_write_normalize: ok\n");
+    return 0;
+}
@@ -0,0 +1,39 @@
+// 移除设备时清掉它的历史，不影响同名属性的其他设备
+#include "device/twinhistory.h"
+#include "data/publish/publisher.h"
+#include "tests/check.h"
+#include <stdio.h>
+
+Publisher *g_publisher = NULL;
+
+int main(void) {
+    twinhistory_init(16);
+    for (int i = 0; i < 100; i++) {
+        twinhistory_append("default", "gone", "temp", "21.5", 1000 + i);
+        twinhistory_append("default", "gone", "fan", "true", 1000 + i);
+        twinhistory_append("default", "kept", "temp", "22.5", 1000 + i);
+        twinhistory_append("other", "gone", "temp", "23.5", 1000 + i);
+    }
+
+    twinhistory_remove_device("default", "gone");
+
+    TwinHistorySlice slice;
+    CHECK(twinhistory_query("default", "gone", "temp", 0, 1LL << 60, 0, &slice) == -1);
+    CHECK(twinhistory_query("default", "gone", "fan", 0, 1LL << 60, 0, &slice) == -1);
+    CHECK(twinhistory_query("default", "kept", "temp", 0, 1LL << 60, 0, &slice) == 0);
+    CHECK(slice.count > 0 && slice.values[0] == 22.5);
+    twinhistory_slice_free(&slice);
+    CHECK(twinhistory_query("other", "gone", "temp", 0, 1LL << 60, 0, &slice) == 0);
+    CHECK(slice.count > 0 && slice.values[0] == 23.5);
+    twinhistory_slice_free(&slice);
+
+    // 同名设备重新加入后从空历史开始
+    twinhistory_append("default", "gone", "temp", "30", 5000);
+    CHECK(twinhistory_query("default", "gone", "temp", 0, 1LL << 60, 0, &slice) == 0);
+    CHECK(slice.count == 1 && slice.values[0] == 30.0);
+    twinhistory_slice_free(&slice);
+
+    twinhistory_shutdown();
+    printf("twinhistory_remove: ok\n");
+    return 0;
+}
@@ -166,7 +166,7 @@ int get_device_model_from_grpc(const V1beta1__DeviceModel *model, DeviceModel *o
     if (!model || !out) return -1;
     out->id = NULL; // 可根据需要拼接 namespace/name
     out->name = strdup_safe(model->name);
-    out->namespace_ = model->namespace_;
+    out->namespace_ = strdup_safe(model->namespace_);
     out->description = NULL;
     if (model->spec && model->spec->n_properties > 0) {
         out->propertiesCount = model->spec->n_properties;
@@ -191,12 +191,13 @@ int get_device_model_from_grpc(const V1beta1__DeviceModel *model, DeviceModel *o
 // 构建 DeviceInstance
 int get_device_from_grpc(const V1beta1__Device *device, const DeviceModel *commonModel, DeviceInstance *out) {
     if (!device || !out) return -1;
+    memset(out, 0, sizeof(*out));
     char *protocolName = NULL;
     get_protocol_name_from_grpc(device, &protocolName);
 
     out->id = NULL; // 可根据需要拼接 namespace/name
     out->name = strdup_safe(device->name);
-    out->namespace_ = device->namespace_;
+    out->namespace_ = strdup_safe(device->namespace_);
     if (protocolName) {
         out->protocolName = malloc(strlen(protocolName) + strlen(device->name) + 2);
         sprintf(out->protocolName, "%s-%s", protocolName, device->name);
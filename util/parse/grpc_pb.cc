@@ -0,0 +1,192 @@
+#include "util/parse/grpc_pb.h"
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cjson/cJSON.h>
+#include "log/log.h"
+#include "common/arena.h"
+#include "common/intern.h"
+
+static char *dup_str(const std::string &s) {
+    char *copy = (char*)std::malloc(s.size() + 1);
+    if (!copy) return nullptr;
+    std::memcpy(copy, s.data(), s.size());
+    copy[s.size()] = '\0';
+    return copy;
+}
+
+// CustomizedValue 的 Any 值按原始字节当作字符串；按 key 排序，保证同一配置生成相同 JSON
+static cJSON *customized_value_to_json(const v1beta1::CustomizedValue &value) {
+    cJSON *obj = cJSON_CreateObject();
+    std::vector<const std::string*> keys;
+    keys.reserve(value.data_size());
+    for (const auto &kv : value.data()) keys.push_back(&kv.first);
+    std::sort(keys.begin(), keys.end(),
+              [](const std::string *a, const std::string *b) { return *a < *b; });
+    for (const std::string *k : keys) {
+        cJSON_AddStringToObject(obj, k->c_str(), value.data().at(*k).value().c_str());
+    }
+    return obj;
+}
+
+static char *print_and_delete(cJSON *obj) {
+    char *json = cJSON_PrintUnformatted(obj);
+    cJSON_Delete(obj);
+    return json;
+}
+
+// 实例 spec 分配在 out->arena 中（同名字符串只存一份）；arena 创建失败时退回堆
+static char *spec_str(Arena *arena, const std::string &s) {
+    return arena ? arena_strdup(arena, s.c_str()) : dup_str(s);
+}
+
+// 跨设备重复的名字进全局驻留表（与 device.c 的 spec_name 一致，堆模式由 device_instance_clear 识别后不释放）
+static char *spec_name(Arena *arena, const std::string &s) {
+    const char *p = intern(s.c_str());
+    if (p) return (char*)p;
+    return spec_str(arena, s);
+}
+
+static char *spec_json(Arena *arena, cJSON *obj) {
+    char *json = print_and_delete(obj);
+    if (!arena || !json) return json;
+    char *copy = arena_strdup(arena, json);
+    std::free(json);
+    return copy;
+}
+
+static void *spec_calloc(Arena *arena, size_t n, size_t size) {
+    return arena ? arena_calloc(arena, n, size) : std::calloc(n, size);
+}
+
+int device_model_from_pb(const v1beta1::DeviceModel &model, DeviceModel *out) {
+    if (!out) return -1;
+    std::memset(out, 0, sizeof(*out));
+    out->name = dup_str(model.name());
+    out->namespace_ = dup_str(model.namespace_());
+    const int n = model.spec().properties_size();
+    if (n > 0) {
+        out->properties = (ModelProperty*)std::calloc(n, sizeof(ModelProperty));
+        if (!out->properties) return -1;
+        out->propertiesCount = n;
+        for (int i = 0; i < n; ++i) {
+            const auto &p = model.spec().properties(i);
+            ModelProperty *dst = &out->properties[i];
+            dst->name = dup_str(p.name());
+            dst->dataType = dup_str(p.type());
+            dst->description = dup_str(p.description());
+            dst->accessMode = dup_str(p.accessmode());
+            dst->minimum = dup_str(p.minimum());
+            dst->maximum = dup_str(p.maximum());
+            dst->unit = dup_str(p.unit());
+        }
+    }
+    return 0;
+}
+
+int device_instance_from_pb(const v1beta1::Device &device, const DeviceModel *commonModel,
+                            DeviceInstance *out) {
+    if (!out) return -1;
+    std::memset(out, 0, sizeof(*out));
+    Arena *arena = arena_new(0);
+    out->arena = arena;
+    const auto &spec = device.spec();
+    const bool hasProtocol = spec.has_protocol();
+    const std::string &protocolName = spec.protocol().protocolname();
+
+    out->name = spec_str(arena, device.name());
+    out->namespace_ = spec_name(arena, device.namespace_());
+    out->model = spec_name(arena, spec.devicemodelreference());
+    if (hasProtocol) {
+        out->protocolName = spec_str(arena, protocolName + "-" + device.name());
+        cJSON *customized = cJSON_CreateObject();
+        cJSON_AddStringToObject(customized, "protocolName", protocolName.c_str());
+        if (spec.protocol().has_configdata()) {
+            cJSON_AddItemToObject(customized, "configData",
+                                  customized_value_to_json(spec.protocol().configdata()));
+        }
+        out->pProtocol.protocolName = spec_name(arena, protocolName);
+        out->pProtocol.configData = spec_json(arena, customized);
+    } else {
+        log_error("device_instance_from_pb: protocol name not found (%s)", device.name().c_str());
+    }
+
+    // properties
+    const int np = spec.properties_size();
+    if (np > 0) {
+        out->properties = (DeviceProperty*)spec_calloc(arena, np, sizeof(DeviceProperty));
+        out->twins = (Twin*)spec_calloc(arena, np, sizeof(Twin));
+        if (!out->properties || !out->twins) return -1;
+        out->propertiesCount = np;
+        out->twinsCount = np;
+    }
+    for (int i = 0; i < np; ++i) {
+        const auto &p = spec.properties(i);
+        DeviceProperty *prop = &out->properties[i];
+        prop->name = spec_name(arena, p.name());
+        prop->propertyName = spec_name(arena, p.name());
+        prop->modelName = spec_name(arena, spec.devicemodelreference());
+        prop->collectCycle = p.collectcycle();
+        prop->reportCycle = p.reportcycle();
+        prop->reportToCloud = p.reporttocloud();
+        prop->protocol = hasProtocol ? spec_name(arena, protocolName) : nullptr;
+
+        cJSON *visitor = cJSON_CreateObject();
+        if (p.has_visitors()) {
+            cJSON_AddStringToObject(visitor, "protocolName", p.visitors().protocolname().c_str());
+            cJSON_AddItemToObject(visitor, "configData", customized_value_to_json(p.visitors().configdata()));
+        }
+        prop->visitors = spec_json(arena, visitor);
+
+        // twin 与 property 一一对应，直接关联到同下标
+        Twin *twin = &out->twins[i];
+        twin->propertyName = spec_name(arena, p.name());
+        twin->property = prop;
+        if (p.has_desired()) {
+            twin->observedDesired.value = dup_str(p.desired().value());
+            const auto &meta = p.desired().metadata();
+            auto ts = meta.find("timestamp");
+            if (ts != meta.end()) twin->observedDesired.metadata.timestamp = dup_str(ts->second);
+            auto type = meta.find("type");
+            if (type != meta.end()) twin->observedDesired.metadata.type = dup_str(type->second);
+        }
+        if (commonModel) {
+            for (int j = 0; j < commonModel->propertiesCount; ++j) {
+                if (commonModel->properties[j].name &&
+                    p.name() == commonModel->properties[j].name) {
+                    prop->pProperty = &commonModel->properties[j];
+                    break;
+                }
+            }
+        }
+    }
+
+    // methods
+    const int nm = spec.methods_size();
+    if (nm > 0) {
+        out->methods = (DeviceMethod*)spec_calloc(arena, nm, sizeof(DeviceMethod));
+        if (!out->methods) return -1;
+        out->methodsCount = nm;
+    }
+    for (int i = 0; i < nm; ++i) {
+        const auto &m = spec.methods(i);
+        DeviceMethod *dst = &out->methods[i];
+        dst->name = spec_str(arena, m.name());
+        dst->description = spec_str(arena, m.description());
+        const int nn = m.propertynames_size();
+        if (nn > 0) {
+            dst->propertyNames = (char**)spec_calloc(arena, nn, sizeof(char*));
+            if (!dst->propertyNames) return -1;
+            dst->propertyNamesCount = nn;
+            for (int j = 0; j < nn; ++j) dst->propertyNames[j] = spec_name(arena, m.propertynames(j));
+        }
+    }
+
+    if (device.has_status()) {
+        out->status.reportToCloud = device.status().reporttocloud();
+        out->status.reportCycle = device.status().reportcycle();
+    }
+    return 0;
+}
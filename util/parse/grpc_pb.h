@@ -0,0 +1,19 @@
+#ifndef UTIL_PARSE_GRPC_PB_H
+#define UTIL_PARSE_GRPC_PB_H
+
+// 直接从 C++ protobuf 对象构建 C 结构，不经过序列化 + protobuf-c 解包
+// 输出与 util/parse/grpc.h 中的 get_device_from_grpc / get_device_model_from_grpc 一致，
+// 所有字符串均为 out 自有，用 device_instance_clear / device_model_clear 释放；
+// 实例的 spec 数据分配在 out->arena 中，交给 device_new_move 时整块接管
+
+#include "dmi/v1beta1/api.pb.h"
+#include "common/configmaptype.h"
+
+// 构建 DeviceModel
+int device_model_from_pb(const v1beta1::DeviceModel &model, DeviceModel *out);
+
+// 构建 DeviceInstance；commonModel 非空时关联 property->pProperty
+int device_instance_from_pb(const v1beta1::Device &device, const DeviceModel *commonModel,
+                            DeviceInstance *out);
+
+#endif // UTIL_PARSE_GRPC_PB_H